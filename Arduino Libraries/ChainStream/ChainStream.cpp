@@ -0,0 +1,188 @@
+#include "ChainStream.h"
+#include <util/crc16.h>
+
+#define STREAM_HEADER_SIZE  10
+#define STREAM_RECORD_MAX   (4 + 4 + 1 + 1 + 8)
+#define STREAM_RAW_MAX      (STREAM_HEADER_SIZE + STREAM_BATCH_FRAMES * STREAM_RECORD_MAX + 2)
+/*COBS adds one code byte per 254 data bytes plus the leading one, then the 0x00 delimiter*/
+#define STREAM_TX_MAX       (STREAM_RAW_MAX + STREAM_RAW_MAX / 254 + 2)
+
+/*Batch currently being filled*/
+static byte _raw[STREAM_RAW_MAX];
+static byte _rawLen = 0;
+static byte _rawCount = 0;
+static unsigned long _rawOpened = 0;
+static unsigned long _lastMsg = 0;
+
+/*Encoded packet currently being handed to the serial port*/
+static byte _tx[STREAM_TX_MAX];
+static byte _txLen = 0;
+static byte _txPos = 0;
+
+static unsigned int _seq = 0;
+static unsigned int _dropped = 0;
+/*Set while a text line is being sent, packet bytes wait until its 0x00*/
+static bool _textOpen = false;
+
+StreamTextPrint streamText;
+
+static void putLong(byte *p, unsigned long v)
+{
+  p[0] = v & 0xFF;
+  p[1] = (v >> 8) & 0xFF;
+  p[2] = (v >> 16) & 0xFF;
+  p[3] = (v >> 24) & 0xFF;
+}
+
+/**COBS encodes len bytes of src into dst and appends the delimiter. Returns the encoded length*/
+static byte cobsEncode(const byte *src, byte len, byte *dst)
+{
+  byte out = 1;
+  byte codePos = 0;
+  byte code = 1;
+  for (byte i = 0; i < len; i++)
+  {
+    if (src[i] == 0)
+    {
+      dst[codePos] = code;
+      codePos = out++;
+      code = 1;
+    }
+    else
+    {
+      dst[out++] = src[i];
+      if (++code == 0xFF)
+      {
+        dst[codePos] = code;
+        codePos = out++;
+        code = 1;
+      }
+    }
+  }
+  dst[codePos] = code;
+  dst[out++] = 0x00;
+  return out;
+}
+
+/**Finishes the open batch and moves it to the TX buffer. Returns false while the previous packet is still being sent*/
+static bool closeBatch(void)
+{
+  if (_rawCount == 0) return true;
+  if (_txPos < _txLen) return false;
+
+  _raw[1] = _rawCount;
+  _raw[2] = _seq & 0xFF;
+  _raw[3] = (_seq >> 8) & 0xFF;
+  _raw[8] = _dropped & 0xFF;
+  _raw[9] = (_dropped >> 8) & 0xFF;
+  unsigned int crc = 0;
+  for (byte i = 0; i < _rawLen; i++)
+  {
+    crc = _crc_xmodem_update(crc, _raw[i]);
+  }
+  _raw[_rawLen++] = crc & 0xFF;
+  _raw[_rawLen++] = (crc >> 8) & 0xFF;
+
+  _txLen = cobsEncode(_raw, _rawLen, _tx);
+  _txPos = 0;
+  _seq++;
+  _rawLen = 0;
+  _rawCount = 0;
+  return true;
+}
+
+void streamBegin(void)
+{
+  Serial.begin(STREAM_BAUD);
+  _rawLen = 0;
+  _rawCount = 0;
+  _txLen = 0;
+  _txPos = 0;
+  _seq = 0;
+  _dropped = 0;
+}
+
+bool streamFrame(unsigned long msgNum, unsigned long timeUs, unsigned long id, byte ide, byte rtr, byte dlc, const byte *data)
+{
+  //A batch is closed when it is full or when the Msg# step no longer fits in a byte
+  if ((_rawCount == STREAM_BATCH_FRAMES || (_rawCount > 0 && msgNum - _lastMsg > 255)) && !closeBatch())
+  {
+    _dropped++;
+    return false;
+  }
+  if (dlc > 8) dlc = 8;
+  if (_rawCount == 0)
+  {
+    _raw[0] = STREAM_VERSION;
+    putLong(&_raw[4], msgNum);
+    _lastMsg = msgNum;
+    _rawLen = STREAM_HEADER_SIZE;
+    _rawOpened = millis();
+  }
+  if (ide) id |= STREAM_ID_EXTENDED;
+  if (rtr) id |= STREAM_ID_RTR;
+  putLong(&_raw[_rawLen], timeUs);
+  putLong(&_raw[_rawLen + 4], id);
+  _raw[_rawLen + 8] = msgNum - _lastMsg;
+  _raw[_rawLen + 9] = dlc;
+  _rawLen += 10;
+  _lastMsg = msgNum;
+  for (byte i = 0; i < dlc; i++)
+  {
+    _raw[_rawLen++] = data[i];
+  }
+  _rawCount++;
+  if (_rawCount == STREAM_BATCH_FRAMES) closeBatch();
+  return true;
+}
+
+bool streamReady(void)
+{
+  return _rawCount < STREAM_BATCH_FRAMES || _txPos == _txLen;
+}
+
+void streamService(void)
+{
+  if (_rawCount > 0 && (millis() - _rawOpened) >= STREAM_FLUSH_MS)
+  {
+    closeBatch();
+  }
+  if (_textOpen) return;
+  //Only hand over what fits, so the CAN loop never waits on the UART
+  int room = Serial.availableForWrite();
+  while (room > 0 && _txPos < _txLen)
+  {
+    Serial.write(_tx[_txPos++]);
+    room--;
+  }
+  if (_txPos == _txLen && _rawCount == STREAM_BATCH_FRAMES)
+  {
+    closeBatch();
+  }
+}
+
+unsigned int streamDropped(void)
+{
+  return _dropped;
+}
+
+size_t StreamTextPrint::write(uint8_t c)
+{
+  if (c == 0) return 0;
+  if (!_textOpen)
+  {
+    //The packet being sent is finished first, text must not land inside it
+    while (_txPos < _txLen)
+    {
+      Serial.write(_tx[_txPos++]);
+    }
+    _textOpen = true;
+  }
+  Serial.write(c);
+  if (c == '\n')
+  {
+    Serial.write((byte)0);
+    _textOpen = false;
+  }
+  return 1;
+}
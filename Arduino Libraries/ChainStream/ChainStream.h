@@ -0,0 +1,68 @@
+/*
+  ChainStream.h - Framed binary streaming of CAN frames over the USB-serial link
+
+  Frames are collected in batches and sent as a single packet:
+
+    offset  size  field
+    0       1     version (STREAM_VERSION)
+    1       1     number of records in the batch
+    2       2     packet sequence number, incremented for every packet
+    4       4     Msg# of the first record (same counter as the SD logs)
+    8       2     frames dropped on the device so far (wraps)
+    10      ...   records: timestamp us (4), id (4), Msg# step (1), dlc (1), data (dlc)
+    end     2     CRC-16/XMODEM over everything above
+
+  All multi byte values are little endian. Bit 31 of the id marks an extended
+  frame and bit 30 a remote request. The Msg# step is the distance to the
+  previous record's Msg# (0 for the first one), so decimated feeds keep their
+  original numbering. The packet is COBS encoded and terminated
+  by a 0x00 byte, so the receiver can resynchronise on any zero byte.
+
+  Status text shares the port: lines printed through streamText are sent
+  between packets, each ended by its own 0x00, so the receiver sees them as
+  records of printable characters (a packet always holds the 0x01 version
+  byte) instead of garbage in front of the next packet.
+
+  Used by ChainLogger_no_S_on_Serial (every frame) and by the live feed of
+  ChainLogger_no_S_mega_NuovaLib. The host side decoder lives in
+  ChainTools/ChainStream.cpp.
+*/
+
+#ifndef ChainStream_h
+#define ChainStream_h
+
+#include "Arduino.h"
+
+#define STREAM_BAUD          1000000
+#define STREAM_VERSION       1
+/*Records per packet before the batch is closed*/
+#define STREAM_BATCH_FRAMES  8
+/*Maximum time a record may wait in an open batch*/
+#define STREAM_FLUSH_MS      5
+
+#define STREAM_ID_EXTENDED   0x80000000UL
+#define STREAM_ID_RTR        0x40000000UL
+
+/**Opens the serial port at STREAM_BAUD and resets the packet state*/
+void streamBegin(void);
+/**Appends one frame to the open batch. Returns false if the frame had to be dropped*/
+bool streamFrame(unsigned long msgNum, unsigned long timeUs, unsigned long id, byte ide, byte rtr, byte dlc, const byte *data);
+/**True if streamFrame() would accept a frame right now*/
+bool streamReady(void);
+/**Closes stale batches and moves pending bytes into the serial TX buffer without blocking. Call from loop()*/
+void streamService(void);
+/**Number of frames dropped because both packet buffers were busy*/
+unsigned int streamDropped(void);
+
+/**Print that sends text lines as 0x00 delimited records between packets*/
+class StreamTextPrint : public Print
+{
+  public:
+    virtual size_t write(uint8_t c);
+    using Print::write;
+};
+
+/**All text on Serial goes through this while the live feed runs*/
+extern StreamTextPrint streamText;
+
+#endif
@@ -0,0 +1,112 @@
+#include "AnalogSampler.h"
+
+#define ANALOG_RING_MASK  (ANALOG_RING_SIZE - 1)
+/*Timer1 runs at F_CPU / 64*/
+#define ANALOG_TIMER_HZ   (F_CPU / 64)
+/*Shortest trigger period in Timer1 ticks: an auto triggered conversion takes 13.5 ADC clocks of 128 CPU cycles*/
+#define ANALOG_MIN_TOP    ((14UL * 128 + 63) / 64)
+
+static byte _channels[ANALOG_MAX_CHANNELS];
+static byte _count = 0;
+static volatile byte _index = 0;
+static unsigned long _scanStart = 0;
+
+static AnalogScan _ring[ANALOG_RING_SIZE];
+static volatile byte _head = 0;
+static volatile byte _tail = 0;
+static volatile unsigned long _overruns = 0;
+
+/**Routes the ADC multiplexer to channel; takes effect for the next conversion*/
+static inline void selectChannel(byte channel)
+{
+  ADMUX = _BV(REFS0) | (channel & 0x07);
+  // trigger source: Timer/Counter1 Compare Match B
+  byte adcsrb = _BV(ADTS2) | _BV(ADTS0);
+#ifdef MUX5
+  if (channel & 0x08) adcsrb |= _BV(MUX5);
+#endif
+  ADCSRB = adcsrb;
+}
+
+bool analogBegin(const byte *channels, byte count, unsigned int scanHz)
+{
+  if (count == 0 || count > ANALOG_MAX_CHANNELS || scanHz == 0) return false;
+  unsigned long top = ANALOG_TIMER_HZ / ((unsigned long)scanHz * count);
+  // A trigger during a conversion is lost without notice, so the period must cover one
+  if (top < ANALOG_MIN_TOP || top > 65536UL) return false;
+
+  analogEnd();
+  for (byte i = 0; i < count; i++)
+  {
+    _channels[i] = channels[i];
+  }
+  _count = count;
+  _index = 0;
+  _head = 0;
+  _tail = 0;
+  _overruns = 0;
+
+  // Timer1 in CTC mode, clk/64, compare B at the top so it fires once per period
+  TCCR1A = 0;
+  TCCR1B = 0;
+  TCNT1 = 0;
+  OCR1A = top - 1;
+  OCR1B = top - 1;
+  TIFR1 = _BV(OCF1B);
+  selectChannel(_channels[0]);
+  // ADC on, auto trigger, interrupt on completion, clk/128 (125 kHz, ~104 us per conversion)
+  ADCSRA = _BV(ADEN) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+  TCCR1B = _BV(WGM12) | _BV(CS11) | _BV(CS10);
+  return true;
+}
+
+void analogEnd(void)
+{
+  TCCR1B = 0;
+  ADCSRA = 0;
+}
+
+bool analogNext(AnalogScan &scan)
+{
+  byte tail = _tail;
+  if (tail == _head) return false;
+  scan = _ring[tail];
+  _tail = (tail + 1) & ANALOG_RING_MASK;
+  return true;
+}
+
+unsigned long analogOverruns(void)
+{
+  noInterrupts();
+  unsigned long overruns = _overruns;
+  interrupts();
+  return overruns;
+}
+
+ISR(ADC_vect)
+{
+  unsigned int value = ADC;
+  // The trigger fires on the rising edge of OCF1B, clear it for the next period
+  TIFR1 = _BV(OCF1B);
+
+  byte index = _index;
+  byte head = _head;
+  if (index == 0) _scanStart = micros();
+  _ring[head].value[index] = value;
+  if (++index == _count)
+  {
+    index = 0;
+    byte next = (head + 1) & ANALOG_RING_MASK;
+    if (next == _tail)
+    {
+      _overruns++;
+    }
+    else
+    {
+      _ring[head].timeUs = _scanStart;
+      _head = next;
+    }
+  }
+  _index = index;
+  selectChannel(_channels[index]);
+}
@@ -0,0 +1,39 @@
+/*
+  AnalogSampler.h - Free running, timer triggered sampling of the analog inputs
+
+  Timer1 (CTC mode) triggers the ADC through its auto trigger input, one
+  conversion per trigger; the ADC complete interrupt stores the result and
+  selects the next channel of the list. A complete scan of all channels is
+  queued together with its micros() timestamp, the same clock the CAN frames
+  are stamped with. Nothing here waits on the ADC and the sample rate no
+  longer depends on bus load.
+
+  Written for the ATmega2560 (channels 0..15, MUX5 in ADCSRB).
+*/
+
+#ifndef AnalogSampler_h
+#define AnalogSampler_h
+
+#include "Arduino.h"
+
+#define ANALOG_MAX_CHANNELS  8
+/*Completed scans buffered between the ADC interrupt and loop(), power of two*/
+#define ANALOG_RING_SIZE     8
+
+typedef struct
+{
+  unsigned long timeUs;                       // micros() at the start of the scan
+  unsigned int value[ANALOG_MAX_CHANNELS];    // one result per configured channel
+} AnalogScan;
+
+/**Starts sampling count channels (ADC channel numbers, e.g. 8 for A8), each at scanHz. Returns false on a bad
+   configuration, including one that would trigger conversions faster than the ADC completes them (~104 us each)*/
+bool analogBegin(const byte *channels, byte count, unsigned int scanHz);
+/**Stops the timer and the ADC*/
+void analogEnd(void);
+/**Copies the oldest completed scan into scan. Returns false if none is waiting*/
+bool analogNext(AnalogScan &scan);
+/**Scans lost because loop() did not collect them in time*/
+unsigned long analogOverruns(void);
+
+#endif
@@ -0,0 +1,130 @@
+#include "CaptureQueue.h"
+
+#define CAPTURE_MASK (CAPTURE_QUEUE_SIZE - 1)
+
+static CapturedFrame _queue[CAPTURE_QUEUE_SIZE];
+/*Write position, only ever incremented; slot = position & CAPTURE_MASK*/
+static unsigned int _head = 0;
+static CaptureSink *_sinks[CAPTURE_MAX_SINKS];
+static byte _sinkCount = 0;
+
+bool captureAddSink(CaptureSink *sink)
+{
+  if (_sinkCount == CAPTURE_MAX_SINKS) return false;
+  if (sink->every == 0) sink->every = 1;
+  sink->position = _head;
+  sink->phase = 0;
+  sink->delivered = 0;
+  sink->dropped = 0;
+  sink->decimated = 0;
+  _sinks[_sinkCount++] = sink;
+  return true;
+}
+
+/**Moves a sink past count frames it will not write; those its decimation would have passed over anyway are not lost*/
+static void skipFrames(CaptureSink *sink, unsigned int count)
+{
+  unsigned int lost = (sink->phase + count) / sink->every;
+  sink->phase = (sink->phase + count) % sink->every;
+  sink->position += count;
+  sink->dropped += lost;
+  sink->decimated += count - lost;
+}
+
+void captureFrame(const Frame &frame, unsigned long msgNum)
+{
+  captureFrameAt(frame, msgNum, micros());
+}
+
+void captureFrameAt(const Frame &frame, unsigned long msgNum, unsigned long timeUs)
+{
+  // A sink that is a full lap behind is about to lose its oldest frame
+  for (byte s = 0; s < _sinkCount; s++)
+  {
+    CaptureSink *sink = _sinks[s];
+    if ((unsigned int)(_head - sink->position) >= CAPTURE_QUEUE_SIZE)
+    {
+      skipFrames(sink, 1);
+    }
+  }
+  CapturedFrame &slot = _queue[_head & CAPTURE_MASK];
+  slot.msgNum = msgNum;
+  slot.timeUs = timeUs;
+  slot.frame = frame;
+  _head++;
+}
+
+/**Delivers up to budget frames to one sink. Returns the number of frames still pending*/
+static unsigned int serviceSink(CaptureSink *sink, unsigned int budget)
+{
+  unsigned int pending = _head - sink->position;
+  if (sink->policy == SINK_SKIP_TO_LIVE && pending > sink->behindLimit)
+  {
+    skipFrames(sink, pending - 1);
+    pending = 1;
+  }
+  while (pending > 0 && budget > 0)
+  {
+    if (sink->ready != NULL && !sink->ready()) break;
+    const CapturedFrame &captured = _queue[sink->position & CAPTURE_MASK];
+    sink->position++;
+    pending--;
+    if (++sink->phase >= sink->every)
+    {
+      sink->phase = 0;
+      sink->write(captured);
+      sink->delivered++;
+      budget--;
+    }
+    else
+    {
+      sink->decimated++;
+    }
+  }
+  return pending;
+}
+
+void captureService(void)
+{
+  for (byte s = 0; s < _sinkCount; s++)
+  {
+    serviceSink(_sinks[s], CAPTURE_SINK_BUDGET);
+  }
+}
+
+bool captureIdle(void)
+{
+  for (byte s = 0; s < _sinkCount; s++)
+  {
+    if (_sinks[s]->position != _head) return false;
+  }
+  return true;
+}
+
+void captureDrain(void)
+{
+  for (byte s = 0; s < _sinkCount; s++)
+  {
+    // A sink that never gets ready is left behind rather than hanging the logger
+    unsigned long start = millis();
+    while (serviceSink(_sinks[s], CAPTURE_QUEUE_SIZE) > 0 && (millis() - start) < 1000)
+    {
+      ;
+    }
+  }
+}
+
+void captureReport(Print &out)
+{
+  for (byte s = 0; s < _sinkCount; s++)
+  {
+    out.print("sink ");
+    out.print(_sinks[s]->name);
+    out.print(": delivered ");
+    out.print(_sinks[s]->delivered);
+    out.print(", dropped ");
+    out.print(_sinks[s]->dropped);
+    out.print(", decimated ");
+    out.println(_sinks[s]->decimated);
+  }
+}
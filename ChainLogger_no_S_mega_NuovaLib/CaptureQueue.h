@@ -0,0 +1,76 @@
+/*
+  CaptureQueue.h - Single capture queue fanned out to several output sinks
+
+  The RX path only copies each frame into the queue (captureFrame). Every
+  registered sink (SD file, live serial feed, statistics, ...) keeps its own
+  read position and is drained from loop() by captureService(), so a sink
+  that falls behind only loses its own frames, not those of the others.
+  The MCP2515 is polled from the same loop(), so whatever a sink's write()
+  costs delays reception: sinks keep it bounded through ready() (the live
+  feed waits for a free packet buffer, the SD sink allows one block write
+  per pass) and CAPTURE_SINK_BUDGET frames per call.
+
+  What a sink loses when it falls behind is decided by its policy:
+    SINK_DROP_OLDEST   - keep reading in order; when the writer laps the sink
+                         the oldest unread frames are skipped (SD logging)
+    SINK_SKIP_TO_LIVE  - once more than behindLimit frames are pending, jump to
+                         the newest frame and skip the backlog (live feeds)
+  A sink can also take only every Nth frame (decimation); frames passed over
+  by it are counted as decimated, not as dropped.
+*/
+
+#ifndef CaptureQueue_h
+#define CaptureQueue_h
+
+#include "Arduino.h"
+#include "MCP2515_defs.h"
+
+/*Number of frames buffered between the RX path and the slowest sink, power of two*/
+#define CAPTURE_QUEUE_SIZE   32
+#define CAPTURE_MAX_SINKS    4
+/*Frames a single sink may handle per captureService() call*/
+#define CAPTURE_SINK_BUDGET  4
+
+#define SINK_DROP_OLDEST     0
+#define SINK_SKIP_TO_LIVE    1
+
+typedef struct
+{
+  unsigned long msgNum;       // Msg# column
+  unsigned long timeUs;       // micros() at reception; sinks derive the Time Diff column from it
+  Frame frame;
+} CapturedFrame;
+
+typedef struct
+{
+  const char *name;
+  byte policy;                // SINK_DROP_OLDEST or SINK_SKIP_TO_LIVE
+  byte every;                 // deliver every Nth frame, 1 = all
+  unsigned int behindLimit;   // used by SINK_SKIP_TO_LIVE
+  bool (*ready)(void);        // true if write() would not block, NULL = always
+  void (*write)(const CapturedFrame &captured);
+
+  // maintained by the queue
+  unsigned int position;
+  byte phase;
+  unsigned long delivered;
+  unsigned long dropped;
+  unsigned long decimated;
+} CaptureSink;
+
+/**Registers a sink; it starts at the current write position. Returns false if all slots are used*/
+bool captureAddSink(CaptureSink *sink);
+/**Copies one frame into the queue, stamped with micros(). Never blocks*/
+void captureFrame(const Frame &frame, unsigned long msgNum);
+/**Same as captureFrame for records sampled earlier, e.g. analog scans, stamped with their own micros() time*/
+void captureFrameAt(const Frame &frame, unsigned long msgNum, unsigned long timeUs);
+/**Lets every sink consume up to CAPTURE_SINK_BUDGET frames*/
+void captureService(void);
+/**True if every sink has consumed everything queued so far*/
+bool captureIdle(void);
+/**Drains all sinks completely (used before closing files)*/
+void captureDrain(void);
+/**Prints delivered/dropped/decimated counters of every sink to out*/
+void captureReport(Print &out);
+
+#endif
@@ -1,6 +1,11 @@
 #include <SD.h>
 #include <SPI.h>
 #include <MCP2515.h>
+#include "CaptureQueue.h"
+#include <ChainStream.h>
+#include "RxRules.h"
+#include "SessionFiles.h"
+#include "AnalogSampler.h"
 
 /*#include "LINX_Config.h"
 #include "LINX_Devices.h"
@@ -36,6 +41,21 @@ const int LIGHT_SD       = 7;
 /* CAN_INTERRUPT assigned to pin 2*/
 const int CAN_INTERRUPT_PIN    = 2;
 
+/*Buffer full capture mode: the MCP2515 RX0BF/RX1BF pins (not routed on the Sparkfun shield, wire them by hand)
+ drive two external interrupts, so each frame is read straight from the buffer that signalled it. This saves the
+ CANINTF read and the flag reset per frame; the INT pin then only reports errors. The mode takes the receive
+ interrupts off the INT pin, so a stock shield would log nothing: it is only on when BUFFER_FULL_PINS_WIRED is
+ defined for a board with the pins wired.*/
+#ifdef BUFFER_FULL_PINS_WIRED
+const boolean BUFFER_FULL_PINS = true;
+#else
+const boolean BUFFER_FULL_PINS = false;
+#endif
+/* RX0BF assigned to pin 3 (INT5 on the Mega)*/
+const int RX0BF_PIN    = 3;
+/* RX1BF assigned to pin 18 (INT3 on the Mega)*/
+const int RX1BF_PIN    = 18;
+
 /*MCP2515 CONFIG state: Enables mask configuration etc.*/
 const byte MCP2515_CONFIG = 0x80;
 /*MCP2515 LISTEN_ONLY state: Receives messages but does not send any*/
@@ -47,12 +67,10 @@ const byte MCP2515_SLEEP  = 0x20;
 /*MCP2515 NORMAL state: Participates as a regular node in the CAN network*/
 const byte MCP2515_NORMAL = 0x00;
 
-/*File name of log file*/
-char fileName[]     = "DATA00.txt";
 /**Column headers for logged data*/
 char header[]       = "Msg#,Time Diff, ID,DLC, Data";
-/*File objet used to access the SD card*/
-File myFile;
+/*Set once the current idle gap has been handled, cleared by the next message*/
+boolean sessionIdle = false;
 
 /*Object to interact with the MCP2515 directly*/
 MCP2515 CAN( CAN_CHIP_SELECT, CAN_INTERRUPT_PIN);
@@ -62,10 +80,13 @@ Frame message0;
 Frame message1;
 /* CAN message frame exposed by the potsFrame */
 Frame potsFrame;
+/*Analog inputs sampled by AnalogSampler: ADC channel numbers (8 = A8), scan rate and the ID of the emitted records*/
+const byte ANALOG_CHANNELS[] = { 8, 9, 10, 11 };
+const unsigned int ANALOG_SCAN_HZ = 100;
+const unsigned long ANALOG_FRAME_ID = 0x110;
 //Various helper variables
 int counter = 0;
 int msgCount = 0;
-int pots[4];
 
 /*Time at which the last message was received*/
 unsigned long timeLastMessageReceived = 0;
@@ -76,12 +97,50 @@ unsigned long timeDifference = 0;
 boolean KEEPGOING = true;
 /*Byte generale che è bene portasse in giro */
 byte interruptFlags;
+/*RX0IF/RX1IF bits set by the buffer full pin interrupts*/
+volatile byte rxBuffersFull = 0;
 byte mask;
 const byte INTERRUPT_RESET = B00000000;
 
 /*Variable for temporary message assembly*/
 String tmpMessage;
 
+/*SD sink: log lines are assembled here and written a block at a time*/
+const int SD_BUFFER_SIZE = 512;
+/*Longest line: "4294967295,4294967295,1FFFFFFF,15," + 15 * "XX " + CR LF*/
+const int SD_LINE_MAX = 96;
+/*The SD file is flushed at most this often instead of after every frame*/
+const unsigned long SD_FLUSH_MS = 1000;
+char sdBuffer[SD_BUFFER_SIZE];
+int sdBufferUsed = 0;
+unsigned long sdLastFlush = 0;
+/*Block writes (or flushes) the SD sink may still do in this serviceSinks() pass, so the card never holds off reception for
+ more than one block between two polls of the MCP2515*/
+byte sdBlockBudget = 0;
+/*Time Diff state: micros() of the last record written and the part of a ms it carried over*/
+boolean sdHaveTime = false;
+unsigned long sdLastUs = 0;
+unsigned long sdCarryUs = 0;
+
+/*Live serial feed: only every LIVE_DECIMATION-th frame is streamed to the host*/
+const byte LIVE_DECIMATION = 10;
+/*Statistics: frame/byte counters and a report on Serial every STATS_PERIOD_MS*/
+const unsigned long STATS_PERIOD_MS = 10000;
+unsigned long statsFrames = 0;
+unsigned long statsBytes = 0;
+unsigned long statsLastReport = 0;
+
+bool sdSinkReady(void);
+void sdSinkWrite(const CapturedFrame &captured);
+bool serialSinkReady(void);
+void serialSinkWrite(const CapturedFrame &captured);
+void statsSinkWrite(const CapturedFrame &captured);
+
+/*Every captured frame is fanned out to these sinks, each with its own position and drop policy*/
+CaptureSink sdSink     = { "SD",     SINK_DROP_OLDEST,  1,               0, sdSinkReady,     sdSinkWrite };
+CaptureSink serialSink = { "serial", SINK_SKIP_TO_LIVE, LIVE_DECIMATION, 8, serialSinkReady, serialSinkWrite };
+CaptureSink statsSink  = { "stats",  SINK_DROP_OLDEST,  1,               0, NULL,            statsSinkWrite };
+
 /**Debug variable controls whether or not debug/status information will bewritten to the serial console. Setting DEBUG to true has a negative performance impact.*/
 // boolean DEBUG = true;
 
@@ -98,14 +157,19 @@ void setup()
   pinMode(LIGHT_SD, OUTPUT);
   pinMode(LIGHT_CAN, OUTPUT);
   boolean setupSuccess = true;
-  Serial.begin(115200);
-  Serial.println("Setup");
+  streamBegin();
+  streamText.println("Setup");
   pinMode(10, OUTPUT);
   pinMode(9, OUTPUT);
   //sd
   CAN.initSPI();
   setupSuccess = CAN.initSD();
-  if (setupSuccess) preparaSD();
+  if (setupSuccess)
+  {
+    preparaSD();
+    streamText.print("Rules: ");
+    streamText.println(rxRulesLoad(RULES_FILE));
+  }
   delay(100);
 
   //can
@@ -117,7 +181,18 @@ void setup()
     {
       CAN.displayCanStatus();
     }
-    Serial.println("log start");
+    captureAddSink(&sdSink);
+    captureAddSink(&serialSink);
+    captureAddSink(&statsSink);
+    if (BUFFER_FULL_PINS == true)
+    {
+      initBufferFullPins();
+    }
+    if (!analogBegin(ANALOG_CHANNELS, sizeof(ANALOG_CHANNELS), ANALOG_SCAN_HZ))
+    {
+      streamText.println("Analog config invalid");
+    }
+    streamText.println("log start");
   }
 
 
@@ -137,10 +212,10 @@ void loop()
     {
       tmpMessage = String("loop:timeDifference = ");
       tmpMessage.concat( timeDifference );
-      Serial.println( tmpMessage );
+      streamText.println( tmpMessage );
     }
-    /*After a inital message has been received, the program will shutdown afte 10 sec of idle time*/
-    if ( ((timeLastMessageReceived != 0)) && ( timeDifference > 10000))
+    /*After a inital message has been received, an idle gap ends the session and logging continues in the next file*/
+    if ( ((timeLastMessageReceived != 0)) && ( timeDifference > SESSION_IDLE_MS) && (sessionIdle == false))
     {
       if ( DEBUG == true)
       {
@@ -148,46 +223,68 @@ void loop()
         tmpMessage.concat( timeDifference );
         tmpMessage.concat(", timeLastMessageReceived= ");
         tmpMessage.concat( timeLastMessageReceived );
-        Serial.println( tmpMessage);
+        streamText.println( tmpMessage);
       }
-      //Close file
-      myFile.close();
-      KEEPGOING = false;
+      //Hand everything still queued to the sinks, then switch file
+      drainSinks();
+      sessionRotate();
+      captureReport(streamText);
+      streamText.print("Logging to ");
+      streamText.println(sessionFileName());
+      sessionIdle = true;
     }
     else
     {
       //continue
     }
 
-    interruptFlags = CAN.Read(CANINTF);
+    if (BUFFER_FULL_PINS == false)
+    {
+      interruptFlags = CAN.Read(CANINTF);
+    }
     if ( DEBUG == true)
     {
-      Serial.println(interruptFlags, BIN);
-      Serial.println("interrupt flags OK");
-      Serial.println("Waiting for interrrupt");
+      streamText.println(interruptFlags, BIN);
+      streamText.println("interrupt flags OK");
+      streamText.println("Waiting for interrrupt");
     }
     //Wait a maximum of 10 seconds for the next message
     unsigned long start_wait_time = millis();
-    while (  (KEEPGOING == true) && (! CAN.Interrupt()) && ( ! CAN.hasTimeElapsed(start_wait_time, 10000 )) )
+    while (  (KEEPGOING == true) && (rxBuffersFull == 0) && (! CAN.Interrupt()) && ( ! CAN.hasTimeElapsed(start_wait_time, 10000 )) )
     {
-      ;
+      serviceSinks();
+    }
+
+    if (rxBuffersFull != 0)
+    {
+      checkBuffersFull();
     }
 
     // This implementation utilizes the MCP2515 INT pin to flag received messages
     if (CAN.Interrupt())
     {
-      checkCanRx0();
-      checkCanRx1();
+      if (BUFFER_FULL_PINS == true)
+      {
+        //RXnIF is still set here for a frame the RXnBF path reads, so only the TX and error flags are handled
+        interruptFlags = CAN.Read(CANINTF);
+      }
+      else
+      {
+        checkCanRx0();
+        checkCanRx1();
+      }
       checkCanTx0();
       checkCanTx1();
       checkCanTx2();
       checkCanErr0();
       checkCanErr1();
-      readPots();
     }
+    serviceSinks();
   }  // end while loop
-  Serial.println("Program complete!");
-  Serial.println("Waiting for reset...");
+  drainSinks();
+  sessionEnd();
+  streamText.println("Program complete!");
+  streamText.println("Waiting for reset...");
   /* myFile = SD.open(fileName);
    if (myFile) {
    Serial.println(fileName);
@@ -219,115 +316,198 @@ void loop()
 
 void preparaSD(void) {
 
-  //Find the next available file name to prevent overwriting previously recorded sessions.
-  Serial.print("Checking file name: ");
-  Serial.println(fileName);
-  boolean fileExists = SD.exists( fileName );
-  Serial.flush();
-  //If the file exists change the name until a new one is created
-  if ( fileExists == true )
-  {
-    for (uint8_t i = 0; i < 100; i++)
-    {
-      fileName[4] = i / 10 + '0';
-      fileName[5] = i % 10 + '0';
-      Serial.print("Checking file name: ");
-      Serial.println(fileName);
-      fileExists = SD.exists( fileName );
-      Serial.flush();
-      Serial.println("");
-      if (fileExists == false )
-      {
-        break;
-      }
-    }
-  }
-  else
-  {
-    //file does not exist yet -> create it
-  }
-  Serial.flush();
-  //Open file and get ready to enter data
+  //The next file number comes from the counter in EEPROM, no scan over existing files
   unsigned short int j = 0;
-  while (!myFile) {
+  while (!sessionBegin(header) && j < 10) {
     delay(100);
-    myFile = SD.open(fileName, FILE_WRITE);
-    Serial.print("Try #");
-    Serial.println((int)j++);
+    streamText.print("Try #");
+    streamText.println((int)j++);
     Serial.flush();
   }
-  if (myFile) {
-    Serial.println("Esi il fle txt:");
-    myFile.println(header);
-    myFile.flush();
-    // close the file:
+  if (j < 10) {
+    streamText.print("Logging to ");
+    streamText.println(sessionFileName());
   }
   else {
     // if the file didn't open, print an error:
-    Serial.println("NO");
+    streamText.println("NO");
   }
 }
 
-void print_hex(int v, int num_places)
+/**Queues the received message for the sinks. Formatting and all file/serial I/O happen later in ``serviceSinks''
+ */
+void processMessage( Frame& message )
 {
-  int mask = 0, n, num_nibbles, digit;
+  digitalWrite(LIGHT_CAN, HIGH);
 
-  for (n = 1; n <= num_places; n++)
+  //current time
+  timeLastMessageReceived = millis();
+  sessionIdle = false;
+
+  if (message.id > 0)
   {
-    mask = (mask << 1) | 0x0001;
+    if (DEBUG == true)
+    {
+      streamText.println(message.id, HEX);
+    }
+    captureFrame(message, msgCount++);
   }
-  v = v & mask; // truncate v to specified number of places
+  digitalWrite(LIGHT_CAN, LOW);
+
+}
 
-  num_nibbles = num_places / 4;
-  if ((num_places % 4) != 0)
+/**Lets the sinks consume queued frames and runs their periodic work*/
+void serviceSinks(void)
+{
+  sdBlockBudget = 1;
+  readPots();
+  captureService();
+  //Keeps the next file open ahead even under sustained load, so a rotation in the SD sink only swaps files
+  sessionService(millis() - timeLastMessageReceived);
+  streamService();
+  unsigned long now = millis();
+  if (now - sdLastFlush >= SD_FLUSH_MS && sdBlockBudget > 0)
   {
-    ++num_nibbles;
+    sdSinkFlush();
+    sdBlockBudget = 0;
+    sdLastFlush = now;
   }
+  if (now - statsLastReport >= STATS_PERIOD_MS)
+  {
+    statsLastReport = now;
+    streamText.print("frames ");
+    streamText.print(statsFrames);
+    streamText.print(", bytes ");
+    streamText.print(statsBytes);
+    streamText.print(", rule drops ");
+    streamText.print(rxRulesDropped());
+    streamText.print(", analog overruns ");
+    streamText.println(analogOverruns());
+    captureReport(streamText);
+  }
+}
 
+/**Hands everything still queued to the sinks before a file is closed; the SD sink may write as many blocks as it takes*/
+void drainSinks(void)
+{
+  sdBlockBudget = 255;
+  captureDrain();
+  sdSinkFlush();
+}
+
+char *putDec(char *p, unsigned long v)
+{
+  char tmp[10];
+  byte n = 0;
   do
   {
-    digit = ((v >> (num_nibbles - 1) * 4)) & 0x0f;
-    myFile.print(digit, HEX);
+    tmp[n++] = '0' + v % 10;
+    v /= 10;
   }
-  while (--num_nibbles);
+  while (v);
+  while (n) *p++ = tmp[--n];
+  return p;
+}
 
+char *putHex(char *p, unsigned long v)
+{
+  char tmp[8];
+  byte n = 0;
+  do
+  {
+    tmp[n++] = "0123456789ABCDEF"[v & 0x0F];
+    v >>= 4;
+  }
+  while (v);
+  while (n) *p++ = tmp[--n];
+  return p;
 }
 
-void processMessage( Frame& message )
+/**Writes the assembled block to the file, one SD block per call*/
+void sdSinkWriteBlock(void)
 {
-  digitalWrite(LIGHT_CAN, HIGH);
+  if (sdBufferUsed > 0)
+  {
+    sessionWrite(sdBuffer, sdBufferUsed);
+    sdBufferUsed = 0;
+  }
+}
 
-  //current time
-  timeLastMessageReceived = millis();
+void sdSinkFlush(void)
+{
+  sdSinkWriteBlock();
+  sessionFlush();
+}
 
-  if (message.id > 0)
+/**A record fits in the buffer, or the block write it would need is still within this pass's budget*/
+bool sdSinkReady(void)
+{
+  return sdBufferUsed + SD_LINE_MAX <= SD_BUFFER_SIZE || sdBlockBudget > 0;
+}
+
+/**Time Diff of a record: the difference of the truncated ms times of this record and the previous one, so the
+ * running sum the host tools rebuild the time from stays on the micros() clock at any frame rate*/
+unsigned long sdTimeDiff(unsigned long timeUs)
+{
+  if (!sdHaveTime)
   {
-    if (DEBUG == true)
-    {
-      Serial.println(message.id, HEX);
-    }
+    sdHaveTime = true;
+    sdLastUs = timeUs;
+    sdCarryUs = timeUs % 1000;
+    return 0;
+  }
+  //An analog scan sampled before the CAN frame queued ahead of it counts as simultaneous
+  if ((long)(timeUs - sdLastUs) < 0) return 0;
+  unsigned long elapsed = timeUs - sdLastUs + sdCarryUs;
+  sdLastUs = timeUs;
+  sdCarryUs = elapsed % 1000;
+  return elapsed / 1000;
+}
 
-    myFile.print(msgCount++, DEC);
-    myFile.print(",");
-    myFile.print(getTimeDifference(), DEC);
-    myFile.print(",");
-    myFile.print(message.id, HEX);
-    myFile.print(",");
-    myFile.print(message.dlc, DEC);
-    myFile.print(",");
-    for (int i = 0; i < message.dlc; i++)
-    {
-      print_hex(message.data[i], 8);
-      myFile.print(" ");
+/**Formats one record as "Msg#,Time Diff,ID,DLC,Data" with two hex digits per data byte*/
+void sdSinkWrite(const CapturedFrame &captured)
+{
+  const Frame &message = captured.frame;
+  if (sdBufferUsed + SD_LINE_MAX > SD_BUFFER_SIZE)
+  {
+    sdSinkWriteBlock();
+    if (sdBlockBudget > 0) sdBlockBudget--;
+  }
+  char *p = &sdBuffer[sdBufferUsed];
+  p = putDec(p, captured.msgNum);
+  *p++ = ',';
+  p = putDec(p, sdTimeDiff(captured.timeUs));
+  *p++ = ',';
+  p = putHex(p, message.id);
+  *p++ = ',';
+  p = putDec(p, message.dlc);
+  *p++ = ',';
+  for (int i = 0; i < message.dlc; i++)
+  {
+    *p++ = "0123456789ABCDEF"[message.data[i] >> 4];
+    *p++ = "0123456789ABCDEF"[message.data[i] & 0x0F];
+    *p++ = ' ';
+  }
+  *p++ = '\r';
+  *p++ = '\n';
+  sdBufferUsed = p - sdBuffer;
+}
 
-    }
+bool serialSinkReady(void)
+{
+  return streamReady();
+}
 
-    myFile.println();
-    //flush for illustration purpose only
-    myFile.flush();
-  }
-  digitalWrite(LIGHT_CAN, LOW);
+void serialSinkWrite(const CapturedFrame &captured)
+{
+  const Frame &message = captured.frame;
+  streamFrame(captured.msgNum, captured.timeUs, message.id, message.ide, message.rtr, message.dlc, message.data);
+}
 
+void statsSinkWrite(const CapturedFrame &captured)
+{
+  statsFrames++;
+  statsBytes += captured.frame.dlc;
 }
 
 unsigned long getTimeDifference()
@@ -355,14 +535,17 @@ void checkCanRx0() {
     // Serial.println("Message on RX Buffer 0");
     if (DEBUG == true )
     {
-      Serial.println("Message on RX Buffer 0");
+      streamText.println("Message on RX Buffer 0");
       interruptFlags =  CAN.Read(CANINTF);
-      Serial.println(interruptFlags, BIN);
+      streamText.println(interruptFlags, BIN);
     }
     //Retrieve the new message
     message0 =   CAN.ReadBuffer(RXB0);
-    //Process the message
-    processMessage( message0);
+    //Process the message unless a decimation/rate rule discards it
+    if (rxRuleAccept(message0.id, message0.ide, millis()))
+    {
+      processMessage( message0);
+    }
     //Reset the CANITF flag
     mask = RX0IF;
     CAN.BitModify(CANINTF, mask, INTERRUPT_RESET);
@@ -375,20 +558,70 @@ void checkCanRx1() {
     //Serial.println("Message on RX Buffer 1");
     if (DEBUG == true)
     {
-      Serial.println("Message on RX Buffer 1");
+      streamText.println("Message on RX Buffer 1");
       interruptFlags =  CAN.Read(CANINTF);
-      Serial.println(interruptFlags, BIN);
+      streamText.println(interruptFlags, BIN);
     }
     //Retrieve the new message
     message1 =  CAN.ReadBuffer(RXB1);
-    //Process the message
-    processMessage( message1 );
+    //Process the message unless a decimation/rate rule discards it
+    if (rxRuleAccept(message1.id, message1.ide, millis()))
+    {
+      processMessage( message1 );
+    }
     //Reset the CANITF flag
     mask = RX1IF;
     CAN.BitModify(CANINTF, mask, INTERRUPT_RESET);
   }
 }
 
+void rx0BufferFull() {
+  rxBuffersFull |= RX0IF;
+}
+
+void rx1BufferFull() {
+  rxBuffersFull |= RX1IF;
+}
+
+/**Switches the MCP2515 to buffer full pins and attaches one external interrupt per RX buffer*/
+void initBufferFullPins(void) {
+  CAN.setBufferFullPins(true);
+  pinMode(RX0BF_PIN, INPUT);
+  pinMode(RX1BF_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(RX0BF_PIN), rx0BufferFull, FALLING);
+  attachInterrupt(digitalPinToInterrupt(RX1BF_PIN), rx1BufferFull, FALLING);
+  //A frame that arrived before the interrupts were attached produced no edge
+  noInterrupts();
+  if (digitalRead(RX0BF_PIN) == LOW) rxBuffersFull |= RX0IF;
+  if (digitalRead(RX1BF_PIN) == LOW) rxBuffersFull |= RX1IF;
+  interrupts();
+}
+
+/**Reads the buffers flagged by the pin interrupts. READ RX BUFFER clears RXnIF when CS goes high,
+ * which releases the pin for the next frame, so no status read or BitModify is needed*/
+void checkBuffersFull() {
+  noInterrupts();
+  byte full = rxBuffersFull;
+  rxBuffersFull = 0;
+  interrupts();
+  if (full & RX0IF)
+  {
+    message0 = CAN.ReadBuffer(RXB0);
+    if (rxRuleAccept(message0.id, message0.ide, millis()))
+    {
+      processMessage(message0);
+    }
+  }
+  if (full & RX1IF)
+  {
+    message1 = CAN.ReadBuffer(RXB1);
+    if (rxRuleAccept(message1.id, message1.ide, millis()))
+    {
+      processMessage(message1);
+    }
+  }
+}
+
 void checkCanTx0() {
   if (interruptFlags & TX0IF)
   {
@@ -437,23 +670,21 @@ void checkCanErr1() {
   }
 }
 
+/**Emits every completed analog scan as a synthetic frame 0x110 (channel values as little endian pairs).
+ * The ADC runs from Timer1 on its own; this only moves finished scans into the capture queue.*/
 void readPots(void) {
-    potsFrame.id = 0x110;                 // Extended ID flag
-  pots[0] = analogRead(A8);
-  pots[1] = analogRead(A9);
-  pots[2] = analogRead(A10);
-  pots[3] = analogRead(A11);
-  potsFrame.srr = 0;
-  potsFrame.rtr = 0;                 // Remote Transmission Request
-  potsFrame.ide = 0x110;                 // Extended ID flag
-  potsFrame.dlc = 15;
-  int i;
-  for (i = 0; i < 4; i++) {
-    potsFrame.data[2 * i] = (pots[i] & 0xFF);
-    potsFrame.data[2 * i + 1] = ((pots[i] >> 8) & 0xFF);
-  }
-  for (i = 8; i < 16; i++) {
-    potsFrame.data[i] = 0x00;
+  AnalogScan scan;
+  while (analogNext(scan))
+  {
+    potsFrame.id = ANALOG_FRAME_ID;
+    potsFrame.srr = 0;
+    potsFrame.rtr = 0;                 // Remote Transmission Request
+    potsFrame.ide = 0;                 // Extended ID flag
+    potsFrame.dlc = 2 * sizeof(ANALOG_CHANNELS);
+    for (byte i = 0; i < sizeof(ANALOG_CHANNELS); i++) {
+      potsFrame.data[2 * i] = (scan.value[i] & 0xFF);
+      potsFrame.data[2 * i + 1] = ((scan.value[i] >> 8) & 0xFF);
+    }
+    captureFrameAt(potsFrame, msgCount++, scan.timeUs);
   }
-  processMessage(potsFrame);
-}
+}
@@ -522,6 +522,23 @@ void MCP2515::setCanStatus(){
   }
 }
 
+/*
+  Buffer full pins: RX0BF/RX1BF go low while RXB0/RXB1 hold an unread frame,
+  so each pin can drive its own external interrupt and the handler knows which
+  buffer to read without asking the chip. The RX flags are taken off the INT
+  pin, which then only signals errors and TX completion.
+*/
+void MCP2515::setBufferFullPins(bool enable) {
+  if(enable) {
+    Write(BFPCTRL, B0BFM | B1BFM | B0BFE | B1BFE);
+    // CANINTE uses the same bit positions as CANINTF
+    BitModify(CANINTE, RX0IF | RX1IF, 0);
+  } else {
+    Write(BFPCTRL, 0);
+    BitModify(CANINTE, RX0IF | RX1IF, RX0IF | RX1IF);
+  }
+}
+
 void MCP2515::displayCanStatus(void)
 {
   Serial.println("displayCANStatus:entry");
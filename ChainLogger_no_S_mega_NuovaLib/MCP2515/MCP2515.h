@@ -11,7 +11,11 @@
   http://en.wikipedia.org/wiki/CAN_bus
 */
 
-#define DEBUG 1
+/*Debug/status text on Serial from the library and the sketch; off by default, as every line costs the live feed and
+ the RX loop time. Define DEBUG 1 before including this header to turn it on*/
+#ifndef DEBUG
+#define DEBUG 0
+#endif
 #define SD_CHIP_SELECT 9
 #define LIGHT_CAN  7
 #ifndef MCP2515_h
@@ -48,6 +52,7 @@ class MCP2515
       bool Mode(byte mode); // Returns TRUE if mode change successful
       void setCanStatus();
 	  void displayCanStatus(void);
+	  void setBufferFullPins(bool enable); // RX0BF/RX1BF pins signal full RX buffers
 	  bool initSD(void);
 	  void initSPI(void);
 	  bool hasTimeElapsed( unsigned long start_time, unsigned long wait_time);
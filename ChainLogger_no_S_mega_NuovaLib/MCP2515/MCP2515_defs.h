@@ -54,6 +54,14 @@ typedef struct
 #define WAKIF                  0x40
 #define MERRF                  0x80
 
+// BFPCTRL
+#define B0BFM                  0x01
+#define B1BFM                  0x02
+#define B0BFE                  0x04
+#define B1BFE                  0x08
+#define B0BFS                  0x10
+#define B1BFS                  0x20
+
 // Configuration Registers
 #define CANSTAT         0x0E
 #define CANCTRL         0x0F
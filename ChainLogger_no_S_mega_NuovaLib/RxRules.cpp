@@ -0,0 +1,194 @@
+#include "RxRules.h"
+#include <ChainStream.h>
+#include <SD.h>
+
+#define RULES_TABLE_MASK  (RULES_TABLE_SIZE - 1)
+/*Set in a table key for extended frames*/
+#define KEY_EXTENDED      0x80000000UL
+/*Table slot states stored in rule*/
+#define SLOT_EMPTY        0xFF
+#define SLOT_NO_RULE      0xFE
+
+typedef struct
+{
+  unsigned long id;
+  unsigned long mask;
+  byte action;
+  unsigned int value;
+} RxRule;
+
+typedef struct
+{
+  unsigned long key;        // id, KEY_EXTENDED for extended frames
+  byte rule;                // index into _rules, SLOT_NO_RULE or SLOT_EMPTY
+  unsigned int count;       // frames seen since the last kept one (RULE_EVERY), 1 once a frame was kept (RULE_RATE)
+  unsigned long lastKept;   // millis() of the last kept frame (RULE_RATE)
+} RxSlot;
+
+static RxRule _rules[RULES_MAX];
+static byte _ruleCount = 0;
+static RxSlot _table[RULES_TABLE_SIZE];
+static bool _tableReady = false;
+static unsigned long _dropped = 0;
+
+static void clearTable(void)
+{
+  for (int i = 0; i < RULES_TABLE_SIZE; i++)
+  {
+    _table[i].rule = SLOT_EMPTY;
+  }
+  _tableReady = true;
+}
+
+static byte matchRule(unsigned long id)
+{
+  for (byte r = 0; r < _ruleCount; r++)
+  {
+    if ((id & _rules[r].mask) == (_rules[r].id & _rules[r].mask)) return r;
+  }
+  return SLOT_NO_RULE;
+}
+
+/**Finds the slot of key, inserting it on first sight. Returns NULL if there is no room within RULES_PROBE_MAX slots*/
+static RxSlot *lookup(unsigned long key)
+{
+  byte h = (key ^ (key >> 7) ^ (key >> 14) ^ (key >> 21) ^ (key >> 31)) & RULES_TABLE_MASK;
+  for (byte probe = 0; probe < RULES_PROBE_MAX; probe++)
+  {
+    RxSlot *slot = &_table[(h + probe) & RULES_TABLE_MASK];
+    if (slot->rule == SLOT_EMPTY)
+    {
+      slot->key = key;
+      slot->rule = matchRule(key & ~KEY_EXTENDED);
+      slot->count = 0;
+      slot->lastKept = 0;
+      return slot;
+    }
+    if (slot->key == key) return slot;
+  }
+  return NULL;
+}
+
+bool rxRulesAdd(unsigned long id, unsigned long mask, byte action, unsigned int value)
+{
+  if (_ruleCount == RULES_MAX) return false;
+  _rules[_ruleCount].id = id;
+  _rules[_ruleCount].mask = mask;
+  _rules[_ruleCount].action = action;
+  _rules[_ruleCount].value = value;
+  _ruleCount++;
+  // IDs already cached were resolved against the old list
+  clearTable();
+  return true;
+}
+
+/**Parses one line of the rules file, ignoring blanks and comments*/
+/**Reads a hex number at p that ends at one of the characters in stop; false if there are no digits or it ends elsewhere*/
+static bool parseHex(char *&p, const char *stop, unsigned long &value)
+{
+  if (!isxdigit(*p)) return false;
+  value = strtoul(p, &p, 16);
+  return *p != '\0' && strchr(stop, *p) != NULL;
+}
+
+static void parseRule(char *line)
+{
+  char *p = line;
+  while (*p == ' ' || *p == '\t') p++;
+  if (*p == '\0' || *p == '#') return;
+
+  unsigned long id;
+  unsigned long mask = 0x1FFFFFFFUL;
+  bool ok = parseHex(p, "/ \t", id);
+  if (ok && *p == '/')
+  {
+    p++;
+    ok = parseHex(p, " \t", mask);
+  }
+  while (*p == ' ' || *p == '\t') p++;
+
+  byte action;
+  if (ok && strncmp(p, "every", 5) == 0) action = RULE_EVERY;
+  else if (ok && strncmp(p, "rate", 4) == 0) action = RULE_RATE;
+  else if (ok && strncmp(p, "drop", 4) == 0) action = RULE_DROP;
+  else
+  {
+    streamText.print("Bad rule: ");
+    streamText.println(line);
+    return;
+  }
+  while (*p != '\0' && *p != ' ' && *p != '\t') p++;
+  unsigned int value = strtoul(p, NULL, 10);
+  if (action == RULE_EVERY && value == 0) value = 1;
+  rxRulesAdd(id, mask, action, value);
+}
+
+byte rxRulesLoad(const char *fileName)
+{
+  clearTable();
+  File rulesFile = SD.open(fileName, FILE_READ);
+  if (!rulesFile) return 0;
+
+  char line[48];
+  byte len = 0;
+  while (rulesFile.available())
+  {
+    char c = rulesFile.read();
+    if (c == '\n' || c == '\r')
+    {
+      line[len] = '\0';
+      parseRule(line);
+      len = 0;
+    }
+    else if (len < sizeof(line) - 1)
+    {
+      line[len++] = c;
+    }
+  }
+  line[len] = '\0';
+  parseRule(line);
+  rulesFile.close();
+  return _ruleCount;
+}
+
+bool rxRuleAccept(unsigned long id, byte ide, unsigned long nowMs)
+{
+  if (_ruleCount == 0) return true;
+  if (!_tableReady) clearTable();
+
+  RxSlot *slot = lookup(ide ? id | KEY_EXTENDED : id);
+  // No room for the ID: kept like one without a rule
+  if (slot == NULL) return true;
+  byte rule = slot->rule;
+  if (rule == SLOT_NO_RULE) return true;
+
+  bool keep = false;
+  switch (_rules[rule].action)
+  {
+    case RULE_EVERY:
+      if (++slot->count >= _rules[rule].value)
+      {
+        slot->count = 0;
+        keep = true;
+      }
+      break;
+    case RULE_RATE:
+      if (slot->count == 0 || nowMs - slot->lastKept >= _rules[rule].value)
+      {
+        slot->count = 1;
+        slot->lastKept = nowMs;
+        keep = true;
+      }
+      break;
+    case RULE_DROP:
+      keep = false;
+      break;
+  }
+  if (!keep) _dropped++;
+  return keep;
+}
+
+unsigned long rxRulesDropped(void)
+{
+  return _dropped;
+}
@@ -0,0 +1,48 @@
+/*
+  RxRules.h - Per ID decimation and rate limiting applied in the RX path
+
+  Rules are read from RULES.txt on the SD card at startup, one per line:
+
+    # id[/mask]  action
+    1A0          every 10     keep every 10th frame of 0x1A0
+    300/700      rate 100     each ID 0x300..0x3FF at most once per 100 ms
+    7DF          drop         never log 0x7DF
+
+  IDs and masks are hex like the log files; the mask defaults to all bits.
+  The first matching rule wins. IDs without a matching rule are kept.
+
+  Each ID is resolved against the rule list once, on its first frame, and
+  cached in an open addressing hash table together with its counter and last
+  kept time. Every later frame costs one hash probe, independent of the
+  number of rules. Standard and extended frames with the same ID number are
+  tracked apart. Probing stops after RULES_PROBE_MAX slots, so an ID that
+  finds no room (more IDs on the bus than the table holds) is kept like an
+  ID without a rule instead of costing a walk over the whole table.
+*/
+
+#ifndef RxRules_h
+#define RxRules_h
+
+#include "Arduino.h"
+
+#define RULES_FILE        "RULES.txt"
+#define RULES_MAX         16
+/*IDs tracked in the lookup table, power of two*/
+#define RULES_TABLE_SIZE  128
+/*Slots looked at per lookup before an ID is treated as untracked*/
+#define RULES_PROBE_MAX   8
+
+#define RULE_EVERY  1
+#define RULE_RATE   2
+#define RULE_DROP   3
+
+/**Reads the rule table from the SD card. Returns the number of rules loaded*/
+byte rxRulesLoad(const char *fileName);
+/**Adds one rule. Returns false if the table is full*/
+bool rxRulesAdd(unsigned long id, unsigned long mask, byte action, unsigned int value);
+/**True if a frame with this id (extended if ide is set), received at nowMs, should be logged*/
+bool rxRuleAccept(unsigned long id, byte ide, unsigned long nowMs);
+/**Frames rejected by the rules so far*/
+unsigned long rxRulesDropped(void);
+
+#endif
@@ -0,0 +1,151 @@
+#include "SessionFiles.h"
+#include <SD.h>
+#include <EEPROM.h>
+
+#define SESSION_MAGIC  'C'
+/*Names taken by files from another logger are skipped, but never more than this many per open*/
+#define SESSION_MAX_SKIP  100
+
+static const char *_header = "";
+static unsigned int _counter = 0;
+
+static File _current;
+static char _currentName[13];
+static unsigned long _currentBytes = 0;
+static unsigned long _currentStart = 0;
+
+/*Opened ahead of time, close to a limit, so a rotation never waits for the card*/
+static File _next;
+static char _nextName[13];
+
+/*Rotated out, closed from sessionService()*/
+static File _retired;
+
+static void loadCounter(void)
+{
+  if (EEPROM.read(SESSION_EEPROM_ADDR) == SESSION_MAGIC)
+  {
+    EEPROM.get(SESSION_EEPROM_ADDR + 1, _counter);
+  }
+  else
+  {
+    _counter = 0;
+  }
+}
+
+static void saveCounter(void)
+{
+  EEPROM.update(SESSION_EEPROM_ADDR, SESSION_MAGIC);
+  EEPROM.put(SESSION_EEPROM_ADDR + 1, _counter);
+}
+
+/**DATAnnnn.txt, nnnn = counter modulo 10000*/
+static void makeName(unsigned int n, char *name)
+{
+  strcpy(name, "DATA0000.txt");
+  n %= 10000;
+  for (byte i = 7; i >= 4; i--)
+  {
+    name[i] = '0' + n % 10;
+    n /= 10;
+  }
+}
+
+/**Opens the next free numbered file and writes the header line*/
+static bool openNumbered(File &file, char *name)
+{
+  for (byte skip = 0; skip < SESSION_MAX_SKIP; skip++)
+  {
+    makeName(_counter++, name);
+    if (!SD.exists(name)) break;
+  }
+  saveCounter();
+  file = SD.open(name, FILE_WRITE);
+  if (!file) return false;
+  file.println(_header);
+  file.flush();
+  return true;
+}
+
+bool sessionBegin(const char *header)
+{
+  _header = header;
+  loadCounter();
+  if (!openNumbered(_current, _currentName)) return false;
+  _currentBytes = 0;
+  _currentStart = millis();
+  return true;
+}
+
+/**The current file is within bytes / ms of a size or time limit*/
+static bool limitWithin(unsigned long bytes, unsigned long ms)
+{
+  return _currentBytes + bytes >= SESSION_MAX_BYTES || (millis() - _currentStart) + ms >= SESSION_MAX_MS;
+}
+
+/**Makes the file opened ahead the current one; the old one is closed later by sessionService()*/
+static void switchToNext(void)
+{
+  _retired = _current;
+  _current = _next;
+  _next = File();
+  strcpy(_currentName, _nextName);
+  _currentBytes = 0;
+  _currentStart = millis();
+}
+
+void sessionRotate(void)
+{
+  if (_currentBytes == 0) return;
+  if (!_next && !openNumbered(_next, _nextName))
+  {
+    //No new file: keep appending to the current one
+    return;
+  }
+  if (_retired) _retired.close();
+  switchToNext();
+}
+
+void sessionWrite(const char *data, int len)
+{
+  //Only swaps handles: the next file and the retired one are sessionService()'s work
+  if (_next && !_retired
+      && (_currentBytes + len > SESSION_MAX_BYTES || (millis() - _currentStart) >= SESSION_MAX_MS))
+  {
+    switchToNext();
+  }
+  _current.write((const uint8_t *)data, len);
+  _currentBytes += len;
+}
+
+void sessionFlush(void)
+{
+  _current.flush();
+}
+
+void sessionService(unsigned long quietMs)
+{
+  //One slow SD operation per call
+  if (_retired)
+  {
+    _retired.close();
+  }
+  else if (!_next && _currentBytes > 0
+           && (limitWithin(0, 0)
+               || (quietMs >= SESSION_QUIET_MS && limitWithin(SESSION_PREOPEN_BYTES, SESSION_PREOPEN_MS))))
+  {
+    openNumbered(_next, _nextName);
+  }
+}
+
+void sessionEnd(void)
+{
+  if (_retired) _retired.close();
+  if (_current) _current.close();
+  if (_next) _next.close();
+}
+
+const char *sessionFileName(void)
+{
+  return _currentName;
+}
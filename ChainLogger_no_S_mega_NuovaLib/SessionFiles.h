@@ -0,0 +1,60 @@
+/*
+  SessionFiles.h - Continuous logging into a rotating series of DATAnnnn.txt files
+
+  A new file is started after an idle gap on the bus, when the current file
+  reaches SESSION_MAX_BYTES, or after SESSION_MAX_MS. The number of the next
+  file is kept in EEPROM, so finding a free name costs one SD.exists() call
+  instead of a scan over all previous sessions.
+
+  The write path never opens or closes a file: a rotation only swaps two
+  File objects. The next file is opened (and its header written) ahead of
+  time from sessionService(), but only once the current file is within
+  SESSION_PREOPEN_BYTES / SESSION_PREOPEN_MS of a limit and the bus has been
+  quiet for SESSION_QUIET_MS, or the limit has been reached. Should a limit
+  be reached before the next file is ready, the current one grows until it
+  is. The retired file is closed later, again from sessionService().
+
+  Opening is not free: up to SESSION_MAX_SKIP SD.exists() calls, the open,
+  the header flush and an EEPROM write, a few milliseconds in which the
+  MCP2515 is not read; frames beyond its two receive buffers are lost. A
+  file opened ahead that never receives a record (power cut close to a
+  limit) keeps just the header line.
+*/
+
+#ifndef SessionFiles_h
+#define SessionFiles_h
+
+#include "Arduino.h"
+
+/*Start a new file after this long without traffic*/
+#define SESSION_IDLE_MS      10000UL
+/*Start a new file once the current one is this large*/
+#define SESSION_MAX_BYTES    (64UL * 1024UL * 1024UL)
+/*Start a new file after this much logging time*/
+#define SESSION_MAX_MS       (60UL * 60UL * 1000UL)
+/*Open the next file once the current one is this close to SESSION_MAX_BYTES...*/
+#define SESSION_PREOPEN_BYTES  (1024UL * 1024UL)
+/*...or to SESSION_MAX_MS*/
+#define SESSION_PREOPEN_MS     (60UL * 1000UL)
+/*...and the bus has been without frames for this long*/
+#define SESSION_QUIET_MS       50UL
+/*EEPROM address of the persisted file counter (magic byte + 16 bit counter)*/
+#define SESSION_EEPROM_ADDR  0
+
+/**Opens the first file and writes header as its first line. Returns false if no file could be opened*/
+bool sessionBegin(const char *header);
+/**Appends len bytes to the current file, rotating first if a size or time limit is reached*/
+void sessionWrite(const char *data, int len);
+/**Flushes the current file*/
+void sessionFlush(void);
+/**Switches to the next file, e.g. after an idle gap. Does nothing if the current file holds no records*/
+void sessionRotate(void);
+/**Closes a retired file or prepares the next one, one SD operation per call; call on every loop pass, busy or not.
+ quietMs is the time since the last frame was received*/
+void sessionService(unsigned long quietMs);
+/**Closes all files*/
+void sessionEnd(void);
+/**Name of the file currently being written*/
+const char *sessionFileName(void);
+
+#endif
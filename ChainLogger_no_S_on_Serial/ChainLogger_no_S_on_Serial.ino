@@ -1,19 +1,20 @@
-#include <SD.h>
 #include <SPI.h>
 #include <MCP2515.h>
+#include <ChainStream.h>
 
 /** CAN/J1939 logger based on the Arduino platform using a Sparkfun CAN-BUS shield.
  * Required Hardware: 1.) Arduino Duemilanove or similar, available at http://arduino.cc/en/Main/Buy
  * 2.) CAN Shield, available at http://www.sparkfun.com/products/10039
- * 3.) Any Micro SD Card
- * 4.) USB Cable and ODB-II cable
+ * 3.) USB Cable and ODB-II cable
  * 
  * Required Software: 1.) Arduino Software 0023, available at http://www.arduino.cc/   
- * 2.) Arduino SD card library
- * 3.) Arduino SPI library    
+ * 2.) Arduino SPI library    
  * 
  * Approach: Continuously record CAN/J1939 messages (optional: record messages that match filter criteria). Please not that the application has been configured to log all information accessible on the CAN bus and explicitly show 
  * individual processing steps. Significant performance improvements are possbile by using selective message filters and writing storage routines that use the bandwidth available at the SD card interface.
+ *
+ * This variant does not use the SD card: every frame is streamed live to the host as batched, COBS framed binary packets at STREAM_BAUD
+ * (see ChainStream.h). ChainTools/chain_rx decodes the stream back into the same Msg#,Time Diff,ID,DLC,Data records the SD loggers write.
  */
 #define summary
 
@@ -43,13 +44,6 @@ const byte MCP2515_SLEEP  =0x20;
 /*MCP2515 NORMAL state: Participates as a regular node in the CAN network*/
 const byte MCP2515_NORMAL =0x00;
 
-/*File name of log file*/
-char fileName[]     = "DATA00.txt";
-/**Column headers for logged data*/
-char header[]       = "Msg#,Time Diff, ID,DLC, Data";
-/*File objet used to access the SD card*/
-File myFile;
-
 /*Object to interact with the MCP2515 directly*/
 MCP2515 CAN( CAN_CHIP_SELECT, CAN_INTERRUPT_PIN);
 /* CAN message frame exposed by the MCP2515 RX0 buffer*/
@@ -72,15 +66,17 @@ boolean KEEPGOING = true;
 /*Variable for temporary message assembly*/
 String tmpMessage;
 
-/**Debug variable controls whether or not debug/status information will bewritten to the serial console. Setting DEBUG to true has a negative performance impact.*/
-boolean DEBUG = true;
+/**Debug variable controls whether or not debug/status information will bewritten to the serial console. Setting DEBUG to true has a negative performance impact.
+ * Debug text goes out through streamText as its own 0x00 delimited records between packets; the host counts and skips them,
+ * but every line delays the stream.*/
+boolean DEBUG = false;
 
 
 /**Initialize the CAN shield*/
 boolean initCAN(void)
 {
   // Progress statement
-  Serial.println("initCan:entry");  
+  streamText.println("initCan:entry");  
   //Setup not complete yet.
   boolean setupSuccess = false;
   //Initialize CAN shield
@@ -95,17 +91,17 @@ boolean initCAN(void)
   if(baudRate>0) 
   { 
     //Print current progress
-    Serial.println("MCP2515 init OK");
-    Serial.print("Baud: ");
-    Serial.println(baudRate,DEC);
+    streamText.println("MCP2515 init OK");
+    streamText.print("Baud: ");
+    streamText.println(baudRate,DEC);
     delay(1000);
 
     //Print CAN bus status
     if(DEBUG ==true)
     {
-      Serial.print("CAN Stat: ");
+      streamText.print("CAN Stat: ");
       displayCanStatus();
-      Serial.println(" ");
+      streamText.println(" ");
     }
 
     setCanStatus();        
@@ -113,7 +109,7 @@ boolean initCAN(void)
   } 
   else 
   {
-    Serial.println("MCP2515 Init Fail");
+    streamText.println("MCP2515 Init Fail");
   }   
   return setupSuccess;
 }
@@ -121,7 +117,7 @@ boolean initCAN(void)
 /**Modifies several registers that determine which methods will be processed by the receive buffers*/
 void setCanStatus()
 {
-  Serial.println("sCANStat:entr");
+  streamText.println("sCANStat:entr");
   /*
     // MCP2515 SPI Commands
    #define CAN_RESET	0xC0
@@ -204,9 +200,9 @@ void setCanStatus()
   int modeset = CAN.Mode(MCP2515_CONFIG);
   if(DEBUG ==true)
   {
-    Serial.println("Cfg MCP2515 Reg");
-    Serial.print("Mode set: ");
-    Serial.println(modeset);
+    streamText.println("Cfg MCP2515 Reg");
+    streamText.print("Mode set: ");
+    streamText.println(modeset);
   }
 
 
@@ -215,8 +211,8 @@ void setCanStatus()
   CAN.Write(RXB0CTRL, value);
   if(DEBUG==true)
   {
-    Serial.print("RXB0CTRL: ");
-    Serial.println( CAN.Read(RXB0CTRL),BIN);
+    streamText.print("RXB0CTRL: ");
+    streamText.println( CAN.Read(RXB0CTRL),BIN);
   }           
 
   //enable reception of all messages in buffer 1
@@ -224,8 +220,8 @@ void setCanStatus()
   CAN.Write(RXB1CTRL, value);
   if(DEBUG ==true)
   {
-    Serial.print("RXB1CTRL: ");
-    Serial.println( CAN.Read(RXB1CTRL),BIN);
+    streamText.print("RXB1CTRL: ");
+    streamText.println( CAN.Read(RXB1CTRL),BIN);
   }
 
   //Set the interrupt enable flags    
@@ -241,37 +237,14 @@ void setCanStatus()
   modeset = CAN.Mode(MCP2515_LISTEN);
   if(DEBUG == true)
   {
-    Serial.print("Mode set: ");
-    Serial.println(modeset);
+    streamText.print("Mode set: ");
+    streamText.println(modeset);
   }
 }
-/**Initializes SD card communication*/
-boolean initSD(void)
-{
-    pinMode(10, OUTPUT);
-    
-  Serial.println("initSD:entry");
-  boolean setupSuccess =false;
-  // Initialize the SD card SPI CS Pin
-  pinMode(SD_CHIP_SELECT, OUTPUT);      
-  //digitalWrite(SD_CHIP_SELECT, HIGH);   // Turns Sd Card communication off 
-  //Check whether SD card initialization is successful
-  if (!SD.begin(SD_CHIP_SELECT)) 
-  {  
-    Serial.println("Card failed");
-  }
-  else
-  {
-    Serial.println("Card OK");
-    setupSuccess = true;
-  }
-  return setupSuccess;
-}
-
 /**Initialize SPI communication*/
 void initSPI(void)
 {
-  Serial.println("initSPI:entry");
+  streamText.println("initSPI:entry");
   // Set up SPI Communication
   // dataMode can be SPI_MODE0 or SPI_MODE3 only for MCP2515
   SPI.setClockDivider(SPI_CLOCK_DIV2);
@@ -283,7 +256,7 @@ void initSPI(void)
 /**Method that provides summary information on the status of the MCP2515 chip*/
 void displayCanStatus(void)
 {    
-  Serial.println("displayCANStatus:entry");
+  streamText.println("displayCANStatus:entry");
   //Display CAN Status bits
   /*
     bit 7 - CANINTF.TX2IF
@@ -295,8 +268,8 @@ void displayCanStatus(void)
    bit 1 - CANINTF.RX1IF
    bit 0 - CANINTF.RX0IF         
    */
-  Serial.print("CAN Status: ");  
-  Serial.println(CAN.Status(), BIN);
+  streamText.print("CAN Status: ");  
+  streamText.println(CAN.Status(), BIN);
 
   //DISPLAY RX status bits  
   /*
@@ -316,63 +289,63 @@ void displayCanStatus(void)
    	1 | 1 | 0 | RXF0 (rollover to RXB1)
    	1 | 1 | 1 | RXF1 (rollover to RXB1)
    */
-  Serial.print("RX Status: ");   
-  Serial.println(CAN.RXStatus(), BIN);
+  streamText.print("RX Status: ");   
+  streamText.println(CAN.RXStatus(), BIN);
 
   byte helper = CAN.Read(CANCTRL);  
-  Serial.print("CANTRL: ");    
-  Serial.println(helper, BIN);
+  streamText.print("CANTRL: ");    
+  streamText.println(helper, BIN);
 
   helper = CAN.Read(CANSTAT);
-  Serial.print("CANSTAT: ");   
-  Serial.println(helper, BIN);
+  streamText.print("CANSTAT: ");   
+  streamText.println(helper, BIN);
 
-  Serial.println();
+  streamText.println();
   helper = CAN.Read(RXB0CTRL);   
-  Serial.print("RXB0CTRL: ");  
-  Serial.println(helper,BIN);
+  streamText.print("RXB0CTRL: ");  
+  streamText.println(helper,BIN);
 
   helper= CAN.Read(RXB0SIDL);
-  Serial.print("RFX0SIDL: ");  
-  Serial.println(helper,BIN);
+  streamText.print("RFX0SIDL: ");  
+  streamText.println(helper,BIN);
 
   helper= CAN.Read(RXB0EID8);
-  Serial.print("RXB0EID8: ");  
-  Serial.println(helper,BIN);
+  streamText.print("RXB0EID8: ");  
+  streamText.println(helper,BIN);
 
   helper= CAN.Read(RXB0EID0);
-  Serial.print("RXB0EID0: ");  
-  Serial.println(helper,BIN);
-  Serial.println();
+  streamText.print("RXB0EID0: ");  
+  streamText.println(helper,BIN);
+  streamText.println();
 
   helper = CAN.Read(RXB1CTRL);
-  Serial.print("RXB1CTRL: ");  
-  Serial.println(helper,BIN);
+  streamText.print("RXB1CTRL: ");  
+  streamText.println(helper,BIN);
 
   helper= CAN.Read(RXB1SIDL);
-  Serial.print("RXB1SIDL: ");  
-  Serial.println(helper,BIN);
+  streamText.print("RXB1SIDL: ");  
+  streamText.println(helper,BIN);
 
   helper= CAN.Read(RXB1EID8);
-  Serial.print("RXB1EID8: ");  
-  Serial.println(helper,BIN);
+  streamText.print("RXB1EID8: ");  
+  streamText.println(helper,BIN);
 
   helper= CAN.Read(RXB1EID0);
-  Serial.print("RXB1EID0: ");  
-  Serial.println(helper,BIN);
-  Serial.println();
+  streamText.print("RXB1EID0: ");  
+  streamText.println(helper,BIN);
+  streamText.println();
 
   helper = CAN.Read(BFPCTRL);
-  Serial.print("BFPCTRL: ");   
-  Serial.println(helper,BIN);
+  streamText.print("BFPCTRL: ");   
+  streamText.println(helper,BIN);
 
   helper = CAN.Read(CANINTE);
-  Serial.print("CANINTE: ");   
-  Serial.println(helper,BIN);
+  streamText.print("CANINTE: ");   
+  streamText.println(helper,BIN);
 
   helper = CAN.Read(CANINTF);
-  Serial.print("CANINTF: ");   
-  Serial.println(helper,BIN);
+  streamText.print("CANINTF: ");   
+  streamText.println(helper,BIN);
 }
 
 /**Initializes all components that will be used during the continuous loop*/
@@ -381,15 +354,10 @@ void setup()
   pinMode(LIGHT_SD,OUTPUT);
   pinMode(LIGHT_CAN,OUTPUT);
   boolean setupSuccess = true;
-  Serial.begin(115200);
-  Serial.println("Setup");
+  streamBegin();
+  streamText.println("Setup");
   pinMode(10, OUTPUT);
   pinMode(9, OUTPUT);
-  //sd
-  initSPI();
-  setupSuccess = initSD();
-  if (setupSuccess) preparaSD();
-  delay(100);
   initSPI();
 
 
@@ -404,7 +372,7 @@ void setup()
     {
       displayCanStatus();
     }    
-    Serial.println("log start");
+    streamText.println("log start");
   }
 
 
@@ -444,7 +412,7 @@ boolean hasTimeElapsed( unsigned long start_time, unsigned long wait_time)
   return ret_value;
 }
 
-/**Main loop continuously reading CAN messages and writing text representaions to the SD card. Each time a interupt is generated 
+/**Main loop continuously reading CAN messages and streaming them to the host. Each time a interupt is generated 
  * the nessage is extracted and forearded to ``processMessage''
  */
 void loop()
@@ -460,7 +428,7 @@ void loop()
     {
       tmpMessage = String("loop:timeDifference = ");
       tmpMessage.concat( timeDifference );
-      Serial.println( tmpMessage );
+      streamText.println( tmpMessage );
     }
     /*After a inital message has been received, the program will shutdown afte 10 sec of idle time*/
     if( ((timeLastMessageReceived!=0)) && ( timeDifference > 10000))
@@ -471,10 +439,8 @@ void loop()
         tmpMessage.concat( timeDifference );
         tmpMessage.concat(", timeLastMessageReceived= ");
         tmpMessage.concat( timeLastMessageReceived );
-        Serial.println( tmpMessage);
+        streamText.println( tmpMessage);
       }      
-      //Close file
-      myFile.close();      
       KEEPGOING = false;
     }
     else
@@ -485,15 +451,15 @@ void loop()
     byte interruptFlags = CAN.Read(CANINTF);
     if( DEBUG == true)
     {
-      Serial.println(interruptFlags,BIN);
-      Serial.println("interrupt flags OK");
-      Serial.println("Waiting for interrrupt");
+      streamText.println(interruptFlags,BIN);
+      streamText.println("interrupt flags OK");
+      streamText.println("Waiting for interrrupt");
     }
     //Wait a maximum of 10 seconds for the next message
     unsigned long start_wait_time = millis();
     while(  (KEEPGOING==true) && (! CAN.Interrupt()) && ( ! hasTimeElapsed(start_wait_time, 10000 )) )
     {
-      ;
+      streamService();
     }
 
     // This implementation utilizes the MCP2515 INT pin to flag received messages
@@ -506,9 +472,9 @@ void loop()
         // Serial.println("Message on RX Buffer 0");
         if(DEBUG == true )
         {	
-          Serial.println("Message on RX Buffer 0");
+          streamText.println("Message on RX Buffer 0");
           interruptFlags = CAN.Read(CANINTF);
-          Serial.println(interruptFlags,BIN);
+          streamText.println(interruptFlags,BIN);
         }
         //Retrieve the new message
         message0 = CAN.ReadBuffer(RXB0);
@@ -523,9 +489,9 @@ void loop()
         //Serial.println("Message on RX Buffer 1");
         if(DEBUG == true)
         {
-          Serial.println("Message on RX Buffer 1");
+          streamText.println("Message on RX Buffer 1");
           interruptFlags = CAN.Read(CANINTF);
-          Serial.println(interruptFlags,BIN);
+          streamText.println(interruptFlags,BIN);
         }
         //Retrieve the new message
         message1 = CAN.ReadBuffer(RXB1);
@@ -574,8 +540,14 @@ void loop()
       }
     }
   }  // end while loop 
-  Serial.println("Program complete!");
-  Serial.println("Waiting for reset...");
+  //Drain the last batch before any text goes out
+  unsigned long drain_time = millis();
+  while( ! hasTimeElapsed(drain_time, 100) )
+  {
+    streamService();
+  }
+  streamText.println("Program complete!");
+  streamText.println("Waiting for reset...");
   /* myFile = SD.open(fileName);
    if (myFile) {
    Serial.println(fileName);
@@ -601,8 +573,7 @@ void loop()
   }
 }
 
-/**Extracts the components from received messsage and writes them to file. This method has a considerable performance impact 
- * and is for illustration purposes only. Speedup can be achieved by ensuring the maximum amount of data (e.g. 512 byte ) is written each time ``print'' is called. 
+/**Hands the received message to the stream. The batch is encoded and sent from ``streamService'' so the RX path never waits on the UART.
  */
 void processMessage( Frame& message )
 {
@@ -612,93 +583,21 @@ void processMessage( Frame& message )
   timeLastMessageReceived = millis();
   if(DEBUG == true)
   {
-    Serial.print("Assigning= ");
-    Serial.println(timeLastMessageReceived);
+    streamText.print("Assigning= ");
+    streamText.println(timeLastMessageReceived);
   }   
 
   if(message.id>0) 
   { 
     if(DEBUG == true)
     {      
-      Serial.println(message.id,HEX);
-    }
-
-    myFile.print(msgCount++, DEC);
-    myFile.print(",");
-    myFile.print(getTimeDifference(),DEC);
-    myFile.print(",");
-    myFile.print(message.id,HEX);
-    myFile.print(",");
-    myFile.print(message.dlc,DEC);  
-    myFile.print(",");       
-    for(int i=0;i<message.dlc;i++) 
-    {	
-      myFile.print(message.data[i],HEX);
-      myFile.print(" ");
-
+      streamText.println(message.id,HEX);
     }
 
-    myFile.println();     
-    //flush for illustration purpose only
-    myFile.flush();
+    streamFrame(msgCount++, micros(), message.id, message.ide, message.rtr, message.dlc, message.data);
+    streamService();
   }
   digitalWrite(LIGHT_CAN,LOW);
   digitalWrite(LIGHT_SD,LOW);
 
-}  
-void preparaSD(void) {
-
-  //Find the next available file name to prevent overwriting previously recorded sessions.
-  Serial.print("Checking file name: ");
-  Serial.println(fileName); 
-  boolean fileExists = SD.exists( fileName );
-  Serial.flush();
-  //If the file exists change the name until a new one is created
-  if( fileExists == true )
-  {
-    for (uint8_t i = 0; i < 100; i++) 
-    {
-      fileName[4] = i/10 + '0';
-      fileName[5] = i%10 + '0';
-      Serial.print("Checking file name: ");
-      Serial.println(fileName);
-      fileExists = SD.exists( fileName );
-      Serial.flush();
-      Serial.println("");
-      if(fileExists == false )
-      {
-        break;
-      }
-    }
-  }
-  else
-  {
-    //file does not exist yet -> create it
-  }
-  Serial.flush();
-
-  //Open file and get ready to enter data
-  Serial.println("1");
-  unsigned short int j=0;
-  Serial.println("1");
-  
-  while (!myFile) {
-   delay(100);
-    myFile = SD.open(fileName, FILE_WRITE);
-    Serial.print("teo nuo");
-    Serial.println((int)j++);
-    Serial.flush();
-  }
-  if (myFile) {
-    Serial.println("Esi il fle txt:");
-    myFile.println(header);
-    myFile.flush();
-    // close the file:
-  } 
-  else {
-    // if the file didn't open, print an error:
-    Serial.println("NO");
-  }
 }
-
-
@@ -0,0 +1,293 @@
+#include "BitSearch.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*Words tested at a time*/
+#define SEARCH_BLOCK  4
+
+static int hexDigit(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/**Hex bytes in frame order ("0020") into a little endian payload word; advances p past them*/
+static bool payloadWord(const char *&p, uint64_t &word)
+{
+  word = 0;
+  int bytes = 0;
+  while (hexDigit(p[0]) >= 0)
+  {
+    if (hexDigit(p[1]) < 0 || bytes == 8) return false;
+    word |= (uint64_t)(hexDigit(p[0]) << 4 | hexDigit(p[1])) << (bytes * 8);
+    bytes++;
+    p += 2;
+  }
+  return bytes > 0;
+}
+
+bool parsePredicate(const char *text, SearchPredicate &predicate)
+{
+  char *end;
+  unsigned long id = strtoul(text, &end, 16);
+  if (end == text || hexDigit(*text) < 0) return false;
+  predicate.extended = *end == 'x';
+  if (predicate.extended) end++;
+  if (*end != ':' || id > (predicate.extended ? 0x1FFFFFFFUL : 0x7FFUL)) return false;
+  predicate.id = (uint32_t)id;
+  const char *p = end + 1;
+  if (!payloadWord(p, predicate.mask)) return false;
+  predicate.value = 0;
+  if (*p == '=')
+  {
+    p++;
+    predicate.kind = SEARCH_EQUAL;
+    if (!payloadWord(p, predicate.value) || (predicate.value & ~predicate.mask)) return false;
+  }
+  else if (*p == '+') predicate.kind = SEARCH_RISE;
+  else if (*p == '-') predicate.kind = SEARCH_FALL;
+  else if (*p == '!') predicate.kind = SEARCH_CHANGE;
+  else return false;
+  return predicate.kind == SEARCH_EQUAL ? *p == 0 : p[1] == 0;
+}
+
+/**What must be 0 for a hit with SEARCH_EQUAL, and not 0 for a hit with the others; p is the previous word*/
+template <SearchKind Kind>
+static inline uint64_t residue(uint64_t w, uint64_t p, uint64_t mask, uint64_t value)
+{
+  if (Kind == SEARCH_EQUAL) return (w & mask) ^ value;
+  if (Kind == SEARCH_RISE) return ~p & w & mask;
+  if (Kind == SEARCH_FALL) return p & ~w & mask;
+  return (p ^ w) & mask;
+}
+
+/**Bit i set where w[i] (previous word p[i]) is a hit, for the SEARCH_BLOCK words at w*/
+template <SearchKind Kind>
+static inline unsigned blockHits(const uint64_t *w, const uint64_t *p, uint64_t mask, uint64_t value)
+{
+  unsigned zero;
+#if defined(__AVX2__)
+  __m256i x = _mm256_loadu_si256((const __m256i *)w);
+  __m256i m = _mm256_set1_epi64x((long long)mask);
+  __m256i t;
+  if (Kind == SEARCH_EQUAL) t = _mm256_xor_si256(_mm256_and_si256(x, m), _mm256_set1_epi64x((long long)value));
+  else
+  {
+    __m256i y = _mm256_loadu_si256((const __m256i *)p);
+    if (Kind == SEARCH_RISE) t = _mm256_and_si256(_mm256_andnot_si256(y, x), m);
+    else if (Kind == SEARCH_FALL) t = _mm256_and_si256(_mm256_andnot_si256(x, y), m);
+    else t = _mm256_and_si256(_mm256_xor_si256(x, y), m);
+  }
+  zero = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(t, _mm256_setzero_si256())));
+#elif defined(__SSE2__)
+  // no 64 bit compare in SSE2: a word is 0 where both of its 32 bit halves are
+  zero = 0;
+  for (int i = 0; i < SEARCH_BLOCK; i += 2)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i *)(w + i));
+    __m128i m = _mm_set1_epi64x((long long)mask);
+    __m128i t;
+    if (Kind == SEARCH_EQUAL) t = _mm_xor_si128(_mm_and_si128(x, m), _mm_set1_epi64x((long long)value));
+    else
+    {
+      __m128i y = _mm_loadu_si128((const __m128i *)(p + i));
+      if (Kind == SEARCH_RISE) t = _mm_and_si128(_mm_andnot_si128(y, x), m);
+      else if (Kind == SEARCH_FALL) t = _mm_and_si128(_mm_andnot_si128(x, y), m);
+      else t = _mm_and_si128(_mm_xor_si128(x, y), m);
+    }
+    __m128i e = _mm_cmpeq_epi32(t, _mm_setzero_si128());
+    e = _mm_and_si128(e, _mm_shuffle_epi32(e, _MM_SHUFFLE(2, 3, 0, 1)));
+    zero |= (unsigned)_mm_movemask_pd(_mm_castsi128_pd(e)) << i;
+  }
+#else
+  zero = 0;
+  for (int i = 0; i < SEARCH_BLOCK; i++)
+  {
+    zero |= (unsigned)(residue<Kind>(w[i], Kind == SEARCH_EQUAL ? 0 : p[i], mask, value) == 0) << i;
+  }
+#endif
+  return Kind == SEARCH_EQUAL ? zero : ~zero & ((1U << SEARCH_BLOCK) - 1);
+}
+
+/**Rows of words[0..n-1] that are hits, appended to rows; previous is the word before words[0], if any*/
+template <SearchKind Kind>
+static void scanWords(const uint64_t *words, size_t n, bool havePrevious, uint64_t previous, uint64_t mask,
+                      uint64_t value, std::vector<uint32_t> &rows)
+{
+  size_t k = 0;
+  if (Kind != SEARCH_EQUAL && n)
+  {
+    // the first word compares with the last batch, the rest with their neighbour
+    if (havePrevious && residue<Kind>(words[0], previous, mask, value)) rows.push_back(0);
+    k = 1;
+  }
+  for (; k + SEARCH_BLOCK <= n; k += SEARCH_BLOCK)
+  {
+    unsigned hits = blockHits<Kind>(words + k, words + k - (Kind != SEARCH_EQUAL), mask, value);
+    while (hits)
+    {
+      rows.push_back((uint32_t)(k + __builtin_ctz(hits)));
+      hits &= hits - 1;
+    }
+  }
+  for (; k < n; k++)
+  {
+    uint64_t r = residue<Kind>(words[k], Kind == SEARCH_EQUAL ? 0 : words[k - 1], mask, value);
+    if (Kind == SEARCH_EQUAL ? r == 0 : r != 0) rows.push_back((uint32_t)k);
+  }
+}
+
+BitSearch::BitSearch(const std::vector<SearchPredicate> &predicates)
+  : _predicates(predicates),
+    _standard(0x800, -1),
+    _frameBase(0)
+{
+  for (uint32_t i = 0; i < _predicates.size(); i++)
+  {
+    const SearchPredicate &p = _predicates[i];
+    int32_t index;
+    if (p.extended)
+    {
+      auto it = _extended.emplace(p.id, (int32_t)_ids.size());
+      index = it.first->second;
+    }
+    else
+    {
+      if (_standard[p.id] < 0) _standard[p.id] = (int32_t)_ids.size();
+      index = _standard[p.id];
+    }
+    if (index == (int32_t)_ids.size())
+    {
+      Id id;
+      id.id = p.id;
+      id.extended = p.extended;
+      id.havePrevious = false;
+      id.previous = 0;
+      _ids.push_back(id);
+    }
+    _ids[index].predicates.push_back(i);
+  }
+}
+
+int BitSearch::_lookup(const CanFrame &frame) const
+{
+  if (frame.flags & FRAME_RTR) return -1;
+  if (!(frame.flags & FRAME_EXTENDED)) return frame.id <= 0x7FF ? _standard[frame.id] : -1;
+  auto it = _extended.find(frame.id);
+  return it == _extended.end() ? -1 : it->second;
+}
+
+void BitSearch::_scanColumn(Id &id, const uint64_t *words, size_t n)
+{
+  for (uint32_t p : id.predicates)
+  {
+    const SearchPredicate &s = _predicates[p];
+    switch (s.kind)
+    {
+      case SEARCH_EQUAL:
+        scanWords<SEARCH_EQUAL>(words, n, id.havePrevious, id.previous, s.mask, s.value, _hitRows);
+        break;
+      case SEARCH_RISE:
+        scanWords<SEARCH_RISE>(words, n, id.havePrevious, id.previous, s.mask, s.value, _hitRows);
+        break;
+      case SEARCH_FALL:
+        scanWords<SEARCH_FALL>(words, n, id.havePrevious, id.previous, s.mask, s.value, _hitRows);
+        break;
+      case SEARCH_CHANGE:
+        scanWords<SEARCH_CHANGE>(words, n, id.havePrevious, id.previous, s.mask, s.value, _hitRows);
+        break;
+    }
+    _hitPredicates.resize(_hitRows.size(), p);
+  }
+  if (n)
+  {
+    id.havePrevious = true;
+    id.previous = words[n - 1];
+  }
+}
+
+void BitSearch::scan(const CanFrame *frames, size_t count, std::vector<SearchHit> &out)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    int id = _lookup(frames[i]);
+    if (id >= 0) _ids[id].rows.push_back((uint32_t)i);
+  }
+  size_t first = out.size();
+  for (Id &id : _ids)
+  {
+    if (id.rows.empty()) continue;
+    // gather the ID's payloads, bytes past the DLC cleared
+    size_t n = id.rows.size();
+    _payload.resize(n);
+    for (size_t k = 0; k < n; k++)
+    {
+      const CanFrame &f = frames[id.rows[k]];
+      memcpy(&_payload[k], f.data, 8);
+      if (f.dlc < 8) _payload[k] &= (1ULL << (f.dlc * 8)) - 1;
+    }
+    _hitRows.clear();
+    _hitPredicates.clear();
+    _scanColumn(id, _payload.data(), n);
+    for (size_t h = 0; h < _hitRows.size(); h++)
+    {
+      uint32_t row = id.rows[_hitRows[h]];
+      SearchHit hit;
+      hit.timeUs = frames[row].timeUs;
+      hit.index = _frameBase + row;
+      hit.msgNum = frames[row].msgNum;
+      hit.predicate = _hitPredicates[h];
+      out.push_back(hit);
+    }
+    id.rows.clear();
+  }
+  std::sort(out.begin() + first, out.end(), [](const SearchHit &a, const SearchHit &b) {
+    return a.index != b.index ? a.index < b.index : a.predicate < b.predicate;
+  });
+  _frameBase += count;
+}
+
+void BitSearch::scan(const ColumnStore &store, std::vector<SearchHit> &out)
+{
+  size_t first = out.size();
+  for (Id &id : _ids)
+  {
+    const ColumnStoreEntry *entry = store.find(id.id, id.extended);
+    if (!entry) continue;
+    ColumnSeries s = store.series(*entry);
+    // a store is searched on its own: no previous frame
+    bool havePrevious = id.havePrevious;
+    uint64_t previous = id.previous;
+    id.havePrevious = false;
+    _hitRows.clear();
+    _hitPredicates.clear();
+    _scanColumn(id, (const uint64_t *)s.data, s.count);
+    id.havePrevious = havePrevious;
+    id.previous = previous;
+    for (size_t h = 0; h < _hitRows.size(); h++)
+    {
+      uint32_t row = _hitRows[h];
+      if (s.flags[row] & FRAME_RTR) continue;
+      SearchHit hit;
+      hit.timeUs = s.timeUs[row];
+      hit.index = row;
+      hit.msgNum = s.msgNum[row];
+      hit.predicate = _hitPredicates[h];
+      out.push_back(hit);
+    }
+  }
+  std::sort(out.begin() + first, out.end(), [](const SearchHit &a, const SearchHit &b) {
+    if (a.timeUs != b.timeUs) return a.timeUs < b.timeUs;
+    return a.msgNum != b.msgNum ? a.msgNum < b.msgNum : a.predicate < b.predicate;
+  });
+}
@@ -0,0 +1,100 @@
+/*
+  BitSearch.h - Searching captures for bit patterns and flag changes
+
+  Replaces UI/SubVI/Flag Finder.vi. A predicate names an ID, a mask over
+  its payload and a test:
+
+    SEARCH_EQUAL   the masked payload equals value
+    SEARCH_RISE    a masked bit is 1 where the ID's previous frame had 0
+    SEARCH_FALL    a masked bit is 0 where the ID's previous frame had 1
+    SEARCH_CHANGE  any masked bit differs from the ID's previous frame
+
+  Written as text (parsePredicate()): "ID[x]:MASK=VALUE", "ID:MASK+",
+  "ID:MASK-" and "ID:MASK!", ID in hex with x for a 29 bit ID, MASK and
+  VALUE as hex bytes in frame order like the logs show them, missing
+  bytes 0: "3A0:0020=0020" is bit 5 of byte 1 set, "3A0:0020+" that bit
+  being switched on.
+
+  All predicates run in one pass. Packed frames are sorted by ID and each
+  ID's payloads gathered into one array, as SignalDecoder does; a column
+  store (ColumnStore.h) already holds them that way, so there only the
+  searched IDs are read at all. Every predicate then tests its ID's whole
+  column four 64 bit words at a time (AVX2, or SSE2 in pairs) and only
+  looks closer where a block has a hit.
+*/
+
+#ifndef BitSearch_h
+#define BitSearch_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "CanFrame.h"
+#include "ColumnStore.h"
+
+enum SearchKind
+{
+  SEARCH_EQUAL,
+  SEARCH_RISE,
+  SEARCH_FALL,
+  SEARCH_CHANGE,
+};
+
+struct SearchPredicate
+{
+  uint32_t id;
+  bool extended;
+  SearchKind kind;
+  uint64_t mask;   // payload as a little endian word: byte 0 in the low 8 bits
+  uint64_t value;
+};
+
+struct SearchHit
+{
+  uint64_t timeUs;
+  uint64_t index;      // frame number in the input, or row of the ID in a column store
+  uint32_t msgNum;
+  uint32_t predicate;  // position in the predicate list
+};
+
+/**Parses "ID[x]:MASK=VALUE", "ID:MASK+", "ID:MASK-" or "ID:MASK!"*/
+bool parsePredicate(const char *text, SearchPredicate &predicate);
+
+class BitSearch
+{
+  public:
+    explicit BitSearch(const std::vector<SearchPredicate> &predicates);
+
+    /**Appends the hits in a batch of frames, in frame order; the previous frame of an ID carries over from the last batch*/
+    void scan(const CanFrame *frames, size_t count, std::vector<SearchHit> &out);
+    /**Appends the hits in a whole column store, in time order*/
+    void scan(const ColumnStore &store, std::vector<SearchHit> &out);
+
+  private:
+    struct Id
+    {
+      uint32_t id;
+      bool extended;
+      std::vector<uint32_t> predicates;
+      bool havePrevious;
+      uint64_t previous;   // payload of the last frame of the last batch
+      std::vector<uint32_t> rows;
+    };
+
+    int _lookup(const CanFrame &frame) const;
+    /**Hits of the ID's predicates in words[0..n-1]; rows appended to _hitRows, predicates to _hitPredicates*/
+    void _scanColumn(Id &id, const uint64_t *words, size_t n);
+
+    std::vector<SearchPredicate> _predicates;
+    std::vector<Id> _ids;
+    std::vector<int32_t> _standard;  // entry of every 11 bit ID in _ids, -1 if none
+    std::unordered_map<uint32_t, int32_t> _extended;
+    uint64_t _frameBase;             // index of the first frame of the batch
+    std::vector<uint64_t> _payload;
+    std::vector<uint32_t> _hitRows;
+    std::vector<uint32_t> _hitPredicates;
+};
+
+#endif
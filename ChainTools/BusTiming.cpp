@@ -0,0 +1,94 @@
+#include "BusTiming.h"
+
+/*SOF, 11 bit ID, RTR, IDE, r0, DLC*/
+#define STD_HEADER_BITS  19
+/*SOF, 11 bit base ID, SRR, IDE, 18 bit ID extension, RTR, r1, r0, DLC*/
+#define EXT_HEADER_BITS  39
+#define CRC_BITS         15
+
+/**Data bytes actually sent: none for a remote frame, at most 8*/
+static unsigned payloadBytes(const CanFrame &frame)
+{
+  if (frame.flags & FRAME_RTR) return 0;
+  return frame.dlc > 8 ? 8 : frame.dlc;
+}
+
+static unsigned putBits(uint8_t *bits, unsigned n, uint32_t value, unsigned count)
+{
+  while (count--) bits[n++] = (value >> count) & 1;
+  return n;
+}
+
+uint16_t canCrc15(const uint8_t *bits, unsigned nbits)
+{
+  uint16_t crc = 0;
+  for (unsigned i = 0; i < nbits; i++)
+  {
+    bool next = bits[i] ^ ((crc >> 14) & 1);
+    crc = (crc << 1) & 0x7FFF;
+    if (next) crc ^= 0x4599;
+  }
+  return crc;
+}
+
+unsigned canFrameBitsUnstuffed(const CanFrame &frame)
+{
+  unsigned header = (frame.flags & FRAME_EXTENDED) ? EXT_HEADER_BITS : STD_HEADER_BITS;
+  return header + 8 * payloadBytes(frame) + CRC_BITS + CAN_TAIL_BITS;
+}
+
+unsigned canFrameBits(const CanFrame &frame)
+{
+  uint8_t bits[EXT_HEADER_BITS + 64 + CRC_BITS];
+  unsigned n = 0;
+  bool rtr = (frame.flags & FRAME_RTR) != 0;
+  uint8_t dlc = frame.dlc > 15 ? 15 : frame.dlc;
+
+  n = putBits(bits, n, 0, 1);                          // SOF
+  if (frame.flags & FRAME_EXTENDED)
+  {
+    n = putBits(bits, n, frame.id >> 18, 11);
+    n = putBits(bits, n, 1, 1);                        // SRR
+    n = putBits(bits, n, 1, 1);                        // IDE
+    n = putBits(bits, n, frame.id & 0x3FFFF, 18);
+    n = putBits(bits, n, rtr, 1);
+    n = putBits(bits, n, 0, 2);                        // r1, r0
+  }
+  else
+  {
+    n = putBits(bits, n, frame.id & 0x7FF, 11);
+    n = putBits(bits, n, rtr, 1);
+    n = putBits(bits, n, 0, 2);                        // IDE, r0
+  }
+  n = putBits(bits, n, dlc, 4);
+  for (unsigned i = 0; i < payloadBytes(frame); i++)
+  {
+    n = putBits(bits, n, frame.data[i], 8);
+  }
+  n = putBits(bits, n, canCrc15(bits, n), CRC_BITS);
+
+  // After five equal bits the complement is inserted, and counts towards the next run
+  unsigned stuffed = 0;
+  uint8_t last = bits[0];
+  unsigned run = 1;
+  for (unsigned i = 1; i < n; i++)
+  {
+    if (run == 5)
+    {
+      stuffed++;
+      last ^= 1;
+      run = 1;
+    }
+    if (bits[i] == last)
+    {
+      run++;
+    }
+    else
+    {
+      last = bits[i];
+      run = 1;
+    }
+  }
+  if (run == 5) stuffed++;
+  return n + stuffed + CAN_TAIL_BITS;
+}
@@ -0,0 +1,27 @@
+/*
+  BusTiming.h - On-the-wire length of CAN 2.0 frames
+
+  The length includes the stuff bits the transmitter inserts after five equal
+  bits (SOF up to the end of the CRC sequence), the fixed-form tail (CRC and
+  ACK delimiters, ACK slot, EOF) and the 3 bit intermission, i.e. the bus
+  time one frame occupies before the next one can start.
+*/
+
+#ifndef BusTiming_h
+#define BusTiming_h
+
+#include <stdint.h>
+
+#include "CanFrame.h"
+
+/*Fixed-form bits after the CRC sequence: CRC delimiter, ACK slot, ACK delimiter, EOF, intermission*/
+#define CAN_TAIL_BITS  13
+
+/**Bits on the bus for frame, stuff bits and intermission included*/
+unsigned canFrameBits(const CanFrame &frame);
+/**Same frame without stuff bits, the lower bound for its ID and DLC*/
+unsigned canFrameBitsUnstuffed(const CanFrame &frame);
+/**CRC-15/CAN over nbits bits, bits[] holds one bit (0 or 1) per element in bus order*/
+uint16_t canCrc15(const uint8_t *bits, unsigned nbits);
+
+#endif
@@ -0,0 +1,34 @@
+/*
+  CanFrame.h - Binary frame record shared by the ChainTools host utilities
+
+  One CanFrame holds one line of a DATAxx.txt log (Msg#,Time Diff,ID,DLC,Data)
+  or one record of the live serial stream. Arrays of CanFrame are what the
+  parsers produce and every analysis stage consumes.
+*/
+
+#ifndef CanFrame_h
+#define CanFrame_h
+
+#include <stdint.h>
+
+// CanFrame.flags
+#define FRAME_EXTENDED   0x01  // 29 bit identifier
+#define FRAME_RTR        0x02  // Remote Transmission Request
+#define FRAME_TRUNCATED  0x04  // source DLC was larger than 8, only 8 bytes kept
+
+struct CanFrame
+{
+  uint64_t timeUs;      // absolute time since the start of the capture
+  uint32_t msgNum;      // Msg# column / device frame counter
+  uint32_t id;          // EID if FRAME_EXTENDED, SID otherwise
+  uint32_t timeDiffMs;  // Time Diff column as written by the logger
+  uint8_t dlc;          // number of data bytes, as logged
+  uint8_t flags;
+  uint8_t channel;      // source logger when several captures are combined
+  uint8_t reserved;
+  uint8_t data[8];
+};
+
+static_assert(sizeof(CanFrame) == 32, "CanFrame is a fixed 32 byte record");
+
+#endif
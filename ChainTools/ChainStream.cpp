@@ -0,0 +1,133 @@
+#include "ChainStream.h"
+
+#include <string.h>
+
+#include "Cobs.h"
+#include "Crc.h"
+
+// Longest packet the device can produce is well below this; anything longer is noise
+#define STREAM_MAX_ENCODED 1024
+
+static uint16_t getShort(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/**True for a record of printable characters and line breaks; a packet always holds the 0x01 version byte*/
+static bool isText(const uint8_t *p, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    if (p[i] < 0x20 && p[i] != '\r' && p[i] != '\n' && p[i] != '\t') return false;
+    if (p[i] > 0x7E) return false;
+  }
+  return true;
+}
+
+static uint32_t getLong(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+StreamDecoder::StreamDecoder()
+  : _haveSeq(false), _lastSeq(0), _haveDropped(false), _lastDropped(0),
+    _haveTime(false), _lastDeviceUs(0), _timeUs(0)
+{
+  memset(&_stats, 0, sizeof(_stats));
+  _encoded.reserve(STREAM_MAX_ENCODED);
+}
+
+void StreamDecoder::feed(const uint8_t *data, size_t len, std::vector<CanFrame> &out)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    if (data[i] != 0)
+    {
+      if (_encoded.size() < STREAM_MAX_ENCODED) _encoded.push_back(data[i]);
+      continue;
+    }
+    if (!_encoded.empty()) _packet(out);
+    _encoded.clear();
+  }
+}
+
+void StreamDecoder::_packet(std::vector<CanFrame> &out)
+{
+  if (isText(_encoded.data(), _encoded.size()))
+  {
+    _stats.textRecords++;
+    return;
+  }
+  if (_encoded.size() >= STREAM_MAX_ENCODED)
+  {
+    _stats.badPackets++;
+    return;
+  }
+  _decoded.resize(_encoded.size());
+  size_t len = cobsDecode(_encoded.data(), _encoded.size(), _decoded.data());
+  const uint8_t *p = _decoded.data();
+  if (len < STREAM_HEADER_SIZE + 2 || p[0] != STREAM_VERSION
+      || crc16Xmodem(p, len - 2) != getShort(p + len - 2))
+  {
+    _stats.badPackets++;
+    return;
+  }
+
+  uint8_t count = p[1];
+  uint16_t seq = getShort(p + 2);
+  uint32_t msgNum = getLong(p + 4);
+  uint16_t dropped = getShort(p + 8);
+
+  // Validate the records before touching any state
+  size_t end = len - 2;
+  size_t pos = STREAM_HEADER_SIZE;
+  for (uint8_t n = 0; n < count; n++)
+  {
+    if (pos + 10 > end || p[pos + 9] > 8) break;
+    pos += 10 + p[pos + 9];
+  }
+  if (pos != end)
+  {
+    _stats.badPackets++;
+    return;
+  }
+
+  if (_haveSeq) _stats.lostPackets += (uint16_t)(seq - _lastSeq - 1);
+  _haveSeq = true;
+  _lastSeq = seq;
+  if (_haveDropped) _stats.deviceDropped += (uint16_t)(dropped - _lastDropped);
+  else _stats.deviceDropped += dropped;
+  _haveDropped = true;
+  _lastDropped = dropped;
+  _stats.packets++;
+
+  pos = STREAM_HEADER_SIZE;
+  for (uint8_t n = 0; n < count; n++)
+  {
+    CanFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    uint32_t deviceUs = getLong(p + pos);
+    uint32_t id = getLong(p + pos + 4);
+    msgNum += p[pos + 8];
+    frame.dlc = p[pos + 9];
+    memcpy(frame.data, p + pos + 10, frame.dlc);
+    pos += 10 + frame.dlc;
+
+    // micros() wraps every ~71 minutes, the unsigned difference carries across it
+    uint32_t diffUs = _haveTime ? deviceUs - _lastDeviceUs : 0;
+    _haveTime = true;
+    _lastDeviceUs = deviceUs;
+    uint64_t prevTimeUs = _timeUs;
+    _timeUs += diffUs;
+
+    frame.timeUs = _timeUs;
+    // difference of the truncated times, so the running sum of Time Diff stays on the real time at any rate
+    frame.timeDiffMs = (uint32_t)(_timeUs / 1000 - prevTimeUs / 1000);
+    frame.msgNum = msgNum;
+    frame.id = id & 0x1FFFFFFF;
+    if (id & STREAM_ID_EXTENDED) frame.flags |= FRAME_EXTENDED;
+    if (id & STREAM_ID_RTR) frame.flags |= FRAME_RTR;
+    out.push_back(frame);
+    _stats.frames++;
+  }
+}
@@ -0,0 +1,61 @@
+/*
+  ChainStream.h - Decoder for the binary stream sent by ChainLogger_no_S_on_Serial
+  and by the live feed of ChainLogger_no_S_mega_NuovaLib
+
+  The wire format is documented in Arduino Libraries/ChainStream/ChainStream.h.
+  Bytes are fed in as they arrive; complete, CRC checked packets are turned
+  into CanFrame records. Status text the NuovaLib logger sends as its own
+  0x00 delimited records is counted apart; anything else between delimiters
+  that does not decode (line noise, a packet cut in half) is counted and
+  skipped.
+*/
+
+#ifndef ChainStream_h
+#define ChainStream_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "CanFrame.h"
+
+#define STREAM_VERSION       1
+#define STREAM_HEADER_SIZE   10
+#define STREAM_ID_EXTENDED   0x80000000UL
+#define STREAM_ID_RTR        0x40000000UL
+
+struct StreamStats
+{
+  uint64_t packets;        // packets that passed the CRC
+  uint64_t frames;         // records delivered
+  uint64_t badPackets;     // COBS, length or CRC failures
+  uint64_t lostPackets;    // gaps in the packet sequence number
+  uint64_t deviceDropped;  // frames the device could not queue
+  uint64_t textRecords;    // records of printable text (status lines)
+};
+
+class StreamDecoder
+{
+  public:
+    StreamDecoder();
+
+    /**Consumes len raw bytes and appends every decoded frame to out*/
+    void feed(const uint8_t *data, size_t len, std::vector<CanFrame> &out);
+    const StreamStats &stats() const { return _stats; }
+
+  private:
+    void _packet(std::vector<CanFrame> &out);
+
+    std::vector<uint8_t> _encoded;
+    std::vector<uint8_t> _decoded;
+    StreamStats _stats;
+    bool _haveSeq;
+    uint16_t _lastSeq;
+    bool _haveDropped;
+    uint16_t _lastDropped;
+    bool _haveTime;
+    uint32_t _lastDeviceUs;
+    uint64_t _timeUs;
+};
+
+#endif
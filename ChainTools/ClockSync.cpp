@@ -0,0 +1,26 @@
+#include "ClockSync.h"
+
+ClockSync::ClockSync(uint64_t windowUs)
+  : _windowUs(windowUs), _windowStart(0), _current(INT64_MAX), _previous(INT64_MAX), _valid(false)
+{
+}
+
+void ClockSync::observe(uint64_t deviceUs, uint64_t hostUs)
+{
+  int64_t d = (int64_t)hostUs - (int64_t)deviceUs;
+  if (!_valid)
+  {
+    _valid = true;
+    _windowStart = hostUs;
+    _current = _previous = d;
+    return;
+  }
+  if (hostUs - _windowStart >= _windowUs)
+  {
+    // a new window; the last one stays in the minimum until this one has seen enough
+    _previous = _current;
+    _current = d;
+    _windowStart = hostUs;
+  }
+  else if (d < _current) _current = d;
+}
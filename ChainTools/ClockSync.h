@@ -0,0 +1,44 @@
+/*
+  ClockSync.h - Maps device timestamps of the live stream onto the host clock
+
+  The loggers stamp every frame when it is read off the bus, but the host
+  sees frames only when a whole packet (up to 8 frames or 5 ms, see
+  Arduino Libraries/ChainStream/ChainStream.h) has crossed the USB link, so
+  host arrival times come in bursts and late. A frame cannot arrive before
+  it was on the bus, so host time - device time is the link delay plus a
+  constant clock offset, and its minimum over a while is the offset with
+  the least delay in it. The minimum is kept over the current and the last
+  window (2 s), so it follows a slowly drifting device clock without ever
+  jumping on one late packet.
+*/
+
+#ifndef ClockSync_h
+#define ClockSync_h
+
+#include <stdint.h>
+
+/*Length of one minimum window*/
+#define CLOCK_SYNC_WINDOW_US  2000000
+
+class ClockSync
+{
+  public:
+    explicit ClockSync(uint64_t windowUs = CLOCK_SYNC_WINDOW_US);
+
+    /**A frame stamped deviceUs arrived at host time hostUs*/
+    void observe(uint64_t deviceUs, uint64_t hostUs);
+    /**False until the first observe()*/
+    bool valid() const { return _valid; }
+    /**Host time at which the frame stamped deviceUs was on the bus*/
+    uint64_t hostTime(uint64_t deviceUs) const { return (uint64_t)((int64_t)deviceUs + offset()); }
+    int64_t offset() const { return _current < _previous ? _current : _previous; }
+
+  private:
+    uint64_t _windowUs;
+    uint64_t _windowStart;  // host time
+    int64_t _current;       // minimum of host - device in this window
+    int64_t _previous;      // and in the last one
+    bool _valid;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include "Cobs.h"
+
+size_t cobsMaxEncoded(size_t len)
+{
+  return len + len / 254 + 1;
+}
+
+size_t cobsEncode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+  size_t out = 1;
+  size_t codePos = 0;
+  uint8_t code = 1;
+  for (size_t i = 0; i < len; i++)
+  {
+    if (src[i] == 0)
+    {
+      dst[codePos] = code;
+      codePos = out++;
+      code = 1;
+    }
+    else
+    {
+      dst[out++] = src[i];
+      if (++code == 0xFF)
+      {
+        dst[codePos] = code;
+        codePos = out++;
+        code = 1;
+      }
+    }
+  }
+  dst[codePos] = code;
+  return out;
+}
+
+size_t cobsDecode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+  size_t in = 0;
+  size_t out = 0;
+  while (in < len)
+  {
+    uint8_t code = src[in++];
+    if (code == 0 || in + code - 1 > len) return 0;
+    for (uint8_t i = 1; i < code; i++)
+    {
+      if (src[in] == 0) return 0;
+      dst[out++] = src[in++];
+    }
+    // a full block (0xFF) is not followed by an implicit zero, neither is the last block
+    if (code != 0xFF && in < len) dst[out++] = 0;
+  }
+  return out;
+}
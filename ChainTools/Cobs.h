@@ -0,0 +1,22 @@
+/*
+  Cobs.h - Consistent Overhead Byte Stuffing
+
+  For further information see:
+
+  http://www.stuartcheshire.org/papers/COBSforToN.pdf
+*/
+
+#ifndef Cobs_h
+#define Cobs_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**Worst case encoded size of len bytes, without the 0x00 delimiter*/
+size_t cobsMaxEncoded(size_t len);
+/**Encodes len bytes of src into dst (no delimiter appended). Returns the encoded length*/
+size_t cobsEncode(const uint8_t *src, size_t len, uint8_t *dst);
+/**Decodes one packet (delimiter already removed) into dst. Returns the decoded length or 0 if the packet is malformed*/
+size_t cobsDecode(const uint8_t *src, size_t len, uint8_t *dst);
+
+#endif
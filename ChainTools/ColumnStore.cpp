@@ -0,0 +1,189 @@
+#include "ColumnStore.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "FrameDemux.h"
+
+/*Columns start on a cache line*/
+#define COLUMN_ALIGN  64
+
+static uint64_t align(uint64_t offset)
+{
+  return (offset + COLUMN_ALIGN - 1) & ~(uint64_t)(COLUMN_ALIGN - 1);
+}
+
+/**Directory key: standard and extended IDs with the same number are different IDs*/
+static uint64_t idKey(uint32_t id, uint8_t flags)
+{
+  return (uint64_t)(flags & FRAME_EXTENDED) << 32 | id;
+}
+
+/**Column sizes of count frames, laid out from offset on; returns the end*/
+static uint64_t layout(ColumnStoreEntry &entry, uint64_t offset)
+{
+  uint64_t n = entry.count;
+  entry.timeOffset = align(offset);
+  entry.dataOffset = align(entry.timeOffset + n * sizeof(uint64_t));
+  entry.msgNumOffset = align(entry.dataOffset + n * 8);
+  entry.dlcOffset = align(entry.msgNumOffset + n * sizeof(uint32_t));
+  entry.flagsOffset = align(entry.dlcOffset + n);
+  return entry.flagsOffset + n;
+}
+
+bool writeColumnStore(const char *path, const CanFrame *frames, size_t count)
+{
+  ThreadPool pool(1);
+  FrameDemux demux(pool);
+  demux.split(frames, count);
+  return writeColumnStore(path, demux, pool);
+}
+
+bool writeColumnStore(const char *path, const FrameDemux &demux, ThreadPool &pool)
+{
+  // the groups are in directory order already
+  size_t idCount = demux.groupCount();
+  std::vector<ColumnStoreEntry> directory(idCount);
+  uint64_t frameCount = 0;
+  uint64_t offset = sizeof(ColumnStoreHeader);
+  for (size_t g = 0; g < idCount; g++)
+  {
+    const DemuxGroup &group = demux.groups()[g];
+    const CanFrame *frames = demux.frames(group);
+    ColumnStoreEntry &e = directory[g];
+    memset(&e, 0, sizeof(e));
+    e.id = group.id;
+    e.flags = group.flags;
+    e.count = group.count;
+    e.firstUs = frames[0].timeUs;
+    e.lastUs = frames[group.count - 1].timeUs;
+    offset = layout(e, offset);
+    frameCount += group.count;
+  }
+  uint64_t directoryOffset = align(offset);
+  uint64_t size = directoryOffset + directory.size() * sizeof(ColumnStoreEntry);
+
+  int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return false;
+  void *map = MAP_FAILED;
+  if (ftruncate(fd, (off_t)size) == 0) map = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED)
+  {
+    int err = errno;
+    ::close(fd);
+    errno = err;
+    return false;
+  }
+  char *base = (char *)map;
+
+  ColumnStoreHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, COLUMN_STORE_MAGIC, sizeof(COLUMN_STORE_MAGIC));
+  header.entrySize = sizeof(ColumnStoreEntry);
+  header.idCount = (uint32_t)directory.size();
+  header.frameCount = frameCount;
+  header.directoryOffset = directoryOffset;
+  memcpy(base, &header, sizeof(header));
+  memcpy(base + directoryOffset, directory.data(), directory.size() * sizeof(ColumnStoreEntry));
+
+  // every ID's columns on their own, one ID per task: no two tasks write the same bytes
+  pool.run(idCount, [&](size_t g) {
+    const ColumnStoreEntry &e = directory[g];
+    const CanFrame *frames = demux.frames(demux.groups()[g]);
+    uint64_t *time = (uint64_t *)(base + e.timeOffset);
+    uint8_t *data = (uint8_t *)(base + e.dataOffset);
+    uint32_t *msgNum = (uint32_t *)(base + e.msgNumOffset);
+    uint8_t *dlc = (uint8_t *)(base + e.dlcOffset);
+    uint8_t *flags = (uint8_t *)(base + e.flagsOffset);
+    for (uint64_t r = 0; r < e.count; r++)
+    {
+      const CanFrame &f = frames[r];
+      time[r] = f.timeUs;
+      memcpy(data + r * 8, f.data, 8);
+      if (f.dlc < 8) memset(data + r * 8 + f.dlc, 0, 8 - f.dlc);
+      msgNum[r] = f.msgNum;
+      dlc[r] = f.dlc;
+      flags[r] = f.flags & ~FRAME_EXTENDED;
+    }
+  });
+
+  bool ok = munmap(map, (size_t)size) == 0;
+  int err = errno;
+  if (::close(fd) != 0 && ok)
+  {
+    ok = false;
+    err = errno;
+  }
+  errno = err;
+  return ok;
+}
+
+bool ColumnStore::open(const char *path)
+{
+  _idCount = 0;
+  _directoryOffset = 0;
+  if (!_map.open(path)) return false;
+  size_t size = _map.size();
+  const ColumnStoreHeader *header = (const ColumnStoreHeader *)_map.data();
+  bool ok = size >= sizeof(ColumnStoreHeader)
+         && memcmp(header->magic, COLUMN_STORE_MAGIC, sizeof(COLUMN_STORE_MAGIC)) == 0
+         && header->entrySize == sizeof(ColumnStoreEntry)
+         && header->directoryOffset % 8 == 0 && header->directoryOffset <= size
+         && header->idCount <= (size - header->directoryOffset) / sizeof(ColumnStoreEntry);
+  if (ok)
+  {
+    // every column inside the file, so series() needs no checks
+    const ColumnStoreEntry *e = (const ColumnStoreEntry *)(_map.data() + header->directoryOffset);
+    for (uint32_t i = 0; i < header->idCount && ok; i++)
+    {
+      ColumnStoreEntry expect = e[i];
+      ok = e[i].count <= size && e[i].timeOffset <= size && layout(expect, e[i].timeOffset) <= size
+        && memcmp(&expect, &e[i], sizeof(expect)) == 0;
+    }
+  }
+  if (!ok)
+  {
+    _map.close();
+    errno = EINVAL;
+    return false;
+  }
+  // only the IDs asked for are read: no read ahead into the neighbours
+  _map.adviseRandom();
+  _idCount = header->idCount;
+  _directoryOffset = header->directoryOffset;
+  return true;
+}
+
+const ColumnStoreEntry *ColumnStore::find(uint32_t id, bool extended) const
+{
+  uint64_t key = idKey(id, extended ? FRAME_EXTENDED : 0);
+  const ColumnStoreEntry *begin = entries();
+  const ColumnStoreEntry *end = begin + _idCount;
+  const ColumnStoreEntry *e = std::lower_bound(begin, end, key, [](const ColumnStoreEntry &entry, uint64_t k) {
+    return idKey(entry.id, entry.flags) < k;
+  });
+  return e != end && idKey(e->id, e->flags) == key ? e : nullptr;
+}
+
+ColumnSeries ColumnStore::series(const ColumnStoreEntry &entry) const
+{
+  const char *base = _map.data();
+  ColumnSeries s;
+  s.count = (size_t)entry.count;
+  s.timeUs = (const uint64_t *)(base + entry.timeOffset);
+  s.data = (const uint8_t(*)[8])(base + entry.dataOffset);
+  s.msgNum = (const uint32_t *)(base + entry.msgNumOffset);
+  s.dlc = (const uint8_t *)(base + entry.dlcOffset);
+  s.flags = (const uint8_t *)(base + entry.flagsOffset);
+  return s;
+}
+
+void ColumnStore::prefetch(const ColumnStoreEntry &entry)
+{
+  _map.adviseWillNeed((size_t)entry.timeOffset, (size_t)(entry.flagsOffset + entry.count - entry.timeOffset));
+}
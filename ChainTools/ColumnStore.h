@@ -0,0 +1,94 @@
+/*
+  ColumnStore.h - Per-ID columnar frame files (.col) for plotting and queries
+
+    header | ID 0: timeUs[] data[][8] msgNum[] dlc[] flags[] | ID 1: ... | directory
+
+  Every CAN ID (standard and extended kept apart) gets its own column
+  group: the fields of its frames, in time order, as separate contiguous
+  arrays, each starting on a 64 byte boundary. The directory at the end
+  lists the groups sorted by ID, so opening one ID's time series is a
+  binary search plus the pages of that ID; the rest of the file is never
+  read. Little endian host layout, like FrameFile.
+*/
+
+#ifndef ColumnStore_h
+#define ColumnStore_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "CanFrame.h"
+#include "MappedFile.h"
+
+class FrameDemux;
+class ThreadPool;
+
+#define COLUMN_STORE_MAGIC  "CHNCOL1"
+
+struct ColumnStoreHeader
+{
+  char magic[8];             // COLUMN_STORE_MAGIC, NUL terminated
+  uint32_t entrySize;        // sizeof(ColumnStoreEntry)
+  uint32_t idCount;          // directory entries
+  uint64_t frameCount;       // frames in all groups
+  uint64_t directoryOffset;  // file offset of the directory
+};
+
+static_assert(sizeof(ColumnStoreHeader) == 32, "ColumnStoreHeader is a fixed 32 byte record");
+
+/*One directory entry; offsets are from the start of the file*/
+struct ColumnStoreEntry
+{
+  uint32_t id;
+  uint8_t flags;          // FRAME_EXTENDED for a 29 bit ID
+  uint8_t reserved[3];
+  uint64_t count;         // frames of this ID
+  uint64_t firstUs;       // timeUs of the first and last of them
+  uint64_t lastUs;
+  uint64_t timeOffset;    // uint64_t timeUs[count]
+  uint64_t dataOffset;    // uint8_t data[count][8], bytes past dlc are 0
+  uint64_t msgNumOffset;  // uint32_t msgNum[count]
+  uint64_t dlcOffset;     // uint8_t dlc[count]
+  uint64_t flagsOffset;   // uint8_t flags[count] (FRAME_RTR, FRAME_TRUNCATED)
+};
+
+static_assert(sizeof(ColumnStoreEntry) == 72, "ColumnStoreEntry is a fixed 72 byte record");
+
+/*Columns of one ID, pointing into the mapping*/
+struct ColumnSeries
+{
+  size_t count;
+  const uint64_t *timeUs;
+  const uint8_t (*data)[8];
+  const uint32_t *msgNum;
+  const uint8_t *dlc;
+  const uint8_t *flags;
+};
+
+/**Writes frames (in time order) to path as a column store. Returns false with errno set*/
+bool writeColumnStore(const char *path, const CanFrame *frames, size_t count);
+/**Writes the frames split by demux, the columns of different IDs filled in parallel on pool*/
+bool writeColumnStore(const char *path, const FrameDemux &demux, ThreadPool &pool);
+
+class ColumnStore
+{
+  public:
+    /**Maps path and checks the directory. Returns false with errno set (EINVAL: not a column store)*/
+    bool open(const char *path);
+    void close() { _map.close(); }
+
+    size_t idCount() const { return _idCount; }
+    const ColumnStoreEntry *entries() const { return (const ColumnStoreEntry *)(_map.data() + _directoryOffset); }
+    /**Entry of id, NULL if the capture has no such frames*/
+    const ColumnStoreEntry *find(uint32_t id, bool extended) const;
+    ColumnSeries series(const ColumnStoreEntry &entry) const;
+    /**Starts reading all columns of entry in the background*/
+    void prefetch(const ColumnStoreEntry &entry);
+
+  private:
+    MappedFile _map;
+    size_t _idCount = 0;
+    uint64_t _directoryOffset = 0;
+};
+
+#endif
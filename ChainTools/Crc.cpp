@@ -0,0 +1,68 @@
+#include "Crc.h"
+
+namespace
+{
+  struct Crc16Table
+  {
+    uint16_t entry[256];
+    Crc16Table()
+    {
+      for (int i = 0; i < 256; i++)
+      {
+        uint16_t crc = (uint16_t)(i << 8);
+        for (int bit = 0; bit < 8; bit++)
+        {
+          crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+        entry[i] = crc;
+      }
+    }
+  };
+
+  const Crc16Table crc16Table;
+
+  struct Crc8Table
+  {
+    uint8_t entry[256];
+    explicit Crc8Table(uint8_t poly)
+    {
+      for (int i = 0; i < 256; i++)
+      {
+        uint8_t crc = (uint8_t)i;
+        for (int bit = 0; bit < 8; bit++)
+        {
+          crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ poly) : (uint8_t)(crc << 1);
+        }
+        entry[i] = crc;
+      }
+    }
+  };
+
+  const Crc8Table crc8J1850Table(0x1D);
+  const Crc8Table crc8H2fTable(0x2F);
+
+  uint8_t crc8(const Crc8Table &table, const uint8_t *data, size_t len, uint8_t crc)
+  {
+    for (size_t i = 0; i < len; i++) crc = table.entry[crc ^ data[i]];
+    return (uint8_t)(crc ^ 0xFF);
+  }
+}
+
+uint16_t crc16Xmodem(const uint8_t *data, size_t len, uint16_t crc)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    crc = (uint16_t)((crc << 8) ^ crc16Table.entry[(crc >> 8) ^ data[i]]);
+  }
+  return crc;
+}
+
+uint8_t crc8SaeJ1850(const uint8_t *data, size_t len, uint8_t init)
+{
+  return crc8(crc8J1850Table, data, len, init);
+}
+
+uint8_t crc8H2f(const uint8_t *data, size_t len, uint8_t init)
+{
+  return crc8(crc8H2fTable, data, len, init);
+}
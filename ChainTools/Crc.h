@@ -0,0 +1,20 @@
+/*
+  Crc.h - Table driven CRCs used by the stream protocol and the log checks
+*/
+
+#ifndef Crc_h
+#define Crc_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**CRC-16/XMODEM (poly 0x1021, init 0), matches avr-libc _crc_xmodem_update*/
+uint16_t crc16Xmodem(const uint8_t *data, size_t len, uint16_t crc = 0);
+
+/**CRC-8 SAE J1850 (poly 0x1D, xorout 0xFF) from init, 0xFF for the standard one*/
+uint8_t crc8SaeJ1850(const uint8_t *data, size_t len, uint8_t init = 0xFF);
+
+/**CRC-8H2F of AUTOSAR (poly 0x2F, xorout 0xFF) from init, 0xFF for the standard one*/
+uint8_t crc8H2f(const uint8_t *data, size_t len, uint8_t init = 0xFF);
+
+#endif
@@ -0,0 +1,235 @@
+#include "Dbc.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*DBC message IDs of 29 bit frames carry this bit*/
+#define DBC_EXTENDED_FLAG  0x80000000UL
+
+/*Reads the tokens of one line*/
+struct Cursor
+{
+  const char *p;
+
+  void skip()
+  {
+    while (*p == ' ' || *p == '\t') p++;
+  }
+
+  bool literal(char c)
+  {
+    skip();
+    if (*p != c) return false;
+    p++;
+    return true;
+  }
+
+  bool word(std::string &out)
+  {
+    skip();
+    const char *start = p;
+    while ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z') || (*p >= '0' && *p <= '9') || *p == '_') p++;
+    out.assign(start, p);
+    return p > start;
+  }
+
+  bool integer(unsigned long &out)
+  {
+    skip();
+    char *end;
+    out = strtoul(p, &end, 10);
+    if (end == p) return false;
+    p = end;
+    return true;
+  }
+
+  bool real(double &out)
+  {
+    skip();
+    char *end;
+    out = strtod(p, &end);
+    if (end == p) return false;
+    p = end;
+    return true;
+  }
+
+  bool quoted(std::string &out)
+  {
+    if (!literal('"')) return false;
+    const char *start = p;
+    while (*p && *p != '"') p++;
+    if (*p != '"') return false;
+    out.assign(start, p);
+    p++;
+    return true;
+  }
+};
+
+/**Position of the signal's LSB in the 64 bit big endian view of the payload, counted from its MSB (bit 0)*/
+static int motorolaEnd(const DbcSignal &s)
+{
+  int msb = (s.startBit / 8) * 8 + (7 - s.startBit % 8);
+  return msb + s.length;
+}
+
+/**"SG_ name [M|mN] : start|length@order sign (factor,offset) [min|max] "unit" receivers"; what says why it is not*/
+static bool parseSignal(Cursor &c, DbcSignal &s, const char *&what)
+{
+  what = "malformed SG_";
+  std::string mux;
+  if (!c.word(s.name)) return false;
+  s.multiplex = DBC_PLAIN;
+  if (c.word(mux))
+  {
+    // "M", "m3", or "m3M" (extended multiplexing: take it as plain m3)
+    if (mux == "M") s.multiplex = DBC_MULTIPLEXOR;
+    else if (mux[0] == 'm' && mux.size() > 1) s.multiplex = atoi(mux.c_str() + 1);
+    else return false;
+  }
+  unsigned long start, length;
+  if (!c.literal(':') || !c.integer(start) || !c.literal('|') || !c.integer(length) || !c.literal('@')) return false;
+  c.skip();
+  if (*c.p != '0' && *c.p != '1') return false;
+  s.motorola = *c.p++ == '0';
+  if (*c.p != '+' && *c.p != '-') return false;
+  s.isSigned = *c.p++ == '-';
+  if (!c.literal('(') || !c.real(s.factor) || !c.literal(',') || !c.real(s.offset) || !c.literal(')')) return false;
+  if (!c.literal('[') || !c.real(s.minimum) || !c.literal('|') || !c.real(s.maximum) || !c.literal(']')) return false;
+  if (!c.quoted(s.unit)) return false;
+  s.valueType = DBC_INTEGER;
+
+  what = "signal outside the 8 data bytes";
+  if (length < 1 || length > 64 || start > 63) return false;
+  s.startBit = (uint16_t)start;
+  s.length = (uint8_t)length;
+  if (s.motorola ? motorolaEnd(s) > 64 : start + length > 64) return false;
+  what = nullptr;
+  return true;
+}
+
+bool DbcFile::parse(const std::string &text, std::string *error)
+{
+  _messages.clear();
+  DbcMessage *message = nullptr;
+  bool skipping = false;
+  int lineNumber = 0;
+  size_t pos = 0;
+  while (pos < text.size())
+  {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos) eol = text.size();
+    std::string line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+    lineNumber++;
+
+    Cursor c = {line.c_str()};
+    std::string keyword;
+    c.word(keyword);
+    const char *what = nullptr;
+    if (keyword == "BO_")
+    {
+      unsigned long id, dlc;
+      std::string name;
+      message = nullptr;
+      if (!c.integer(id) || !c.word(name) || !c.literal(':') || !c.integer(dlc))
+      {
+        what = "malformed BO_";
+      }
+      else if (dlc > 8)
+      {
+        skipping = true;
+      }
+      else
+      {
+        skipping = false;
+        DbcMessage m;
+        m.extended = (id & DBC_EXTENDED_FLAG) != 0;
+        m.id = (uint32_t)(id & 0x1FFFFFFF);
+        m.name = name;
+        m.dlc = (uint8_t)dlc;
+        _messages.push_back(m);
+        message = &_messages.back();
+      }
+    }
+    else if (keyword == "SG_")
+    {
+      DbcSignal s;
+      if (skipping) continue;
+      if (!message) what = "SG_ outside a message";
+      else if (parseSignal(c, s, what)) message->signals.push_back(s);
+    }
+    else if (keyword == "SIG_VALTYPE_")
+    {
+      // SIG_VALTYPE_ id name : 1;
+      unsigned long id, type;
+      std::string name;
+      if (!c.integer(id) || !c.word(name) || !c.literal(':') || !c.integer(type) || type > 2)
+      {
+        what = "malformed SIG_VALTYPE_";
+      }
+      else
+      {
+        message = nullptr;
+        for (DbcMessage &m : _messages)
+        {
+          if (m.id != (id & 0x1FFFFFFF) || m.extended != ((id & DBC_EXTENDED_FLAG) != 0)) continue;
+          for (DbcSignal &s : m.signals)
+          {
+            if (s.name != name) continue;
+            if (type && s.length != (type == DBC_FLOAT ? 32 : 64)) what = "SIG_VALTYPE_ does not match the signal length";
+            else s.valueType = (uint8_t)type;
+          }
+        }
+      }
+    }
+    else if (!keyword.empty())
+    {
+      // any other section ends the signal list of the current message
+      message = nullptr;
+      skipping = false;
+    }
+
+    if (what)
+    {
+      _messages.clear();
+      if (error) *error = "line " + std::to_string(lineNumber) + ": " + what;
+      errno = EINVAL;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DbcFile::load(const char *path, std::string *error)
+{
+  FILE *in = fopen(path, "rb");
+  if (!in)
+  {
+    if (error) *error = strerror(errno);
+    return false;
+  }
+  std::string text;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) text.append(buf, n);
+  bool readError = ferror(in) != 0;
+  fclose(in);
+  if (readError)
+  {
+    if (error) *error = "read error";
+    errno = EIO;
+    return false;
+  }
+  return parse(text, error);
+}
+
+const DbcMessage *DbcFile::find(uint32_t id, bool extended) const
+{
+  for (const DbcMessage &m : _messages)
+  {
+    if (m.id == id && m.extended == extended) return &m;
+  }
+  return nullptr;
+}
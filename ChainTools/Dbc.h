@@ -0,0 +1,69 @@
+/*
+  Dbc.h - Messages and signals of a Vector CAN database (.dbc)
+
+  Reads what decoding needs: BO_ messages, their SG_ signals (Intel @1 and
+  Motorola @0 byte order, signed or not, factor, offset, range, unit,
+  multiplexor M and multiplexed mN signals) and SIG_VALTYPE_ for IEEE
+  float/double signals. Everything else (nodes, comments, attributes,
+  value tables) is skipped, and so are CAN FD messages longer than the 8
+  bytes a CanFrame holds. A message ID with bit 31 set is a 29 bit ID, as
+  the DBC format writes it.
+*/
+
+#ifndef Dbc_h
+#define Dbc_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// DbcSignal.multiplex
+#define DBC_PLAIN        -1  // always present
+#define DBC_MULTIPLEXOR  -2  // selects which multiplexed signals a frame holds
+
+// DbcSignal.valueType
+#define DBC_INTEGER  0
+#define DBC_FLOAT    1  // IEEE single, length 32
+#define DBC_DOUBLE   2  // IEEE double, length 64
+
+struct DbcSignal
+{
+  std::string name;
+  uint16_t startBit;   // as in the file: LSB for Intel, MSB (sawtooth numbering) for Motorola
+  uint8_t length;
+  bool motorola;       // @0, big endian
+  bool isSigned;       // -
+  uint8_t valueType;
+  int multiplex;       // DBC_PLAIN, DBC_MULTIPLEXOR or the multiplexor value it appears at
+  double factor;
+  double offset;
+  double minimum;
+  double maximum;
+  std::string unit;
+};
+
+struct DbcMessage
+{
+  uint32_t id;
+  bool extended;
+  std::string name;
+  uint8_t dlc;
+  std::vector<DbcSignal> signals;
+};
+
+class DbcFile
+{
+  public:
+    /**Reads path. Returns false with errno set, or EINVAL and a "line n: ..." message in error*/
+    bool load(const char *path, std::string *error = nullptr);
+    /**Reads DBC text from memory*/
+    bool parse(const std::string &text, std::string *error = nullptr);
+
+    const std::vector<DbcMessage> &messages() const { return _messages; }
+    const DbcMessage *find(uint32_t id, bool extended) const;
+
+  private:
+    std::vector<DbcMessage> _messages;
+};
+
+#endif
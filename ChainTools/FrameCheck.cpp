@@ -0,0 +1,357 @@
+#include "FrameCheck.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Crc.h"
+
+/*A 29 bit ID as a DBC file writes it*/
+#define CHECK_EXTENDED_FLAG  0x80000000UL
+
+/**Parses an unsigned number (decimal or 0x hex) that is all of text and at most max*/
+static bool number(const char *text, unsigned long max, unsigned long &value)
+{
+  char *end;
+  errno = 0;
+  value = strtoul(text, &end, 0);
+  return end != text && *end == 0 && errno == 0 && value <= max;
+}
+
+/**One "key=value" rule into rule; what says why it is not one*/
+static bool parseKey(const std::string &token, CheckRule &rule, bool &over, const char *&what)
+{
+  size_t eq = token.find('=');
+  std::string key = token.substr(0, eq);
+  std::string value = eq == std::string::npos ? "" : token.substr(eq + 1);
+  unsigned long a, b;
+  what = "bad value";
+  if (key == "xor" || key == "sum" || key == "j1850" || key == "h2f")
+  {
+    if (rule.scheme != CHECK_NONE)
+    {
+      what = "two checksums";
+      return false;
+    }
+    if (!number(value.c_str(), 7, a)) return false;
+    rule.at = (uint8_t)a;
+    if (key == "xor") rule.scheme = CHECK_XOR;
+    else if (key == "sum") rule.scheme = CHECK_SUM;
+    else rule.scheme = key == "j1850" ? CHECK_CRC8_J1850 : CHECK_CRC8_H2F;
+  }
+  else if (key == "over")
+  {
+    size_t dash = value.find('-');
+    if (dash == std::string::npos || !number(value.substr(0, dash).c_str(), 7, a)
+        || !number(value.substr(dash + 1).c_str(), 7, b) || b < a)
+    {
+      return false;
+    }
+    rule.first = (uint8_t)a;
+    rule.last = (uint8_t)b;
+    over = true;
+  }
+  else if (key == "init")
+  {
+    if (!number(value.c_str(), 0xFF, a)) return false;
+    rule.init = (uint8_t)a;
+  }
+  else if (key == "counter")
+  {
+    size_t slash = value.find('/');
+    if (slash == std::string::npos || !number(value.substr(0, slash).c_str(), 63, a)
+        || !number(value.substr(slash + 1).c_str(), 8, b) || b == 0 || a + b > 64)
+    {
+      return false;
+    }
+    rule.counterStart = (int)a;
+    rule.counterLength = (uint8_t)b;
+  }
+  else if (key == "max")
+  {
+    if (!number(value.c_str(), 0xFF, a) || a == 0) return false;
+    rule.counterMax = (uint8_t)a;
+  }
+  else
+  {
+    what = "unknown rule";
+    return false;
+  }
+  what = nullptr;
+  return true;
+}
+
+bool parseCheckRules(const std::string &text, std::vector<CheckRule> &rules, std::string *error)
+{
+  rules.clear();
+  int lineNumber = 0;
+  size_t pos = 0;
+  while (pos < text.size())
+  {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos) eol = text.size();
+    std::string line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+    lineNumber++;
+    size_t hash = line.find('#');
+    if (hash != std::string::npos) line.erase(hash);
+
+    std::vector<std::string> tokens;
+    for (size_t i = 0; i < line.size();)
+    {
+      size_t start = line.find_first_not_of(" \t\r", i);
+      if (start == std::string::npos) break;
+      size_t stop = line.find_first_of(" \t\r", start);
+      if (stop == std::string::npos) stop = line.size();
+      tokens.push_back(line.substr(start, stop - start));
+      i = stop;
+    }
+    if (tokens.empty()) continue;
+
+    CheckRule rule;
+    memset(&rule, 0, sizeof(rule));
+    rule.counterStart = -1;
+    bool over = false;
+    bool initGiven = false;
+    bool maxGiven = false;
+    const char *what = nullptr;
+    unsigned long id;
+    if (!number(tokens[0].c_str(), 0xFFFFFFFFUL, id)
+        || (id & ~CHECK_EXTENDED_FLAG) > ((id & CHECK_EXTENDED_FLAG) ? 0x1FFFFFFFUL : 0x7FFUL))
+    {
+      what = "bad ID";
+    }
+    for (size_t t = 1; t < tokens.size() && !what; t++)
+    {
+      initGiven |= tokens[t].compare(0, 5, "init=") == 0;
+      maxGiven |= tokens[t].compare(0, 4, "max=") == 0;
+      parseKey(tokens[t], rule, over, what);
+    }
+    if (!what)
+    {
+      rule.extended = (id & CHECK_EXTENDED_FLAG) != 0;
+      rule.id = (uint32_t)(id & ~CHECK_EXTENDED_FLAG);
+      if (!over)
+      {
+        rule.first = 0;
+        rule.last = CHECK_TO_END;
+      }
+      if (!initGiven) rule.init = rule.scheme == CHECK_CRC8_J1850 || rule.scheme == CHECK_CRC8_H2F ? 0xFF : 0;
+      if (!maxGiven) rule.counterMax = (uint8_t)((1U << rule.counterLength) - 1);
+      if (rule.scheme == CHECK_NONE && rule.counterStart < 0) what = "nothing to check";
+      else if (rule.counterStart >= 0 && rule.counterMax >= (1U << rule.counterLength)) what = "max does not fit the counter";
+      for (const CheckRule &r : rules)
+      {
+        if (!what && r.id == rule.id && r.extended == rule.extended) what = "ID listed twice";
+      }
+    }
+    if (what)
+    {
+      rules.clear();
+      if (error) *error = "line " + std::to_string(lineNumber) + ": " + what;
+      errno = EINVAL;
+      return false;
+    }
+    rules.push_back(rule);
+  }
+  return true;
+}
+
+bool loadCheckRules(const char *path, std::vector<CheckRule> &rules, std::string *error)
+{
+  FILE *in = fopen(path, "rb");
+  if (!in)
+  {
+    if (error) *error = strerror(errno);
+    return false;
+  }
+  std::string text;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) text.append(buf, n);
+  bool readError = ferror(in) != 0;
+  fclose(in);
+  if (readError)
+  {
+    if (error) *error = "read error";
+    errno = EIO;
+    return false;
+  }
+  return parseCheckRules(text, rules, error);
+}
+
+/**Mask of the first dlc bytes of a payload word*/
+static inline uint64_t dlcMask(uint8_t dlc)
+{
+  return dlc >= 8 ? ~0ULL : (1ULL << (dlc * 8)) - 1;
+}
+
+static void checkXor(const uint64_t *words, const uint8_t *dlc, size_t n, uint64_t cover, uint8_t init, uint8_t *out)
+{
+  for (size_t k = 0; k < n; k++)
+  {
+    uint64_t w = words[k] & cover & dlcMask(dlc[k]);
+    w ^= w >> 32;
+    w ^= w >> 16;
+    w ^= w >> 8;
+    out[k] = (uint8_t)(w ^ init);
+  }
+}
+
+static void checkSum(const uint64_t *words, const uint8_t *dlc, size_t n, uint64_t cover, uint8_t init, uint8_t *out)
+{
+  for (size_t k = 0; k < n; k++)
+  {
+    // bytes into 16 bit lanes, then all four lanes into the top one: no lane can carry over
+    uint64_t w = words[k] & cover & dlcMask(dlc[k]);
+    uint64_t lanes = (w & 0x00FF00FF00FF00FFULL) + ((w >> 8) & 0x00FF00FF00FF00FFULL);
+    out[k] = (uint8_t)(((lanes * 0x0001000100010001ULL) >> 48) + init);
+  }
+}
+
+static void checkCrc(uint8_t (*crc)(const uint8_t *, size_t, uint8_t), const uint64_t *words, const uint8_t *dlc,
+                     size_t n, const CheckRule &rule, uint8_t *out)
+{
+  for (size_t k = 0; k < n; k++)
+  {
+    const uint8_t *bytes = (const uint8_t *)&words[k];
+    size_t end = rule.last == CHECK_TO_END || rule.last >= dlc[k] ? dlc[k] : (size_t)rule.last + 1;
+    uint8_t value = rule.init;
+    if (rule.at >= rule.first && rule.at < end)
+    {
+      // around the checksum byte: the second part continues from the first
+      value = crc(bytes + rule.first, rule.at - rule.first, value) ^ 0xFF;
+      value = crc(bytes + rule.at + 1, end - rule.at - 1, value);
+    }
+    else value = crc(bytes + rule.first, end > rule.first ? end - rule.first : 0, value);
+    out[k] = value;
+  }
+}
+
+FrameChecker::FrameChecker(const std::vector<CheckRule> &rules) : _standard(0x800, -1), _frameBase(0), _unchecked(0)
+{
+  for (const CheckRule &r : rules)
+  {
+    if (r.extended ? _extended.count(r.id) != 0 : r.id > 0x7FF || _standard[r.id] >= 0) continue;
+    Rule rule;
+    rule.rule = r;
+    rule.cover = 0;
+    rule.sumNeeds = 0;
+    rule.counterNeeds = 0;
+    if (r.scheme != CHECK_NONE)
+    {
+      uint8_t last = r.last == CHECK_TO_END ? 7 : r.last;
+      for (uint8_t b = r.first; b <= last; b++)
+      {
+        if (b != r.at) rule.cover |= 0xFFULL << (b * 8);
+      }
+      rule.sumNeeds = (uint8_t)(r.at + 1);
+      if (r.last != CHECK_TO_END && r.last + 1 > rule.sumNeeds) rule.sumNeeds = (uint8_t)(r.last + 1);
+    }
+    if (r.counterStart >= 0) rule.counterNeeds = (uint8_t)((r.counterStart + r.counterLength + 7) / 8);
+    rule.haveCounter = false;
+    rule.last = 0;
+    int32_t index = (int32_t)_rules.size();
+    _rules.push_back(std::move(rule));
+    if (r.extended) _extended[r.id] = index;
+    else _standard[r.id] = index;
+
+    CheckResult result;
+    result.id = r.id;
+    result.extended = r.extended;
+    result.frames = 0;
+    result.checksumErrors = 0;
+    result.counterErrors = 0;
+    result.shortFrames = 0;
+    _results.push_back(result);
+  }
+}
+
+int FrameChecker::_lookup(const CanFrame &frame) const
+{
+  if (frame.flags & FRAME_RTR) return -1;
+  if (!(frame.flags & FRAME_EXTENDED)) return frame.id <= 0x7FF ? _standard[frame.id] : -1;
+  auto it = _extended.find(frame.id);
+  return it == _extended.end() ? -1 : it->second;
+}
+
+void FrameChecker::check(const CanFrame *frames, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    int r = _lookup(frames[i]);
+    if (r >= 0) _rules[r].rows.push_back((uint32_t)i);
+    else _unchecked++;
+  }
+  for (size_t r = 0; r < _rules.size(); r++)
+  {
+    if (_rules[r].rows.empty()) continue;
+    _checkRule(r, frames);
+    _rules[r].rows.clear();
+  }
+  _frameBase += count;
+}
+
+void FrameChecker::_checkRule(size_t r, const CanFrame *frames)
+{
+  Rule &rule = _rules[r];
+  const CheckRule &c = rule.rule;
+  CheckResult &result = _results[r];
+  size_t n = rule.rows.size();
+  _payload.resize(n);
+  _dlc.resize(n);
+  _kind.resize(n);
+  for (size_t k = 0; k < n; k++)
+  {
+    const CanFrame &f = frames[rule.rows[k]];
+    memcpy(&_payload[k], f.data, 8);
+    _dlc[k] = f.dlc;
+    _kind[k] = f.dlc < rule.sumNeeds || f.dlc < rule.counterNeeds ? CHECK_FAIL_SHORT : 0;
+  }
+
+  if (c.scheme != CHECK_NONE)
+  {
+    _computed.resize(n);
+    if (c.scheme == CHECK_XOR) checkXor(_payload.data(), _dlc.data(), n, rule.cover, c.init, _computed.data());
+    else if (c.scheme == CHECK_SUM) checkSum(_payload.data(), _dlc.data(), n, rule.cover, c.init, _computed.data());
+    else checkCrc(c.scheme == CHECK_CRC8_J1850 ? crc8SaeJ1850 : crc8H2f, _payload.data(), _dlc.data(), n, c, _computed.data());
+    for (size_t k = 0; k < n; k++)
+    {
+      uint8_t stored = (uint8_t)(_payload[k] >> (c.at * 8));
+      if (_dlc[k] >= rule.sumNeeds && stored != _computed[k]) _kind[k] |= CHECK_FAIL_SUM;
+    }
+  }
+
+  if (c.counterStart >= 0)
+  {
+    uint64_t mask = (1ULL << c.counterLength) - 1;
+    _counter.resize(n);
+    for (size_t k = 0; k < n; k++) _counter[k] = (uint8_t)((_payload[k] >> c.counterStart) & mask);
+    for (size_t k = 0; k < n; k++)
+    {
+      if (_dlc[k] < rule.counterNeeds) continue;
+      uint8_t expect = rule.last >= c.counterMax ? 0 : (uint8_t)(rule.last + 1);
+      if (rule.haveCounter && _counter[k] != expect) _kind[k] |= CHECK_FAIL_COUNTER;
+      rule.last = _counter[k];
+      rule.haveCounter = true;
+    }
+  }
+
+  result.frames += n;
+  for (size_t k = 0; k < n; k++)
+  {
+    if (!_kind[k]) continue;
+    result.checksumErrors += (_kind[k] & CHECK_FAIL_SUM) != 0;
+    result.counterErrors += (_kind[k] & CHECK_FAIL_COUNTER) != 0;
+    result.shortFrames += (_kind[k] & CHECK_FAIL_SHORT) != 0;
+    if (result.first.size() < FRAME_CHECK_FIRST)
+    {
+      CheckFailure failure;
+      failure.index = _frameBase + rule.rows[k];
+      failure.msgNum = frames[rule.rows[k]].msgNum;
+      failure.kind = _kind[k];
+      result.first.push_back(failure);
+    }
+  }
+}
@@ -0,0 +1,143 @@
+/*
+  FrameCheck.h - Payload checksum and alive counter validation per CAN ID
+
+  Replaces UI/SubVI/CheckSum.vi. A rules file says, per ID, where its
+  checksum byte is, which bytes it covers and how it is computed, and
+  where its rolling alive counter sits:
+
+    # ID   rules
+    0x0A0  counter=56/4
+    0x123  j1850=0 over=1-7 counter=8/4
+    0x2F0  xor=7 init=0x5A
+    0x98FEF100  sum=7 over=0-6 counter=48/4 max=14
+
+    xor=B sum=B j1850=B h2f=B  checksum in byte B: XOR or sum (mod 256) of
+                               the bytes, CRC-8 SAE J1850 or AUTOSAR
+                               CRC-8H2F; covers all other bytes of the
+                               frame unless over=first-last is given
+    init=N                     start value (0, or 0xFF for the CRCs)
+    counter=start/length       Intel bit position and length (up to 8)
+    max=N                      the counter wraps from N to 0 (2^length - 1)
+
+  IDs are written as in a DBC file, 29 bit ones with bit 31 set.
+
+  check() works like SignalDecoder::decode(): it sorts a batch of frames
+  by ID, gathers every checked ID's payloads into one array and runs its
+  rule over the whole column at once: XOR and sum fold the masked 64 bit
+  words without branches, CRCs go through a 256 entry table, and the
+  counter check is a compare of every value against the one before. The
+  counters carry over from one batch to the next, so a log can be checked
+  batch by batch as it is parsed.
+*/
+
+#ifndef FrameCheck_h
+#define FrameCheck_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CanFrame.h"
+
+/*Failing frames remembered per ID*/
+#define FRAME_CHECK_FIRST  8
+
+/*CheckRule.last when no over= is given*/
+#define CHECK_TO_END  0xFF
+
+enum CheckScheme
+{
+  CHECK_NONE,
+  CHECK_XOR,
+  CHECK_SUM,
+  CHECK_CRC8_J1850,
+  CHECK_CRC8_H2F,
+};
+
+struct CheckRule
+{
+  uint32_t id;
+  bool extended;
+  CheckScheme scheme;
+  uint8_t at;             // checksum byte
+  uint8_t first;          // covered bytes, the checksum byte left out
+  uint8_t last;           // CHECK_TO_END: up to the end of each frame
+  uint8_t init;
+  int counterStart;       // -1: no counter
+  uint8_t counterLength;
+  uint8_t counterMax;
+};
+
+// CheckFailure.kind
+#define CHECK_FAIL_SUM      1  // checksum mismatch
+#define CHECK_FAIL_COUNTER  2  // counter not the last one + 1: repeated or frames lost
+#define CHECK_FAIL_SHORT    4  // frame too short for the checksum or counter
+
+struct CheckFailure
+{
+  uint64_t index;   // frame number counted over all check() calls
+  uint32_t msgNum;
+  uint8_t kind;
+};
+
+struct CheckResult
+{
+  uint32_t id;
+  bool extended;
+  uint64_t frames;
+  uint64_t checksumErrors;
+  uint64_t counterErrors;
+  uint64_t shortFrames;
+  std::vector<CheckFailure> first;  // the first FRAME_CHECK_FIRST failing frames
+};
+
+/**Reads a rules file. Returns false with errno set, or EINVAL and a "line n: ..." message in error*/
+bool loadCheckRules(const char *path, std::vector<CheckRule> &rules, std::string *error = nullptr);
+/**Reads rules text from memory*/
+bool parseCheckRules(const std::string &text, std::vector<CheckRule> &rules, std::string *error = nullptr);
+
+class FrameChecker
+{
+  public:
+    explicit FrameChecker(const std::vector<CheckRule> &rules);
+
+    /**Checks a batch of frames, continuing the counters of the last one*/
+    void check(const CanFrame *frames, size_t count);
+
+    /**One per rule, in rule order*/
+    const std::vector<CheckResult> &results() const { return _results; }
+    /**Frames without a rule, and RTR frames*/
+    uint64_t unchecked() const { return _unchecked; }
+
+  private:
+    struct Rule
+    {
+      CheckRule rule;
+      uint64_t cover;          // mask of the covered bytes in the payload word
+      uint8_t sumNeeds;        // dlc the checksum and the counter need
+      uint8_t counterNeeds;
+      bool haveCounter;        // last is valid
+      uint8_t last;
+      std::vector<uint32_t> rows;
+    };
+
+    int _lookup(const CanFrame &frame) const;
+    void _checkRule(size_t r, const CanFrame *frames);
+
+    std::vector<Rule> _rules;
+    std::vector<CheckResult> _results;
+    std::vector<int32_t> _standard;  // rule of every 11 bit ID, -1 if none
+    std::unordered_map<uint32_t, int32_t> _extended;
+    uint64_t _frameBase;             // index of the first frame of the batch
+    uint64_t _unchecked;
+    // scratch for one rule: payload words, dlcs, checksums, counters and per row failure kinds
+    std::vector<uint64_t> _payload;
+    std::vector<uint8_t> _dlc;
+    std::vector<uint8_t> _computed;
+    std::vector<uint8_t> _counter;
+    std::vector<uint8_t> _kind;
+};
+
+#endif
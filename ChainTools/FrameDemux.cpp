@@ -0,0 +1,125 @@
+#include "FrameDemux.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+/*Fewest frames worth a chunk of their own, and chunks per thread to even out the load*/
+#define DEMUX_MIN_CHUNK          16384
+#define DEMUX_CHUNKS_PER_THREAD  4
+
+/*Keys below this (the 11 bit IDs) are counted in a table, the rest in a map*/
+#define DEMUX_TABLE  0x800
+
+/**Group key: standard and extended IDs with the same number are different IDs*/
+static inline uint64_t idKey(const CanFrame &f)
+{
+  return (uint64_t)(f.flags & FRAME_EXTENDED) << 32 | f.id;
+}
+
+namespace
+{
+  struct Chunk
+  {
+    size_t begin;
+    size_t end;
+    std::vector<uint64_t> table;                    // frames of every key below DEMUX_TABLE
+    std::unordered_map<uint64_t, uint64_t> others;  // and of the others
+    std::vector<uint64_t> next;                     // write position in every group
+  };
+}
+
+void FrameDemux::split(const CanFrame *frames, size_t count)
+{
+  size_t chunkCount = count / DEMUX_MIN_CHUNK;
+  size_t most = (size_t)_pool.threads() * DEMUX_CHUNKS_PER_THREAD;
+  if (chunkCount > most) chunkCount = most;
+  if (chunkCount == 0) chunkCount = 1;
+  std::vector<Chunk> chunks(chunkCount);
+  for (size_t c = 0; c < chunkCount; c++)
+  {
+    chunks[c].begin = count * c / chunkCount;
+    chunks[c].end = count * (c + 1) / chunkCount;
+  }
+
+  // pass 1: a histogram per chunk
+  _pool.run(chunkCount, [&](size_t c) {
+    Chunk &chunk = chunks[c];
+    chunk.table.assign(DEMUX_TABLE, 0);
+    for (size_t i = chunk.begin; i < chunk.end; i++)
+    {
+      uint64_t key = idKey(frames[i]);
+      if (key < DEMUX_TABLE) chunk.table[key]++;
+      else chunk.others[key]++;
+    }
+  });
+
+  // the groups, sorted by key, and their sizes
+  std::vector<uint64_t> keys;
+  std::vector<uint64_t> totals(DEMUX_TABLE, 0);
+  std::unordered_map<uint64_t, uint64_t> otherTotals;
+  for (const Chunk &chunk : chunks)
+  {
+    for (uint64_t key = 0; key < DEMUX_TABLE; key++) totals[key] += chunk.table[key];
+    for (const auto &other : chunk.others) otherTotals[other.first] += other.second;
+  }
+  for (uint64_t key = 0; key < DEMUX_TABLE; key++)
+  {
+    if (totals[key]) keys.push_back(key);
+  }
+  for (const auto &other : otherTotals) keys.push_back(other.first);
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<int32_t> tableGroup(DEMUX_TABLE, -1);
+  std::unordered_map<uint64_t, uint32_t> otherGroup;
+  _groups.resize(keys.size());
+  uint64_t offset = 0;
+  for (uint32_t g = 0; g < keys.size(); g++)
+  {
+    uint64_t key = keys[g];
+    DemuxGroup &group = _groups[g];
+    group.id = (uint32_t)key;
+    group.flags = (uint8_t)(key >> 32);
+    group.first = offset;
+    group.count = key < DEMUX_TABLE ? totals[key] : otherTotals[key];
+    offset += group.count;
+    if (key < DEMUX_TABLE) tableGroup[key] = (int32_t)g;
+    else otherGroup[key] = g;
+  }
+
+  // prefix sums in chunk order: each chunk writes behind the frames of the chunks before it
+  std::vector<uint64_t> position(keys.size());
+  for (uint32_t g = 0; g < keys.size(); g++) position[g] = _groups[g].first;
+  for (Chunk &chunk : chunks)
+  {
+    chunk.next = position;
+    for (uint64_t key = 0; key < DEMUX_TABLE; key++)
+    {
+      if (chunk.table[key]) position[tableGroup[key]] += chunk.table[key];
+    }
+    for (const auto &other : chunk.others) position[otherGroup[other.first]] += other.second;
+  }
+
+  // pass 2: scatter, every chunk into its own slots
+  _frames.resize(count);
+  _sources.resize(count);
+  _pool.run(chunkCount, [&](size_t c) {
+    Chunk &chunk = chunks[c];
+    for (size_t i = chunk.begin; i < chunk.end; i++)
+    {
+      uint64_t key = idKey(frames[i]);
+      uint32_t g = key < DEMUX_TABLE ? (uint32_t)tableGroup[key] : otherGroup.find(key)->second;
+      uint64_t slot = chunk.next[g]++;
+      _frames[slot] = frames[i];
+      _sources[slot] = i;
+    }
+  });
+}
+
+const DemuxGroup *FrameDemux::find(uint32_t id, bool extended) const
+{
+  uint64_t key = (uint64_t)(extended ? FRAME_EXTENDED : 0) << 32 | id;
+  auto it = std::lower_bound(_groups.begin(), _groups.end(), key, [](const DemuxGroup &g, uint64_t k) {
+    return ((uint64_t)g.flags << 32 | g.id) < k;
+  });
+  return it != _groups.end() && ((uint64_t)it->flags << 32 | it->id) == key ? &*it : nullptr;
+}
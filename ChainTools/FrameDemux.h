@@ -0,0 +1,62 @@
+/*
+  FrameDemux.h - Splitting a frame array into per-ID streams on all cores
+
+  Replaces UI/SubVI/Message splitter.vi. split() cuts the frames into
+  chunks and works in two passes over them on a ThreadPool:
+
+    count    every chunk makes its own histogram of IDs
+    scatter  prefix sums over the histograms, chunk by chunk in input
+             order, give every chunk its own write position in each ID's
+             stream; the chunks then copy their frames there
+
+  No two chunks ever write the same slot, so the scatter takes no locks,
+  and every ID's frames keep their input (time) order. The result is one
+  contiguous CanFrame array per ID, sorted by ID like a column store
+  directory, plus the input position of every frame, for the per-ID
+  analyses to take directly.
+*/
+
+#ifndef FrameDemux_h
+#define FrameDemux_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "CanFrame.h"
+#include "ThreadPool.h"
+
+struct DemuxGroup
+{
+  uint32_t id;
+  uint8_t flags;   // FRAME_EXTENDED for a 29 bit ID
+  uint64_t first;  // of the group's frames in frames() and sources()
+  uint64_t count;
+};
+
+class FrameDemux
+{
+  public:
+    explicit FrameDemux(ThreadPool &pool) : _pool(pool) {}
+
+    /**Splits frames by ID, replacing the last split*/
+    void split(const CanFrame *frames, size_t count);
+
+    /**Groups sorted by ID, standard IDs first*/
+    size_t groupCount() const { return _groups.size(); }
+    const DemuxGroup *groups() const { return _groups.data(); }
+    /**Group of id, NULL if the frames have no such ID*/
+    const DemuxGroup *find(uint32_t id, bool extended) const;
+
+    const CanFrame *frames(const DemuxGroup &group) const { return _frames.data() + group.first; }
+    /**Position of every frame of the group in the input of split()*/
+    const uint64_t *sources(const DemuxGroup &group) const { return _sources.data() + group.first; }
+
+  private:
+    ThreadPool &_pool;
+    std::vector<DemuxGroup> _groups;
+    std::vector<CanFrame> _frames;
+    std::vector<uint64_t> _sources;
+};
+
+#endif
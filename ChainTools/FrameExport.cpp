@@ -0,0 +1,394 @@
+#include "FrameExport.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+/*Longest line of any text format, and the size of an MDF record*/
+#define EXPORT_LINE_MAX   96
+#define MDF_RECORD_BYTES  24
+
+/*MDF block and channel constants used here (ASAM MDF 4.1)*/
+#define MDF_ID_SIZE         64
+#define MDF_CN_FIXED        0
+#define MDF_CN_MASTER       2
+#define MDF_SYNC_NONE       0
+#define MDF_SYNC_TIME       1
+#define MDF_UINT_LE         0
+#define MDF_FLOAT_LE        4
+#define MDF_BYTE_ARRAY      10
+#define MDF_CN_BUS_EVENT    0x0400
+#define MDF_CG_BUS_EVENT    0x0002
+#define MDF_CG_PLAIN_BUS    0x0004
+#define MDF_SI_BUS          2
+#define MDF_BUS_CAN         2
+#define MDF_UNFIN_CYCLES    0x0001
+#define MDF_UNFIN_DT_LENGTH 0x0004
+
+bool exportFormat(const char *path, ExportFormat &format)
+{
+  const char *dot = strrchr(path, '.');
+  if (!dot) return false;
+  if (strcasecmp(dot, ".log") == 0) format = EXPORT_CANDUMP;
+  else if (strcasecmp(dot, ".asc") == 0) format = EXPORT_ASC;
+  else if (strcasecmp(dot, ".mf4") == 0 || strcasecmp(dot, ".mdf") == 0) format = EXPORT_MDF4;
+  else return false;
+  return true;
+}
+
+static void put16(std::vector<uint8_t> &b, size_t at, uint16_t v)
+{
+  memcpy(&b[at], &v, sizeof(v));
+}
+
+static void put32(std::vector<uint8_t> &b, size_t at, uint32_t v)
+{
+  memcpy(&b[at], &v, sizeof(v));
+}
+
+static void put64(std::vector<uint8_t> &b, size_t at, uint64_t v)
+{
+  memcpy(&b[at], &v, sizeof(v));
+}
+
+/**Appends an empty block with links links and dataSize data bytes (a multiple of 8) to b; returns its offset*/
+static uint64_t mdfBlock(std::vector<uint8_t> &b, const char *id, uint32_t links, size_t dataSize)
+{
+  uint64_t at = b.size();
+  uint64_t length = 24 + links * 8 + dataSize;
+  b.resize(at + length, 0);
+  memcpy(&b[at], id, 4);
+  put64(b, at + 8, length);
+  put64(b, at + 16, links);
+  return at;
+}
+
+static void mdfLink(std::vector<uint8_t> &b, uint64_t block, uint32_t link, uint64_t target)
+{
+  put64(b, block + 24 + link * 8, target);
+}
+
+/**TX or MD block holding text, NUL terminated and padded to 8 bytes*/
+static uint64_t mdfText(std::vector<uint8_t> &b, const char *id, const char *text)
+{
+  size_t n = strlen(text) + 1;
+  uint64_t at = mdfBlock(b, id, 0, (n + 7) & ~(size_t)7);
+  memcpy(&b[at + 24], text, n);
+  return at;
+}
+
+/**CN block of a channel at byteOffset/bitOffset with bitCount bits; links are set by the caller*/
+static uint64_t mdfChannel(std::vector<uint8_t> &b, const char *name, uint8_t type, uint8_t sync, uint8_t dataType,
+                           uint32_t byteOffset, uint8_t bitOffset, uint32_t bitCount, uint32_t flags)
+{
+  uint64_t tx = mdfText(b, "##TX", name);
+  uint64_t at = mdfBlock(b, "##CN", 8, 72);
+  mdfLink(b, at, 2, tx);
+  size_t d = at + 24 + 8 * 8;
+  b[d] = type;
+  b[d + 1] = sync;
+  b[d + 2] = dataType;
+  b[d + 3] = bitOffset;
+  put32(b, d + 4, byteOffset);
+  put32(b, d + 8, bitCount);
+  put32(b, d + 12, flags);
+  return at;
+}
+
+void FrameExporter::_mdfHeader()
+{
+  std::vector<uint8_t> b(MDF_ID_SIZE, 0);
+  // ID block: unfinished until close() has patched the counts
+  memcpy(&b[0], "UnFinMF ", 8);
+  memcpy(&b[8], "4.10    ", 8);
+  memcpy(&b[16], "ChainTls", 8);
+  put16(b, 28, 410);
+  put16(b, 60, MDF_UNFIN_CYCLES | MDF_UNFIN_DT_LENGTH);
+
+  uint64_t created = (uint64_t)time(NULL) * 1000000000ULL;
+  uint64_t hd = mdfBlock(b, "##HD", 6, 32);
+  put64(b, hd + 24 + 6 * 8, created);
+  uint64_t fh = mdfBlock(b, "##FH", 2, 16);
+  mdfLink(b, hd, 1, fh);
+  put64(b, fh + 24 + 2 * 8, created);
+  mdfLink(b, fh, 1, mdfText(b, "##MD", "<FHcomment><TX>created</TX><tool_id>ChainTools</tool_id>"
+                                       "<tool_vendor>ChainLogger</tool_vendor><tool_version>1</tool_version></FHcomment>"));
+
+  uint64_t dg = mdfBlock(b, "##DG", 4, 8);
+  mdfLink(b, hd, 0, dg);
+  uint64_t cg = mdfBlock(b, "##CG", 6, 32);
+  mdfLink(b, dg, 1, cg);
+  mdfLink(b, cg, 2, mdfText(b, "##TX", "CAN_DataFrame"));
+  uint64_t si = mdfBlock(b, "##SI", 3, 8);
+  mdfLink(b, si, 0, mdfText(b, "##TX", "CAN"));
+  b[si + 24 + 3 * 8] = MDF_SI_BUS;
+  b[si + 24 + 3 * 8 + 1] = MDF_BUS_CAN;
+  mdfLink(b, cg, 3, si);
+  size_t cgData = cg + 24 + 6 * 8;
+  _mdfCycleCount = cgData + 8;
+  put16(b, cgData + 16, MDF_CG_BUS_EVENT | MDF_CG_PLAIN_BUS);
+  put16(b, cgData + 18, '.');
+  put32(b, cgData + 24, MDF_RECORD_BYTES);
+
+  // record: Timestamp (8), BusChannel (1), ID + IDE in bit 31 (4), DLC (1), DataLength (1), DataBytes (8), pad
+  uint64_t timestamp = mdfChannel(b, "Timestamp", MDF_CN_MASTER, MDF_SYNC_TIME, MDF_FLOAT_LE, 0, 0, 64, 0);
+  mdfLink(b, timestamp, 6, mdfText(b, "##TX", "s"));
+  uint64_t frame = mdfChannel(b, "CAN_DataFrame", MDF_CN_FIXED, MDF_SYNC_NONE, MDF_BYTE_ARRAY, 8, 0, 15 * 8,
+                              MDF_CN_BUS_EVENT);
+  mdfLink(b, timestamp, 0, frame);
+  mdfLink(b, cg, 1, timestamp);
+  struct
+  {
+    const char *name;
+    uint8_t dataType;
+    uint32_t byteOffset;
+    uint8_t bitOffset;
+    uint32_t bitCount;
+  } const members[] = {
+    {"CAN_DataFrame.BusChannel", MDF_UINT_LE, 8, 0, 8},
+    {"CAN_DataFrame.ID", MDF_UINT_LE, 9, 0, 29},
+    {"CAN_DataFrame.IDE", MDF_UINT_LE, 12, 7, 1},
+    {"CAN_DataFrame.DLC", MDF_UINT_LE, 13, 0, 4},
+    {"CAN_DataFrame.DataLength", MDF_UINT_LE, 14, 0, 7},
+    {"CAN_DataFrame.DataBytes", MDF_BYTE_ARRAY, 15, 0, 64},
+  };
+  uint64_t previous = 0;
+  for (const auto &m : members)
+  {
+    uint64_t cn = mdfChannel(b, m.name, MDF_CN_FIXED, MDF_SYNC_NONE, m.dataType, m.byteOffset, m.bitOffset, m.bitCount,
+                             MDF_CN_BUS_EVENT);
+    mdfLink(b, previous ? previous : frame, previous ? 0 : 1, cn);
+    previous = cn;
+  }
+
+  // the records follow in one data block, its length patched by close()
+  _mdfDataBlock = mdfBlock(b, "##DT", 0, 0);
+  mdfLink(b, dg, 2, _mdfDataBlock);
+  _put(b.data(), b.size());
+}
+
+FrameExporter::FrameExporter()
+  : _fd(-1), _format(EXPORT_CANDUMP), _used(0), _count(0), _ok(true), _mdfCycleCount(0), _mdfDataBlock(0)
+{
+}
+
+FrameExporter::~FrameExporter()
+{
+  close();
+}
+
+bool FrameExporter::open(const char *path, ExportFormat format)
+{
+  close();
+  _fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (_fd < 0) return false;
+  _format = format;
+  _buf.resize(EXPORT_BUFFER);
+  _used = 0;
+  _count = 0;
+  _ok = true;
+  if (format == EXPORT_ASC)
+  {
+    char date[64];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%a %b %d %I:%M:%S.000 %p %Y", localtime(&now));
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "date %s\nbase hex  timestamps absolute\ninternal events logged\n// version 9.0.0\n"
+                     "Begin Triggerblock %s\n   0.000000 Start of measurement\n", date, date);
+    _put(header, (size_t)n);
+  }
+  else if (format == EXPORT_MDF4) _mdfHeader();
+  if (_ok) return true;
+  int err = errno;
+  close();
+  errno = err;
+  return false;
+}
+
+bool FrameExporter::_flush()
+{
+  for (size_t done = 0; done < _used && _ok;)
+  {
+    ssize_t n = ::write(_fd, _buf.data() + done, _used - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) _ok = false;
+    else done += (size_t)n;
+  }
+  _used = 0;
+  return _ok;
+}
+
+bool FrameExporter::_put(const void *data, size_t len)
+{
+  if (_used + len > _buf.size() && !_flush()) return false;
+  if (len > _buf.size())
+  {
+    // larger than the buffer: straight through
+    for (size_t done = 0; done < len && _ok;)
+    {
+      ssize_t n = ::write(_fd, (const char *)data + done, len - done);
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0) _ok = false;
+      else done += (size_t)n;
+    }
+    return _ok;
+  }
+  memcpy(_buf.data() + _used, data, len);
+  _used += len;
+  return true;
+}
+
+static char *putTime(char *p, uint64_t timeUs, int width)
+{
+  // seconds right aligned to width digits, then six decimals
+  char digits[24];
+  int n = 0;
+  uint64_t s = timeUs / 1000000;
+  do
+  {
+    digits[n++] = (char)('0' + s % 10);
+    s /= 10;
+  } while (s);
+  for (int i = n; i < width; i++) *p++ = width == 10 ? '0' : ' ';
+  while (n) *p++ = digits[--n];
+  *p++ = '.';
+  uint32_t us = (uint32_t)(timeUs % 1000000);
+  for (int div = 100000; div; div /= 10) *p++ = (char)('0' + us / div % 10);
+  return p;
+}
+
+static char *putId(char *p, const CanFrame &frame)
+{
+  for (int shift = frame.flags & FRAME_EXTENDED ? 28 : 8; shift >= 0; shift -= 4) *p++ = HEX_DIGITS[frame.id >> shift & 0xF];
+  return p;
+}
+
+size_t FrameExporter::_line(const CanFrame &f, char *line) const
+{
+  char *p = line;
+  int dlc = f.dlc < 8 ? f.dlc : 8;
+  if (_format == EXPORT_CANDUMP)
+  {
+    *p++ = '(';
+    p = putTime(p, f.timeUs, 10);
+    memcpy(p, ") can", 5);
+    p += 5;
+    if (f.channel >= 10) *p++ = (char)('0' + f.channel / 10 % 10);
+    *p++ = (char)('0' + f.channel % 10);
+    *p++ = ' ';
+    p = putId(p, f);
+    *p++ = '#';
+    if (f.flags & FRAME_RTR) *p++ = 'R';
+    else
+    {
+      for (int i = 0; i < dlc; i++)
+      {
+        *p++ = HEX_DIGITS[f.data[i] >> 4];
+        *p++ = HEX_DIGITS[f.data[i] & 0xF];
+      }
+    }
+    *p++ = '\n';
+    return (size_t)(p - line);
+  }
+
+  // ASC: time, channel, ID (x for 29 bit) in 16 columns, direction, type, DLC, data
+  p = putTime(p, f.timeUs, 4);
+  *p++ = ' ';
+  unsigned channel = f.channel + 1u;
+  if (channel >= 100) *p++ = (char)('0' + channel / 100 % 10);
+  if (channel >= 10) *p++ = (char)('0' + channel / 10 % 10);
+  *p++ = (char)('0' + channel % 10);
+  *p++ = ' ';
+  *p++ = ' ';
+  char *id = p;
+  p = putId(p, f);
+  if (f.flags & FRAME_EXTENDED) *p++ = 'x';
+  while (p < id + 16) *p++ = ' ';
+  memcpy(p, "Rx   ", 5);
+  p += 5;
+  if (f.flags & FRAME_RTR)
+  {
+    *p++ = 'r';
+    *p++ = ' ';
+    *p++ = HEX_DIGITS[dlc];
+  }
+  else
+  {
+    *p++ = 'd';
+    *p++ = ' ';
+    *p++ = HEX_DIGITS[dlc];
+    for (int i = 0; i < dlc; i++)
+    {
+      *p++ = ' ';
+      *p++ = HEX_DIGITS[f.data[i] >> 4];
+      *p++ = HEX_DIGITS[f.data[i] & 0xF];
+    }
+  }
+  *p++ = '\n';
+  return (size_t)(p - line);
+}
+
+bool FrameExporter::write(const CanFrame *frames, size_t count)
+{
+  if (_fd < 0)
+  {
+    errno = EBADF;
+    return false;
+  }
+  for (size_t i = 0; i < count && _ok; i++)
+  {
+    const CanFrame &f = frames[i];
+    if (_used + EXPORT_LINE_MAX > _buf.size() && !_flush()) break;
+    char *p = _buf.data() + _used;
+    if (_format == EXPORT_MDF4)
+    {
+      uint8_t dlc = f.dlc < 8 ? f.dlc : 8;
+      double t = f.timeUs / 1e6;
+      uint32_t id = f.id & 0x1FFFFFFF;
+      if (f.flags & FRAME_EXTENDED) id |= 0x80000000U;
+      memset(p, 0, MDF_RECORD_BYTES);
+      memcpy(p, &t, 8);
+      p[8] = (char)(f.channel + 1);
+      memcpy(p + 9, &id, 4);
+      p[13] = (char)(f.dlc < 15 ? f.dlc : 15);
+      p[14] = (char)(f.flags & FRAME_RTR ? 0 : dlc);
+      if (!(f.flags & FRAME_RTR)) memcpy(p + 15, f.data, dlc);
+      _used += MDF_RECORD_BYTES;
+    }
+    else _used += _line(f, p);
+  }
+  _count += count;
+  return _ok;
+}
+
+bool FrameExporter::close()
+{
+  if (_fd < 0) return _ok;
+  if (_format == EXPORT_ASC) _put("End TriggerBlock\n", 17);
+  _flush();
+  if (_format == EXPORT_MDF4 && _ok)
+  {
+    // record count, data block length, then the file is finished
+    uint64_t length = 24 + _count * MDF_RECORD_BYTES;
+    uint16_t finished = 0;
+    if (pwrite(_fd, &_count, 8, (off_t)_mdfCycleCount) != 8 || pwrite(_fd, &length, 8, (off_t)_mdfDataBlock + 8) != 8 ||
+        pwrite(_fd, &finished, 2, 60) != 2 || pwrite(_fd, "MDF     ", 8, 0) != 8)
+    {
+      _ok = false;
+    }
+  }
+  int err = errno;
+  if (::close(_fd) != 0) _ok = false;
+  else errno = err;
+  _fd = -1;
+  _buf.clear();
+  _buf.shrink_to_fit();
+  return _ok;
+}
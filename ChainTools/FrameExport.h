@@ -0,0 +1,79 @@
+/*
+  FrameExport.h - Streaming writers for the standard CAN log formats
+
+  Turns CanFrame batches into files the usual tools read, without keeping
+  more than one output buffer (EXPORT_BUFFER) per file:
+
+    EXPORT_CANDUMP  candump -l log (can-utils, python-can):
+                      (0000000012.345678) can0 18FEF100#FFFF00FF00FFFFFF
+    EXPORT_ASC      Vector ASCII log (CANalyzer, CANoe, python-can):
+                      12.345678 1  18FEF100x       Rx   d 8 FF FF 00 FF 00 FF FF FF
+    EXPORT_MDF4     ASAM MDF 4.10 with bus logging (CANape, asammdf): one
+                    data group holding one CAN_DataFrame channel group, so
+                    the file is sorted; records are a Timestamp master
+                    channel and the CAN_DataFrame structure (BusChannel,
+                    ID, IDE, DLC, DataLength, DataBytes), 24 bytes each
+
+  Times are seconds since the start of the capture (CanFrame.timeUs);
+  CanFrame.channel becomes can<n> in candump, channel n + 1 in ASC and
+  BusChannel n + 1 in MDF. Remote requests are written as such in candump
+  and ASC and as frames of no data in MDF. The MDF file is marked
+  unfinished until close() has patched the record count into it.
+*/
+
+#ifndef FrameExport_h
+#define FrameExport_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "CanFrame.h"
+
+/*Output collected per write() call*/
+#define EXPORT_BUFFER  (4UL << 20)
+
+enum ExportFormat
+{
+  EXPORT_CANDUMP,
+  EXPORT_ASC,
+  EXPORT_MDF4
+};
+
+/**Format of an output path by its extension: .log, .asc, .mf4 or .mdf. Returns false for any other*/
+bool exportFormat(const char *path, ExportFormat &format);
+
+class FrameExporter
+{
+  public:
+    FrameExporter();
+    ~FrameExporter();
+    FrameExporter(const FrameExporter &) = delete;
+    FrameExporter &operator=(const FrameExporter &) = delete;
+
+    /**Creates path (truncating it) and writes the format's header. Returns false with errno set*/
+    bool open(const char *path, ExportFormat format);
+    /**Appends frames in time order. Returns false with errno set on a write error*/
+    bool write(const CanFrame *frames, size_t count);
+    /**Writes the trailer (and the MDF record count) and closes the file. Returns false with errno set*/
+    bool close();
+    uint64_t count() const { return _count; }
+
+  private:
+    bool _put(const void *data, size_t len);
+    bool _flush();
+    void _mdfHeader();
+    size_t _line(const CanFrame &frame, char *p) const;
+
+    int _fd;
+    ExportFormat _format;
+    std::vector<char> _buf;
+    size_t _used;
+    uint64_t _count;
+    bool _ok;
+    // MDF: where close() patches the record count and the length of the data block
+    uint64_t _mdfCycleCount;
+    uint64_t _mdfDataBlock;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include "FrameFile.h"
+
+#include <errno.h>
+#include <string.h>
+
+static FrameFileHeader makeHeader(uint64_t count)
+{
+  FrameFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, FRAME_FILE_MAGIC, sizeof(FRAME_FILE_MAGIC));
+  header.recordSize = sizeof(CanFrame);
+  header.count = count;
+  return header;
+}
+
+FrameFileWriter::FrameFileWriter() : _out(nullptr), _count(0), _ok(false)
+{
+}
+
+FrameFileWriter::~FrameFileWriter()
+{
+  close();
+}
+
+bool FrameFileWriter::open(const char *path)
+{
+  close();
+  _out = fopen(path, "wb");
+  if (!_out) return false;
+  // large stdio buffer: the records come in batches of thousands
+  setvbuf(_out, nullptr, _IOFBF, 1 << 20);
+  _count = 0;
+  FrameFileHeader header = makeHeader(0);
+  _ok = fwrite(&header, sizeof(header), 1, _out) == 1;
+  return _ok;
+}
+
+bool FrameFileWriter::write(const CanFrame *frames, size_t count)
+{
+  if (!_out) return false;
+  if (count && fwrite(frames, sizeof(CanFrame), count, _out) != count) _ok = false;
+  _count += count;
+  return _ok;
+}
+
+bool FrameFileWriter::close()
+{
+  if (!_out) return _ok;
+  FrameFileHeader header = makeHeader(_count);
+  if (fseek(_out, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, _out) != 1) _ok = false;
+  if (fclose(_out) != 0) _ok = false;
+  _out = nullptr;
+  return _ok;
+}
+
+bool FrameFile::open(const char *path)
+{
+  _count = 0;
+  if (!_map.open(path)) return false;
+  const FrameFileHeader *header = (const FrameFileHeader *)_map.data();
+  if (_map.size() < sizeof(FrameFileHeader) || memcmp(header->magic, FRAME_FILE_MAGIC, sizeof(FRAME_FILE_MAGIC)) != 0
+      || header->recordSize != sizeof(CanFrame)
+      || header->count > (_map.size() - sizeof(FrameFileHeader)) / sizeof(CanFrame))
+  {
+    _map.close();
+    errno = EINVAL;
+    return false;
+  }
+  _count = (size_t)header->count;
+  return true;
+}
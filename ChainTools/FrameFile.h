@@ -0,0 +1,66 @@
+/*
+  FrameFile.h - Packed binary frame arrays (.bin), the output of txt2bin
+
+  A 32 byte header followed by count CanFrame records exactly as they are
+  in memory (little endian host). Mapping the file gives a CanFrame array
+  without any parsing, which is what the analysis tools start from.
+*/
+
+#ifndef FrameFile_h
+#define FrameFile_h
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "CanFrame.h"
+#include "MappedFile.h"
+
+#define FRAME_FILE_MAGIC  "CHNFRM1"
+
+struct FrameFileHeader
+{
+  char magic[8];        // FRAME_FILE_MAGIC, NUL terminated
+  uint32_t recordSize;  // sizeof(CanFrame)
+  uint32_t flags;       // 0
+  uint64_t count;       // records that follow
+  uint64_t reserved;
+};
+
+static_assert(sizeof(FrameFileHeader) == 32, "FrameFileHeader is a fixed 32 byte record");
+
+class FrameFileWriter
+{
+  public:
+    FrameFileWriter();
+    ~FrameFileWriter();
+
+    /**Creates path (truncating it) and writes a header for 0 records. Returns false with errno set*/
+    bool open(const char *path);
+    bool write(const CanFrame *frames, size_t count);
+    /**Writes the final record count into the header and closes the file. Returns false on a write error*/
+    bool close();
+    uint64_t count() const { return _count; }
+
+  private:
+    FILE *_out;
+    uint64_t _count;
+    bool _ok;
+};
+
+class FrameFile
+{
+  public:
+    /**Maps path. Returns false if it cannot be read or is not a frame file of this build's CanFrame*/
+    bool open(const char *path);
+    void close() { _map.close(); }
+
+    const CanFrame *frames() const { return (const CanFrame *)(_map.data() + sizeof(FrameFileHeader)); }
+    size_t count() const { return _count; }
+    MappedFile &map() { return _map; }
+
+  private:
+    MappedFile _map;
+    size_t _count = 0;
+};
+
+#endif
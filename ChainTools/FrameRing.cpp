@@ -0,0 +1,212 @@
+#include "FrameRing.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+FrameRingWriter::FrameRingWriter() : _header(nullptr), _slots(nullptr), _size(0), _head(0)
+{
+  _name[0] = 0;
+}
+
+FrameRingWriter::~FrameRingWriter()
+{
+  close();
+}
+
+bool FrameRingWriter::create(const char *name, uint32_t capacity)
+{
+  close();
+  if (capacity == 0 || (capacity & (capacity - 1)) || strlen(name) >= sizeof(_name))
+  {
+    errno = EINVAL;
+    return false;
+  }
+  // a new object: readers still on an old ring keep their mapping instead of losing its pages
+  shm_unlink(name);
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) return false;
+  size_t size = sizeof(FrameRingHeader) + (size_t)capacity * sizeof(CanFrame);
+  void *p = MAP_FAILED;
+  if (ftruncate(fd, (off_t)size) == 0) p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  int err = errno;
+  ::close(fd);
+  if (p == MAP_FAILED)
+  {
+    shm_unlink(name);
+    errno = err;
+    return false;
+  }
+
+  // the pages come zeroed; the magic goes in last, when the rest is valid
+  _header = (FrameRingHeader *)p;
+  _slots = (CanFrame *)(_header + 1);
+  _size = size;
+  _head = 0;
+  strcpy(_name, name);
+  _header->recordSize = sizeof(CanFrame);
+  _header->capacity = capacity;
+  _header->writerPid = (int32_t)getpid();
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(_header->magic, FRAME_RING_MAGIC, sizeof(_header->magic));
+  return true;
+}
+
+void FrameRingWriter::publish(const CanFrame *frames, size_t count)
+{
+  if (!_header || count == 0) return;
+  uint64_t capacity = _header->capacity;
+  if (count > capacity)
+  {
+    // only the last capacity frames would survive anyway
+    frames += count - capacity;
+    _head += count - capacity;
+    count = capacity;
+  }
+  uint64_t end = _head + count;
+  _header->claimed.store(end, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  size_t slot = (size_t)(_head & (capacity - 1));
+  size_t first = count < capacity - slot ? count : capacity - slot;
+  memcpy(_slots + slot, frames, first * sizeof(CanFrame));
+  memcpy(_slots, frames + first, (count - first) * sizeof(CanFrame));
+  _header->published.store(end, std::memory_order_release);
+  _head = end;
+}
+
+void FrameRingWriter::close()
+{
+  if (!_header) return;
+  _header->closed.store(1, std::memory_order_release);
+  munmap(_header, _size);
+  // only our own ring: a newer writer may have replaced the name
+  int fd = shm_open(_name, O_RDONLY, 0);
+  if (fd >= 0)
+  {
+    int32_t pid;
+    if (pread(fd, &pid, sizeof(pid), offsetof(FrameRingHeader, writerPid)) == (ssize_t)sizeof(pid) &&
+        pid == (int32_t)getpid())
+    {
+      shm_unlink(_name);
+    }
+    ::close(fd);
+  }
+  _header = nullptr;
+  _slots = nullptr;
+  _size = 0;
+}
+
+FrameRingReader::FrameRingReader() : _header(nullptr), _slots(nullptr), _size(0), _cursor(0), _lost(0)
+{
+}
+
+FrameRingReader::~FrameRingReader()
+{
+  close();
+}
+
+bool FrameRingReader::open(const char *name)
+{
+  close();
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    int err = errno;
+    ::close(fd);
+    errno = err;
+    return false;
+  }
+  if ((size_t)st.st_size < sizeof(FrameRingHeader))
+  {
+    ::close(fd);
+    errno = EINVAL;
+    return false;
+  }
+  void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  int err = errno;
+  ::close(fd);
+  if (p == MAP_FAILED)
+  {
+    errno = err;
+    return false;
+  }
+  const FrameRingHeader *h = (const FrameRingHeader *)p;
+  if (memcmp(h->magic, FRAME_RING_MAGIC, sizeof(h->magic)) != 0 || h->recordSize != sizeof(CanFrame) ||
+      h->capacity == 0 || (h->capacity & (h->capacity - 1)) ||
+      (size_t)st.st_size != sizeof(FrameRingHeader) + (size_t)h->capacity * sizeof(CanFrame))
+  {
+    munmap(p, (size_t)st.st_size);
+    errno = EINVAL;
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  _header = h;
+  _slots = (const CanFrame *)(h + 1);
+  _size = (size_t)st.st_size;
+  _cursor = h->published.load(std::memory_order_acquire);
+  _lost = 0;
+  return true;
+}
+
+void FrameRingReader::close()
+{
+  if (!_header) return;
+  munmap((void *)_header, _size);
+  _header = nullptr;
+  _slots = nullptr;
+  _size = 0;
+}
+
+void FrameRingReader::rewind()
+{
+  if (!_header) return;
+  uint64_t head = _header->published.load(std::memory_order_acquire);
+  _cursor = head > _header->capacity ? head - _header->capacity : 0;
+}
+
+size_t FrameRingReader::read(CanFrame *out, size_t max)
+{
+  if (!_header) return 0;
+  uint64_t capacity = _header->capacity;
+  uint64_t head = _header->published.load(std::memory_order_acquire);
+  if (head - _cursor > capacity)
+  {
+    _lost += head - capacity - _cursor;
+    _cursor = head - capacity;
+  }
+  size_t count = head - _cursor < max ? (size_t)(head - _cursor) : max;
+  size_t slot = (size_t)(_cursor & (capacity - 1));
+  size_t first = count < capacity - slot ? count : capacity - slot;
+  memcpy(out, _slots + slot, first * sizeof(CanFrame));
+  memcpy(out + first, _slots, (count - first) * sizeof(CanFrame));
+
+  // frames more than a ring below what the writer has claimed since may be torn
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t claimed = _header->claimed.load(std::memory_order_relaxed);
+  if (claimed > _cursor + capacity)
+  {
+    uint64_t skip = claimed - capacity - _cursor;
+    size_t torn = skip < count ? (size_t)skip : count;
+    memmove(out, out + torn, (count - torn) * sizeof(CanFrame));
+    _lost += skip;
+    _cursor += skip;
+    count -= torn;
+  }
+  _cursor += count;
+  return count;
+}
+
+bool FrameRingReader::finished() const
+{
+  if (!_header) return true;
+  bool stopped = _header->closed.load(std::memory_order_acquire) ||
+                 (kill(_header->writerPid, 0) != 0 && errno == ESRCH);
+  return stopped && _cursor >= _header->published.load(std::memory_order_acquire);
+}
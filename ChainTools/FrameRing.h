@@ -0,0 +1,109 @@
+/*
+  FrameRing.h - Shared memory frame ring: one live capture, any number of readers
+
+  The capture daemon (chain_rxd) is the only writer. It publishes decoded
+  frames into a POSIX shared memory object (/dev/shm/<name>): a 192 byte
+  header and a power-of-two array of CanFrame slots. Frame n goes into slot
+  n % capacity; the header holds two counters of frames written:
+
+    claimed    raised before the writer starts to fill the slots of a batch
+    published  raised once they are filled
+
+  Readers map the ring read-only and keep their own cursor (the number of
+  the next frame to read), so they never write to the ring, never make the
+  writer wait or copy for them, and attach and leave at any time. A reader
+  copies the frames from its cursor up to published, then looks at claimed
+  again: frames more than capacity below it may have been overwritten
+  while they were copied and are dropped. Frames the writer got a whole
+  ring ahead of the reader are lost the same way; both are counted, so an
+  overrun is never silent.
+*/
+
+#ifndef FrameRing_h
+#define FrameRing_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <atomic>
+
+#include "CanFrame.h"
+
+#define FRAME_RING_MAGIC  "CHNRNG1"
+
+/*Shared memory name and slots (32 MB, over two minutes of a fully loaded 1 Mbit/s bus) by default*/
+#define FRAME_RING_NAME      "/chainlog"
+#define FRAME_RING_CAPACITY  (1U << 20)
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring counters must be lock free to be shared");
+
+struct FrameRingHeader
+{
+  char magic[8];                             // FRAME_RING_MAGIC, NUL terminated
+  uint32_t recordSize;                       // sizeof(CanFrame)
+  uint32_t capacity;                         // slots, a power of two
+  int32_t writerPid;                         // gone: the ring is dead even if not closed
+  std::atomic<uint32_t> closed;              // set by the writer when it stops
+  uint8_t reserved[40];
+  alignas(64) std::atomic<uint64_t> claimed;
+  alignas(64) std::atomic<uint64_t> published;
+};
+
+static_assert(sizeof(FrameRingHeader) == 192, "FrameRingHeader is a fixed 192 byte record");
+
+class FrameRingWriter
+{
+  public:
+    FrameRingWriter();
+    ~FrameRingWriter();
+    FrameRingWriter(const FrameRingWriter &) = delete;
+    FrameRingWriter &operator=(const FrameRingWriter &) = delete;
+
+    /**Creates the ring name with capacity slots (a power of two), replacing an old one. Returns false with errno set*/
+    bool create(const char *name, uint32_t capacity);
+    /**Publishes frames; no system calls, no waiting for readers*/
+    void publish(const CanFrame *frames, size_t count);
+    /**Marks the ring closed for the readers and removes its name*/
+    void close();
+
+  private:
+    FrameRingHeader *_header;
+    CanFrame *_slots;
+    size_t _size;
+    uint64_t _head;
+    char _name[256];
+};
+
+class FrameRingReader
+{
+  public:
+    FrameRingReader();
+    ~FrameRingReader();
+    FrameRingReader(const FrameRingReader &) = delete;
+    FrameRingReader &operator=(const FrameRingReader &) = delete;
+
+    /**Attaches to the ring name at its newest frame. Returns false with errno set (EINVAL: not a frame ring)*/
+    bool open(const char *name);
+    void close();
+
+    /**Moves the cursor back to the oldest frame still in the ring*/
+    void rewind();
+    /**Copies up to max frames from the cursor on to out and returns how many; 0 if there are none yet*/
+    size_t read(CanFrame *out, size_t max);
+    /**True once the writer has stopped (or died) and every frame it published was read or lost*/
+    bool finished() const;
+
+    /**Frames overwritten before they were read*/
+    uint64_t lost() const { return _lost; }
+    /**Number of the next frame to read*/
+    uint64_t cursor() const { return _cursor; }
+
+  private:
+    const FrameRingHeader *_header;
+    const CanFrame *_slots;
+    size_t _size;
+    uint64_t _cursor;
+    uint64_t _lost;
+};
+
+#endif
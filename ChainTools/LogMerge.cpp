@@ -0,0 +1,182 @@
+#include "LogMerge.h"
+
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+bool MergeSource::open(const char *path)
+{
+  if (_bin.open(path))
+  {
+    _isText = false;
+    _bin.map().adviseSequential();
+  }
+  else if (errno == EINVAL && _text.open(path))
+  {
+    _isText = true;
+    _text.adviseSequential();
+  }
+  else return false;
+  _rewind();
+  return true;
+}
+
+void MergeSource::setup(int64_t offsetUs, uint8_t channel)
+{
+  _offsetUs = offsetUs;
+  _channel = channel;
+  _rewind();
+}
+
+void MergeSource::_rewind()
+{
+  _parser = LogParser();
+  _pos = _text.data();
+  _binPos = 0;
+  _frames.clear();
+  _next = 0;
+}
+
+bool MergeSource::_fill()
+{
+  _frames.clear();
+  _next = 0;
+  if (!_isText)
+  {
+    size_t n = _bin.count() - _binPos < MERGE_READ_AHEAD ? _bin.count() - _binPos : MERGE_READ_AHEAD;
+    _frames.assign(_bin.frames() + _binPos, _bin.frames() + _binPos + n);
+    _binPos += n;
+  }
+  else
+  {
+    // a block ends on a line boundary; one of only header or bad lines yields nothing, so go on
+    const char *end = _text.data() + _text.size();
+    while (_frames.empty() && _pos < end)
+    {
+      const char *stop = (size_t)(end - _pos) > MERGE_TEXT_BLOCK ? _pos + MERGE_TEXT_BLOCK : end;
+      if (stop < end)
+      {
+        const char *nl = (const char *)memchr(stop, '\n', (size_t)(end - stop));
+        stop = nl ? nl + 1 : end;
+      }
+      _parser.parse(_pos, stop, _frames);
+      _pos = stop;
+    }
+  }
+  for (CanFrame &f : _frames)
+  {
+    int64_t t = (int64_t)f.timeUs + _offsetUs;
+    f.timeUs = t > 0 ? (uint64_t)t : 0;
+    f.channel = _channel;
+  }
+  return !_frames.empty();
+}
+
+bool MergeSource::findFirst(uint32_t id, bool extended, uint64_t &timeUs)
+{
+  int64_t offset = _offsetUs;
+  _offsetUs = 0;
+  _rewind();
+  bool found = false;
+  for (const CanFrame *f = peek(); f && !found; pop(), f = peek())
+  {
+    if (f->id == id && (bool)(f->flags & FRAME_EXTENDED) == extended && !(f->flags & FRAME_RTR))
+    {
+      timeUs = f->timeUs;
+      found = true;
+    }
+  }
+  _offsetUs = offset;
+  _rewind();
+  return found;
+}
+
+bool LogMerge::open(const std::vector<const char *> &paths)
+{
+  _sources.clear();
+  _heap.clear();
+  _started = false;
+  for (size_t i = 0; i < paths.size(); i++)
+  {
+    std::unique_ptr<MergeSource> source(new MergeSource());
+    if (!source->open(paths[i]))
+    {
+      _failed = i;
+      return false;
+    }
+    _sources.push_back(std::move(source));
+  }
+  _offsets.assign(_sources.size(), 0);
+  return true;
+}
+
+void LogMerge::setOffsets(const std::vector<int64_t> &offsetsUs)
+{
+  for (size_t i = 0; i < _offsets.size() && i < offsetsUs.size(); i++) _offsets[i] = offsetsUs[i];
+}
+
+bool LogMerge::syncOffsets(uint32_t id, bool extended, std::vector<int64_t> &offsetsUs, size_t &missing)
+{
+  offsetsUs.resize(_sources.size(), 0);
+  std::vector<uint64_t> first(_sources.size());
+  for (size_t i = 0; i < _sources.size(); i++)
+  {
+    if (!_sources[i]->findFirst(id, extended, first[i]))
+    {
+      missing = i;
+      return false;
+    }
+  }
+  for (size_t i = 1; i < _sources.size(); i++)
+  {
+    offsetsUs[i] = offsetsUs[0] + (int64_t)first[0] - (int64_t)first[i];
+  }
+  return true;
+}
+
+/**Heap order: the earliest frame on top, equal times in input order*/
+bool LogMerge::_later(const Head &a, const Head &b)
+{
+  return a.timeUs != b.timeUs ? a.timeUs > b.timeUs : a.source > b.source;
+}
+
+void LogMerge::_push(uint32_t source)
+{
+  const CanFrame *f = _sources[source]->peek();
+  if (!f) return;
+  _heap.push_back({f->timeUs, source});
+  std::push_heap(_heap.begin(), _heap.end(), _later);
+}
+
+size_t LogMerge::next(std::vector<CanFrame> &out, size_t max)
+{
+  if (!_started)
+  {
+    for (uint32_t s = 0; s < _sources.size(); s++)
+    {
+      _sources[s]->setup(_offsets[s], (uint8_t)s);
+      _push(s);
+    }
+    _started = true;
+  }
+  size_t n = 0;
+  while (n < max && !_heap.empty())
+  {
+    std::pop_heap(_heap.begin(), _heap.end(), _later);
+    uint32_t s = _heap.back().source;
+    _heap.pop_back();
+    // the source's frames are in time order: take all of them up to the next source's time at once
+    uint64_t limit = _heap.empty() ? UINT64_MAX : _heap.front().timeUs;
+    uint32_t limitSource = _heap.empty() ? 0 : _heap.front().source;
+    MergeSource &source = *_sources[s];
+    for (const CanFrame *f = source.peek(); f && n < max; f = source.peek())
+    {
+      if (f->timeUs > limit || (f->timeUs == limit && s > limitSource)) break;
+      out.push_back(*f);
+      source.pop();
+      n++;
+    }
+    _push(s);
+  }
+  return n;
+}
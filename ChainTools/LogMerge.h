@@ -0,0 +1,102 @@
+/*
+  LogMerge.h - K-way time merge of several captures into one frame stream
+
+  preparaSD() starts a new DATAxx.txt at every power cycle and every logger
+  of a multi-logger setup writes its own files; LogMerge puts them back
+  into one time ordered stream instead of concatenating them by hand.
+
+  Every input is a MergeSource: a log or txt2bin file read front to back
+  in bounded steps (MERGE_TEXT_BLOCK of text, MERGE_READ_AHEAD frames at a
+  time), its times moved by a per-input offset and its frames tagged with
+  the input's channel. LogMerge keeps the next frame of every input in a
+  binary heap keyed by time (then by input, so equal times come out in
+  input order) and pops the earliest, so merging n frames of k inputs
+  costs O(n log k) and memory stays at k read-ahead windows.
+
+  The offsets come from the caller (a session's start after the previous
+  one, a known clock difference) or from a sync ID seen by all loggers:
+  syncOffsets() moves every input so that its first frame with that ID
+  lines up with the first input's.
+*/
+
+#ifndef LogMerge_h
+#define LogMerge_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "CanFrame.h"
+#include "FrameFile.h"
+#include "LogParser.h"
+#include "MappedFile.h"
+
+/*Text parsed per step, and frames taken from a txt2bin file per step*/
+#define MERGE_TEXT_BLOCK  (1UL << 20)
+#define MERGE_READ_AHEAD  16384
+
+class MergeSource
+{
+  public:
+    /**Opens a log or txt2bin file. Returns false with errno set*/
+    bool open(const char *path);
+    /**Moves every time by offsetUs (times that would be negative become 0) and tags every frame with channel*/
+    void setup(int64_t offsetUs, uint8_t channel);
+    /**Time of the first frame with id, before any offset. Returns false if there is none*/
+    bool findFirst(uint32_t id, bool extended, uint64_t &timeUs);
+
+    /**The next frame, NULL at the end; valid until pop()*/
+    const CanFrame *peek() { return _next < _frames.size() || _fill() ? &_frames[_next] : nullptr; }
+    void pop() { _next++; }
+
+  private:
+    bool _fill();
+    void _rewind();
+
+    FrameFile _bin;
+    MappedFile _text;
+    bool _isText = false;
+    LogParser _parser;
+    const char *_pos = nullptr;
+    size_t _binPos = 0;
+    std::vector<CanFrame> _frames;
+    size_t _next = 0;
+    int64_t _offsetUs = 0;
+    uint8_t _channel = 0;
+};
+
+class LogMerge
+{
+  public:
+    /**Opens every input as channel 0, 1, ... Returns false with errno set, failed() naming the input*/
+    bool open(const std::vector<const char *> &paths);
+    size_t failed() const { return _failed; }
+
+    /**Offsets in us, one per input; call before the first next()*/
+    void setOffsets(const std::vector<int64_t> &offsetsUs);
+    /**Offsets that line up the first frame with id in every input with the first input's (plus its offset in
+       offsetsUs). Returns false, with missing the first input without one, if an input never has the ID*/
+    bool syncOffsets(uint32_t id, bool extended, std::vector<int64_t> &offsetsUs, size_t &missing);
+
+    /**Appends up to max frames in time order to out and returns how many; 0 when every input is done*/
+    size_t next(std::vector<CanFrame> &out, size_t max);
+
+  private:
+    struct Head
+    {
+      uint64_t timeUs;
+      uint32_t source;
+    };
+
+    static bool _later(const Head &a, const Head &b);
+    void _push(uint32_t source);
+
+    std::vector<std::unique_ptr<MergeSource>> _sources;
+    std::vector<int64_t> _offsets;
+    std::vector<Head> _heap;
+    bool _started = false;
+    size_t _failed = 0;
+};
+
+#endif
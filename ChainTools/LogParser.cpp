@@ -0,0 +1,283 @@
+#include "LogParser.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*A record is at most 59 characters (10 digit Msg# with sign, 10 digit Time Diff, 8 digit ID, 8 data bytes)*/
+#define LOG_BLOCK  64
+
+/*A space after every second hex digit: "00 11 22 ..."*/
+#define PADDED_SPACES  0x924924ULL
+
+struct HexTable
+{
+  uint8_t value[256];   // 0..15, 0xFF if the character is not a hex digit
+
+  HexTable()
+  {
+    memset(value, 0xFF, sizeof(value));
+    for (int c = '0'; c <= '9'; c++) value[c] = (uint8_t)(c - '0');
+    for (int c = 'A'; c <= 'F'; c++) value[c] = (uint8_t)(c - 'A' + 10);
+    for (int c = 'a'; c <= 'f'; c++) value[c] = (uint8_t)(c - 'a' + 10);
+  }
+};
+
+static const HexTable HEX;
+
+struct BlockMasks
+{
+  uint64_t newline;
+  uint64_t comma;
+  uint64_t space;
+};
+
+/**Bit i set where p[i] is a newline, comma or space, for the LOG_BLOCK bytes at p*/
+static inline BlockMasks classify(const char *p)
+{
+  BlockMasks m;
+#if defined(__AVX2__)
+  const __m256i nl = _mm256_set1_epi8('\n');
+  const __m256i comma = _mm256_set1_epi8(',');
+  const __m256i space = _mm256_set1_epi8(' ');
+  __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+  __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+  m.newline = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nl))
+            | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nl)) << 32;
+  m.comma = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, comma))
+          | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, comma)) << 32;
+  m.space = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, space))
+          | (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, space)) << 32;
+#elif defined(__SSE2__)
+  const __m128i nl = _mm_set1_epi8('\n');
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i space = _mm_set1_epi8(' ');
+  m.newline = m.comma = m.space = 0;
+  for (int i = 0; i < LOG_BLOCK; i += 16)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+    m.newline |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)) << i;
+    m.comma |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)) << i;
+    m.space |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, space)) << i;
+  }
+#else
+  m.newline = m.comma = m.space = 0;
+  for (int i = 0; i < LOG_BLOCK; i++)
+  {
+    m.newline |= (uint64_t)(p[i] == '\n') << i;
+    m.comma |= (uint64_t)(p[i] == ',') << i;
+    m.space |= (uint64_t)(p[i] == ' ') << i;
+  }
+#endif
+  return m;
+}
+
+/**Bits 0..n-1*/
+static inline uint64_t lowBits(size_t n)
+{
+  return n >= 64 ? ~0ULL : (1ULL << n) - 1;
+}
+
+/**Unsigned decimal of 1..10 digits filling [p, e)*/
+static inline bool parseDec(const char *p, const char *e, uint64_t &value)
+{
+  if (p >= e || e - p > 10) return false;
+  uint64_t v = 0;
+  for (; p < e; p++)
+  {
+    unsigned d = (unsigned)(*p - '0');
+    if (d > 9) return false;
+    v = v * 10 + d;
+  }
+  value = v;
+  return true;
+}
+
+/**Hex number of 1..8 digits filling [p, e)*/
+static inline bool parseHex(const char *p, const char *e, uint32_t &value)
+{
+  if (p >= e || e - p > 8) return false;
+  uint32_t v = 0;
+  for (; p < e; p++)
+  {
+    uint8_t d = HEX.value[(uint8_t)*p];
+    if (d > 15) return false;
+    v = v << 4 | d;
+  }
+  value = v;
+  return true;
+}
+
+LogParser::LogParser() : _begin(nullptr), _offsets(nullptr), _timeMs(0), _msgNum(0), _haveMsgNum(false)
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void LogParser::resume(uint64_t timeMs, uint32_t msgNum, bool haveMsgNum)
+{
+  _timeMs = timeMs;
+  _msgNum = msgNum;
+  _haveMsgNum = haveMsgNum;
+}
+
+/**Fields of one record; commas and spaces are the masks of the line (bit i = line[i])*/
+bool LogParser::_record(const char *line, size_t len, uint64_t commas, uint64_t spaces, CanFrame &frame)
+{
+  size_t c[4];
+  for (int i = 0; i < 4; i++)
+  {
+    if (!commas) return false;
+    c[i] = (size_t)__builtin_ctzll(commas);
+    commas &= commas - 1;
+  }
+  if (commas) return false;
+
+  // Msg#: the old sketches print their int counter signed
+  const char *p = line;
+  bool negative = *p == '-';
+  uint64_t msg;
+  if (!parseDec(p + negative, line + c[0], msg)) return false;
+  uint64_t diff;
+  if (!parseDec(line + c[0] + 1, line + c[1], diff)) return false;
+  uint32_t id;
+  if (!parseHex(line + c[1] + 1, line + c[2], id)) return false;
+  uint64_t dlc;
+  if (!parseDec(line + c[2] + 1, line + c[3], dlc) || dlc > 15) return false;
+
+  // data bytes: one or two hex digits each, every one followed by a space (the last one may not be)
+  memset(frame.data, 0, sizeof(frame.data));
+  size_t pos = c[3] + 1;
+  uint64_t ends = spaces & ~lowBits(pos);
+  unsigned n = 0;
+  if (dlc <= 8 && ends == (PADDED_SPACES & lowBits(3 * dlc)) << pos && len - pos >= 3 * dlc - (dlc != 0))
+  {
+    // two digits each, as NuovaLib and LogWriter print them: no token boundaries to look for
+    uint8_t bad = 0;
+    for (unsigned i = 0; i < dlc; i++)
+    {
+      uint8_t hi = HEX.value[(uint8_t)line[pos + 3 * i]];
+      uint8_t lo = HEX.value[(uint8_t)line[pos + 3 * i + 1]];
+      bad |= hi | lo;
+      frame.data[i] = (uint8_t)(hi << 4 | lo);
+    }
+    if (bad > 15 || len - pos > 3 * dlc) return false;
+    n = (unsigned)dlc;
+  }
+  else
+  {
+    while (pos < len)
+    {
+      size_t end = ends ? (size_t)__builtin_ctzll(ends) : len;
+      ends &= ends - 1;
+      size_t digits = end - pos;
+      if (digits == 0 || digits > 2) return false;
+      uint8_t hi = HEX.value[(uint8_t)line[pos]];
+      uint8_t lo = digits == 2 ? HEX.value[(uint8_t)line[pos + 1]] : 0;
+      if ((hi | lo) > 15) return false;
+      uint8_t value = digits == 2 ? (uint8_t)(hi << 4 | lo) : hi;
+      if (n < 8) frame.data[n] = value;
+      n++;
+      pos = end + 1;
+    }
+  }
+  // a DLC above 8 still carries 8 bytes on the wire; the loggers print 8 or, reading past the array, DLC of them
+  if (dlc <= 8 ? n != dlc : (n != 8 && n != dlc)) return false;
+
+  uint32_t raw = negative ? (uint32_t)(0 - msg) : (uint32_t)msg;
+  if (!_haveMsgNum) _msgNum = raw;
+  else _msgNum += (uint16_t)(raw - _msgNum);
+  _haveMsgNum = true;
+  _timeMs += diff;
+
+  frame.timeUs = _timeMs * 1000;
+  frame.msgNum = _msgNum;
+  frame.id = id & 0x1FFFFFFF;
+  frame.timeDiffMs = (uint32_t)diff;
+  frame.dlc = (uint8_t)(dlc > 8 ? 8 : dlc);
+  frame.flags = (id > 0x7FF ? FRAME_EXTENDED : 0) | (dlc > 8 ? FRAME_TRUNCATED : 0);
+  frame.channel = 0;
+  frame.reserved = 0;
+  return true;
+}
+
+void LogParser::_lineMasked(const char *line, size_t len, uint64_t commas, uint64_t spaces, std::vector<CanFrame> &out)
+{
+  _stats.lines++;
+  CanFrame frame;
+  if (_record(line, len, commas, spaces, frame))
+  {
+    out.push_back(frame);
+    if (_offsets) _offsets->push_back((uint64_t)(line - _begin));
+    _stats.frames++;
+    if (frame.flags & FRAME_TRUNCATED) _stats.truncated++;
+  }
+  else if (len == 0 || (len >= 4 && memcmp(line, "Msg#", 4) == 0))
+  {
+    _stats.skipped++;
+  }
+  else
+  {
+    _stats.badLines++;
+  }
+}
+
+/*A line the block scan did not cover: near the end of the buffer or longer than a block*/
+void LogParser::_line(const char *line, size_t len, std::vector<CanFrame> &out)
+{
+  if (len && line[len - 1] == '\r') len--;
+  if (len > LOG_BLOCK)
+  {
+    _stats.lines++;
+    _stats.badLines++;
+    return;
+  }
+  uint64_t commas = 0;
+  uint64_t spaces = 0;
+  for (size_t i = 0; i < len; i++)
+  {
+    commas |= (uint64_t)(line[i] == ',') << i;
+    spaces |= (uint64_t)(line[i] == ' ') << i;
+  }
+  _lineMasked(line, len, commas, spaces, out);
+}
+
+void LogParser::parse(const char *begin, const char *end, std::vector<CanFrame> &out, std::vector<uint64_t> *offsets)
+{
+  _begin = begin;
+  _offsets = offsets;
+  // about 36 bytes per record
+  out.reserve(out.size() + (size_t)(end - begin) / 32);
+  const char *p = begin;
+  // masks of the LOG_BLOCK bytes at block; a record is shorter than a block, so one classify usually covers two lines
+  const char *block = nullptr;
+  BlockMasks m = {0, 0, 0};
+  while (p < end)
+  {
+    size_t offset = (size_t)(p - block);
+    uint64_t newlines = block && offset < LOG_BLOCK ? m.newline >> offset : 0;
+    if (!newlines && end - p >= LOG_BLOCK)
+    {
+      block = p;
+      offset = 0;
+      m = classify(p);
+      newlines = m.newline;
+    }
+    if (newlines)
+    {
+      size_t len = (size_t)__builtin_ctzll(newlines);
+      size_t n = len && p[len - 1] == '\r' ? len - 1 : len;
+      uint64_t keep = lowBits(n);
+      _lineMasked(p, n, (m.comma >> offset) & keep, (m.space >> offset) & keep, out);
+      p += len + 1;
+      continue;
+    }
+    const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+    const char *e = nl ? nl : end;
+    _line(p, (size_t)(e - p), out);
+    p = nl ? nl + 1 : end;
+  }
+}
@@ -0,0 +1,71 @@
+/*
+  LogParser.h - Fast parser for the DATAxx.txt logs of the SD loggers
+
+    Msg#,Time Diff, ID,DLC, Data
+    0,0,1A0,8,00 7F 10 00 00 00 00 00
+    1,3,7E8,3,2 A 0
+
+  Data bytes may be two hex digits (ChainLogger_no_S_mega_NuovaLib, LogWriter)
+  or unpadded as Arduino's print(x, HEX) writes them; lines may end in CR LF
+  or LF. The header, blank lines and anything else that is not a record
+  (a line cut short by a power loss, a stray debug print) are counted and
+  skipped.
+
+  The line structure is found with SIMD compares (SSE2, or AVX2 when the
+  build targets it) that turn 64 bytes at a time into bit masks of
+  newlines, commas and spaces; the fields are then read at the positions
+  those masks give, hex digits through a lookup table.
+
+  Derived columns: timeUs is the running sum of Time Diff (the loggers only
+  store the difference to the previous frame), and msgNum is Msg# made
+  continuous: the sketches count in a 16 bit int, which prints as -32768..
+  (or 4294934528.. through an unsigned long) after 32767.
+*/
+
+#ifndef LogParser_h
+#define LogParser_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "CanFrame.h"
+
+struct LogParseStats
+{
+  uint64_t lines;      // lines seen, a last one without newline included
+  uint64_t frames;     // records produced
+  uint64_t skipped;    // header and blank lines
+  uint64_t badLines;   // neither a record nor skipped: malformed field, missing data bytes
+  uint64_t truncated;  // records with a DLC above 8 (FRAME_TRUNCATED)
+};
+
+class LogParser
+{
+  public:
+    LogParser();
+
+    /**Parses every line in [begin, end), the last one may lack its newline, and appends the records to out.
+       With offsets, also appends the position of every record's line relative to begin*/
+    void parse(const char *begin, const char *end, std::vector<CanFrame> &out, std::vector<uint64_t> *offsets = nullptr);
+
+    const LogParseStats &stats() const { return _stats; }
+    /**Absolute time (sum of Time Diff) of the last record, in ms*/
+    uint64_t timeMs() const { return _timeMs; }
+    /**Continues the running time and Msg# of an earlier part of the same log*/
+    void resume(uint64_t timeMs, uint32_t msgNum, bool haveMsgNum);
+
+  private:
+    bool _record(const char *line, size_t len, uint64_t commas, uint64_t spaces, CanFrame &frame);
+    void _line(const char *line, size_t len, std::vector<CanFrame> &out);
+    void _lineMasked(const char *line, size_t len, uint64_t commas, uint64_t spaces, std::vector<CanFrame> &out);
+
+    LogParseStats _stats;
+    const char *_begin;
+    std::vector<uint64_t> *_offsets;
+    uint64_t _timeMs;
+    uint32_t _msgNum;
+    bool _haveMsgNum;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include "LogWriter.h"
+
+#include <string.h>
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+static char *putDec(char *p, uint32_t v)
+{
+  char tmp[10];
+  int n = 0;
+  do
+  {
+    tmp[n++] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v);
+  while (n) *p++ = tmp[--n];
+  return p;
+}
+
+static char *putHex(char *p, uint32_t v)
+{
+  char tmp[8];
+  int n = 0;
+  do
+  {
+    tmp[n++] = HEX_DIGITS[v & 0xF];
+    v >>= 4;
+  } while (v);
+  while (n) *p++ = tmp[--n];
+  return p;
+}
+
+size_t formatLogLine(const CanFrame &frame, char *line)
+{
+  char *p = line;
+  p = putDec(p, frame.msgNum);
+  *p++ = ',';
+  p = putDec(p, frame.timeDiffMs);
+  *p++ = ',';
+  p = putHex(p, frame.id);
+  *p++ = ',';
+  p = putDec(p, frame.dlc);
+  *p++ = ',';
+  int n = frame.dlc > 8 ? 8 : frame.dlc;
+  for (int i = 0; i < n; i++)
+  {
+    *p++ = HEX_DIGITS[frame.data[i] >> 4];
+    *p++ = HEX_DIGITS[frame.data[i] & 0xF];
+    *p++ = ' ';
+  }
+  *p++ = '\r';
+  *p++ = '\n';
+  return (size_t)(p - line);
+}
+
+LogWriter::LogWriter(FILE *out, size_t bufferSize)
+  : _out(out), _buf(bufferSize < 256 ? 256 : bufferSize), _used(0), _ok(true)
+{
+}
+
+LogWriter::~LogWriter()
+{
+  flush();
+}
+
+void LogWriter::header()
+{
+  static const char line[] = LOG_HEADER "\r\n";
+  if (_used + sizeof(line) > _buf.size()) flush();
+  memcpy(&_buf[_used], line, sizeof(line) - 1);
+  _used += sizeof(line) - 1;
+}
+
+void LogWriter::write(const CanFrame &frame)
+{
+  if (_used + 64 > _buf.size()) flush();
+  _used += formatLogLine(frame, &_buf[_used]);
+}
+
+void LogWriter::write(const CanFrame *frames, size_t count)
+{
+  for (size_t i = 0; i < count; i++) write(frames[i]);
+}
+
+bool LogWriter::flush()
+{
+  if (_used > 0)
+  {
+    if (fwrite(_buf.data(), 1, _used, _out) != _used) _ok = false;
+    _used = 0;
+  }
+  if (fflush(_out) != 0) _ok = false;
+  return _ok;
+}
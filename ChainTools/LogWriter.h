@@ -0,0 +1,45 @@
+/*
+  LogWriter.h - Writes CanFrame records in the DATAxx.txt format of the SD loggers
+
+    Msg#,Time Diff, ID,DLC, Data
+    0,0,1A0,8,00 7F 10 00 00 00 00 00
+
+  Data bytes are written as two hex digits (as ChainLogger_no_S_mega_NuovaLib
+  does) and lines end in CR LF like Arduino's println. Output is collected in
+  a large buffer and written with few system calls.
+*/
+
+#ifndef LogWriter_h
+#define LogWriter_h
+
+#include <stdio.h>
+#include <vector>
+
+#include "CanFrame.h"
+
+#define LOG_HEADER "Msg#,Time Diff, ID,DLC, Data"
+
+class LogWriter
+{
+  public:
+    /**Writes to an already open stream; the stream is not closed by the writer*/
+    explicit LogWriter(FILE *out, size_t bufferSize = 1 << 20);
+    ~LogWriter();
+
+    void header();
+    void write(const CanFrame &frame);
+    void write(const CanFrame *frames, size_t count);
+    /**Hands the buffered lines to the stream. Returns false on a write error*/
+    bool flush();
+
+  private:
+    FILE *_out;
+    std::vector<char> _buf;
+    size_t _used;
+    bool _ok;
+};
+
+/**Formats one record into line (at least 64 bytes) and returns its length*/
+size_t formatLogLine(const CanFrame &frame, char *line);
+
+#endif
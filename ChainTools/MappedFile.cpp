@@ -0,0 +1,74 @@
+#include "MappedFile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile() : _data(nullptr), _size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool MappedFile::open(const char *path)
+{
+  close();
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+  {
+    int err = errno;
+    ::close(fd);
+    errno = err;
+    return false;
+  }
+  if (st.st_size == 0)
+  {
+    ::close(fd);
+    return true;
+  }
+  void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int err = errno;
+  ::close(fd);
+  if (p == MAP_FAILED)
+  {
+    errno = err;
+    return false;
+  }
+  _data = (const char *)p;
+  _size = (size_t)st.st_size;
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (_data) munmap((void *)_data, _size);
+  _data = nullptr;
+  _size = 0;
+}
+
+void MappedFile::adviseSequential()
+{
+  if (_data) madvise((void *)_data, _size, MADV_SEQUENTIAL);
+}
+
+void MappedFile::adviseRandom()
+{
+  if (_data) madvise((void *)_data, _size, MADV_RANDOM);
+}
+
+void MappedFile::adviseWillNeed(size_t offset, size_t length)
+{
+  if (!_data || offset >= _size) return;
+  if (length > _size - offset) length = _size - offset;
+  // madvise wants a page aligned start
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  size_t start = offset / page * page;
+  madvise((void *)(_data + start), length + (offset - start), MADV_WILLNEED);
+}
@@ -0,0 +1,38 @@
+/*
+  MappedFile.h - Read-only memory mapping of a whole file
+
+  The log tools work on captures of several hundred MB; mapping them lets
+  the parsers and readers run over the page cache without copying.
+*/
+
+#ifndef MappedFile_h
+#define MappedFile_h
+
+#include <stddef.h>
+
+class MappedFile
+{
+  public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**Maps path. Returns false with errno set on failure; an empty file maps to size() == 0*/
+    bool open(const char *path);
+    void close();
+
+    const char *data() const { return _data; }
+    size_t size() const { return _size; }
+    /**Tells the kernel the file is read front to back (read ahead) or at random (no read ahead)*/
+    void adviseSequential();
+    void adviseRandom();
+    /**Starts reading [offset, offset + length) in ahead of use*/
+    void adviseWillNeed(size_t offset, size_t length);
+
+  private:
+    const char *_data;
+    size_t _size;
+};
+
+#endif
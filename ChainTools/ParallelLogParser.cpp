@@ -0,0 +1,77 @@
+#include "ParallelLogParser.h"
+
+#include <string.h>
+
+ParallelLogParser::ParallelLogParser(ThreadPool &pool, size_t chunkBytes)
+  : _pool(pool), _chunkBytes(chunkBytes ? chunkBytes : 1), _timeMs(0), _msgNum(0), _haveMsgNum(false)
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void ParallelLogParser::parse(const char *begin, const char *end, std::vector<CanFrame> &out)
+{
+  // chunk boundaries, each just after a newline
+  _chunks.clear();
+  const char *p = begin;
+  while (p < end)
+  {
+    const char *stop = end;
+    if ((size_t)(end - p) > _chunkBytes)
+    {
+      const char *nl = (const char *)memchr(p + _chunkBytes - 1, '\n', (size_t)(end - p) - (_chunkBytes - 1));
+      if (nl) stop = nl + 1;
+    }
+    _chunks.emplace_back();
+    _chunks.back().begin = p;
+    _chunks.back().end = stop;
+    p = stop;
+  }
+
+  _pool.run(_chunks.size(), [this](size_t i) {
+    Chunk &chunk = _chunks[i];
+    LogParser parser;
+    chunk.frames.clear();
+    parser.parse(chunk.begin, chunk.end, chunk.frames);
+    chunk.stats = parser.stats();
+    chunk.timeMs = parser.timeMs();
+  });
+
+  // stitch: the first Msg# of a chunk was taken as printed, continue it from the one before
+  size_t total = out.size();
+  for (Chunk &chunk : _chunks)
+  {
+    chunk.timeOffsetMs = _timeMs;
+    chunk.msgOffset = 0;
+    chunk.outIndex = total;
+    if (!chunk.frames.empty())
+    {
+      uint32_t first = chunk.frames.front().msgNum;
+      if (_haveMsgNum) chunk.msgOffset = _msgNum + (uint16_t)(first - _msgNum) - first;
+      _msgNum = chunk.frames.back().msgNum + chunk.msgOffset;
+      _haveMsgNum = true;
+    }
+    _timeMs += chunk.timeMs;
+    total += chunk.frames.size();
+    _stats.lines += chunk.stats.lines;
+    _stats.frames += chunk.stats.frames;
+    _stats.skipped += chunk.stats.skipped;
+    _stats.badLines += chunk.stats.badLines;
+    _stats.truncated += chunk.stats.truncated;
+  }
+
+  out.resize(total);
+  CanFrame *dest = out.data();
+  _pool.run(_chunks.size(), [this, dest](size_t i) {
+    Chunk &chunk = _chunks[i];
+    CanFrame *d = dest + chunk.outIndex;
+    uint64_t timeOffsetUs = chunk.timeOffsetMs * 1000;
+    for (const CanFrame &frame : chunk.frames)
+    {
+      *d = frame;
+      d->timeUs += timeOffsetUs;
+      d->msgNum += chunk.msgOffset;
+      d++;
+    }
+    std::vector<CanFrame>().swap(chunk.frames);
+  });
+}
@@ -0,0 +1,62 @@
+/*
+  ParallelLogParser.h - LogParser over chunks of a log on a ThreadPool
+
+  The text is cut into chunks of about chunkBytes, each moved forward to
+  just after a newline so no line is split. Every chunk is parsed by its
+  own LogParser as if it started the log: time from 0, Msg# as found. The
+  chunks are then stitched in order: a chunk's time is offset by the sum
+  of Time Diff of all before it, and its Msg# by the multiple of 65536
+  that continues the previous chunk's last Msg#, which is what a single
+  pass would have computed. Fixing up and copying into the output run in
+  parallel again, so only a per-chunk prefix sum is sequential.
+
+  Like LogParser, successive parse() calls continue the same log.
+*/
+
+#ifndef ParallelLogParser_h
+#define ParallelLogParser_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "LogParser.h"
+#include "ThreadPool.h"
+
+/*Chunk size: large enough that resynchronizing and stitching are noise, small enough to balance 16+ threads on a few hundred MB*/
+#define PARALLEL_CHUNK_BYTES  (4UL << 20)
+
+class ParallelLogParser
+{
+  public:
+    explicit ParallelLogParser(ThreadPool &pool, size_t chunkBytes = PARALLEL_CHUNK_BYTES);
+
+    /**Parses every line in [begin, end), the last one may lack its newline, and appends the records to out*/
+    void parse(const char *begin, const char *end, std::vector<CanFrame> &out);
+
+    const LogParseStats &stats() const { return _stats; }
+    uint64_t timeMs() const { return _timeMs; }
+
+  private:
+    struct Chunk
+    {
+      const char *begin;
+      const char *end;
+      std::vector<CanFrame> frames;
+      LogParseStats stats;
+      uint64_t timeMs;      // sum of Time Diff within the chunk
+      uint64_t timeOffsetMs;
+      uint32_t msgOffset;
+      size_t outIndex;
+    };
+
+    ThreadPool &_pool;
+    size_t _chunkBytes;
+    std::vector<Chunk> _chunks;
+    LogParseStats _stats;
+    uint64_t _timeMs;
+    uint32_t _msgNum;
+    bool _haveMsgNum;
+};
+
+#endif
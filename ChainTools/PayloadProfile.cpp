@@ -0,0 +1,149 @@
+#include "PayloadProfile.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+/*Lane masks for the SWAR steps: high bit and 1 of every byte and of every nibble*/
+#define BYTE_HIGH    0x8080808080808080ULL
+#define BYTE_ONE     0x0101010101010101ULL
+#define NIBBLE_HIGH  0x8888888888888888ULL
+#define NIBBLE_ONE   0x1111111111111111ULL
+
+/**High bit of every lane (high marks the lanes' high bits) where w is p + 1, modulo the lane size*/
+static inline uint64_t stepLanes(uint64_t w, uint64_t p, uint64_t high, uint64_t one)
+{
+  uint64_t low = ~high;
+  uint64_t diff = ((w | high) - (p & low)) ^ ((w ^ ~p) & high);  // w - p, lane by lane
+  uint64_t t = diff ^ one;
+  return ~(((t & low) + low) | t | low);                         // lanes where t is 0
+}
+
+/**Adds 1 to the bit-sliced counters of the bits set in x*/
+static inline void addPlanes(uint64_t *planes, uint64_t x)
+{
+  for (int i = 0; x; i++)
+  {
+    uint64_t carry = planes[i] & x;
+    planes[i] ^= x;
+    x = carry;
+  }
+}
+
+/**Counts of the planes into counts[bit / step] for the bits first, first + step, ...; clears the planes*/
+static void flushPlanes(uint64_t *planes, uint64_t *counts, int first, int step)
+{
+  for (int bit = first; bit < 64; bit += step)
+  {
+    uint64_t n = 0;
+    for (int i = 0; i < PROFILE_PLANES; i++) n |= (planes[i] >> bit & 1) << i;
+    counts[bit / step] += n;
+  }
+  memset(planes, 0, PROFILE_PLANES * sizeof(uint64_t));
+}
+
+void PayloadProfiler::_flush(State &state)
+{
+  IdProfile &p = state.profile;
+  flushPlanes(state.ones, p.ones, 0, 1);
+  flushPlanes(state.toggles, p.toggles, 0, 1);
+  flushPlanes(state.byteSteps, p.byteSteps, 7, 8);
+  flushPlanes(state.nibbleSteps, p.nibbleSteps, 3, 4);
+  state.pending = 0;
+}
+
+void PayloadProfiler::_profile(State &state, const CanFrame *frames, size_t count)
+{
+  IdProfile &p = state.profile;
+  for (size_t k = 0; k < count; k++)
+  {
+    const CanFrame &f = frames[k];
+    if (f.flags & FRAME_RTR) continue;
+    int n = f.dlc < 8 ? f.dlc : 8;
+    uint64_t mask = n == 8 ? ~0ULL : (1ULL << (n * 8)) - 1;
+    uint64_t w;
+    memcpy(&w, f.data, 8);
+    w &= mask;
+
+    if (p.frames == 0)
+    {
+      p.firstUs = f.timeUs;
+      p.minDlc = p.maxDlc = f.dlc;
+    }
+    p.frames++;
+    p.lastUs = f.timeUs;
+    if (f.dlc < p.minDlc) p.minDlc = f.dlc;
+    if (f.dlc > p.maxDlc) p.maxDlc = f.dlc;
+    for (int i = 0; i < n; i++)
+    {
+      uint8_t b = f.data[i];
+      p.histogram[i][b]++;
+      if (p.present[i]++ == 0 || b < p.min[i]) p.min[i] = b;
+      if (b > p.max[i]) p.max[i] = b;
+    }
+
+    addPlanes(state.ones, w);
+    if (state.haveLast)
+    {
+      // only the bytes both frames hold
+      int common = n < state.lastDlc ? n : state.lastDlc;
+      uint64_t both = common == 8 ? ~0ULL : (1ULL << (common * 8)) - 1;
+      addPlanes(state.toggles, (w ^ state.last) & both);
+      addPlanes(state.byteSteps, stepLanes(w, state.last, BYTE_HIGH, BYTE_ONE) & both);
+      addPlanes(state.nibbleSteps, stepLanes(w, state.last, NIBBLE_HIGH, NIBBLE_ONE) & both);
+    }
+    state.haveLast = true;
+    state.last = w;
+    state.lastDlc = (uint8_t)n;
+    if (++state.pending == PROFILE_FLUSH) _flush(state);
+  }
+}
+
+void PayloadProfiler::add(const FrameDemux &demux)
+{
+  // the states are made here, so the tasks only touch their own
+  std::vector<State *> states(demux.groupCount());
+  for (size_t g = 0; g < demux.groupCount(); g++)
+  {
+    const DemuxGroup &group = demux.groups()[g];
+    std::unique_ptr<State> &state = _states[(uint64_t)group.flags << 32 | group.id];
+    if (!state)
+    {
+      state.reset(new State());
+      state->profile.id = group.id;
+      state->profile.flags = group.flags;
+    }
+    states[g] = state.get();
+  }
+  _pool.run(demux.groupCount(), [&](size_t g) {
+    const DemuxGroup &group = demux.groups()[g];
+    _profile(*states[g], demux.frames(group), group.count);
+  });
+}
+
+std::vector<IdProfile> PayloadProfiler::profiles()
+{
+  std::vector<IdProfile> out;
+  for (auto &s : _states)
+  {
+    _flush(*s.second);
+    if (s.second->profile.frames) out.push_back(s.second->profile);
+  }
+  std::sort(out.begin(), out.end(), [](const IdProfile &a, const IdProfile &b) {
+    return ((uint64_t)a.flags << 32 | a.id) < ((uint64_t)b.flags << 32 | b.id);
+  });
+  return out;
+}
+
+double byteEntropy(const IdProfile &profile, int byte)
+{
+  if (!profile.present[byte]) return 0;
+  double total = (double)profile.present[byte];
+  double h = 0;
+  for (int v = 0; v < 256; v++)
+  {
+    uint32_t n = profile.histogram[byte][v];
+    if (n) h -= n / total * log2(n / total);
+  }
+  return h;
+}
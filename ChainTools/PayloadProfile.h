@@ -0,0 +1,92 @@
+/*
+  PayloadProfile.h - Per-ID bit and byte statistics for finding signals in unknown frames
+
+  For every ID and every payload bit it counts how often the bit is 1 and
+  how often it toggles from one frame of the ID to the next; for every
+  byte the histogram of its values (hence its entropy), its range, and
+  how often the byte and each of its nibbles is the previous value + 1,
+  which is what alive counters do. Constant bits, slowly moving signals
+  (low bits toggling often, high bits rarely), flags and counters stand
+  out without reading hex.
+
+  The per-bit counts are bit-sliced: each frame adds its 64 bit payload
+  (and its XOR with the previous payload, and SWAR "is previous + 1"
+  masks for the bytes and nibbles) to a stack of counter planes with one
+  AND and XOR per plane, so all 64 counters move at once; the planes go
+  into plain counters every PROFILE_FLUSH frames. Frames come in split by
+  ID (FrameDemux.h) and the IDs are profiled in parallel, batch after
+  batch, so a capture is profiled in one streaming pass.
+*/
+
+#ifndef PayloadProfile_h
+#define PayloadProfile_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "FrameDemux.h"
+#include "ThreadPool.h"
+
+/*Counter planes, and frames per ID after which they go into the plain counters*/
+#define PROFILE_PLANES  16
+#define PROFILE_FLUSH   ((1U << PROFILE_PLANES) - 1)
+
+/*Results of one ID; bit 8 * i + j is bit j of byte i*/
+struct IdProfile
+{
+  uint32_t id;
+  uint8_t flags;                // FRAME_EXTENDED for a 29 bit ID
+  uint8_t minDlc;
+  uint8_t maxDlc;
+  uint64_t frames;
+  uint64_t firstUs;
+  uint64_t lastUs;
+  uint64_t present[8];          // frames holding byte i
+  uint64_t ones[64];
+  uint64_t toggles[64];         // against the ID's previous frame
+  uint64_t byteSteps[8];        // byte i is the previous value + 1 (mod 256)
+  uint64_t nibbleSteps[16];     // nibble i (low nibble of byte i / 2 first) is the previous + 1 (mod 16)
+  uint8_t min[8];
+  uint8_t max[8];
+  uint32_t histogram[8][256];
+};
+
+class PayloadProfiler
+{
+  public:
+    explicit PayloadProfiler(ThreadPool &pool) : _pool(pool) {}
+
+    /**Adds the frames of a split batch; the frames of an ID carry on from the last batch*/
+    void add(const FrameDemux &demux);
+
+    /**Results so far, sorted by ID*/
+    std::vector<IdProfile> profiles();
+
+  private:
+    struct State
+    {
+      IdProfile profile;
+      bool haveLast;
+      uint8_t lastDlc;
+      uint64_t last;
+      uint32_t pending;        // frames in the planes
+      uint64_t ones[PROFILE_PLANES];
+      uint64_t toggles[PROFILE_PLANES];
+      uint64_t byteSteps[PROFILE_PLANES];
+      uint64_t nibbleSteps[PROFILE_PLANES];
+    };
+
+    static void _profile(State &state, const CanFrame *frames, size_t count);
+    static void _flush(State &state);
+
+    ThreadPool &_pool;
+    std::unordered_map<uint64_t, std::unique_ptr<State>> _states;
+};
+
+/**Shannon entropy in bits (0..8) of byte i of profile*/
+double byteEntropy(const IdProfile &profile, int byte);
+
+#endif
@@ -0,0 +1,323 @@
+#include "Pyramid.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const LodBucket EMPTY_BUCKET = {INFINITY, -INFINITY, 0.0, 0, 0};
+
+static void merge(LodBucket &into, const LodBucket &b)
+{
+  if (b.min < into.min) into.min = b.min;
+  if (b.max > into.max) into.max = b.max;
+  into.sum += b.sum;
+  into.count += b.count;
+}
+
+static void addSample(LodBucket &into, double value)
+{
+  float v = (float)value;
+  if (v < into.min) into.min = v;
+  if (v > into.max) into.max = v;
+  into.sum += value;
+  into.count++;
+}
+
+/**Level whose buckets are widthUs wide*/
+static size_t levelOf(uint64_t widthUs, uint64_t baseUs)
+{
+  size_t level = 0;
+  while ((baseUs << level) < widthUs) level++;
+  return level;
+}
+
+uint64_t lodQuery(const LodLevel *levels, size_t levelCount, uint64_t baseUs, uint64_t firstUs, uint64_t lastUs,
+                  unsigned pixels, std::vector<LodPoint> &out)
+{
+  out.clear();
+  if (levelCount == 0 || lastUs < firstUs) return 0;
+  if (pixels == 0) pixels = 1;
+
+  // the finest level with at most 2 buckets per pixel
+  uint64_t want = (lastUs - firstUs) / (2 * (uint64_t)pixels) + 1;
+  size_t level = 0;
+  while (level + 1 < levelCount && (baseUs << level) < want) level++;
+  uint64_t width = baseUs << level;
+
+  const LodLevel &l = levels[level];
+  if (l.count == 0) return width;
+  uint64_t a = firstUs / width;
+  uint64_t b = lastUs / width;
+  if (a < l.first) a = l.first;
+  if (b > l.first + l.count - 1) b = l.first + l.count - 1;
+  for (uint64_t i = a; i <= b && a <= b; i++)
+  {
+    const LodBucket &bucket = l.buckets[i - l.first];
+    if (bucket.count == 0) continue;
+    LodPoint p;
+    p.startUs = i * width;
+    p.min = bucket.min;
+    p.max = bucket.max;
+    p.mean = bucket.sum / bucket.count;
+    p.count = bucket.count;
+    out.push_back(p);
+  }
+  return width;
+}
+
+Pyramid::Pyramid(uint64_t baseUs)
+  : _baseUs(baseUs),
+    _pending(false)
+{
+  memset(_first, 0, sizeof(_first));
+}
+
+void Pyramid::add(uint64_t timeUs, double value)
+{
+  if (value != value) return;
+  if (!_baseUs)
+  {
+    _probe.emplace_back(timeUs, value);
+    if (_probe.size() == PYRAMID_PROBE) _start();
+    return;
+  }
+  std::vector<LodBucket> &l0 = _levels[0];
+  uint64_t index = timeUs / _baseUs;
+  if (l0.empty())
+  {
+    _first[0] = index;
+    l0.push_back(EMPTY_BUCKET);
+  }
+  uint64_t last = _first[0] + l0.size() - 1;
+  if (index > last)
+  {
+    // the filling bucket is complete
+    if (_pending) _propagate();
+    l0.resize(index - _first[0] + 1, EMPTY_BUCKET);
+  }
+  else if (index < last)
+  {
+    // out of time order: its bucket was passed upwards already, so are these
+    if (index < _first[0]) index = _first[0];
+    addSample(l0[index - _first[0]], value);
+    for (size_t level = 1; level < PYRAMID_LEVELS && !_levels[level].empty(); level++)
+    {
+      uint64_t i = index >> level;
+      if (i < _first[level]) i = _first[level];
+      addSample(_levels[level][i - _first[level]], value);
+    }
+    return;
+  }
+  addSample(l0.back(), value);
+  _pending = true;
+}
+
+void Pyramid::add(const uint64_t *timeUs, const double *value, size_t count)
+{
+  for (size_t i = 0; i < count; i++) add(timeUs[i], value[i]);
+}
+
+void Pyramid::_start()
+{
+  if (_probe.size() >= 2 && _probe.back().first > _probe.front().first)
+  {
+    uint64_t span = _probe.back().first - _probe.front().first;
+    uint64_t spacing = PYRAMID_SPAN * span / (_probe.size() - 1);
+    _baseUs = 1;
+    while (_baseUs < spacing) _baseUs <<= 1;
+  }
+  else _baseUs = PYRAMID_BASE_US;
+  for (const std::pair<uint64_t, double> &sample : _probe) add(sample.first, sample.second);
+  _probe.clear();
+  _probe.shrink_to_fit();
+}
+
+void Pyramid::_propagate()
+{
+  const LodBucket bucket = _levels[0].back();
+  uint64_t index = _first[0] + _levels[0].size() - 1;
+  for (size_t level = 1; level < PYRAMID_LEVELS; level++)
+  {
+    std::vector<LodBucket> &l = _levels[level];
+    uint64_t i = index >> level;
+    if (l.empty())
+    {
+      _first[level] = i;
+      l.push_back(EMPTY_BUCKET);
+    }
+    else if (i >= _first[level] + l.size()) l.resize(i - _first[level] + 1, EMPTY_BUCKET);
+    merge(l[i - _first[level]], bucket);
+  }
+  _pending = false;
+}
+
+void Pyramid::flush()
+{
+  if (!_baseUs) _start();
+  if (_pending) _propagate();
+}
+
+void Pyramid::levels(LodLevel *out) const
+{
+  for (size_t level = 0; level < PYRAMID_LEVELS; level++)
+  {
+    out[level].first = _first[level];
+    out[level].count = _levels[level].size();
+    out[level].buckets = _levels[level].data();
+  }
+}
+
+uint64_t Pyramid::query(uint64_t firstUs, uint64_t lastUs, unsigned pixels, std::vector<LodPoint> &out)
+{
+  if (!_baseUs) _start();
+  LodLevel l[PYRAMID_LEVELS];
+  levels(l);
+  uint64_t width = lodQuery(l, PYRAMID_LEVELS, _baseUs, firstUs, lastUs, pixels, out);
+  if (!_pending || width <= _baseUs) return width;
+
+  // the filling level 0 bucket is the newest: it belongs to the last point, or after it
+  const LodBucket &bucket = _levels[0].back();
+  size_t level = levelOf(width, _baseUs);
+  uint64_t startUs = ((_first[0] + _levels[0].size() - 1) >> level << level) * _baseUs;
+  if (!out.empty() && out.back().startUs == startUs)
+  {
+    LodPoint &p = out.back();
+    if (bucket.min < p.min) p.min = bucket.min;
+    if (bucket.max > p.max) p.max = bucket.max;
+    p.mean = (p.mean * p.count + bucket.sum) / (p.count + bucket.count);
+    p.count += bucket.count;
+  }
+  else if (startUs + width > firstUs && startUs <= lastUs && (out.empty() || out.back().startUs < startUs))
+  {
+    LodPoint p;
+    p.startUs = startUs;
+    p.min = bucket.min;
+    p.max = bucket.max;
+    p.mean = bucket.sum / bucket.count;
+    p.count = bucket.count;
+    out.push_back(p);
+  }
+  return width;
+}
+
+bool writeLodFile(const char *path, const std::vector<std::string> &names, const std::vector<std::string> &units,
+                  std::vector<Pyramid> &pyramids)
+{
+  std::vector<LodFileEntry> directory(pyramids.size());
+  uint64_t offset = sizeof(LodFileHeader);
+  for (size_t s = 0; s < pyramids.size(); s++)
+  {
+    pyramids[s].flush();
+    LodLevel l[PYRAMID_LEVELS];
+    pyramids[s].levels(l);
+    LodFileEntry &e = directory[s];
+    memset(&e, 0, sizeof(e));
+    strncpy(e.name, names[s].c_str(), sizeof(e.name) - 1);
+    strncpy(e.unit, units[s].c_str(), sizeof(e.unit) - 1);
+    e.baseUs = pyramids[s].baseUs();
+    e.levelCount = PYRAMID_LEVELS;
+    for (size_t level = 0; level < PYRAMID_LEVELS; level++)
+    {
+      e.levels[level].first = l[level].first;
+      e.levels[level].count = l[level].count;
+      e.levels[level].offset = offset;
+      offset += l[level].count * sizeof(LodBucket);
+    }
+  }
+
+  FILE *out = fopen(path, "wb");
+  if (!out) return false;
+  LodFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, LOD_FILE_MAGIC, sizeof(LOD_FILE_MAGIC));
+  header.entrySize = sizeof(LodFileEntry);
+  header.signalCount = (uint32_t)directory.size();
+  header.bucketSize = sizeof(LodBucket);
+  header.directoryOffset = offset;
+  bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+  for (size_t s = 0; s < pyramids.size() && ok; s++)
+  {
+    LodLevel l[PYRAMID_LEVELS];
+    pyramids[s].levels(l);
+    for (size_t level = 0; level < PYRAMID_LEVELS && ok; level++)
+      ok = fwrite(l[level].buckets, sizeof(LodBucket), l[level].count, out) == l[level].count;
+  }
+  ok = ok && fwrite(directory.data(), sizeof(LodFileEntry), directory.size(), out) == directory.size();
+  int err = errno;
+  if (fclose(out) != 0 && ok)
+  {
+    ok = false;
+    err = errno;
+  }
+  errno = err;
+  return ok;
+}
+
+bool LodFile::open(const char *path)
+{
+  _signalCount = 0;
+  _directoryOffset = 0;
+  if (!_map.open(path)) return false;
+  size_t size = _map.size();
+  const LodFileHeader *header = (const LodFileHeader *)_map.data();
+  bool ok = size >= sizeof(LodFileHeader)
+         && memcmp(header->magic, LOD_FILE_MAGIC, sizeof(LOD_FILE_MAGIC)) == 0
+         && header->entrySize == sizeof(LodFileEntry) && header->bucketSize == sizeof(LodBucket)
+         && header->directoryOffset % 8 == 0 && header->directoryOffset <= size
+         && header->signalCount <= (size - header->directoryOffset) / sizeof(LodFileEntry);
+  if (ok)
+  {
+    // every level inside the file, so query() needs no checks
+    const LodFileEntry *e = (const LodFileEntry *)(_map.data() + header->directoryOffset);
+    for (uint32_t i = 0; i < header->signalCount && ok; i++)
+    {
+      ok = e[i].baseUs != 0 && e[i].levelCount <= PYRAMID_LEVELS && e[i].name[sizeof(e[i].name) - 1] == 0
+        && e[i].unit[sizeof(e[i].unit) - 1] == 0;
+      for (uint32_t level = 0; level < e[i].levelCount && ok; level++)
+      {
+        const LodFileLevel &l = e[i].levels[level];
+        ok = l.offset % 8 == 0 && l.offset <= size && l.count <= (size - l.offset) / sizeof(LodBucket)
+          && (e[i].baseUs << level) >> level == e[i].baseUs;
+      }
+    }
+  }
+  if (!ok)
+  {
+    _map.close();
+    errno = EINVAL;
+    return false;
+  }
+  // a query reads a few pages of one level
+  _map.adviseRandom();
+  _signalCount = header->signalCount;
+  _directoryOffset = header->directoryOffset;
+  return true;
+}
+
+const LodFileEntry *LodFile::find(const char *name) const
+{
+  const LodFileEntry *e = entries();
+  for (size_t i = 0; i < _signalCount; i++)
+    if (strcmp(e[i].name, name) == 0) return &e[i];
+  size_t length = strlen(name);
+  for (size_t i = 0; i < _signalCount; i++)
+  {
+    const char *dot = strrchr(e[i].name, '.');
+    if (dot && strlen(dot + 1) == length && memcmp(dot + 1, name, length) == 0) return &e[i];
+  }
+  return nullptr;
+}
+
+uint64_t LodFile::query(const LodFileEntry &entry, uint64_t firstUs, uint64_t lastUs, unsigned pixels,
+                        std::vector<LodPoint> &out) const
+{
+  LodLevel l[PYRAMID_LEVELS];
+  for (uint32_t level = 0; level < entry.levelCount; level++)
+  {
+    l[level].first = entry.levels[level].first;
+    l[level].count = (size_t)entry.levels[level].count;
+    l[level].buckets = (const LodBucket *)(_map.data() + entry.levels[level].offset);
+  }
+  return lodQuery(l, entry.levelCount, entry.baseUs, firstUs, lastUs, pixels, out);
+}
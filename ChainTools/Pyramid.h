@@ -0,0 +1,173 @@
+/*
+  Pyramid.h - Min/max/mean level-of-detail pyramid of a signal (.lod files)
+
+  Level 0 cuts time into buckets of baseUs (aligned to time 0), level L
+  into buckets of baseUs << L; each bucket keeps min, max, sum and count
+  of the samples in it. A plot of a window at a given pixel width reads
+  the finest level with at most two buckets per pixel, so it touches
+  between 1 and 2 x pixels buckets however long the capture is, and
+  drawing min and max per pixel still shows every spike.
+
+  Levels are dense arrays, so level 0 should not be much finer than the
+  signal: by default the first PYRAMID_PROBE samples are held back and
+  baseUs becomes the power of two (in us) at or above PYRAMID_SPAN of
+  their mean spacing. Zoomed in further than that a plot has fewer
+  samples than pixels and draws them raw (TimeIndex.h, ColumnStore.h);
+  the pyramid stays at about 10 bytes per sample.
+
+  Samples are added in time order as they are decoded. Only the newest
+  level 0 bucket is still filling; when it closes it is merged into the
+  open bucket of every level above, so the pyramid can be queried at any
+  time while a log is parsed or a capture is running, and query() counts
+  the filling bucket in too. NaN samples are left out.
+
+  A .lod file keeps the pyramids of many signals next to their log:
+
+    header | signal 0: level 0 buckets, level 1, ... | signal 1: ... | directory
+
+  with every level a dense array of LodBucket from its first non-empty
+  bucket to its last, so a query maps only the few pages it reads.
+*/
+
+#ifndef Pyramid_h
+#define Pyramid_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.h"
+
+#define LOD_FILE_MAGIC  "CHNLOD1"
+
+/*Levels kept: the top one spans 8 M level 0 buckets (2.3 hours of a 1 ms signal)*/
+#define PYRAMID_LEVELS   24
+/*Samples baseUs is chosen from, samples per level 0 bucket at least, and baseUs when the samples do not tell*/
+#define PYRAMID_PROBE    64
+#define PYRAMID_SPAN     4
+#define PYRAMID_BASE_US  16384
+
+struct LodBucket
+{
+  float min;       // +inf and -inf while empty
+  float max;
+  double sum;
+  uint32_t count;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(LodBucket) == 24, "LodBucket is a fixed 24 byte record");
+
+struct LodFileHeader
+{
+  char magic[8];             // LOD_FILE_MAGIC, NUL terminated
+  uint32_t entrySize;        // sizeof(LodFileEntry)
+  uint32_t signalCount;      // directory entries
+  uint32_t bucketSize;       // sizeof(LodBucket)
+  uint32_t reserved;
+  uint64_t directoryOffset;  // file offset of the directory
+};
+
+static_assert(sizeof(LodFileHeader) == 32, "LodFileHeader is a fixed 32 byte record");
+
+struct LodFileLevel
+{
+  uint64_t first;   // bucket index (time / width) of the first bucket
+  uint64_t count;
+  uint64_t offset;  // of LodBucket buckets[count] from the start of the file
+};
+
+/*One directory entry*/
+struct LodFileEntry
+{
+  char name[96];    // "Message.Signal", NUL terminated (cut if longer)
+  char unit[24];
+  uint64_t baseUs;  // width of a level 0 bucket
+  uint32_t levelCount;
+  uint32_t reserved;
+  LodFileLevel levels[PYRAMID_LEVELS];
+};
+
+static_assert(sizeof(LodFileEntry) == 712, "LodFileEntry is a fixed 712 byte record");
+
+/*One bucket of a query result*/
+struct LodPoint
+{
+  uint64_t startUs;  // the bucket spans startUs .. startUs + widthUs
+  float min;
+  float max;
+  double mean;
+  uint32_t count;
+};
+
+/*Buckets first .. first + count - 1 of one level*/
+struct LodLevel
+{
+  uint64_t first;
+  size_t count;
+  const LodBucket *buckets;
+};
+
+/**Buckets of levels (of width baseUs << level) covering [firstUs, lastUs] for a plot pixels wide, empty ones
+   left out; returns the width of the level used, 0 if there is none*/
+uint64_t lodQuery(const LodLevel *levels, size_t levelCount, uint64_t baseUs, uint64_t firstUs, uint64_t lastUs,
+                  unsigned pixels, std::vector<LodPoint> &out);
+
+class Pyramid
+{
+  public:
+    /**baseUs 0 picks it from the first samples*/
+    explicit Pyramid(uint64_t baseUs = 0);
+
+    void add(uint64_t timeUs, double value);
+    void add(const uint64_t *timeUs, const double *value, size_t count);
+
+    /**As lodQuery(), the level 0 bucket still filling included*/
+    uint64_t query(uint64_t firstUs, uint64_t lastUs, unsigned pixels, std::vector<LodPoint> &out);
+
+    bool empty() const { return _levels[0].empty() && _probe.empty(); }
+    /**Merges the filling level 0 bucket into the levels above, so levels() is complete*/
+    void flush();
+    /**After flush()*/
+    uint64_t baseUs() const { return _baseUs; }
+    void levels(LodLevel *out) const;
+
+  private:
+    void _start();
+    void _propagate();
+
+    uint64_t _baseUs;                  // 0 while probing
+    std::vector<std::pair<uint64_t, double>> _probe;
+    std::vector<LodBucket> _levels[PYRAMID_LEVELS];
+    uint64_t _first[PYRAMID_LEVELS];   // bucket index of _levels[L][0]
+    bool _pending;                     // the last level 0 bucket is not merged upwards yet
+};
+
+/**Writes the pyramids of the named signals to path. Returns false with errno set*/
+bool writeLodFile(const char *path, const std::vector<std::string> &names, const std::vector<std::string> &units,
+                  std::vector<Pyramid> &pyramids);
+
+class LodFile
+{
+  public:
+    /**Maps path. Returns false with errno set (EINVAL: not a .lod file)*/
+    bool open(const char *path);
+    void close() { _map.close(); }
+
+    size_t signalCount() const { return _signalCount; }
+    const LodFileEntry *entries() const { return (const LodFileEntry *)(_map.data() + _directoryOffset); }
+    /**Entry of the signal called name, or of the first "Message.Signal" whose signal is name; NULL if none*/
+    const LodFileEntry *find(const char *name) const;
+    /**As lodQuery() on the levels of entry*/
+    uint64_t query(const LodFileEntry &entry, uint64_t firstUs, uint64_t lastUs, unsigned pixels,
+                   std::vector<LodPoint> &out) const;
+
+  private:
+    MappedFile _map;
+    size_t _signalCount = 0;
+    uint64_t _directoryOffset = 0;
+};
+
+#endif
@@ -0,0 +1,243 @@
+#include "Resample.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*Grid points gathered before the kernel runs over them; the five arrays stay in L1/L2*/
+#define RESAMPLE_TILE  1024
+
+/*Per thread work arrays, kept between signals: allocating and faulting in 10 M doubles each time costs more than the spline*/
+struct ResampleScratch
+{
+  std::vector<double> slope;
+  std::vector<double> h;
+  std::vector<double> d;
+  std::vector<double> m;
+  std::vector<double> c;
+};
+
+static thread_local ResampleScratch scratch;
+
+/**Interval j..j+1 is part of a run: both values finite, a positive length no longer than maxGapUs*/
+static inline bool joined(const SignalSeries &s, size_t j, uint64_t maxGapUs)
+{
+  uint64_t h = s.timeUs[j + 1] - s.timeUs[j];
+  return h > 0 && (!maxGapUs || h <= maxGapUs) && isfinite(s.value[j]) && isfinite(s.value[j + 1]);
+}
+
+static inline double secant(const SignalSeries &s, size_t j)
+{
+  return (s.value[j + 1] - s.value[j]) / (double)(s.timeUs[j + 1] - s.timeUs[j]);
+}
+
+/**Monotone slopes (Fritsch-Carlson weighted harmonic mean, 0 at extrema), one sided at the ends of a run*/
+static void hermiteSlopes(const SignalSeries &s, uint64_t maxGapUs, std::vector<double> &slope)
+{
+  size_t n = s.count;
+  bool left = false;
+  double dl = 0, hl = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    bool right = i + 1 < n && joined(s, i, maxGapUs);
+    double dr = right ? secant(s, i) : 0;
+    double hr = right ? (double)(s.timeUs[i + 1] - s.timeUs[i]) : 0;
+    if (left && right)
+    {
+      if (dl * dr <= 0)
+      {
+        slope[i] = 0;
+      }
+      else
+      {
+        double w1 = 2 * hr + hl;
+        double w2 = hr + 2 * hl;
+        slope[i] = (w1 + w2) / (w1 / dl + w2 / dr);
+      }
+    }
+    else
+    {
+      slope[i] = left ? dl : dr;
+    }
+    left = right;
+    dl = dr;
+    hl = hr;
+  }
+}
+
+/**Natural cubic spline of every run: second derivatives by the tridiagonal (Thomas) solve, turned into slopes*/
+static void splineSlopes(const SignalSeries &s, uint64_t maxGapUs, std::vector<double> &slope)
+{
+  size_t n = s.count;
+  // interval lengths and secants computed once, second derivatives, eliminated super diagonal
+  std::vector<double> &h = scratch.h;
+  std::vector<double> &d = scratch.d;
+  std::vector<double> &m = scratch.m;
+  std::vector<double> &c = scratch.c;
+  h.resize(n);
+  d.resize(n);
+  m.resize(n);
+  c.resize(n);
+  size_t a = 0;
+  while (a < n)
+  {
+    size_t b = a;
+    m[a] = 0;
+    for (; b + 1 < n && joined(s, b, maxGapUs); b++)
+    {
+      h[b] = (double)(s.timeUs[b + 1] - s.timeUs[b]);
+      d[b] = (s.value[b + 1] - s.value[b]) / h[b];
+    }
+    // run a..b; M[a] = M[b] = 0
+    m[b] = 0;
+    for (size_t i = a + 1; i < b; i++)
+    {
+      double rhs = 6 * (d[i] - d[i - 1]);
+      double diag = 2 * (h[i - 1] + h[i]) - (i > a + 1 ? h[i - 1] * c[i - 1] : 0);
+      c[i] = h[i] / diag;
+      m[i] = (rhs - (i > a + 1 ? h[i - 1] * m[i - 1] : 0)) / diag;
+    }
+    for (size_t i = b - (b > a); i > a + 1; i--) m[i - 1] -= c[i - 1] * m[i];
+    for (size_t i = a; i <= b; i++)
+    {
+      if (a == b) slope[i] = 0;
+      else if (i < b) slope[i] = d[i] - h[i] * (2 * m[i] + m[i + 1]) / 6;
+      else slope[i] = d[i - 1] + h[i - 1] * (m[i - 1] + 2 * m[i]) / 6;
+    }
+    a = b + 1;
+  }
+}
+
+/**Cubic Hermite segments: out = h00(u) y0 + h10(u) d0 + h01(u) y1 + h11(u) d1, d the slopes times the interval*/
+static void hermiteTile(const double *u, const double *y0, const double *d0, const double *y1, const double *d1,
+                        double *out, size_t n)
+{
+  size_t k = 0;
+#if defined(__AVX__)
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d two = _mm256_set1_pd(2.0);
+  const __m256d three = _mm256_set1_pd(3.0);
+  for (; k + 4 <= n; k += 4)
+  {
+    __m256d t = _mm256_loadu_pd(u + k);
+    __m256d t1 = _mm256_sub_pd(one, t);
+    __m256d t1sq = _mm256_mul_pd(t1, t1);
+    __m256d tsq = _mm256_mul_pd(t, t);
+    __m256d h00 = _mm256_mul_pd(_mm256_add_pd(one, _mm256_mul_pd(two, t)), t1sq);
+    __m256d h10 = _mm256_mul_pd(t, t1sq);
+    __m256d h01 = _mm256_mul_pd(tsq, _mm256_sub_pd(three, _mm256_mul_pd(two, t)));
+    __m256d h11 = _mm256_mul_pd(tsq, _mm256_sub_pd(t, one));
+    __m256d r = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(h00, _mm256_loadu_pd(y0 + k)), _mm256_mul_pd(h10, _mm256_loadu_pd(d0 + k))),
+                              _mm256_add_pd(_mm256_mul_pd(h01, _mm256_loadu_pd(y1 + k)), _mm256_mul_pd(h11, _mm256_loadu_pd(d1 + k))));
+    _mm256_storeu_pd(out + k, r);
+  }
+#elif defined(__SSE2__)
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d two = _mm_set1_pd(2.0);
+  const __m128d three = _mm_set1_pd(3.0);
+  for (; k + 2 <= n; k += 2)
+  {
+    __m128d t = _mm_loadu_pd(u + k);
+    __m128d t1 = _mm_sub_pd(one, t);
+    __m128d t1sq = _mm_mul_pd(t1, t1);
+    __m128d tsq = _mm_mul_pd(t, t);
+    __m128d h00 = _mm_mul_pd(_mm_add_pd(one, _mm_mul_pd(two, t)), t1sq);
+    __m128d h10 = _mm_mul_pd(t, t1sq);
+    __m128d h01 = _mm_mul_pd(tsq, _mm_sub_pd(three, _mm_mul_pd(two, t)));
+    __m128d h11 = _mm_mul_pd(tsq, _mm_sub_pd(t, one));
+    __m128d r = _mm_add_pd(_mm_add_pd(_mm_mul_pd(h00, _mm_loadu_pd(y0 + k)), _mm_mul_pd(h10, _mm_loadu_pd(d0 + k))),
+                           _mm_add_pd(_mm_mul_pd(h01, _mm_loadu_pd(y1 + k)), _mm_mul_pd(h11, _mm_loadu_pd(d1 + k))));
+    _mm_storeu_pd(out + k, r);
+  }
+#endif
+  for (; k < n; k++)
+  {
+    double t = u[k];
+    double t1 = 1 - t;
+    out[k] = (1 + 2 * t) * t1 * t1 * y0[k] + t * t1 * t1 * d0[k] + t * t * (3 - 2 * t) * y1[k] + t * t * (t - 1) * d1[k];
+  }
+}
+
+void resample(const SignalSeries &in, const ResampleGrid &grid, const ResampleOptions &options, double *out)
+{
+  size_t n = in.count;
+  std::vector<double> &slope = scratch.slope;
+  if (options.method != RESAMPLE_LINEAR && n)
+  {
+    slope.resize(n);
+    if (options.method == RESAMPLE_HERMITE) hermiteSlopes(in, options.maxGapUs, slope);
+    else splineSlopes(in, options.maxGapUs, slope);
+  }
+
+  double u[RESAMPLE_TILE], y0[RESAMPLE_TILE], d0[RESAMPLE_TILE], y1[RESAMPLE_TILE], d1[RESAMPLE_TILE];
+  size_t j = 0;
+  size_t segment = SIZE_MAX;    // interval the segment values below are of
+  double sy0 = NAN, sd0 = 0, sy1 = 0, sd1 = 0, sh = 0;
+  bool valid = false;
+  for (size_t k0 = 0; k0 < grid.count; k0 += RESAMPLE_TILE)
+  {
+    size_t tile = grid.count - k0 < RESAMPLE_TILE ? grid.count - k0 : RESAMPLE_TILE;
+    for (size_t i = 0; i < tile; i++)
+    {
+      uint64_t t = grid.startUs + (k0 + i) * grid.stepUs;
+      if (!n || t < in.timeUs[0] || t > in.timeUs[n - 1])
+      {
+        // NaN through the kernel: u = 0 picks y0 alone
+        u[i] = 0;
+        y0[i] = NAN;
+        d0[i] = y1[i] = d1[i] = 0;
+        continue;
+      }
+      while (j + 1 < n && in.timeUs[j + 1] <= t) j++;
+      if (j != segment)
+      {
+        segment = j;
+        valid = j + 1 < n && joined(in, j, options.maxGapUs);
+        if (valid)
+        {
+          sh = (double)(in.timeUs[j + 1] - in.timeUs[j]);
+          sy0 = in.value[j];
+          sy1 = in.value[j + 1];
+          sd0 = options.method == RESAMPLE_LINEAR ? sy1 - sy0 : slope[j] * sh;
+          sd1 = options.method == RESAMPLE_LINEAR ? sy1 - sy0 : slope[j + 1] * sh;
+        }
+      }
+      if (valid)
+      {
+        u[i] = (double)(t - in.timeUs[j]) / sh;
+        y0[i] = sy0;
+        d0[i] = sd0;
+        y1[i] = sy1;
+        d1[i] = sd1;
+      }
+      else
+      {
+        // in a gap, or right on a sample that ends a run
+        u[i] = 0;
+        y0[i] = t == in.timeUs[j] ? in.value[j] : NAN;
+        d0[i] = y1[i] = d1[i] = 0;
+      }
+    }
+    hermiteTile(u, y0, d0, y1, d1, out + k0, tile);
+  }
+}
+
+void resampleAll(ThreadPool &pool, const std::vector<SignalSeries> &in, const ResampleGrid &grid,
+                 const ResampleOptions &options, double *const *out)
+{
+  pool.run(in.size(), [&](size_t i) { resample(in[i], grid, options, out[i]); });
+}
+
+bool resampleMethod(const char *name, ResampleMethod &method)
+{
+  if (strcmp(name, "linear") == 0) method = RESAMPLE_LINEAR;
+  else if (strcmp(name, "hermite") == 0) method = RESAMPLE_HERMITE;
+  else if (strcmp(name, "spline") == 0) method = RESAMPLE_SPLINE;
+  else return false;
+  return true;
+}
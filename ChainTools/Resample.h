@@ -0,0 +1,72 @@
+/*
+  Resample.h - Aligning decoded signals onto a common time base
+
+  Every signal (for instance a SignalColumn of SignalDecoder.h) is sampled
+  whenever its frame came in; plotting or combining several needs them on
+  one timeline. resample() evaluates a signal on a uniform grid with
+
+    RESAMPLE_LINEAR   straight lines between samples
+    RESAMPLE_HERMITE  monotone cubic Hermite (Fritsch-Carlson, as PCHIP):
+                      smooth, but never overshoots between samples
+    RESAMPLE_SPLINE   natural cubic spline: smoothest, may overshoot
+
+  All three are written as a cubic Hermite segment per interval (end
+  values and slopes), so one evaluation kernel serves them: a scalar walk
+  gathers the segment of each grid point, then the polynomial runs with
+  SSE2/AVX over a tile of points.
+
+  Gaps are explicit: a NaN sample, or two samples further apart than
+  maxGapUs, break the signal into runs. Grid points between runs, or
+  outside the signal, come out NaN; splines and slopes never reach across
+  a gap. resampleAll() spreads many signals over a ThreadPool.
+*/
+
+#ifndef Resample_h
+#define Resample_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "ThreadPool.h"
+
+enum ResampleMethod
+{
+  RESAMPLE_LINEAR,
+  RESAMPLE_HERMITE,
+  RESAMPLE_SPLINE,
+};
+
+/*Samples of one signal, timeUs rising (equal times allowed)*/
+struct SignalSeries
+{
+  const uint64_t *timeUs;
+  const double *value;
+  size_t count;
+};
+
+/*Grid point k is at startUs + k * stepUs*/
+struct ResampleGrid
+{
+  uint64_t startUs;
+  uint64_t stepUs;
+  size_t count;
+};
+
+struct ResampleOptions
+{
+  ResampleMethod method = RESAMPLE_LINEAR;
+  uint64_t maxGapUs = 0;  // samples further apart are not joined; 0 joins all
+};
+
+/**Evaluates in on every grid point into out[grid.count]*/
+void resample(const SignalSeries &in, const ResampleGrid &grid, const ResampleOptions &options, double *out);
+
+/**resample() of every series in into out[i], one signal per task on pool*/
+void resampleAll(ThreadPool &pool, const std::vector<SignalSeries> &in, const ResampleGrid &grid,
+                 const ResampleOptions &options, double *const *out);
+
+/**Parses "linear", "hermite" or "spline"*/
+bool resampleMethod(const char *name, ResampleMethod &method);
+
+#endif
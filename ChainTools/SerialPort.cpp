@@ -0,0 +1,44 @@
+#include "SerialPort.h"
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+static speed_t baudConstant(long baud)
+{
+  switch (baud)
+  {
+    case 9600: return B9600;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 500000: return B500000;
+    case 1000000: return B1000000;
+    case 2000000: return B2000000;
+    default: return B0;
+  }
+}
+
+int openSerialPort(const char *path, long baud)
+{
+  int fd = open(path, O_RDONLY | O_NOCTTY);
+  if (fd < 0) return -1;
+
+  struct termios tio;
+  if (tcgetattr(fd, &tio) == 0)
+  {
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    // Block until at least one byte is there, then return whatever has arrived
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    speed_t speed = baudConstant(baud);
+    if (speed != B0)
+    {
+      cfsetispeed(&tio, speed);
+      cfsetospeed(&tio, speed);
+    }
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  return fd;
+}
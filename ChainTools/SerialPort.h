@@ -0,0 +1,14 @@
+/*
+  SerialPort.h - Raw POSIX serial port access for the live capture tools
+
+  Also accepts a pty (or any character device / FIFO); the line settings are
+  then applied where the device supports them and otherwise ignored.
+*/
+
+#ifndef SerialPort_h
+#define SerialPort_h
+
+/**Opens path read-only in raw 8N1 mode at baud. Returns the descriptor or -1 (errno set)*/
+int openSerialPort(const char *path, long baud);
+
+#endif
@@ -0,0 +1,105 @@
+#include "SignalCache.h"
+
+#include <string.h>
+#include <time.h>
+
+/*Longest sleep of wait() before it looks at the stop flag again*/
+#define CACHE_WAIT_STEP_US  10000
+
+static uint64_t nowUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void sleepUs(uint64_t us)
+{
+  struct timespec ts = {(time_t)(us / 1000000), (long)(us % 1000000 * 1000)};
+  nanosleep(&ts, NULL);
+}
+
+SignalCache::SignalCache(size_t signals) : _slots(signals), _sequence(0)
+{
+  for (Slot &slot : _slots)
+  {
+    slot.timeUs.store(0, std::memory_order_relaxed);
+    slot.value.store(0, std::memory_order_relaxed);
+    slot.changed.store(0, std::memory_order_relaxed);
+  }
+}
+
+void SignalCache::_store(Slot &slot, uint64_t timeUs, double value, uint64_t commit)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  slot.timeUs.store(timeUs, std::memory_order_relaxed);
+  slot.value.store(bits, std::memory_order_relaxed);
+  slot.changed.store(commit, std::memory_order_relaxed);
+}
+
+void SignalCache::update(const std::vector<SignalColumn> &columns)
+{
+  uint64_t sequence = _sequence.load(std::memory_order_relaxed);
+  uint64_t commit = sequence / 2 + 1;
+  _sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  size_t n = columns.size() < _slots.size() ? columns.size() : _slots.size();
+  for (size_t s = 0; s < n; s++)
+  {
+    const SignalColumn &c = columns[s];
+    if (!c.value.empty()) _store(_slots[s], c.timeUs.back(), c.value.back(), commit);
+  }
+  _sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void SignalCache::set(size_t signal, uint64_t timeUs, double value)
+{
+  if (signal >= _slots.size()) return;
+  uint64_t sequence = _sequence.load(std::memory_order_relaxed);
+  _sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  _store(_slots[signal], timeUs, value, sequence / 2 + 1);
+  _sequence.store(sequence + 2, std::memory_order_release);
+}
+
+uint64_t SignalCache::snapshot(const uint32_t *signals, size_t count, SignalValue *out) const
+{
+  for (;;)
+  {
+    uint64_t before = _sequence.load(std::memory_order_acquire);
+    if (before & 1) continue;  // a commit is being written
+    for (size_t i = 0; i < count; i++)
+    {
+      const Slot &slot = _slots[signals[i]];
+      uint64_t bits = slot.value.load(std::memory_order_relaxed);
+      out[i].timeUs = slot.timeUs.load(std::memory_order_relaxed);
+      memcpy(&out[i].value, &bits, sizeof(bits));
+      out[i].changed = slot.changed.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_sequence.load(std::memory_order_relaxed) == before) return before / 2;
+  }
+}
+
+uint64_t SignalCache::wait(uint64_t seen, uint64_t intervalUs, uint64_t *last, const std::atomic<bool> &stop) const
+{
+  for (;;)
+  {
+    uint64_t now = nowUs();
+    uint64_t due = *last + intervalUs;
+    if (now >= due)
+    {
+      uint64_t commit = commits();
+      if (commit > seen)
+      {
+        *last = now;
+        return commit;
+      }
+      // nothing new yet: look again after a step
+      due = now + CACHE_WAIT_STEP_US;
+    }
+    if (stop.load(std::memory_order_relaxed)) return seen;
+    sleepUs(due - now < CACHE_WAIT_STEP_US ? due - now : CACHE_WAIT_STEP_US);
+  }
+}
@@ -0,0 +1,72 @@
+/*
+  SignalCache.h - Latest value of every decoded signal, for live dashboards
+
+  Replaces the per-refresh recomputation in UI/Dashboard.vi and Car Data
+  Live.vi. One writer (the thread decoding the live stream) commits the
+  newest value and time of every signal a batch carried; any number of
+  dashboard threads take snapshots of the signals they show. A refresh
+  then costs O(signals on screen), whatever the bus rate.
+
+  Commits and snapshots go through a sequence lock: the writer makes the
+  sequence odd, stores the values and makes it even again, never waiting
+  for anyone; a reader copies its signals and retries only if the
+  sequence moved meanwhile, so every snapshot holds the values of one
+  commit. Every slot also remembers the commit that last changed it, so a
+  reader can tell which of its signals changed since its last snapshot.
+  wait() is the rate-limited notification: it returns at most once per
+  interval, and only when something was committed.
+*/
+
+#ifndef SignalCache_h
+#define SignalCache_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include "SignalDecoder.h"
+
+struct SignalValue
+{
+  uint64_t timeUs;
+  double value;
+  uint64_t changed;  // commit that last set it, 0 if never
+};
+
+class SignalCache
+{
+  public:
+    /**Cache for signals signals, numbered as the columns of SignalDecoder*/
+    explicit SignalCache(size_t signals);
+
+    size_t signalCount() const { return _slots.size(); }
+
+    /**Writer: commits the newest value of every column that has any (decode() output)*/
+    void update(const std::vector<SignalColumn> &columns);
+    /**Writer: commits one value*/
+    void set(size_t signal, uint64_t timeUs, double value);
+
+    /**Copies the values of signals[0..count-1] into out, all from one commit, and returns that commit*/
+    uint64_t snapshot(const uint32_t *signals, size_t count, SignalValue *out) const;
+    /**Number of the latest commit, 0 before the first*/
+    uint64_t commits() const { return _sequence.load(std::memory_order_acquire) / 2; }
+    /**Sleeps until a commit newer than seen and at least intervalUs after the last return (*last, updated).
+       Returns the newest commit, or seen if stop became true*/
+    uint64_t wait(uint64_t seen, uint64_t intervalUs, uint64_t *last, const std::atomic<bool> &stop) const;
+
+  private:
+    struct Slot
+    {
+      std::atomic<uint64_t> timeUs;
+      std::atomic<uint64_t> value;    // bits of the double
+      std::atomic<uint64_t> changed;
+    };
+
+    void _store(Slot &slot, uint64_t timeUs, double value, uint64_t commit);
+
+    std::vector<Slot> _slots;
+    alignas(64) std::atomic<uint64_t> _sequence;
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "SignalDecoder.h"
+
+#include <string.h>
+
+/**Raw value of a plan in word: the field, sign extended if signed*/
+template <bool Signed>
+static inline int64_t fieldOf(uint64_t word, uint8_t shift, uint64_t mask, uint8_t up)
+{
+  uint64_t raw = (word >> shift) & mask;
+  return Signed ? (int64_t)(raw << up) >> up : (int64_t)raw;
+}
+
+template <bool Signed>
+static void extractInteger(const uint64_t *words, size_t n, uint8_t shift, uint64_t mask, uint8_t length,
+                           double factor, double offset, double *out)
+{
+  uint8_t up = (uint8_t)(64 - length);
+  if (Signed)
+  {
+    for (size_t k = 0; k < n; k++) out[k] = (double)fieldOf<true>(words[k], shift, mask, up) * factor + offset;
+  }
+  else
+  {
+    for (size_t k = 0; k < n; k++) out[k] = (double)((words[k] >> shift) & mask) * factor + offset;
+  }
+}
+
+static void extractFloat(const uint64_t *words, size_t n, uint8_t shift, double factor, double offset, double *out)
+{
+  for (size_t k = 0; k < n; k++)
+  {
+    uint32_t bits = (uint32_t)(words[k] >> shift);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    out[k] = v * factor + offset;
+  }
+}
+
+static void extractDouble(const uint64_t *words, size_t n, double factor, double offset, double *out)
+{
+  for (size_t k = 0; k < n; k++)
+  {
+    double v;
+    memcpy(&v, &words[k], sizeof(v));
+    out[k] = v * factor + offset;
+  }
+}
+
+SignalDecoder::SignalDecoder(const DbcFile &dbc) : _signalCount(0), _standard(0x800, -1)
+{
+  for (const DbcMessage &m : dbc.messages())
+  {
+    // a repeated ID keeps its first definition
+    if (m.extended ? _extended.count(m.id) != 0 : m.id > 0x7FF || _standard[m.id] >= 0) continue;
+    Message message;
+    message.dlc = m.dlc;
+    message.anySwap = false;
+    message.multiplexor = -1;
+    for (const DbcSignal &s : m.signals)
+    {
+      Plan p;
+      p.length = s.length;
+      p.mask = s.length == 64 ? ~0ULL : (1ULL << s.length) - 1;
+      p.swap = s.motorola;
+      if (s.motorola)
+      {
+        // MSB of the field counted from the MSB of the byte swapped word
+        int msb = (s.startBit / 8) * 8 + (7 - s.startBit % 8);
+        p.shift = (uint8_t)(64 - (msb + s.length));
+        p.bytes = (uint8_t)((msb + s.length + 7) / 8);
+      }
+      else
+      {
+        p.shift = (uint8_t)s.startBit;
+        p.bytes = (uint8_t)((s.startBit + s.length + 7) / 8);
+      }
+      p.isSigned = s.isSigned;
+      p.valueType = s.valueType;
+      p.multiplex = s.multiplex;
+      p.factor = s.factor;
+      p.offset = s.offset;
+      p.column = (uint32_t)_signalCount++;
+      _names.push_back(m.name + "." + s.name);
+      _units.push_back(s.unit);
+      if (s.multiplex == DBC_MULTIPLEXOR) message.multiplexor = (int)message.plans.size();
+      message.anySwap |= s.motorola;
+      message.plans.push_back(p);
+    }
+    int32_t index = (int32_t)_messages.size();
+    _messages.push_back(std::move(message));
+    if (m.extended) _extended[m.id] = index;
+    else _standard[m.id] = index;
+  }
+}
+
+void SignalDecoder::columns(std::vector<SignalColumn> &out) const
+{
+  out.clear();
+  out.resize(_signalCount);
+  for (size_t i = 0; i < _signalCount; i++)
+  {
+    out[i].name = _names[i];
+    out[i].unit = _units[i];
+  }
+}
+
+int SignalDecoder::_lookup(const CanFrame &frame) const
+{
+  if (frame.flags & FRAME_RTR) return -1;
+  if (!(frame.flags & FRAME_EXTENDED)) return frame.id <= 0x7FF ? _standard[frame.id] : -1;
+  auto it = _extended.find(frame.id);
+  return it == _extended.end() ? -1 : it->second;
+}
+
+void SignalDecoder::decode(const CanFrame *frames, size_t count, std::vector<SignalColumn> &out)
+{
+  if (out.size() != _signalCount) columns(out);
+  for (size_t i = 0; i < count; i++)
+  {
+    int m = _lookup(frames[i]);
+    if (m >= 0) _messages[m].rows.push_back((uint32_t)i);
+  }
+  for (Message &message : _messages)
+  {
+    if (message.rows.empty()) continue;
+    _decodeMessage(message, frames, out);
+    message.rows.clear();
+  }
+}
+
+void SignalDecoder::_decodeMessage(Message &message, const CanFrame *frames, std::vector<SignalColumn> &out)
+{
+  // gather the rows once; every plan then streams over contiguous words
+  size_t n = message.rows.size();
+  _time.resize(n);
+  _payload.resize(n);
+  _dlc.resize(n);
+  uint8_t minDlc = 8;
+  for (size_t k = 0; k < n; k++)
+  {
+    const CanFrame &f = frames[message.rows[k]];
+    _time[k] = f.timeUs;
+    memcpy(&_payload[k], f.data, 8);
+    _dlc[k] = f.dlc;
+    if (f.dlc < minDlc) minDlc = f.dlc;
+  }
+  if (message.anySwap)
+  {
+    _swapped.resize(n);
+    for (size_t k = 0; k < n; k++) _swapped[k] = __builtin_bswap64(_payload[k]);
+  }
+  if (message.multiplexor >= 0)
+  {
+    const Plan &p = message.plans[message.multiplexor];
+    const uint64_t *words = p.swap ? _swapped.data() : _payload.data();
+    _multiplex.resize(n);
+    for (size_t k = 0; k < n; k++) _multiplex[k] = (words[k] >> p.shift) & p.mask;
+  }
+
+  for (const Plan &p : message.plans)
+  {
+    const uint64_t *words = p.swap ? _swapped.data() : _payload.data();
+    const uint64_t *times = _time.data();
+    size_t m = n;
+    bool multiplexed = p.multiplex >= 0 && message.multiplexor >= 0;
+    if (multiplexed || minDlc < p.bytes)
+    {
+      // only the frames that hold this signal
+      _pickWord.resize(n);
+      _pickTime.resize(n);
+      m = 0;
+      for (size_t k = 0; k < n; k++)
+      {
+        bool take = _dlc[k] >= p.bytes && (!multiplexed || _multiplex[k] == (uint64_t)p.multiplex);
+        _pickWord[m] = words[k];
+        _pickTime[m] = times[k];
+        m += take;
+      }
+      words = _pickWord.data();
+      times = _pickTime.data();
+    }
+    if (!m) continue;
+
+    SignalColumn &column = out[p.column];
+    size_t base = column.value.size();
+    column.timeUs.insert(column.timeUs.end(), times, times + m);
+    column.value.resize(base + m);
+    double *dest = column.value.data() + base;
+    if (p.valueType == DBC_FLOAT) extractFloat(words, m, p.shift, p.factor, p.offset, dest);
+    else if (p.valueType == DBC_DOUBLE) extractDouble(words, m, p.factor, p.offset, dest);
+    else if (p.isSigned) extractInteger<true>(words, m, p.shift, p.mask, p.length, p.factor, p.offset, dest);
+    else extractInteger<false>(words, m, p.shift, p.mask, p.length, p.factor, p.offset, dest);
+  }
+}
@@ -0,0 +1,95 @@
+/*
+  SignalDecoder.h - Compiled DBC signal decoding into typed columns
+
+  Each DBC signal is compiled once into an extraction plan: the payload is
+  read as one 64 bit word (byte swapped for Motorola signals), so every
+  signal becomes a shift, a mask, an optional sign extension and a scale
+  and offset, whatever its byte order and alignment. decode() first sorts
+  a batch of frames by message (a table lookup for 11 bit IDs), gathers
+  each message's payloads into a contiguous array, and then runs one
+  plan at a time over all of them: a tight loop with no per-signal
+  branching on byte order, sign or type.
+
+  Multiplexed signals are taken only from frames whose multiplexor has
+  their value. A frame shorter than a signal needs does not produce it.
+*/
+
+#ifndef SignalDecoder_h
+#define SignalDecoder_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CanFrame.h"
+#include "Dbc.h"
+
+/*One decoded signal: physical values and the times of the frames they came from*/
+struct SignalColumn
+{
+  std::string name;  // "Message.Signal"
+  std::string unit;
+  std::vector<uint64_t> timeUs;
+  std::vector<double> value;
+};
+
+class SignalDecoder
+{
+  public:
+    explicit SignalDecoder(const DbcFile &dbc);
+
+    /**Columns named and empty, one per signal, for decode() to fill*/
+    void columns(std::vector<SignalColumn> &out) const;
+    size_t signalCount() const { return _signalCount; }
+
+    /**Decodes frames and appends every signal they carry to its column in out (see columns())*/
+    void decode(const CanFrame *frames, size_t count, std::vector<SignalColumn> &out);
+
+  private:
+    struct Plan
+    {
+      uint64_t mask;     // length low bits
+      uint8_t shift;     // of the LSB in the (swapped) payload word
+      uint8_t length;
+      uint8_t bytes;     // payload bytes the signal reaches into
+      bool swap;         // Motorola: taken from the byte swapped word
+      bool isSigned;
+      uint8_t valueType;
+      int multiplex;     // DBC_PLAIN or the multiplexor value
+      double factor;
+      double offset;
+      uint32_t column;
+    };
+
+    struct Message
+    {
+      uint8_t dlc;
+      bool anySwap;
+      int multiplexor;   // plan index of the multiplexor, -1 if none
+      std::vector<Plan> plans;
+      std::vector<uint32_t> rows;  // frames of the batch being decoded
+    };
+
+    int _lookup(const CanFrame &frame) const;
+    void _decodeMessage(Message &message, const CanFrame *frames, std::vector<SignalColumn> &out);
+
+    std::vector<Message> _messages;
+    std::vector<std::string> _names;
+    std::vector<std::string> _units;
+    size_t _signalCount;
+    std::vector<int32_t> _standard;  // message index of every 11 bit ID, -1 if none
+    std::unordered_map<uint32_t, int32_t> _extended;
+    // scratch for one message: its rows' times, payloads (little endian and byte swapped), multiplexor values,
+    // and the subset a multiplexed or long signal is taken from
+    std::vector<uint64_t> _time;
+    std::vector<uint64_t> _payload;
+    std::vector<uint64_t> _swapped;
+    std::vector<uint64_t> _multiplex;
+    std::vector<uint8_t> _dlc;
+    std::vector<uint64_t> _pickTime;
+    std::vector<uint64_t> _pickWord;
+};
+
+#endif
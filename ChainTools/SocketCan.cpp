@@ -0,0 +1,171 @@
+#include "SocketCan.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <linux/can/raw.h>
+
+/*Longest wait for room in a full interface queue before sending is retried*/
+#define CAN_SEND_WAIT_MS  10
+/*Messages per sendmmsg() call, the kernel's limit (UIO_MAXIOV)*/
+#define CAN_SEND_BATCH    1024
+
+CanSocket::CanSocket() : _fd(-1)
+{
+}
+
+CanSocket::~CanSocket()
+{
+  close();
+}
+
+bool CanSocket::open(const char *interface)
+{
+  close();
+  struct ifreq ifr;
+  if (strlen(interface) >= sizeof(ifr.ifr_name))
+  {
+    errno = EINVAL;
+    return false;
+  }
+  int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (fd < 0) return false;
+  memset(&ifr, 0, sizeof(ifr));
+  strcpy(ifr.ifr_name, interface);
+  struct sockaddr_can addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.can_family = AF_CAN;
+  bool ok = ioctl(fd, SIOCGIFINDEX, &ifr) == 0;
+  addr.can_ifindex = ifr.ifr_ifindex;
+  if (!ok || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+  {
+    int err = errno;
+    ::close(fd);
+    errno = err;
+    return false;
+  }
+  // the gateway only sends: frames from other senders on the bus would just pile up unread
+  setsockopt(fd, SOL_CAN_RAW, CAN_RAW_FILTER, NULL, 0);
+  _fd = fd;
+  return true;
+}
+
+void CanSocket::close()
+{
+  if (_fd >= 0) ::close(_fd);
+  _fd = -1;
+}
+
+bool CanSocket::send(const CanFrame *frames, size_t count)
+{
+  if (_fd < 0)
+  {
+    errno = EBADF;
+    return false;
+  }
+  _frames.resize(count);
+  _iov.resize(count);
+  _messages.resize(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    const CanFrame &f = frames[i];
+    struct can_frame &c = _frames[i];
+    memset(&c, 0, sizeof(c));
+    c.can_id = f.id;
+    if (f.flags & FRAME_EXTENDED) c.can_id |= CAN_EFF_FLAG;
+    if (f.flags & FRAME_RTR) c.can_id |= CAN_RTR_FLAG;
+    c.can_dlc = f.dlc < 8 ? f.dlc : 8;
+    if (!(f.flags & FRAME_RTR)) memcpy(c.data, f.data, c.can_dlc);
+    _iov[i].iov_base = &c;
+    _iov[i].iov_len = sizeof(c);
+    memset(&_messages[i], 0, sizeof(_messages[i]));
+    _messages[i].msg_hdr.msg_iov = &_iov[i];
+    _messages[i].msg_hdr.msg_iovlen = 1;
+  }
+  size_t sent = 0;
+  while (sent < count)
+  {
+    size_t n = count - sent < CAN_SEND_BATCH ? count - sent : CAN_SEND_BATCH;
+    int r = sendmmsg(_fd, &_messages[sent], (unsigned)n, 0);
+    if (r > 0)
+    {
+      sent += (size_t)r;
+      continue;
+    }
+    if (r < 0 && errno == EINTR) continue;
+    if (r < 0 && errno != ENOBUFS && errno != EAGAIN) return false;
+    // the interface queue is full: wait until it drains
+    struct pollfd p = {_fd, POLLOUT, 0};
+    poll(&p, 1, CAN_SEND_WAIT_MS);
+  }
+  return true;
+}
+
+SlcanWriter::SlcanWriter() : _fd(-1)
+{
+}
+
+SlcanWriter::~SlcanWriter()
+{
+  close();
+}
+
+bool SlcanWriter::open(const char *path)
+{
+  close();
+  _fd = ::open(path, O_WRONLY | O_NOCTTY | O_CREAT | O_TRUNC, 0644);
+  return _fd >= 0;
+}
+
+void SlcanWriter::close()
+{
+  if (_fd >= 0) ::close(_fd);
+  _fd = -1;
+}
+
+size_t formatSlcanLine(const CanFrame &frame, char *line)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  bool extended = frame.flags & FRAME_EXTENDED;
+  bool rtr = frame.flags & FRAME_RTR;
+  char *p = line;
+  *p++ = extended ? (rtr ? 'R' : 'T') : (rtr ? 'r' : 't');
+  for (int shift = extended ? 28 : 8; shift >= 0; shift -= 4) *p++ = hex[frame.id >> shift & 0xF];
+  int dlc = frame.dlc < 8 ? frame.dlc : 8;
+  *p++ = (char)('0' + dlc);
+  if (!rtr)
+  {
+    for (int i = 0; i < dlc; i++)
+    {
+      *p++ = hex[frame.data[i] >> 4];
+      *p++ = hex[frame.data[i] & 0xF];
+    }
+  }
+  *p++ = '\r';
+  return (size_t)(p - line);
+}
+
+bool SlcanWriter::send(const CanFrame *frames, size_t count)
+{
+  if (_fd < 0)
+  {
+    errno = EBADF;
+    return false;
+  }
+  _buf.resize(count * 32);
+  size_t used = 0;
+  for (size_t i = 0; i < count; i++) used += formatSlcanLine(frames[i], &_buf[used]);
+  for (size_t done = 0; done < used;)
+  {
+    ssize_t n = write(_fd, &_buf[done], used - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) return false;
+    done += (size_t)n;
+  }
+  return true;
+}
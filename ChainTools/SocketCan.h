@@ -0,0 +1,75 @@
+/*
+  SocketCan.h - CanFrame output to Linux SocketCAN and to the slcan line protocol
+
+  CanSocket sends on a raw CAN socket (a vcan interface for tests, or real
+  hardware) so candump, Wireshark and python-can see the logger's frames
+  as a local bus. A batch goes out in one sendmmsg() call, a message per
+  frame, instead of a write() per frame; when the interface queue is full
+  the rest of the batch waits for room rather than being dropped.
+
+  SlcanWriter writes the same frames as slcan (LAWICEL) ASCII lines,
+
+    t1A08007F100000000000\r    11 bit ID, DLC, data
+    T18FEF1008...\r            29 bit ID
+    r1A00\r  R18FEF1000\r      remote requests
+
+  to a tty or pty that slcand (or python-can's slcan interface) reads,
+  where no vcan is available. Each batch is one write().
+*/
+
+#ifndef SocketCan_h
+#define SocketCan_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <linux/can.h>
+#include <sys/socket.h>
+
+#include "CanFrame.h"
+
+class CanSocket
+{
+  public:
+    CanSocket();
+    ~CanSocket();
+    CanSocket(const CanSocket &) = delete;
+    CanSocket &operator=(const CanSocket &) = delete;
+
+    /**Opens a raw CAN socket bound to interface (e.g. "vcan0"). Returns false with errno set*/
+    bool open(const char *interface);
+    void close();
+    /**Sends the frames in order. Returns false with errno set on an error other than a full queue*/
+    bool send(const CanFrame *frames, size_t count);
+
+  private:
+    int _fd;
+    std::vector<struct can_frame> _frames;
+    std::vector<struct iovec> _iov;
+    std::vector<struct mmsghdr> _messages;
+};
+
+class SlcanWriter
+{
+  public:
+    SlcanWriter();
+    ~SlcanWriter();
+    SlcanWriter(const SlcanWriter &) = delete;
+    SlcanWriter &operator=(const SlcanWriter &) = delete;
+
+    /**Opens path (a tty, pty or file) for writing. Returns false with errno set*/
+    bool open(const char *path);
+    void close();
+    /**Writes the frames as slcan lines. Returns false with errno set*/
+    bool send(const CanFrame *frames, size_t count);
+
+  private:
+    int _fd;
+    std::vector<char> _buf;
+};
+
+/**Formats frame as one slcan line (at least 32 bytes, CR included) into line and returns its length*/
+size_t formatSlcanLine(const CanFrame &frame, char *line);
+
+#endif
@@ -0,0 +1,114 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned threads)
+  : _shares(threads ? threads : (std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1)),
+    _task(nullptr), _generation(0), _busy(0), _quit(false)
+{
+  for (unsigned i = 1; i < _shares.size(); i++) _workers.emplace_back(&ThreadPool::_worker, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _quit = true;
+  }
+  _start.notify_all();
+  for (std::thread &worker : _workers) worker.join();
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)> &task)
+{
+  if (!count) return;
+  size_t n = _shares.size();
+  for (size_t i = 0; i < n; i++)
+  {
+    std::lock_guard<std::mutex> guard(_shares[i].lock);
+    _shares[i].next = count * i / n;
+    _shares[i].end = count * (i + 1) / n;
+  }
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _task = &task;
+    _generation++;
+    _busy = (unsigned)_workers.size();
+  }
+  _start.notify_all();
+  _work(0);
+  std::unique_lock<std::mutex> lock(_lock);
+  _done.wait(lock, [this] { return _busy == 0; });
+  _task = nullptr;
+}
+
+void ThreadPool::_worker(unsigned self)
+{
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(_lock);
+  for (;;)
+  {
+    _start.wait(lock, [&] { return _quit || _generation != seen; });
+    if (_quit) return;
+    seen = _generation;
+    lock.unlock();
+    _work(self);
+    lock.lock();
+    if (--_busy == 0) _done.notify_one();
+  }
+}
+
+void ThreadPool::_work(unsigned self)
+{
+  for (;;)
+  {
+    size_t index;
+    if (_take(self, index)) (*_task)(index);
+    else if (!_steal(self)) return;
+  }
+}
+
+bool ThreadPool::_take(unsigned self, size_t &index)
+{
+  Share &share = _shares[self];
+  std::lock_guard<std::mutex> guard(share.lock);
+  if (share.next >= share.end) return false;
+  index = share.next++;
+  return true;
+}
+
+/*Moves the back half of the largest share left to our own, empty one*/
+bool ThreadPool::_steal(unsigned self)
+{
+  for (;;)
+  {
+    unsigned victim = self;
+    size_t most = 0;
+    for (unsigned i = 0; i < _shares.size(); i++)
+    {
+      if (i == self) continue;
+      std::lock_guard<std::mutex> guard(_shares[i].lock);
+      size_t left = _shares[i].end - _shares[i].next;
+      if (left > most)
+      {
+        most = left;
+        victim = i;
+      }
+    }
+    if (!most) return false;
+
+    size_t begin, end;
+    {
+      Share &share = _shares[victim];
+      std::lock_guard<std::mutex> guard(share.lock);
+      size_t left = share.end - share.next;
+      if (!left) continue;  // emptied meanwhile, look again
+      end = share.end;
+      begin = end - (left + 1) / 2;
+      share.end = begin;
+    }
+    Share &own = _shares[self];
+    std::lock_guard<std::mutex> guard(own.lock);
+    own.next = begin;
+    own.end = end;
+    return true;
+  }
+}
@@ -0,0 +1,57 @@
+/*
+  ThreadPool.h - Work-stealing pool for the parallel passes over a log
+
+  run(count, task) calls task(i) once for every i in [0, count) and
+  returns when all calls are done; the calling thread works too. Every
+  worker starts on its own contiguous share of the indices and takes them
+  from the front; one that runs out steals the back half of the largest
+  share left, so chunks that parse slower (longer lines, a burst of bad
+  lines) do not hold the others up.
+*/
+
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+  public:
+    /**threads in total, the caller of run() included; 0 for one per hardware thread*/
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    void run(size_t count, const std::function<void(size_t)> &task);
+    unsigned threads() const { return (unsigned)_shares.size(); }
+
+  private:
+    struct Share
+    {
+      std::mutex lock;
+      size_t next = 0;
+      size_t end = 0;
+    };
+
+    void _worker(unsigned self);
+    void _work(unsigned self);
+    bool _take(unsigned self, size_t &index);
+    bool _steal(unsigned self);
+
+    std::vector<Share> _shares;
+    std::vector<std::thread> _workers;
+    std::mutex _lock;
+    std::condition_variable _start;
+    std::condition_variable _done;
+    const std::function<void(size_t)> *_task;
+    uint64_t _generation;
+    unsigned _busy;
+    bool _quit;
+};
+
+#endif
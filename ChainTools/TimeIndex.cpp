@@ -0,0 +1,153 @@
+#include "TimeIndex.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "LogParser.h"
+
+/*Text parsed per step while building, and while decoding a window*/
+#define INDEX_BATCH   (16UL << 20)
+#define WINDOW_BATCH  (64UL << 10)
+
+/**End of the batch of about want bytes from p: just after a newline, or end*/
+static const char *batchEnd(const char *p, const char *end, size_t want)
+{
+  if ((size_t)(end - p) <= want) return end;
+  const char *nl = (const char *)memchr(p + want, '\n', (size_t)(end - p - want));
+  return nl ? nl + 1 : end;
+}
+
+void TimeIndex::build(const char *text, size_t size, uint32_t everyFrames, uint32_t everyMs)
+{
+  _entries.clear();
+  _everyFrames = everyFrames ? everyFrames : 1;
+  _everyMs = everyMs;
+  LogParser parser;
+  std::vector<CanFrame> frames;
+  std::vector<uint64_t> offsets;
+  uint64_t sinceEntry = 0;
+  uint64_t entryMs = 0;
+  const char *end = text + size;
+  for (const char *p = text; p < end;)
+  {
+    const char *stop = batchEnd(p, end, INDEX_BATCH);
+    frames.clear();
+    offsets.clear();
+    parser.parse(p, stop, frames, &offsets);
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+      uint64_t timeMs = frames[i].timeUs / 1000;
+      if (_entries.empty() || sinceEntry >= _everyFrames || (_everyMs && timeMs - entryMs >= _everyMs))
+      {
+        TimeIndexEntry e;
+        e.offset = (uint64_t)(p - text) + offsets[i];
+        e.timeMs = timeMs;
+        e.msgNum = frames[i].msgNum;
+        e.timeDiffMs = frames[i].timeDiffMs;
+        _entries.push_back(e);
+        sinceEntry = 0;
+        entryMs = timeMs;
+      }
+      sinceEntry++;
+    }
+    p = stop;
+  }
+}
+
+static TimeIndexHeader makeHeader(uint64_t count, uint32_t everyFrames, uint32_t everyMs, uint64_t sourceSize,
+                                  int64_t sourceMtime)
+{
+  TimeIndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, TIME_INDEX_MAGIC, sizeof(TIME_INDEX_MAGIC));
+  header.entrySize = sizeof(TimeIndexEntry);
+  header.everyFrames = everyFrames;
+  header.everyMs = everyMs;
+  header.count = count;
+  header.sourceSize = sourceSize;
+  header.sourceMtime = sourceMtime;
+  return header;
+}
+
+bool TimeIndex::write(const char *path, uint64_t sourceSize, int64_t sourceMtime) const
+{
+  FILE *out = fopen(path, "wb");
+  if (!out) return false;
+  TimeIndexHeader header = makeHeader(_entries.size(), _everyFrames, _everyMs, sourceSize, sourceMtime);
+  bool ok = fwrite(&header, sizeof(header), 1, out) == 1
+         && fwrite(_entries.data(), sizeof(TimeIndexEntry), _entries.size(), out) == _entries.size();
+  int err = errno;
+  if (fclose(out) != 0 && ok)
+  {
+    ok = false;
+    err = errno;
+  }
+  errno = err;
+  return ok;
+}
+
+bool TimeIndex::read(const char *path, uint64_t sourceSize, int64_t sourceMtime)
+{
+  _entries.clear();
+  FILE *in = fopen(path, "rb");
+  if (!in) return false;
+  TimeIndexHeader header;
+  int err = EINVAL;
+  bool ok = fread(&header, sizeof(header), 1, in) == 1
+         && memcmp(header.magic, TIME_INDEX_MAGIC, sizeof(TIME_INDEX_MAGIC)) == 0
+         && header.entrySize == sizeof(TimeIndexEntry) && header.count <= sourceSize;
+  if (ok && (header.sourceSize != sourceSize || header.sourceMtime != sourceMtime))
+  {
+    ok = false;
+    err = ESTALE;
+  }
+  if (ok)
+  {
+    _entries.resize((size_t)header.count);
+    ok = fread(_entries.data(), sizeof(TimeIndexEntry), _entries.size(), in) == _entries.size();
+    _everyFrames = header.everyFrames;
+    _everyMs = header.everyMs;
+  }
+  fclose(in);
+  if (!ok)
+  {
+    _entries.clear();
+    errno = err;
+  }
+  return ok;
+}
+
+const TimeIndexEntry *TimeIndex::seek(uint64_t timeMs) const
+{
+  if (_entries.empty()) return nullptr;
+  // several frames share a ms: start before the first entry at timeMs, not on it
+  auto it = std::lower_bound(_entries.begin(), _entries.end(), timeMs,
+                             [](const TimeIndexEntry &e, uint64_t t) { return e.timeMs < t; });
+  if (it != _entries.begin()) --it;
+  return &*it;
+}
+
+void TimeIndex::window(const char *text, size_t size, uint64_t firstMs, uint64_t lastMs, std::vector<CanFrame> &out) const
+{
+  const TimeIndexEntry *e = seek(firstMs);
+  if (!e || e->offset >= size) return;
+  LogParser parser;
+  parser.resume(e->timeMs - e->timeDiffMs, e->msgNum, true);
+  std::vector<CanFrame> frames;
+  const char *end = text + size;
+  for (const char *p = text + e->offset; p < end;)
+  {
+    const char *stop = batchEnd(p, end, WINDOW_BATCH);
+    frames.clear();
+    parser.parse(p, stop, frames);
+    for (const CanFrame &f : frames)
+    {
+      uint64_t timeMs = f.timeUs / 1000;
+      if (timeMs > lastMs) return;
+      if (timeMs >= firstMs) out.push_back(f);
+    }
+    p = stop;
+  }
+}
@@ -0,0 +1,79 @@
+/*
+  TimeIndex.h - Sparse time index of a DATAxx.txt log (.idx sidecar)
+
+  The logs only hold Time Diff, so the absolute time of a line is the sum
+  of everything before it. One pass over the log records, every N frames
+  or every T ms (whichever comes first), the absolute time of a frame, the
+  byte offset of its line and its continuous Msg#. Finding a time is then
+  a binary search over those entries, and decoding a window starts at the
+  entry just before it with the parser resumed from the entry's state:
+  at most N frames or T ms of text are parsed before the window begins.
+
+  The header keeps the size and modification time of the log the index
+  was built from, so a stale index is noticed and rebuilt.
+*/
+
+#ifndef TimeIndex_h
+#define TimeIndex_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "CanFrame.h"
+
+#define TIME_INDEX_MAGIC  "CHNIDX1"
+
+/*Defaults: an entry every 4096 frames or every second of capture*/
+#define TIME_INDEX_FRAMES  4096
+#define TIME_INDEX_MS      1000
+
+struct TimeIndexHeader
+{
+  char magic[8];          // TIME_INDEX_MAGIC, NUL terminated
+  uint32_t entrySize;     // sizeof(TimeIndexEntry)
+  uint32_t everyFrames;   // spacing the index was built with
+  uint32_t everyMs;
+  uint32_t reserved;
+  uint64_t count;         // entries that follow
+  uint64_t sourceSize;    // size and mtime (s) of the indexed log
+  int64_t sourceMtime;
+};
+
+static_assert(sizeof(TimeIndexHeader) == 48, "TimeIndexHeader is a fixed 48 byte record");
+
+struct TimeIndexEntry
+{
+  uint64_t offset;      // start of the frame's line in the log
+  uint64_t timeMs;      // absolute time of the frame
+  uint32_t msgNum;      // continuous Msg#
+  uint32_t timeDiffMs;  // its Time Diff, to resume the running time just before it
+};
+
+static_assert(sizeof(TimeIndexEntry) == 24, "TimeIndexEntry is a fixed 24 byte record");
+
+class TimeIndex
+{
+  public:
+    /**Indexes the log text in [text, text + size)*/
+    void build(const char *text, size_t size, uint32_t everyFrames = TIME_INDEX_FRAMES, uint32_t everyMs = TIME_INDEX_MS);
+    /**Writes the index for a log of sourceSize bytes modified at sourceMtime. Returns false with errno set*/
+    bool write(const char *path, uint64_t sourceSize, int64_t sourceMtime) const;
+    /**Reads an index back; false with errno set, EINVAL if it is not one or ESTALE if it is not of that log*/
+    bool read(const char *path, uint64_t sourceSize, int64_t sourceMtime);
+
+    size_t count() const { return _entries.size(); }
+    const TimeIndexEntry *entries() const { return _entries.data(); }
+    /**The entry to start parsing from for the first frame at or after timeMs; NULL if the log has no frames*/
+    const TimeIndexEntry *seek(uint64_t timeMs) const;
+
+    /**Decodes the frames with firstMs <= time <= lastMs of the indexed log in [text, text + size)*/
+    void window(const char *text, size_t size, uint64_t firstMs, uint64_t lastMs, std::vector<CanFrame> &out) const;
+
+  private:
+    std::vector<TimeIndexEntry> _entries;
+    uint32_t _everyFrames = TIME_INDEX_FRAMES;
+    uint32_t _everyMs = TIME_INDEX_MS;
+};
+
+#endif
@@ -0,0 +1,316 @@
+#include "Traffic.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "BusTiming.h"
+
+#define MS  1000.0
+
+/*Periodic source: id, dlc, period and jitter in us, first release*/
+static TrafficSource periodic(uint32_t id, uint8_t dlc, double periodUs, double jitterUs, double offsetUs)
+{
+  TrafficSource s;
+  s.id = id;
+  s.flags = id > 0x7FF ? FRAME_EXTENDED : 0;
+  s.dlc = dlc;
+  s.burst = 0;
+  s.periodUs = periodUs;
+  s.jitterUs = jitterUs;
+  s.burstGapUs = 0;
+  s.offsetUs = offsetUs;
+  return s;
+}
+
+/*Event source: burst frames every meanUs on average, gapUs apart*/
+static TrafficSource bursts(uint32_t id, uint8_t dlc, uint16_t burst, double meanUs, double gapUs)
+{
+  TrafficSource s = periodic(id, dlc, meanUs, 0, 0);
+  s.burst = burst;
+  s.burstGapUs = gapUs;
+  return s;
+}
+
+static void uniformScenario(std::vector<TrafficSource> &sources)
+{
+  // what emu_bench always used: 16 IDs in turn, 1000 frames/s in total
+  for (uint32_t i = 0; i < 16; i++) sources.push_back(periodic(0x200 + i, 8, 16 * MS, 0, i * MS));
+}
+
+static void bodyScenario(std::vector<TrafficSource> &sources)
+{
+  // passenger car powertrain and body bus, roughly 900 frames/s; jitter a few % of the cycle
+  static const struct { uint16_t id; uint8_t dlc; uint16_t periodMs; } MSGS[] = {
+    { 0x0A0, 8, 10 },  { 0x0A8, 8, 10 },  { 0x0C0, 8, 10 },  { 0x0D0, 6, 10 },  { 0x120, 8, 10 },
+    { 0x130, 8, 10 },  { 0x1A0, 8, 20 },  { 0x1B0, 7, 20 },  { 0x1C0, 8, 20 },  { 0x200, 8, 20 },
+    { 0x210, 5, 50 },  { 0x220, 8, 50 },  { 0x280, 8, 50 },  { 0x2A0, 4, 100 }, { 0x2C0, 8, 100 },
+    { 0x310, 8, 100 }, { 0x320, 8, 100 }, { 0x350, 3, 200 }, { 0x3A0, 8, 200 }, { 0x3E0, 8, 500 },
+    { 0x400, 8, 500 }, { 0x470, 2, 1000 }, { 0x4F0, 8, 1000 }, { 0x5A0, 8, 1000 },
+  };
+  uint32_t n = 0;
+  for (const auto &m : MSGS)
+  {
+    sources.push_back(periodic(m.id, m.dlc, m.periodMs * MS, m.periodMs * MS / 40, (n++ % 10) * 0.7 * MS));
+  }
+}
+
+static void j1939Scenario(std::vector<TrafficSource> &sources)
+{
+  // heavy truck J1939 bus (29 bit IDs, priority in the top bits), roughly 450 frames/s
+  static const struct { uint32_t id; uint16_t periodMs; } MSGS[] = {
+    { 0x0C000003, 10 },  { 0x0CF00300, 50 },  { 0x0CF00400, 10 },  { 0x0CF00203, 10 },  { 0x18F0010B, 100 },
+    { 0x18FEBF0B, 100 }, { 0x18FEF100, 100 }, { 0x18FEF200, 100 }, { 0x0CFE6CEE, 50 },  { 0x18FEE900, 1000 },
+    { 0x18FEEE00, 1000 }, { 0x18FEEF00, 500 }, { 0x18FEF500, 1000 }, { 0x18FEF700, 1000 }, { 0x18FECA00, 1000 },
+    { 0x18FEF600, 500 }, { 0x18FEFC47, 1000 }, { 0x18FD9BFE, 100 }, { 0x0CF00A00, 20 },  { 0x18FEE500, 1000 },
+  };
+  uint32_t n = 0;
+  for (const auto &m : MSGS)
+  {
+    sources.push_back(periodic(m.id, 8, m.periodMs * MS, m.periodMs * MS / 20, (n++ % 7) * 1.3 * MS));
+  }
+}
+
+static void burstyScenario(std::vector<TrafficSource> &sources)
+{
+  bodyScenario(sources);
+  // diagnostic responses (ISO-TP consecutive frames, 1 ms STmin), door/switch events, a gateway flushing its queue
+  sources.push_back(bursts(0x7E8, 8, 16, 250 * MS, 1 * MS));
+  sources.push_back(bursts(0x3F0, 4, 3, 80 * MS, 0));
+  sources.push_back(bursts(0x5D0, 8, 32, 1000 * MS, 0));
+}
+
+static void mixedScenario(std::vector<TrafficSource> &sources)
+{
+  // body bus with a J1939 trailer or tool on the same segment
+  burstyScenario(sources);
+  j1939Scenario(sources);
+}
+
+static const char *const SCENARIO_NAMES[] = {
+  "uniform  16 standard IDs 0x200..0x20F in turn, 8 bytes, no jitter",
+  "body     24 periodic standard IDs, 10..1000 ms cycles with jitter",
+  "j1939    20 periodic extended (J1939) IDs, 10..1000 ms cycles with jitter",
+  "bursty   body plus event frames arriving in bursts",
+  "mixed    bursty plus j1939 on the same bus",
+  nullptr,
+};
+
+bool trafficScenario(const std::string &name, std::vector<TrafficSource> &sources)
+{
+  sources.clear();
+  if (name == "uniform") uniformScenario(sources);
+  else if (name == "body") bodyScenario(sources);
+  else if (name == "j1939") j1939Scenario(sources);
+  else if (name == "bursty") burstyScenario(sources);
+  else if (name == "mixed") mixedScenario(sources);
+  else return false;
+  return true;
+}
+
+const char *const *trafficScenarioNames()
+{
+  return SCENARIO_NAMES;
+}
+
+double trafficFrameRate(const std::vector<TrafficSource> &sources)
+{
+  double fps = 0;
+  for (const TrafficSource &s : sources)
+  {
+    if (s.periodUs > 0) fps += (s.burst ? s.burst : 1) * 1e6 / s.periodUs;
+  }
+  return fps;
+}
+
+double trafficBusLoad(const std::vector<TrafficSource> &sources, uint32_t bitrate)
+{
+  if (!bitrate) return 0;
+  // stuffing depends on the payload: average over a fixed set of pseudo random ones
+  uint64_t rng = 0x9E3779B97F4A7C15ULL;
+  double bitsPerSecond = 0;
+  for (const TrafficSource &s : sources)
+  {
+    if (s.periodUs <= 0) continue;
+    CanFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.id = s.id;
+    frame.flags = s.flags;
+    frame.dlc = s.dlc;
+    double bits = 0;
+    for (int i = 0; i < 32; i++)
+    {
+      for (int b = 0; b < 8; b++)
+      {
+        rng ^= rng >> 12;
+        rng ^= rng << 25;
+        rng ^= rng >> 27;
+        frame.data[b] = (uint8_t)((rng * 0x2545F4914F6CDD1DULL) >> 56);
+      }
+      bits += canFrameBits(frame);
+    }
+    bitsPerSecond += bits / 32 * (s.burst ? s.burst : 1) * 1e6 / s.periodUs;
+  }
+  return bitsPerSecond / bitrate;
+}
+
+void trafficSpeedUp(std::vector<TrafficSource> &sources, double factor)
+{
+  if (factor <= 0) return;
+  for (TrafficSource &s : sources)
+  {
+    s.periodUs /= factor;
+    s.jitterUs /= factor;
+    s.burstGapUs /= factor;
+    s.offsetUs /= factor;
+  }
+}
+
+uint32_t canArbitrationKey(uint32_t id, uint8_t flags)
+{
+  uint32_t rtr = (flags & FRAME_RTR) ? 1 : 0;
+  if (flags & FRAME_EXTENDED)
+  {
+    // base ID, SRR (recessive), IDE (recessive), ID extension, RTR
+    id &= 0x1FFFFFFF;
+    return ((id >> 18) << 21) | (1UL << 20) | (1UL << 19) | ((id & 0x3FFFF) << 1) | rtr;
+  }
+  // base ID, RTR, IDE (dominant)
+  return ((id & 0x7FF) << 21) | (rtr << 20);
+}
+
+// ---------------------------------------------------------------------------
+// TrafficGenerator
+
+TrafficGenerator::TrafficGenerator(const std::vector<TrafficSource> &sources, uint32_t bitrate, uint64_t seed)
+  : _bitrate(bitrate ? bitrate : 500000UL), _rng(seed ? seed : 1), _busFreeNs(0), _busyNs(0), _maxLatencyNs(0),
+    _lastEndUs(0), _msgNum(0)
+{
+  for (const TrafficSource &source : sources)
+  {
+    if (source.periodUs <= 0) continue;
+    State state;
+    memset(&state, 0, sizeof(state));
+    state.source = source;
+    if (state.source.dlc > 8) state.source.dlc = 8;
+    for (int i = 0; i < 8; i++) state.data[i] = (uint8_t)_random();
+    state.counter = (uint32_t)_random();
+    if (source.burst)
+    {
+      state.nominalNs = source.offsetUs * 1000 - source.periodUs * 1000 * log(1 - _uniform());
+      state.releaseNs = state.nominalNs;
+      state.burstLeft = source.burst - 1;
+    }
+    else
+    {
+      state.nominalNs = source.offsetUs * 1000;
+      state.releaseNs = state.nominalNs + source.jitterUs * 1000 * _uniform();
+    }
+    _states.push_back(state);
+  }
+}
+
+/*xorshift64*: the same schedule for a seed on every platform*/
+uint64_t TrafficGenerator::_random()
+{
+  _rng ^= _rng >> 12;
+  _rng ^= _rng << 25;
+  _rng ^= _rng >> 27;
+  return _rng * 0x2545F4914F6CDD1DULL;
+}
+
+double TrafficGenerator::_uniform()
+{
+  return (_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void TrafficGenerator::_schedule(State &state)
+{
+  const TrafficSource &s = state.source;
+  if (!s.burst)
+  {
+    state.nominalNs += s.periodUs * 1000;
+    state.releaseNs = state.nominalNs + s.jitterUs * 1000 * _uniform();
+  }
+  else if (state.burstLeft)
+  {
+    state.burstLeft--;
+    state.releaseNs += s.burstGapUs * 1000;
+  }
+  else
+  {
+    state.nominalNs += -s.periodUs * 1000 * log(1 - _uniform());
+    state.releaseNs = state.nominalNs;
+    state.burstLeft = s.burst - 1;
+  }
+}
+
+/**Alive counter in the low nibble of the last byte, a slowly moving signal in the first two, rarely changing flags in the rest*/
+void TrafficGenerator::_payload(State &state, CanFrame &frame)
+{
+  uint8_t dlc = state.source.dlc;
+  frame.dlc = dlc;
+  if ((state.source.flags & FRAME_RTR) || !dlc) return;
+  state.counter++;
+  if (dlc >= 2)
+  {
+    uint16_t signal = (uint16_t)(state.data[0] << 8 | state.data[1]);
+    signal += (uint16_t)((int)(_random() % 65) - 32);
+    state.data[0] = (uint8_t)(signal >> 8);
+    state.data[1] = (uint8_t)signal;
+  }
+  for (uint8_t i = 2; i + 1 < dlc; i++)
+  {
+    uint64_t r = _random();
+    if ((r & 0x0F) == 0) state.data[i] ^= (uint8_t)(1 << ((r >> 4) & 7));
+  }
+  if (dlc >= 3) state.data[dlc - 1] = (uint8_t)((state.data[dlc - 1] & 0xF0) | (state.counter & 0x0F));
+  memcpy(frame.data, state.data, dlc);
+}
+
+CanFrame TrafficGenerator::next(uint64_t *startNs)
+{
+  CanFrame frame;
+  memset(&frame, 0, sizeof(frame));
+  if (_states.empty()) return frame;
+
+  // the bus is either busy until _busFreeNs or idle until the earliest release
+  double earliest = _states[0].releaseNs;
+  for (const State &state : _states)
+  {
+    if (state.releaseNs < earliest) earliest = state.releaseNs;
+  }
+  double decide = earliest > (double)_busFreeNs ? earliest : (double)_busFreeNs;
+  State *winner = nullptr;
+  uint32_t winnerKey = 0;
+  for (State &state : _states)
+  {
+    if (state.releaseNs > decide) continue;
+    uint32_t key = canArbitrationKey(state.source.id, state.source.flags);
+    if (!winner || key < winnerKey || (key == winnerKey && state.releaseNs < winner->releaseNs))
+    {
+      winner = &state;
+      winnerKey = key;
+    }
+  }
+
+  frame.id = winner->source.id;
+  frame.flags = winner->source.flags & (FRAME_EXTENDED | FRAME_RTR);
+  _payload(*winner, frame);
+
+  uint64_t start = (uint64_t)ceil(decide);
+  uint64_t release = (uint64_t)ceil(winner->releaseNs);
+  if (start > release && start - release > _maxLatencyNs) _maxLatencyNs = start - release;
+  uint64_t length = (uint64_t)canFrameBits(frame) * 1000000000ULL / _bitrate;
+  _busFreeNs = start + length;
+  _busyNs += length;
+  if (startNs) *startNs = start;
+
+  // as the loggers record it: Msg#, reception time, milliseconds since the previous frame
+  frame.timeUs = _busFreeNs / 1000;
+  frame.msgNum = _msgNum++;
+  frame.timeDiffMs = _msgNum == 1 ? 0 : (uint32_t)(frame.timeUs / 1000 - _lastEndUs / 1000);
+  _lastEndUs = frame.timeUs;
+
+  _schedule(*winner);
+  return frame;
+}
@@ -0,0 +1,93 @@
+/*
+  Traffic.h - Synthetic CAN bus schedules for stress tests of the loggers
+
+  A schedule is a set of TrafficSource (one per transmitting ID): periodic
+  messages with a release jitter, or event messages that come in bursts at
+  random (exponential) intervals. TrafficGenerator plays the sources out on
+  one bus at a given bitrate: a released frame waits until the bus is idle,
+  pending frames are sent in arbitration order (lowest identifier first, a
+  standard frame before an extended one with the same base ID), and every
+  frame occupies the bus for its stuffed length (BusTiming). The result is
+  the order and start time of every frame as a logger would see them.
+
+  The generator is deterministic for a given seed, so a schedule can be
+  replayed into the MCP2515 emulator (emu_bench) or written out as a
+  DATAxx.txt log (can_gen) and compared later.
+*/
+
+#ifndef Traffic_h
+#define Traffic_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "CanFrame.h"
+
+struct TrafficSource
+{
+  uint32_t id;
+  uint8_t flags;         // FRAME_EXTENDED / FRAME_RTR
+  uint8_t dlc;
+  uint16_t burst;        // 0: periodic; otherwise frames per burst
+  double periodUs;       // periodic: cycle time; burst: mean time between bursts
+  double jitterUs;       // periodic: release delayed by up to this much
+  double burstGapUs;     // burst: release spacing inside a burst, 0 = all at once
+  double offsetUs;       // first release
+};
+
+/**Builds the sources of a named scenario, see trafficScenarioNames(). Returns false for an unknown name*/
+bool trafficScenario(const std::string &name, std::vector<TrafficSource> &sources);
+/**Names of the built-in scenarios with a one line description each*/
+const char *const *trafficScenarioNames();
+/**Average frames per second the sources release*/
+double trafficFrameRate(const std::vector<TrafficSource> &sources);
+/**Average share of the bus (1.0 = full) the sources need at bitrate, with stuffing as for their typical payload*/
+double trafficBusLoad(const std::vector<TrafficSource> &sources, uint32_t bitrate);
+/**Divides all periods, gaps and offsets by factor (2.0 doubles the frame rate)*/
+void trafficSpeedUp(std::vector<TrafficSource> &sources, double factor);
+
+class TrafficGenerator
+{
+  public:
+    TrafficGenerator(const std::vector<TrafficSource> &sources, uint32_t bitrate, uint64_t seed = 1);
+
+    /**Next frame on the bus. timeUs is the end of the frame (when a receiver has it), startNs its start of frame*/
+    CanFrame next(uint64_t *startNs = nullptr);
+    /**Nanoseconds of bus time the frames so far occupied*/
+    uint64_t busyNs() const { return _busyNs; }
+    /**End of the last frame in nanoseconds*/
+    uint64_t nowNs() const { return _busFreeNs; }
+    /**Longest time a frame waited for the bus after its release*/
+    uint64_t maxLatencyNs() const { return _maxLatencyNs; }
+
+  private:
+    struct State
+    {
+      TrafficSource source;
+      double releaseNs;      // release of the pending frame
+      double nominalNs;      // periodic: unjittered release; burst: start of the current burst
+      uint16_t burstLeft;    // burst: frames still to come in the current burst
+      uint32_t counter;
+      uint8_t data[8];
+    };
+
+    uint64_t _random();
+    double _uniform();
+    void _schedule(State &state);
+    void _payload(State &state, CanFrame &frame);
+
+    std::vector<State> _states;
+    uint32_t _bitrate;
+    uint64_t _rng;
+    uint64_t _busFreeNs;
+    uint64_t _busyNs;
+    uint64_t _maxLatencyNs;
+    uint64_t _lastEndUs;
+    uint32_t _msgNum;
+};
+
+/**Arbitration order of a frame's identifier field: the lower value wins the bus*/
+uint32_t canArbitrationKey(uint32_t id, uint8_t flags);
+
+#endif
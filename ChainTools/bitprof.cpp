@@ -0,0 +1,190 @@
+/*
+  bitprof - Bit and byte profile of every ID of a capture, for reverse engineering
+
+  Usage: bitprof DATAxx.txt|DATAxx.bin [-c] [-j threads]
+
+  Profiles a log (parsed batch by batch on -j threads) or a txt2bin frame
+  file in one pass (see PayloadProfile.h) and prints per ID its frames,
+  DLC range and mean period, and per byte its range, value entropy in
+  bits, share of frames where it (or one of its nibbles) is the previous
+  value + 1, and a toggle map of its bits 7..0: '-' for a bit that never
+  changes, else the share of frames in which it toggles in tenths ('0'
+  below 10 %, '9' for 90 % and more). Bytes that count are marked
+  "counter", "counter lo" or "counter hi". With -c prints one CSV line per
+  ID and bit instead: share of ones, toggle rate and entropy of the bit.
+*/
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FrameDemux.h"
+#include "FrameFile.h"
+#include "MappedFile.h"
+#include "ParallelLogParser.h"
+#include "PayloadProfile.h"
+
+/*Text parsed per batch, and frames split per batch*/
+#define PROFILE_TEXT_BATCH  (16UL << 20)
+#define PROFILE_BATCH       (1UL << 20)
+
+/*Share of steps of + 1 from which a byte or nibble is reported as a counter*/
+#define COUNTER_SHARE  0.75
+
+static void usage()
+{
+  fprintf(stderr, "usage: bitprof DATAxx.txt|DATAxx.bin [-c] [-j threads]\n");
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**Share of n in the frame pairs of a byte present in frames frames*/
+static double share(uint64_t n, uint64_t frames)
+{
+  return frames > 1 ? (double)n / (frames - 1) : 0.0;
+}
+
+static double bitEntropy(double p)
+{
+  return p <= 0 || p >= 1 ? 0.0 : -p * log2(p) - (1 - p) * log2(1 - p);
+}
+
+static void printReport(const std::vector<IdProfile> &profiles)
+{
+  for (const IdProfile &p : profiles)
+  {
+    char id[16];
+    snprintf(id, sizeof(id), p.flags & FRAME_EXTENDED ? "%08X" : "%03X", p.id);
+    printf("%s  %llu frames  dlc %u", id, (unsigned long long)p.frames, p.minDlc);
+    if (p.maxDlc != p.minDlc) printf("-%u", p.maxDlc);
+    if (p.frames > 1) printf("  every %.2f ms", (p.lastUs - p.firstUs) / 1e3 / (p.frames - 1));
+    printf("\n");
+    for (int i = 0; i < 8; i++)
+    {
+      if (!p.present[i]) continue;
+      char map[9];
+      for (int j = 0; j < 8; j++)
+      {
+        int bit = i * 8 + 7 - j;
+        int tenths = (int)(share(p.toggles[bit], p.present[i]) * 10);
+        map[j] = p.toggles[bit] == 0 ? '-' : (char)('0' + (tenths > 9 ? 9 : tenths));
+      }
+      map[8] = 0;
+      double steps = share(p.byteSteps[i], p.present[i]);
+      double lo = share(p.nibbleSteps[i * 2], p.present[i]);
+      double hi = share(p.nibbleSteps[i * 2 + 1], p.present[i]);
+      const char *counter = steps >= COUNTER_SHARE ? "  counter" : lo >= COUNTER_SHARE ? "  counter lo"
+                            : hi >= COUNTER_SHARE ? "  counter hi" : "";
+      printf("  byte %d  %02X-%02X  entropy %.2f  +1 %.2f/%.2f/%.2f  %s%s\n", i, p.min[i], p.max[i],
+             byteEntropy(p, i), steps, lo, hi, map, counter);
+    }
+  }
+}
+
+static void printCsv(const std::vector<IdProfile> &profiles)
+{
+  printf("id,bit,ones,toggles,entropy\n");
+  for (const IdProfile &p : profiles)
+  {
+    for (int bit = 0; bit < 64; bit++)
+    {
+      uint64_t present = p.present[bit / 8];
+      if (!present) continue;
+      double ones = (double)p.ones[bit] / present;
+      printf(p.flags & FRAME_EXTENDED ? "%08Xx," : "%03X,", p.id);
+      printf("%d,%.4f,%.4f,%.4f\n", bit, ones, share(p.toggles[bit], present), bitEntropy(ones));
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  const char *input = NULL;
+  bool csv = false;
+  unsigned threads = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-c") == 0) csv = true;
+    else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+    else if (argv[i][0] != '-' && !input) input = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!input)
+  {
+    usage();
+    return 2;
+  }
+
+  ThreadPool pool(threads);
+  FrameDemux demux(pool);
+  PayloadProfiler profiler(pool);
+  uint64_t frameCount = 0;
+  double profileSeconds = 0;
+  double start = nowSeconds();
+
+  FrameFile bin;
+  MappedFile text;
+  if (bin.open(input))
+  {
+    bin.map().adviseSequential();
+    double t = nowSeconds();
+    for (size_t i = 0; i < bin.count(); i += PROFILE_BATCH)
+    {
+      demux.split(bin.frames() + i, bin.count() - i < PROFILE_BATCH ? bin.count() - i : PROFILE_BATCH);
+      profiler.add(demux);
+    }
+    profileSeconds = nowSeconds() - t;
+    frameCount = bin.count();
+  }
+  else if (errno == EINVAL && text.open(input))
+  {
+    // batches end on a line boundary
+    text.adviseSequential();
+    ParallelLogParser parser(pool);
+    std::vector<CanFrame> frames;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while (p < end)
+    {
+      const char *stop = (size_t)(end - p) > PROFILE_TEXT_BATCH ? p + PROFILE_TEXT_BATCH : end;
+      if (stop < end)
+      {
+        const char *nl = (const char *)memchr(stop, '\n', (size_t)(end - stop));
+        stop = nl ? nl + 1 : end;
+      }
+      frames.clear();
+      parser.parse(p, stop, frames);
+      double t = nowSeconds();
+      demux.split(frames.data(), frames.size());
+      profiler.add(demux);
+      profileSeconds += nowSeconds() - t;
+      frameCount += frames.size();
+      p = stop;
+    }
+  }
+  else
+  {
+    fprintf(stderr, "bitprof: %s: %s\n", input, strerror(errno));
+    return 1;
+  }
+
+  std::vector<IdProfile> profiles = profiler.profiles();
+  if (csv) printCsv(profiles);
+  else printReport(profiles);
+  fprintf(stderr, "bitprof: %llu frames, %zu IDs, profiled at %.1f M frames/s (%.3f s in all)\n",
+          (unsigned long long)frameCount, profiles.size(), profileSeconds > 0 ? frameCount / profileSeconds / 1e6 : 0.0,
+          nowSeconds() - start);
+  return 0;
+}
@@ -0,0 +1,160 @@
+/*
+  bitsearch - Finds bit patterns and flag changes in a capture
+
+  Usage: bitsearch DATAxx.txt|DATAxx.bin|DATAxx.col -p predicate [-p predicate ...] [-n max_lines] [-j threads]
+
+  Runs all predicates (see BitSearch.h: "3A0:0020=0020", "3A0:0020+",
+  "18FEF100x:FF!") in one pass over a log (parsed batch by batch on -j
+  threads), a txt2bin frame file or a txt2col column store, of which
+  only the searched IDs are read. Prints the hits in time order as
+  "time_s,Msg#,index,predicate", the first -n of them (all by default);
+  hits per predicate and the scan rate go to stderr.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "BitSearch.h"
+#include "ColumnStore.h"
+#include "FrameFile.h"
+#include "MappedFile.h"
+#include "ParallelLogParser.h"
+
+/*Text parsed per batch, and frames per scan() call*/
+#define SEARCH_TEXT_BATCH  (16UL << 20)
+#define SEARCH_BATCH       65536
+
+static void usage()
+{
+  fprintf(stderr, "usage: bitsearch DATAxx.txt|DATAxx.bin|DATAxx.col -p predicate [-p predicate ...] [-n max_lines] "
+                  "[-j threads]\n");
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+  const char *input = NULL;
+  std::vector<const char *> texts;
+  std::vector<SearchPredicate> predicates;
+  uint64_t maxLines = ~0ULL;
+  unsigned threads = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    SearchPredicate p;
+    if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+    {
+      if (!parsePredicate(argv[++i], p))
+      {
+        fprintf(stderr, "bitsearch: bad predicate %s\n", argv[i]);
+        return 2;
+      }
+      predicates.push_back(p);
+      texts.push_back(argv[i]);
+    }
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) maxLines = strtoull(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+    else if (argv[i][0] != '-' && !input) input = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!input || predicates.empty())
+  {
+    usage();
+    return 2;
+  }
+
+  BitSearch search(predicates);
+  std::vector<SearchHit> hits;
+  uint64_t frameCount = 0;
+  double scanSeconds = 0;
+  double start = nowSeconds();
+
+  ColumnStore store;
+  FrameFile bin;
+  MappedFile text;
+  if (store.open(input))
+  {
+    double t = nowSeconds();
+    search.scan(store, hits);
+    scanSeconds = nowSeconds() - t;
+    for (const SearchPredicate &p : predicates)
+    {
+      const ColumnStoreEntry *e = store.find(p.id, p.extended);
+      if (e) frameCount += e->count;
+    }
+  }
+  else if (errno == EINVAL && bin.open(input))
+  {
+    bin.map().adviseSequential();
+    double t = nowSeconds();
+    for (size_t i = 0; i < bin.count(); i += SEARCH_BATCH)
+    {
+      search.scan(bin.frames() + i, bin.count() - i < SEARCH_BATCH ? bin.count() - i : SEARCH_BATCH, hits);
+    }
+    scanSeconds = nowSeconds() - t;
+    frameCount = bin.count();
+  }
+  else if (errno == EINVAL && text.open(input))
+  {
+    // batches end on a line boundary
+    text.adviseSequential();
+    ThreadPool pool(threads);
+    ParallelLogParser parser(pool);
+    std::vector<CanFrame> frames;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while (p < end)
+    {
+      const char *stop = (size_t)(end - p) > SEARCH_TEXT_BATCH ? p + SEARCH_TEXT_BATCH : end;
+      if (stop < end)
+      {
+        const char *nl = (const char *)memchr(stop, '\n', (size_t)(end - stop));
+        stop = nl ? nl + 1 : end;
+      }
+      frames.clear();
+      parser.parse(p, stop, frames);
+      double t = nowSeconds();
+      for (size_t i = 0; i < frames.size(); i += SEARCH_BATCH)
+      {
+        search.scan(&frames[i], frames.size() - i < SEARCH_BATCH ? frames.size() - i : SEARCH_BATCH, hits);
+      }
+      scanSeconds += nowSeconds() - t;
+      frameCount += frames.size();
+      p = stop;
+    }
+  }
+  else
+  {
+    fprintf(stderr, "bitsearch: %s: %s\n", input, strerror(errno));
+    return 1;
+  }
+  double elapsed = nowSeconds() - start;
+
+  std::vector<uint64_t> perPredicate(predicates.size(), 0);
+  printf("time_s,Msg#,index,predicate\n");
+  for (size_t h = 0; h < hits.size(); h++)
+  {
+    const SearchHit &hit = hits[h];
+    perPredicate[hit.predicate]++;
+    if (h < maxLines) printf("%.6f,%u,%llu,%s\n", hit.timeUs / 1e6, hit.msgNum, (unsigned long long)hit.index, texts[hit.predicate]);
+  }
+  for (size_t i = 0; i < predicates.size(); i++)
+  {
+    fprintf(stderr, "bitsearch: %s: %llu hits\n", texts[i], (unsigned long long)perPredicate[i]);
+  }
+  fprintf(stderr, "bitsearch: %llu frames searched at %.1f M frames/s (%.3f s in all)\n", (unsigned long long)frameCount,
+          scanSeconds > 0 ? frameCount / scanSeconds / 1e6 : 0.0, elapsed);
+  return 0;
+}
@@ -0,0 +1,125 @@
+/*
+  can_gen - Synthetic CAN traffic in the DATAxx.txt log format
+
+  Usage: can_gen [-s scenario] [-b bitrate] [-u load%] [-f fps] [-t seconds | -n frames] [-x] [-S seed] [-o DATAxx.txt]
+
+  Plays a built-in scenario (see Traffic.h, -s list shows them) out on a bus
+  at the given bitrate (125000, 250000, 500000 or 1000000; default 500000)
+  and writes the frames as a logger would have logged them: Msg#, Time Diff
+  in ms since the previous frame, ID, DLC and data. -u scales the scenario
+  to an average bus load, -f to a frame rate; above 100 % frames queue up
+  and the bus runs back to back. -x turns standard IDs into 29 bit ones
+  (0x18FF0000 + ID). A summary goes to stderr.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LogWriter.h"
+#include "Traffic.h"
+
+static void usage()
+{
+  fprintf(stderr, "usage: can_gen [-s scenario] [-b bitrate] [-u load%%] [-f fps] [-t seconds | -n frames] [-x] [-S seed] "
+                  "[-o output.txt]\n");
+}
+
+static void listScenarios()
+{
+  for (const char *const *name = trafficScenarioNames(); *name; name++) printf("%s\n", *name);
+}
+
+int main(int argc, char **argv)
+{
+  const char *scenario = "body";
+  const char *output = NULL;
+  uint32_t bitrate = 500000;
+  double load = 0;
+  double fps = 0;
+  double seconds = 10;
+  uint64_t frames = 0;
+  bool extended = false;
+  uint64_t seed = 1;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) scenario = argv[++i];
+    else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) bitrate = (uint32_t)atol(argv[++i]);
+    else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) load = atof(argv[++i]);
+    else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) fps = atof(argv[++i]);
+    else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) seconds = atof(argv[++i]);
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) frames = strtoull(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "-x") == 0) extended = true;
+    else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (strcmp(scenario, "list") == 0)
+  {
+    listScenarios();
+    return 0;
+  }
+  std::vector<TrafficSource> sources;
+  if (!trafficScenario(scenario, sources))
+  {
+    fprintf(stderr, "can_gen: unknown scenario %s, one of:\n", scenario);
+    listScenarios();
+    return 2;
+  }
+  if (!bitrate || (load && fps) || load < 0 || fps < 0)
+  {
+    usage();
+    return 2;
+  }
+  if (extended)
+  {
+    for (TrafficSource &s : sources)
+    {
+      if (!(s.flags & FRAME_EXTENDED)) s.id |= 0x18FF0000UL;
+      s.flags |= FRAME_EXTENDED;
+    }
+  }
+  if (load > 0) trafficSpeedUp(sources, load / 100 / trafficBusLoad(sources, bitrate));
+  if (fps > 0) trafficSpeedUp(sources, fps / trafficFrameRate(sources));
+
+  FILE *out = output ? fopen(output, "wb") : stdout;
+  if (!out)
+  {
+    fprintf(stderr, "can_gen: %s: %s\n", output, strerror(errno));
+    return 1;
+  }
+
+  TrafficGenerator generator(sources, bitrate, seed);
+  LogWriter writer(out);
+  writer.header();
+  uint64_t endNs = (uint64_t)(seconds * 1e9);
+  uint64_t n = 0;
+  for (;;)
+  {
+    uint64_t startNs;
+    CanFrame frame = generator.next(&startNs);
+    if (frames ? n >= frames : startNs >= endNs) break;
+    writer.write(frame);
+    n++;
+  }
+  bool ok = writer.flush();
+  if (output && fclose(out) != 0) ok = false;
+  if (!ok)
+  {
+    fprintf(stderr, "can_gen: %s: write error\n", output ? output : "stdout");
+    return 1;
+  }
+
+  double elapsed = generator.nowNs() / 1e9;
+  fprintf(stderr, "can_gen: %s at %u bit/s: %llu frames in %.3f s (%.0f fps), bus load %.1f %% (nominal %.1f %%), "
+                  "longest wait for the bus %.3f ms\n",
+          scenario, bitrate, (unsigned long long)n, elapsed, elapsed > 0 ? n / elapsed : 0.0,
+          generator.nowNs() ? 100.0 * generator.busyNs() / generator.nowNs() : 0.0,
+          100.0 * trafficBusLoad(sources, bitrate), generator.maxLatencyNs() / 1e6);
+  return 0;
+}
@@ -0,0 +1,147 @@
+/*
+  canexport - Converts captures to candump, Vector ASC and ASAM MDF4
+
+  Usage: canexport DATAxx.txt|DATAxx.bin -o output.log|.asc|.mf4 [-o output ...] [-j threads]
+
+  Reads a log (parsed batch by batch on -j threads) or a txt2bin frame
+  file once and writes every -o output from the same batches, the format
+  chosen by the extension (see FrameExport.h): .log candump, .asc Vector
+  ASC, .mf4 MDF 4.10 bus logging. Memory stays at one batch plus one
+  write buffer per output, whatever the capture length.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FrameExport.h"
+#include "FrameFile.h"
+#include "MappedFile.h"
+#include "ParallelLogParser.h"
+
+/*Text parsed per batch, and frames per write() call*/
+#define EXPORT_TEXT_BATCH  (16UL << 20)
+#define EXPORT_BATCH       65536
+
+static void usage()
+{
+  fprintf(stderr, "usage: canexport DATAxx.txt|DATAxx.bin -o output.log|.asc|.mf4 [-o output ...] [-j threads]\n");
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+  const char *input = NULL;
+  std::vector<const char *> paths;
+  std::vector<ExportFormat> formats;
+  unsigned threads = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    ExportFormat format;
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+    {
+      if (!exportFormat(argv[++i], format))
+      {
+        fprintf(stderr, "canexport: %s: unknown output format (.log, .asc or .mf4)\n", argv[i]);
+        return 2;
+      }
+      paths.push_back(argv[i]);
+      formats.push_back(format);
+    }
+    else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+    else if (argv[i][0] != '-' && !input) input = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!input || paths.empty())
+  {
+    usage();
+    return 2;
+  }
+
+  std::vector<FrameExporter> outputs(paths.size());
+  for (size_t o = 0; o < paths.size(); o++)
+  {
+    if (!outputs[o].open(paths[o], formats[o]))
+    {
+      fprintf(stderr, "canexport: %s: %s\n", paths[o], strerror(errno));
+      return 1;
+    }
+  }
+  double start = nowSeconds();
+  bool ok = true;
+  auto writeAll = [&](const CanFrame *frames, size_t count) {
+    for (size_t i = 0; i < count && ok; i += EXPORT_BATCH)
+    {
+      size_t n = count - i < EXPORT_BATCH ? count - i : EXPORT_BATCH;
+      for (size_t o = 0; o < outputs.size() && ok; o++)
+      {
+        if (!outputs[o].write(frames + i, n))
+        {
+          fprintf(stderr, "canexport: %s: %s\n", paths[o], strerror(errno));
+          ok = false;
+        }
+      }
+    }
+  };
+
+  FrameFile bin;
+  MappedFile text;
+  if (bin.open(input))
+  {
+    bin.map().adviseSequential();
+    writeAll(bin.frames(), bin.count());
+  }
+  else if (errno == EINVAL && text.open(input))
+  {
+    // batches end on a line boundary
+    text.adviseSequential();
+    ThreadPool pool(threads);
+    ParallelLogParser parser(pool);
+    std::vector<CanFrame> frames;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while (p < end && ok)
+    {
+      const char *stop = (size_t)(end - p) > EXPORT_TEXT_BATCH ? p + EXPORT_TEXT_BATCH : end;
+      if (stop < end)
+      {
+        const char *nl = (const char *)memchr(stop, '\n', (size_t)(end - stop));
+        stop = nl ? nl + 1 : end;
+      }
+      frames.clear();
+      parser.parse(p, stop, frames);
+      writeAll(frames.data(), frames.size());
+      p = stop;
+    }
+  }
+  else
+  {
+    fprintf(stderr, "canexport: %s: %s\n", input, strerror(errno));
+    return 1;
+  }
+
+  for (size_t o = 0; o < outputs.size(); o++)
+  {
+    if (!outputs[o].close() && ok)
+    {
+      fprintf(stderr, "canexport: %s: %s\n", paths[o], strerror(errno));
+      ok = false;
+    }
+  }
+  if (!ok) return 1;
+  fprintf(stderr, "canexport: %llu frames to %zu outputs in %.3f s\n", (unsigned long long)outputs[0].count(),
+          outputs.size(), nowSeconds() - start);
+  return 0;
+}
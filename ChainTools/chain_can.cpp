@@ -0,0 +1,188 @@
+/*
+  chain_can - SocketCAN / slcan gateway for the serial logger
+
+  Usage: chain_can <serial device | pty | raw capture file> (-i can_interface | -l slcan_tty) [-b baud] [-d delay_ms]
+
+  Decodes the stream of ChainLogger_no_S_on_Serial (or the NuovaLib live
+  feed) like chain_rx and puts every frame on a SocketCAN interface (-i,
+  e.g. vcan0) for candump, Wireshark and python-can, or writes it as slcan
+  lines to a tty or pty (-l) for slcand (see SocketCan.h).
+
+  Frames leave the device in packets, so their arrival on the host says
+  little about when they were on the bus. The device timestamps are mapped
+  onto the host clock (see ClockSync.h) and every frame is sent at its
+  mapped time plus -d ms (20), enough to cover the packet and USB delay;
+  whatever is due at a wake-up goes out as one sendmmsg() batch. The
+  receivers' timestamps then follow the bus timing instead of the USB
+  packets. A raw capture file is replayed at its recorded speed. Frames
+  that arrive after their send time are sent at once and counted as late.
+*/
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ChainStream.h"
+#include "ClockSync.h"
+#include "SerialPort.h"
+#include "SocketCan.h"
+
+/*How far ahead of its send time a replayed capture is read*/
+#define REPLAY_AHEAD_US  1000000
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int)
+{
+  stopRequested = 1;
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: chain_can <device|file> (-i can_interface | -l slcan_tty) [-b baud] [-d delay_ms]\n");
+}
+
+static uint64_t nowUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+int main(int argc, char **argv)
+{
+  const char *device = NULL;
+  const char *interface = NULL;
+  const char *slcanPath = NULL;
+  long baud = 1000000;
+  double delayMs = 20;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) baud = atol(argv[++i]);
+    else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) interface = argv[++i];
+    else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) slcanPath = argv[++i];
+    else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) delayMs = atof(argv[++i]);
+    else if (!device) device = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!device || !interface == !slcanPath || delayMs < 0)
+  {
+    usage();
+    return 2;
+  }
+
+  int fd = openSerialPort(device, baud);
+  if (fd < 0)
+  {
+    fprintf(stderr, "chain_can: %s: %s\n", device, strerror(errno));
+    return 1;
+  }
+  // a capture file arrives all at once: its clock is set by its first frame only
+  struct stat st;
+  bool replay = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+  CanSocket socket;
+  SlcanWriter slcan;
+  if (interface ? !socket.open(interface) : !slcan.open(slcanPath))
+  {
+    fprintf(stderr, "chain_can: %s: %s\n", interface ? interface : slcanPath, strerror(errno));
+    return 1;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  StreamDecoder decoder;
+  ClockSync clock;
+  uint64_t delayUs = (uint64_t)(delayMs * 1000);
+  std::vector<CanFrame> decoded;
+  std::vector<CanFrame> queue;  // decoded, not sent yet, in time order from head on
+  size_t head = 0;
+  uint64_t sent = 0;
+  uint64_t late = 0;
+  uint64_t batches = 0;
+  bool open = true;
+  uint8_t buf[4096];
+  while (!stopRequested && (open || head < queue.size()))
+  {
+    uint64_t now = nowUs();
+    if (head < queue.size())
+    {
+      // everything due goes out in one batch
+      size_t end = head;
+      while (end < queue.size() && clock.hostTime(queue[end].timeUs) + delayUs <= now) end++;
+      if (end > head)
+      {
+        bool ok = interface ? socket.send(&queue[head], end - head) : slcan.send(&queue[head], end - head);
+        if (!ok)
+        {
+          fprintf(stderr, "chain_can: %s: %s\n", interface ? interface : slcanPath, strerror(errno));
+          break;
+        }
+        sent += end - head;
+        batches++;
+        head = end;
+      }
+      if (head > 4096 && head * 2 > queue.size())
+      {
+        queue.erase(queue.begin(), queue.begin() + (long)head);
+        head = 0;
+      }
+    }
+
+    int timeout = -1;
+    if (head < queue.size())
+    {
+      uint64_t due = clock.hostTime(queue[head].timeUs) + delayUs;
+      timeout = due > now ? (int)((due - now + 999) / 1000) : 0;
+    }
+    bool ahead = replay && head < queue.size() && clock.hostTime(queue.back().timeUs) > now + REPLAY_AHEAD_US;
+    if (!open || ahead)
+    {
+      if (timeout > 0) poll(NULL, 0, timeout);
+      continue;
+    }
+    struct pollfd p = {fd, POLLIN, 0};
+    int r = poll(&p, 1, timeout);
+    if (r < 0 && errno == EINTR) continue;
+    if (r <= 0) continue;
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0)
+    {
+      open = false;
+      continue;
+    }
+    decoded.clear();
+    decoder.feed(buf, (size_t)n, decoded);
+    if (decoded.empty()) continue;
+    // the newest frame waited least for its packet
+    now = nowUs();
+    if (!replay) clock.observe(decoded.back().timeUs, now);
+    else if (!clock.valid()) clock.observe(decoded.front().timeUs, now);
+    for (const CanFrame &f : decoded)
+    {
+      if (clock.hostTime(f.timeUs) + delayUs < now) late++;
+      queue.push_back(f);
+    }
+  }
+  close(fd);
+
+  const StreamStats &s = decoder.stats();
+  fprintf(stderr, "chain_can: %llu frames sent in %llu batches, %llu late; %llu bad packets, %llu lost packets, "
+          "%llu dropped on device\n", (unsigned long long)sent, (unsigned long long)batches, (unsigned long long)late,
+          (unsigned long long)s.badPackets, (unsigned long long)s.lostPackets, (unsigned long long)s.deviceDropped);
+  return 0;
+}
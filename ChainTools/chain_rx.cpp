@@ -0,0 +1,101 @@
+/*
+  chain_rx - Live receiver for ChainLogger_no_S_on_Serial
+
+  Usage: chain_rx <serial device | raw capture file> [-b baud] [-o DATAxx.txt]
+
+  Decodes the batched binary stream and writes the same Msg#,Time Diff,ID,DLC,Data
+  records the SD loggers produce (to stdout without -o). Packet loss and
+  device side drops are reported on stderr when the stream ends or on Ctrl-C.
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ChainStream.h"
+#include "LogWriter.h"
+#include "SerialPort.h"
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int)
+{
+  stopRequested = 1;
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: chain_rx <device|file> [-b baud] [-o output.txt]\n");
+}
+
+int main(int argc, char **argv)
+{
+  const char *device = NULL;
+  const char *output = NULL;
+  long baud = 1000000;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) baud = atol(argv[++i]);
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+    else if (!device) device = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!device)
+  {
+    usage();
+    return 2;
+  }
+
+  int fd = openSerialPort(device, baud);
+  if (fd < 0)
+  {
+    fprintf(stderr, "chain_rx: %s: %s\n", device, strerror(errno));
+    return 1;
+  }
+  FILE *out = output ? fopen(output, "wb") : stdout;
+  if (!out)
+  {
+    fprintf(stderr, "chain_rx: %s: %s\n", output, strerror(errno));
+    return 1;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  StreamDecoder decoder;
+  LogWriter writer(out);
+  writer.header();
+  std::vector<CanFrame> frames;
+  uint8_t buf[4096];
+  while (!stopRequested)
+  {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    frames.clear();
+    decoder.feed(buf, (size_t)n, frames);
+    writer.write(frames.data(), frames.size());
+    // Keep the file current while live; a flush per read is cheap at these rates
+    writer.flush();
+  }
+  writer.flush();
+  close(fd);
+  if (output) fclose(out);
+
+  const StreamStats &s = decoder.stats();
+  fprintf(stderr, "chain_rx: %llu frames in %llu packets, %llu bad packets, %llu lost packets, %llu dropped on device, "
+          "%llu text records\n", (unsigned long long)s.frames, (unsigned long long)s.packets,
+          (unsigned long long)s.badPackets, (unsigned long long)s.lostPackets, (unsigned long long)s.deviceDropped,
+          (unsigned long long)s.textRecords);
+  return 0;
+}
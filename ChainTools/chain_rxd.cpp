@@ -0,0 +1,103 @@
+/*
+  chain_rxd - Live capture daemon: one serial stream, any number of local readers
+
+  Usage: chain_rxd <serial device | pty | raw capture file> [-b baud] [-n /ring_name] [-c slots]
+
+  Replaces the serial reading of UI/Live.vi and Car Data Live.vi. Decodes
+  the stream of ChainLogger_no_S_on_Serial (or the NuovaLib live feed) like
+  chain_rx and publishes every frame into a shared memory ring (see
+  FrameRing.h, /chainlog with 1 M slots by default) instead of a file.
+  Plotters, recorders and decoders attach to the ring on their own, e.g.
+  with ring_tap, without the capture ever waiting for or copying for them.
+  Runs in the foreground until the stream ends or on Ctrl-C / SIGTERM, then
+  closes the ring and prints the stream statistics.
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ChainStream.h"
+#include "FrameRing.h"
+#include "SerialPort.h"
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int)
+{
+  stopRequested = 1;
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: chain_rxd <device|file> [-b baud] [-n /ring_name] [-c slots]\n");
+}
+
+int main(int argc, char **argv)
+{
+  const char *device = NULL;
+  const char *name = FRAME_RING_NAME;
+  long baud = 1000000;
+  uint32_t capacity = FRAME_RING_CAPACITY;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) baud = atol(argv[++i]);
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) name = argv[++i];
+    else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) capacity = (uint32_t)strtoul(argv[++i], NULL, 0);
+    else if (!device) device = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!device)
+  {
+    usage();
+    return 2;
+  }
+
+  int fd = openSerialPort(device, baud);
+  if (fd < 0)
+  {
+    fprintf(stderr, "chain_rxd: %s: %s\n", device, strerror(errno));
+    return 1;
+  }
+  FrameRingWriter ring;
+  if (!ring.create(name, capacity))
+  {
+    fprintf(stderr, "chain_rxd: %s: %s\n", name, strerror(errno));
+    return 1;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  StreamDecoder decoder;
+  std::vector<CanFrame> frames;
+  uint8_t buf[4096];
+  while (!stopRequested)
+  {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    frames.clear();
+    decoder.feed(buf, (size_t)n, frames);
+    ring.publish(frames.data(), frames.size());
+  }
+  ring.close();
+  close(fd);
+
+  const StreamStats &s = decoder.stats();
+  fprintf(stderr, "chain_rxd: %llu frames in %llu packets, %llu bad packets, %llu lost packets, %llu dropped on device, "
+          "%llu text records\n", (unsigned long long)s.frames, (unsigned long long)s.packets,
+          (unsigned long long)s.badPackets, (unsigned long long)s.lostPackets, (unsigned long long)s.deviceDropped,
+          (unsigned long long)s.textRecords);
+  return 0;
+}
@@ -0,0 +1,116 @@
+/*
+  colq - Lists or extracts the IDs of a column store
+
+  Usage: colq DATAxx.col [-i ID [-x]] [-b first_s] [-e last_s]
+
+  Without -i lists every ID with its frame count, time span and mean rate.
+  With -i (hex; -x for a 29 bit ID) prints that ID's frames between -b and
+  -e seconds as "time_s,Msg#,DLC,data", reading only its own columns; the
+  time to open the file and the ID goes to stderr.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+#include "ColumnStore.h"
+
+/*Keeps the read of the window from being optimized away*/
+static volatile uint64_t touched;
+
+static void usage()
+{
+  fprintf(stderr, "usage: colq DATAxx.col [-i ID [-x]] [-b first_s] [-e last_s]\n");
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void list(const ColumnStore &store)
+{
+  printf("     ID  frames    first_s     last_s      fps\n");
+  for (size_t i = 0; i < store.idCount(); i++)
+  {
+    const ColumnStoreEntry &e = store.entries()[i];
+    double span = (e.lastUs - e.firstUs) / 1e6;
+    printf(e.flags & FRAME_EXTENDED ? "%8X" : "%7X ", e.id);
+    printf(" %7llu %10.3f %10.3f %8.1f\n", (unsigned long long)e.count, e.firstUs / 1e6, e.lastUs / 1e6,
+           span > 0 ? (e.count - 1) / span : 0.0);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  const char *input = NULL;
+  const char *idText = NULL;
+  bool extended = false;
+  double first = 0;
+  double last = -1;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) idText = argv[++i];
+    else if (strcmp(argv[i], "-x") == 0) extended = true;
+    else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) first = atof(argv[++i]);
+    else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) last = atof(argv[++i]);
+    else if (argv[i][0] != '-' && !input) input = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!input)
+  {
+    usage();
+    return 2;
+  }
+
+  double start = nowSeconds();
+  ColumnStore store;
+  if (!store.open(input))
+  {
+    fprintf(stderr, "colq: %s: %s\n", input, strerror(errno));
+    return 1;
+  }
+  if (!idText)
+  {
+    list(store);
+    return 0;
+  }
+
+  uint32_t id = (uint32_t)strtoul(idText, NULL, 16);
+  const ColumnStoreEntry *entry = store.find(id, extended || id > 0x7FF);
+  if (!entry)
+  {
+    fprintf(stderr, "colq: %s: no frames with ID %X\n", input, id);
+    return 1;
+  }
+  store.prefetch(*entry);
+  ColumnSeries s = store.series(*entry);
+  // the window by binary search on the time column
+  uint64_t firstUs = first > 0 ? (uint64_t)(first * 1e6) : 0;
+  size_t begin = std::lower_bound(s.timeUs, s.timeUs + s.count, firstUs) - s.timeUs;
+  size_t end = last >= 0 ? std::upper_bound(s.timeUs, s.timeUs + s.count, (uint64_t)(last * 1e6)) - s.timeUs : s.count;
+  // touch the window once so the reported time includes reading it in
+  uint64_t sum = 0;
+  for (size_t i = begin; i < end; i++) sum += s.timeUs[i] + s.data[i][0] + s.msgNum[i] + s.dlc[i];
+  touched = sum;
+  double opened = nowSeconds();
+
+  for (size_t i = begin; i < end; i++)
+  {
+    printf("%.3f,%u,%u,", s.timeUs[i] / 1e6, s.msgNum[i], s.dlc[i]);
+    for (int b = 0; b < s.dlc[i] && b < 8; b++) printf("%02X ", s.data[i][b]);
+    printf("\n");
+  }
+  fprintf(stderr, "colq: ID %X: %zu of %zu frames, opened and read in %.3f ms\n", id, end > begin ? end - begin : 0,
+          s.count, (opened - start) * 1e3);
+  return 0;
+}
@@ -0,0 +1,171 @@
+/*
+  dash - Live dashboard of decoded signals from the chain_rxd ring
+
+  Usage: dash file.dbc -s Msg.Sig,... [-n /ring_name] [-r refresh_hz]
+
+  Replaces the gauges of UI/Dashboard.vi and Car Data Live.vi. A decoding
+  thread reads the ring (see FrameRing.h), decodes every batch with the
+  DBC file (see SignalDecoder.h) and commits the newest value of each
+  signal to a SignalCache; the display prints one line of the chosen
+  signals at most -r times a second (10), and only after a commit, with
+  "*" after the values that changed since the line before. The refresh
+  reads only the shown signals, whatever the bus rate. Runs until the
+  capture ends or on Ctrl-C.
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <time.h>
+
+#include "Dbc.h"
+#include "FrameRing.h"
+#include "SignalCache.h"
+#include "SignalDecoder.h"
+
+/*Frames taken from the ring per decode, and the wait when it has none*/
+#define DASH_BATCH    4096
+#define DASH_IDLE_NS  1000000
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int)
+{
+  stopRequested = 1;
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: dash file.dbc -s Msg.Sig,... [-n /ring_name] [-r refresh_hz]\n");
+}
+
+/**Whether column name is in the comma separated list (Msg.Sig or just Sig)*/
+static bool selected(const char *list, const std::string &name)
+{
+  size_t dot = name.find('.');
+  std::string signal = dot == std::string::npos ? name : name.substr(dot + 1);
+  for (const char *p = list; *p;)
+  {
+    const char *end = strchr(p, ',');
+    std::string item = end ? std::string(p, end) : std::string(p);
+    if (item == name || item == signal) return true;
+    if (!end) break;
+    p = end + 1;
+  }
+  return false;
+}
+
+int main(int argc, char **argv)
+{
+  const char *dbcPath = NULL;
+  const char *signals = NULL;
+  const char *name = FRAME_RING_NAME;
+  double rate = 10;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) signals = argv[++i];
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) name = argv[++i];
+    else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) rate = atof(argv[++i]);
+    else if (argv[i][0] != '-' && !dbcPath) dbcPath = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!dbcPath || !signals || rate <= 0)
+  {
+    usage();
+    return 2;
+  }
+
+  DbcFile dbc;
+  std::string error;
+  if (!dbc.load(dbcPath, &error))
+  {
+    fprintf(stderr, "dash: %s: %s\n", dbcPath, error.c_str());
+    return 1;
+  }
+  SignalDecoder decoder(dbc);
+  std::vector<SignalColumn> columns;
+  decoder.columns(columns);
+  std::vector<uint32_t> shown;
+  std::vector<std::string> labels;
+  for (uint32_t s = 0; s < columns.size(); s++)
+  {
+    if (!selected(signals, columns[s].name)) continue;
+    shown.push_back(s);
+    labels.push_back(columns[s].unit.empty() ? columns[s].name : columns[s].name + " [" + columns[s].unit + "]");
+  }
+  if (shown.empty())
+  {
+    fprintf(stderr, "dash: no signal %s in %s\n", signals, dbcPath);
+    return 1;
+  }
+  FrameRingReader ring;
+  if (!ring.open(name))
+  {
+    fprintf(stderr, "dash: %s: %s\n", name, strerror(errno));
+    return 1;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  SignalCache cache(decoder.signalCount());
+  std::atomic<bool> stop(false);
+  std::thread decoding([&]() {
+    std::vector<CanFrame> frames(DASH_BATCH);
+    while (!stopRequested)
+    {
+      size_t n = ring.read(frames.data(), frames.size());
+      if (n == 0)
+      {
+        if (ring.finished()) break;
+        struct timespec idle = {0, DASH_IDLE_NS};
+        nanosleep(&idle, NULL);
+        continue;
+      }
+      for (SignalColumn &c : columns)
+      {
+        c.timeUs.clear();
+        c.value.clear();
+      }
+      decoder.decode(frames.data(), n, columns);
+      cache.update(columns);
+    }
+    stop = true;
+  });
+
+  std::vector<SignalValue> values(shown.size());
+  uint64_t seen = 0;
+  uint64_t last = 0;
+  while (!stop && !stopRequested)
+  {
+    uint64_t commit = cache.wait(seen, (uint64_t)(1e6 / rate), &last, stop);
+    if (commit == seen) continue;
+    commit = cache.snapshot(shown.data(), shown.size(), values.data());
+    uint64_t newest = 0;
+    for (const SignalValue &v : values) newest = v.timeUs > newest ? v.timeUs : newest;
+    printf("%10.3f s", newest / 1e6);
+    for (size_t i = 0; i < shown.size(); i++)
+    {
+      if (values[i].changed == 0) printf("  %s -", labels[i].c_str());
+      else printf("  %s %g%s", labels[i].c_str(), values[i].value, values[i].changed > seen ? "*" : "");
+    }
+    printf("\n");
+    fflush(stdout);
+    seen = commit;
+  }
+  stopRequested = 1;
+  decoding.join();
+  fprintf(stderr, "dash: %llu commits, %llu frames lost to overruns\n", (unsigned long long)cache.commits(),
+          (unsigned long long)ring.lost());
+  return 0;
+}
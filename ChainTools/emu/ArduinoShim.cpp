@@ -0,0 +1,565 @@
+#include "Emu.h"
+
+#include "shim/Arduino.h"
+#include "shim/SPI.h"
+
+volatile EmuAvrRegs emuAvr;
+SPIClass SPI;
+EmuCounters emuCount;
+
+extern "C" void emuIsr_ADC_vect(void) __attribute__((weak));
+
+/*Arduino pins of INT0..INT5*/
+static const int EXT_PIN[6] = { 2, 3, 21, 20, 19, 18 };
+/*Timer1 clock select CS12:0 -> prescaler, 0 = stopped or external clock*/
+static const uint16_t TIMER1_PRESCALE[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+static uint64_t _now = 0;
+static uint64_t _deadline = 0;
+static uint64_t _watchAt = 0;
+static void (*_watchFn)(void *) = nullptr;
+static void *_watchArg = nullptr;
+
+static Mcp2515Emu *_chip = nullptr;
+static int _csPin = -1;
+static int _intPin = -1;
+static int _rx0bfPin = -1;
+static int _rx1bfPin = -1;
+
+static uint8_t _latch[EMU_PINS];
+static uint16_t _analog[16];
+
+// PORTB, PORTC, PORTD as last written, as last applied to the pins, DDR and PIN
+static uint8_t _portOut[3];
+static uint8_t _portSeen[3];
+static uint8_t _ddr[3];
+static uint8_t _pinIn[3];
+static uint8_t _spdr = 0;
+static uint8_t _spsr = 0;
+static bool _spdrTouched = false;
+
+static void (*_extHandler[6])(void);
+static int _extMode[6];
+static bool _extLevel[6];
+// INTF0..5: edge seen, handler not run yet (kept while interrupts are off, like on the AVR)
+static bool _extFlag[6];
+static bool _inIsr = false;
+static uint64_t _adcNext = 0;
+
+// ---------------------------------------------------------------------------
+// Pins
+
+static bool pinLevel(int pin)
+{
+  if (_chip)
+  {
+    if (pin == _intPin) return _chip->intPin();
+    if (pin == _rx0bfPin) return _chip->rx0bfPin();
+    if (pin == _rx1bfPin) return _chip->rx1bfPin();
+  }
+  return pin >= 0 && pin < EMU_PINS && _latch[pin];
+}
+
+static void sampleExtPins();
+
+static void pinWrite(int pin, bool level)
+{
+  if (pin < 0 || pin >= EMU_PINS) return;
+  bool old = _latch[pin] != 0;
+  _latch[pin] = level;
+  if (_chip && pin == _csPin && old != level)
+  {
+    if (level) _chip->deselect();
+    else
+    {
+      emuCount.spiSelects++;
+      _chip->select();
+    }
+    // releasing a buffer raises RXnBF/INT at once, before the next frame can lower it again
+    sampleExtPins();
+  }
+}
+
+/**Arduino pin of bit of port (0 = B, 1 = C, 2 = D), -1 if not brought out on the ATmega328P*/
+static int portPin(int port, int bit)
+{
+  switch (port)
+  {
+    case 0: return bit < 6 ? 8 + bit : -1;
+    case 1: return bit < 6 ? 14 + bit : -1;
+    default: return bit;
+  }
+}
+
+static int portIndex(char port)
+{
+  return port == 'B' ? 0 : (port == 'C' ? 1 : 2);
+}
+
+/**Applies the port writes made since the last register access to the pins*/
+static void syncPorts()
+{
+  for (int p = 0; p < 3; p++)
+  {
+    uint8_t changed = _portOut[p] ^ _portSeen[p];
+    if (!changed) continue;
+    _portSeen[p] = _portOut[p];
+    for (int bit = 0; bit < 8; bit++)
+    {
+      if (changed & (1 << bit)) pinWrite(portPin(p, bit), (_portOut[p] >> bit) & 1);
+    }
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Clock and interrupts
+
+static void runIsr(void (*handler)(void))
+{
+  uint8_t sreg = emuAvr.sreg;
+  _inIsr = true;
+  emuAvr.sreg = sreg & ~0x80;
+  emuCount.isrCalls++;
+  emuSpend(EMU_CYCLES_ISR);
+  handler();
+  emuAvr.sreg = sreg;
+  _inIsr = false;
+}
+
+/**Timer1 compare B triggering the ADC (ADTS = 101), as set up by AnalogSampler. OCF1B is taken as cleared by the ISR*/
+static void serviceAdc()
+{
+  bool running = (emuAvr.tccr1b & 0x07) != 0
+              && (emuAvr.adcsra & (_BV(ADEN) | _BV(ADATE))) == (_BV(ADEN) | _BV(ADATE))
+              && (emuAvr.adcsrb & 0x07) == 0x05;
+  uint64_t period = (uint64_t)TIMER1_PRESCALE[emuAvr.tccr1b & 0x07] * ((uint32_t)emuAvr.ocr1a + 1);
+  if (!running || period == 0)
+  {
+    _adcNext = 0;
+    return;
+  }
+  if (_adcNext == 0)
+  {
+    _adcNext = _now + period;
+    return;
+  }
+  while (_now >= _adcNext)
+  {
+    _adcNext += period;
+    uint8_t channel = (emuAvr.admux & 0x07) | ((emuAvr.adcsrb & _BV(MUX5)) ? 0x08 : 0);
+    emuAvr.adc = _analog[channel];
+    if ((emuAvr.adcsra & _BV(ADIE)) && emuIsr_ADC_vect)
+    {
+      runIsr(emuIsr_ADC_vect);
+    }
+    else
+    {
+      emuAvr.adcsra |= _BV(ADIF);
+    }
+  }
+}
+
+/**Latches the edges on INT0..5 since the last call, whether or not interrupts are enabled*/
+static void sampleExtPins()
+{
+  for (int i = 0; i < 6; i++)
+  {
+    if (!_extHandler[i]) continue;
+    bool level = pinLevel(EXT_PIN[i]);
+    bool prev = _extLevel[i];
+    _extLevel[i] = level;
+    switch (_extMode[i])
+    {
+      case LOW: _extFlag[i] = !level; break;
+      case CHANGE: _extFlag[i] |= level != prev; break;
+      case FALLING: _extFlag[i] |= prev && !level; break;
+      default: _extFlag[i] |= !prev && level; break;
+    }
+  }
+}
+
+static void serviceInterrupts()
+{
+  sampleExtPins();
+  if (_inIsr || !(emuAvr.sreg & 0x80)) return;
+  for (int i = 0; i < 6; i++)
+  {
+    if (!_extHandler[i] || !_extFlag[i]) continue;
+    _extFlag[i] = false;
+    runIsr(_extHandler[i]);
+  }
+  serviceAdc();
+}
+
+static uint64_t nextEvent()
+{
+  uint64_t next = _chip ? _chip->nextEvent() : UINT64_MAX;
+  if (_adcNext && _adcNext < next) next = _adcNext;
+  return next;
+}
+
+/**Moves the clock forward, stopping at every chip/ADC event so interrupts see it in time*/
+static void run(uint64_t cycles, bool busy)
+{
+  uint64_t target = _now + cycles;
+  for (;;)
+  {
+    uint64_t step = target - _now;
+    uint64_t next = nextEvent();
+    if (next > _now && next - _now < step) step = next - _now;
+    _now += step;
+    if (_chip) _chip->advance(_now);
+    uint64_t before = _now;
+    serviceInterrupts();
+    // code interrupted by an ISR still needs all of its own cycles
+    if (busy) target += _now - before;
+    if (_now >= target) break;
+  }
+  if (_watchFn && _now >= _watchAt)
+  {
+    void (*fn)(void *) = _watchFn;
+    _watchFn = nullptr;
+    fn(_watchArg);
+  }
+  if (_deadline && _now >= _deadline && !_inIsr) throw EmuDeadline();
+}
+
+void emuSpend(uint64_t cycles)
+{
+  run(cycles, true);
+}
+
+void emuWaitUntil(uint64_t cycles)
+{
+  run(cycles > _now ? cycles - _now : 0, false);
+}
+
+uint64_t emuNow()
+{
+  return _now;
+}
+
+void emuSetDeadline(uint64_t cycles)
+{
+  _deadline = cycles;
+}
+
+void emuWatchAt(uint64_t cycles, void (*fn)(void *arg), void *arg)
+{
+  _watchAt = cycles;
+  _watchFn = fn;
+  _watchArg = arg;
+}
+
+void emuReset()
+{
+  _now = 0;
+  _deadline = 0;
+  _watchFn = nullptr;
+  _chip = nullptr;
+  _csPin = _intPin = _rx0bfPin = _rx1bfPin = -1;
+  memset(_latch, 0, sizeof(_latch));
+  for (int i = 0; i < 16; i++) _analog[i] = 512;
+  memset(_portOut, 0, sizeof(_portOut));
+  memset(_portSeen, 0, sizeof(_portSeen));
+  memset(_ddr, 0, sizeof(_ddr));
+  memset(_pinIn, 0, sizeof(_pinIn));
+  _spdr = 0;
+  _spsr = 0;
+  _spdrTouched = false;
+  memset((void *)&emuAvr, 0, sizeof(emuAvr));
+  // init() of the core leaves interrupts enabled
+  emuAvr.sreg = 0x80;
+  for (int i = 0; i < 6; i++) _extHandler[i] = nullptr;
+  memset(_extFlag, 0, sizeof(_extFlag));
+  _inIsr = false;
+  _adcNext = 0;
+  Serial.emuReset();
+  emuClearCounters();
+}
+
+void emuAttachChip(Mcp2515Emu *chip, int csPin, int intPin, int rx0bfPin, int rx1bfPin)
+{
+  _chip = chip;
+  _csPin = csPin;
+  _intPin = intPin;
+  _rx0bfPin = rx0bfPin;
+  _rx1bfPin = rx1bfPin;
+  // CS idles high (pull-up on the shields)
+  if (csPin >= 0 && csPin < EMU_PINS) _latch[csPin] = 1;
+  _chip->advance(_now);
+}
+
+void emuSetAnalog(uint8_t channel, uint16_t value)
+{
+  _analog[channel & 0x0F] = value;
+}
+
+const EmuCounters &emuCounters()
+{
+  return emuCount;
+}
+
+void emuClearCounters()
+{
+  memset(&emuCount, 0, sizeof(emuCount));
+}
+
+// ---------------------------------------------------------------------------
+// SPI
+
+/**Shifts one byte at the SPCR/SPSR clock rate; the MCP2515 answers while its CS is low*/
+static uint8_t spiExchange(uint8_t data)
+{
+  if (!(emuAvr.spcr & _BV(SPE))) return 0xFF;
+  static const uint8_t DIVIDER[4] = { 4, 16, 64, 128 };
+  unsigned divider = DIVIDER[emuAvr.spcr & 0x03] >> (_spsr & _BV(SPI2X) ? 1 : 0);
+  uint8_t miso = 0xFF;
+  if (_chip && _csPin >= 0 && !_latch[_csPin]) miso = _chip->transfer(data);
+  emuCount.spiTransfers++;
+  emuSpend(8 * divider);
+  return miso;
+}
+
+SPISettings::SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+{
+  (void)bitOrder;
+  (void)dataMode;
+  static const uint8_t ORDER[7] = { SPI_CLOCK_DIV2, SPI_CLOCK_DIV4, SPI_CLOCK_DIV8, SPI_CLOCK_DIV16,
+                                    SPI_CLOCK_DIV32, SPI_CLOCK_DIV64, SPI_CLOCK_DIV128 };
+  _divider = SPI_CLOCK_DIV128;
+  for (int i = 0; i < 7; i++)
+  {
+    if (F_CPU / (2UL << i) <= clock)
+    {
+      _divider = ORDER[i];
+      break;
+    }
+  }
+}
+
+void SPIClass::begin()
+{
+  emuAvr.spcr |= _BV(MSTR) | _BV(SPE);
+}
+
+void SPIClass::end()
+{
+  emuAvr.spcr &= ~_BV(SPE);
+}
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+  setClockDivider(settings._divider);
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+  emuSpend(EMU_CYCLES_SPI_CALL);
+  return spiExchange(data);
+}
+
+uint16_t SPIClass::transfer16(uint16_t data)
+{
+  uint16_t high = transfer(data >> 8);
+  return (high << 8) | transfer(data & 0xFF);
+}
+
+void SPIClass::transfer(void *buf, size_t count)
+{
+  uint8_t *p = (uint8_t *)buf;
+  for (size_t i = 0; i < count; i++) p[i] = transfer(p[i]);
+}
+
+void SPIClass::setBitOrder(uint8_t bitOrder)
+{
+  if (bitOrder == LSBFIRST) emuAvr.spcr |= _BV(DORD);
+  else emuAvr.spcr &= ~_BV(DORD);
+}
+
+void SPIClass::setDataMode(uint8_t dataMode)
+{
+  emuAvr.spcr = (emuAvr.spcr & ~0x0C) | (dataMode & 0x0C);
+}
+
+void SPIClass::setClockDivider(uint8_t clockDiv)
+{
+  emuAvr.spcr = (emuAvr.spcr & ~0x03) | (clockDiv & 0x03);
+  _spsr = (_spsr & ~_BV(SPI2X)) | ((clockDiv >> 2) & _BV(SPI2X));
+}
+
+// ---------------------------------------------------------------------------
+// I/O registers
+
+extern "C" volatile uint8_t *emuSpdr(void)
+{
+  syncPorts();
+  _spdrTouched = true;
+  return &_spdr;
+}
+
+extern "C" volatile uint8_t *emuSpsr(void)
+{
+  syncPorts();
+  if (_spdrTouched)
+  {
+    // the byte written to SPDR goes out when the code waits for SPIF
+    _spdrTouched = false;
+    _spdr = spiExchange(_spdr);
+  }
+  else
+  {
+    emuSpend(EMU_CYCLES_PORT_ACCESS);
+  }
+  _spsr |= _BV(SPIF);
+  return &_spsr;
+}
+
+extern "C" volatile uint8_t *emuPort(char port)
+{
+  syncPorts();
+  emuSpend(EMU_CYCLES_PORT_ACCESS);
+  return &_portOut[portIndex(port)];
+}
+
+extern "C" volatile uint8_t *emuPin(char port)
+{
+  syncPorts();
+  emuSpend(EMU_CYCLES_PORT_ACCESS);
+  int p = portIndex(port);
+  uint8_t value = 0;
+  for (int bit = 0; bit < 8; bit++)
+  {
+    if (pinLevel(portPin(p, bit))) value |= 1 << bit;
+  }
+  _pinIn[p] = value;
+  return &_pinIn[p];
+}
+
+extern "C" volatile uint8_t *emuDdr(char port)
+{
+  syncPorts();
+  return &_ddr[portIndex(port)];
+}
+
+// ---------------------------------------------------------------------------
+// Arduino core
+
+extern "C" void pinMode(uint8_t pin, uint8_t mode)
+{
+  emuSpend(EMU_CYCLES_PIN_MODE);
+  if (mode == INPUT_PULLUP) pinWrite(pin, true);
+}
+
+extern "C" void digitalWrite(uint8_t pin, uint8_t val)
+{
+  emuCount.digitalWrites++;
+  emuSpend(EMU_CYCLES_DIGITAL_WRITE);
+  pinWrite(pin, val != LOW);
+}
+
+extern "C" int digitalRead(uint8_t pin)
+{
+  emuCount.digitalReads++;
+  emuSpend(EMU_CYCLES_DIGITAL_READ);
+  return pinLevel(pin) ? HIGH : LOW;
+}
+
+extern "C" int analogRead(uint8_t pin)
+{
+  uint8_t channel = pin >= A0 ? pin - A0 : pin;
+  emuSpend(EMU_CYCLES_ANALOG_READ);
+  return _analog[channel & 0x0F];
+}
+
+extern "C" void analogReference(uint8_t mode)
+{
+  (void)mode;
+}
+
+extern "C" void analogWrite(uint8_t pin, int val)
+{
+  emuSpend(EMU_CYCLES_DIGITAL_WRITE);
+  pinWrite(pin, val >= 128);
+}
+
+extern "C" unsigned long millis(void)
+{
+  emuCount.millisCalls++;
+  emuSpend(EMU_CYCLES_MILLIS);
+  return (unsigned long)(_now / (F_CPU / 1000UL));
+}
+
+extern "C" unsigned long micros(void)
+{
+  emuSpend(EMU_CYCLES_MICROS);
+  return (unsigned long)(_now / (F_CPU / 1000000UL));
+}
+
+extern "C" void delay(unsigned long ms)
+{
+  emuSpend(EMU_CYCLES_MILLIS);
+  emuWaitUntil(_now + (uint64_t)ms * (F_CPU / 1000UL));
+}
+
+extern "C" void delayMicroseconds(unsigned int us)
+{
+  emuSpend((uint64_t)us * (F_CPU / 1000000UL));
+}
+
+extern "C" void emuDelayCycles(uint32_t cycles)
+{
+  emuSpend(cycles);
+}
+
+extern "C" void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode)
+{
+  if (interruptNum >= 6) return;
+  _extHandler[interruptNum] = userFunc;
+  _extMode[interruptNum] = mode;
+  _extLevel[interruptNum] = pinLevel(EXT_PIN[interruptNum]);
+  _extFlag[interruptNum] = false;
+}
+
+extern "C" void detachInterrupt(uint8_t interruptNum)
+{
+  if (interruptNum < 6) _extHandler[interruptNum] = nullptr;
+}
+
+uint16_t makeWord(uint16_t w)
+{
+  return w;
+}
+
+uint16_t makeWord(byte h, byte l)
+{
+  return (h << 8) | l;
+}
+
+unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout)
+{
+  (void)pin;
+  (void)state;
+  emuSpend((uint64_t)timeout * (F_CPU / 1000000UL));
+  return 0;
+}
+
+long random(long howbig)
+{
+  return howbig ? ::random() % howbig : 0;
+}
+
+long random(long howsmall, long howbig)
+{
+  return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed)
+{
+  if (seed) srandom(seed);
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
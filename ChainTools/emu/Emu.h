@@ -0,0 +1,119 @@
+/*
+  Emu.h - Virtual Arduino board for running the loggers and the MCP2515 drivers on Linux
+
+  The headers in shim/ (Arduino.h, SPI.h, SD.h, EEPROM.h, avr/io.h, ...) put
+  the unmodified sketches and libraries on top of this board. Nothing runs
+  in real time: every shim call charges the AVR cycles it would take on a
+  16 MHz ATmega (EMU_CYCLES_* below, SPI and UART from their clock rates)
+  to a virtual clock, and the MCP2515 model, the external interrupts and
+  the Timer1/ADC pair are advanced along that clock. Arithmetic done by the
+  sketch itself between shim calls costs nothing, so the measured cycles are
+  a lower bound dominated by I/O, which is what limits these loggers.
+
+  Differences to the target worth knowing: int is 32 bit and long 64 bit on
+  the host (printing and String conversions still use the AVR widths), the
+  port registers follow the ATmega328P pin layout used by Arduino
+  Libraries/3, and the SD card and EEPROM live in memory.
+*/
+
+#ifndef Emu_h
+#define Emu_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+#include "Mcp2515Emu.h"
+
+// Cycle costs of the Arduino core calls (avr-gcc -Os, Arduino AVR core 1.8)
+#define EMU_CYCLES_PIN_MODE       60
+#define EMU_CYCLES_DIGITAL_WRITE  56
+#define EMU_CYCLES_DIGITAL_READ   52
+#define EMU_CYCLES_MILLIS         28
+#define EMU_CYCLES_MICROS         44
+#define EMU_CYCLES_PORT_ACCESS    2     // sbi/cbi/in on an I/O register
+#define EMU_CYCLES_SPI_CALL       12    // SPI.transfer() around the 8 bit shift
+#define EMU_CYCLES_ISR            72    // interrupt entry/exit incl. the attachInterrupt dispatch
+#define EMU_CYCLES_ANALOG_READ    1664  // 13 ADC clocks at 125 kHz
+#define EMU_CYCLES_PRINT_CHAR     24
+#define EMU_CYCLES_PRINT_DIGIT    620   // one 32 bit __udivmodsi4 per printed digit
+#define EMU_CYCLES_UART_BYTE      80    // HardwareSerial::write plus the UDRE interrupt
+#define EMU_CYCLES_STRING_ALLOC   180   // realloc in String
+#define EMU_CYCLES_STRING_CHAR    8
+#define EMU_CYCLES_SD_BYTE        10    // copy into the 512 byte block cache
+#define EMU_CYCLES_SD_BLOCK       16000 // block write incl. card busy time, ~1 ms
+#define EMU_CYCLES_SD_INIT        1600000
+#define EMU_CYCLES_EEPROM_WRITE   54400 // 3.3 ms programming time
+
+/*Digital pins of the board (Mega 2560 numbering, enough for the Uno sketches too)*/
+#define EMU_PINS  70
+
+struct EmuCounters
+{
+  uint64_t digitalWrites;
+  uint64_t digitalReads;
+  uint64_t spiTransfers;   // bytes shifted through SPI.transfer() or SPDR
+  uint64_t spiSelects;     // MCP2515 CS low, i.e. SPI commands
+  uint64_t serialBytes;
+  uint64_t sdBytes;
+  uint64_t sdBlocks;       // card block writes
+  uint64_t eepromWrites;
+  uint64_t isrCalls;
+  uint64_t millisCalls;
+  uint64_t printCalls;     // print()/println()/write() on Serial or a File, nested calls count once
+  uint64_t stringOps;      // String constructions and changes (each one a heap realloc)
+};
+
+/*Counts one printCalls for the outermost Print call on the stack*/
+struct EmuPrintCall
+{
+  EmuPrintCall();
+  ~EmuPrintCall();
+};
+
+/*Thrown out of the sketch when the virtual clock reaches the deadline*/
+struct EmuDeadline
+{
+};
+
+/**Board reset: clock to 0, pins, interrupts, registers and serial line cleared. SD card and EEPROM are kept*/
+void emuReset();
+/**Virtual time in CPU cycles since emuReset()*/
+uint64_t emuNow();
+/**Busy CPU time; interrupts that fire meanwhile extend it*/
+void emuSpend(uint64_t cycles);
+/**Lets the clock run to cycles (delay()); interrupts that fire meanwhile are part of the wait*/
+void emuWaitUntil(uint64_t cycles);
+/**Throws EmuDeadline from the next shim call at or after cycles, 0 disables*/
+void emuSetDeadline(uint64_t cycles);
+/**Calls fn(arg) once from the first shim call at or after cycles (NULL cancels); fn can look at the board and the chip*/
+void emuWatchAt(uint64_t cycles, void (*fn)(void *arg), void *arg);
+
+/**Wires chip to the board: CS and INT pins, optional RX0BF/RX1BF pins (-1 = not connected)*/
+void emuAttachChip(Mcp2515Emu *chip, int csPin, int intPin, int rx0bfPin = -1, int rx1bfPin = -1);
+/**Value returned by analogRead() and the ADC for channel*/
+void emuSetAnalog(uint8_t channel, uint16_t value);
+
+/**Where Serial output goes, NULL (default) discards it*/
+void emuSerialOutput(FILE *out);
+/**Everything written to Serial since the reset, kept if keep is set*/
+void emuSerialCapture(bool keep);
+const std::string &emuSerialCaptured();
+
+/**Contents of a file on the emulated SD card, NULL if it does not exist*/
+const std::string *emuSdFile(const char *name);
+/**Calls fn for every file on the card*/
+void emuSdForEach(void (*fn)(const std::string &name, const std::string &data, void *arg), void *arg);
+/**Empties the card*/
+void emuSdClear();
+/**Makes SD.begin() fail, as with no card inserted*/
+void emuSdPresent(bool present);
+/**Erases the EEPROM to 0xFF*/
+void emuEepromClear();
+
+const EmuCounters &emuCounters();
+void emuClearCounters();
+/*Counters as updated by the shims*/
+extern EmuCounters emuCount;
+
+#endif
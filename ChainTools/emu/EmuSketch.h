@@ -0,0 +1,33 @@
+/*
+  EmuSketch.h - Description of the sketch linked into an emulator binary
+
+  Each file in emu/sketches/ includes one logger .ino (after the function
+  prototypes the Arduino IDE would generate for it) or implements a minimal
+  receive loop on one of the MCP2515 drivers, and defines emuSketch with the
+  wiring of the CAN shield and where the logged records end up, so
+  emu_bench can count them.
+*/
+
+#ifndef EmuSketch_h
+#define EmuSketch_h
+
+enum EmuOutput
+{
+  EMU_OUT_CHIP,    // nothing countable is written, frames read out of the MCP2515 count
+  EMU_OUT_SD,      // "Msg#,Time Diff,ID,DLC,Data" lines in the files on the SD card
+  EMU_OUT_STREAM   // ChainStream packets on Serial
+};
+
+struct EmuSketch
+{
+  const char *name;
+  int csPin;
+  int intPin;
+  int rx0bfPin;    // -1 if the sketch does not use the buffer full pins
+  int rx1bfPin;
+  EmuOutput output;
+};
+
+extern const EmuSketch emuSketch;
+
+#endif
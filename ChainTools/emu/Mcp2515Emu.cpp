@@ -0,0 +1,746 @@
+#include "Mcp2515Emu.h"
+
+#include <string.h>
+
+#include "../BusTiming.h"
+
+// Registers
+#define REG_RXF0      0x00
+#define REG_RXF1      0x04
+#define REG_RXF2      0x08
+#define REG_BFPCTRL   0x0C
+#define REG_TXRTSCTRL 0x0D
+#define REG_CANSTAT   0x0E
+#define REG_CANCTRL   0x0F
+#define REG_RXF3      0x10
+#define REG_RXF4      0x14
+#define REG_RXF5      0x18
+#define REG_TEC       0x1C
+#define REG_REC       0x1D
+#define REG_RXM0      0x20
+#define REG_RXM1      0x24
+#define REG_CNF3      0x28
+#define REG_CNF2      0x29
+#define REG_CNF1      0x2A
+#define REG_CANINTE   0x2B
+#define REG_CANINTF   0x2C
+#define REG_EFLG      0x2D
+#define REG_TXB0CTRL  0x30
+#define REG_RXB0CTRL  0x60
+#define REG_RXB1CTRL  0x70
+
+// CANINTF / CANINTE
+#define RX0IF  0x01
+#define RX1IF  0x02
+#define TX0IF  0x04
+#define ERRIF  0x20
+#define WAKIF  0x40
+#define MERRF  0x80
+
+// EFLG
+#define EWARN   0x01
+#define RXWAR   0x02
+#define TXWAR   0x04
+#define RXEP    0x08
+#define TXEP    0x10
+#define TXBO    0x20
+#define RX0OVR  0x40
+#define RX1OVR  0x80
+
+// TXBnCTRL
+#define TXREQ  0x08
+#define ABTF   0x40
+#define TXP    0x03
+
+// CANCTRL
+#define ABAT  0x10
+
+// RXBnCTRL
+#define RXM_ANY   0x03
+#define RXM_STD   0x01
+#define RXM_EXT   0x02
+#define RXRTR     0x08
+#define BUKT      0x04
+#define BUKT1     0x02
+
+// SIDL
+#define SIDL_SRR    0x10
+#define SIDL_EXIDE  0x08
+// RXBnDLC / TXBnDLC
+#define DLC_RTR     0x40
+
+// Operation modes (CANSTAT.OPMOD, CANCTRL.REQOP)
+#define MODE_NORMAL    0
+#define MODE_SLEEP     1
+#define MODE_LOOPBACK  2
+#define MODE_LISTEN    3
+#define MODE_CONFIG    4
+
+/*A frame at another bitrate than CNF1..3 is received if within this tolerance (parts per 1000)*/
+#define BITRATE_TOLERANCE  15
+
+static const uint8_t FILTER_ADDR[6] = { REG_RXF0, REG_RXF1, REG_RXF2, REG_RXF3, REG_RXF4, REG_RXF5 };
+
+/**Registers the BIT MODIFY command works on, for all others it is a plain write*/
+static bool bitModifiable(uint8_t address)
+{
+  switch (address)
+  {
+    case REG_BFPCTRL: case REG_TXRTSCTRL:
+    case REG_CNF3: case REG_CNF2: case REG_CNF1:
+    case REG_CANINTE: case REG_CANINTF: case REG_EFLG:
+    case 0x30: case 0x40: case 0x50:
+    case REG_RXB0CTRL: case REG_RXB1CTRL:
+      return true;
+  }
+  return (address & 0x0F) == REG_CANCTRL;
+}
+
+/**Filters, masks and bit timing, locked outside configuration mode*/
+static bool configOnly(uint8_t address)
+{
+  return address < REG_BFPCTRL
+      || (address >= REG_RXF3 && address < REG_TEC)
+      || (address >= REG_RXM0 && address <= REG_CNF1)
+      || address == REG_TXRTSCTRL;
+}
+
+Mcp2515Emu::Mcp2515Emu(uint32_t oscHz)
+  : _oscHz(oscHz), _busBitrate(500000UL), _busFreeAt(0), _now(0)
+{
+  powerOn();
+}
+
+void Mcp2515Emu::powerOn()
+{
+  _arrivals.clear();
+  _busFreeAt = _now;
+  _txFrames.clear();
+  _reset();
+  clearStats();
+}
+
+void Mcp2515Emu::_reset()
+{
+  memset(_regs, 0, sizeof(_regs));
+  _regs[REG_CANSTAT] = MODE_CONFIG << 5;
+  _regs[REG_CANCTRL] = (MODE_CONFIG << 5) | 0x07;
+  _rxFilter[0] = _rxFilter[1] = 0;
+  _rxRead[0] = _rxRead[1] = false;
+  _txBuffer = -1;
+  _txEnd = 0;
+  _selected = false;
+  _spiState = SPI_IDLE;
+  _address = 0;
+  _modifyMask = 0;
+  _statusByte = 0;
+  _clearOnDeselect = 0;
+}
+
+void Mcp2515Emu::clearStats()
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+void Mcp2515Emu::setBusBitrate(uint32_t bitrate)
+{
+  _busBitrate = bitrate;
+}
+
+uint32_t Mcp2515Emu::configuredBitrate() const
+{
+  uint8_t cnf1 = _regs[REG_CNF1];
+  uint8_t cnf2 = _regs[REG_CNF2];
+  uint8_t cnf3 = _regs[REG_CNF3];
+  unsigned brp = cnf1 & 0x3F;
+  unsigned prseg = (cnf2 & 0x07) + 1;
+  unsigned phseg1 = ((cnf2 >> 3) & 0x07) + 1;
+  // without BTLMODE PS2 is the larger of PS1 and the 2 TQ information processing time
+  unsigned phseg2 = (cnf2 & 0x80) ? (cnf3 & 0x07) + 1 : (phseg1 > 2 ? phseg1 : 2);
+  unsigned quanta = 1 + prseg + phseg1 + phseg2;
+  if (quanta < 5 || quanta > 25) return 0;
+  return (uint32_t)(((uint64_t)_oscHz + (brp + 1) * quanta) / (2ULL * (brp + 1) * quanta));
+}
+
+uint64_t Mcp2515Emu::_bitCycles(unsigned bits) const
+{
+  return ((uint64_t)bits * EMU_CPU_HZ + _busBitrate - 1) / _busBitrate;
+}
+
+uint64_t Mcp2515Emu::inject(const CanFrame &frame, uint64_t startCycles)
+{
+  uint64_t start = startCycles > _busFreeAt ? startCycles : _busFreeAt;
+  Arrival arrival;
+  arrival.frame = frame;
+  arrival.endCycles = start + _bitCycles(canFrameBits(frame));
+  _busFreeAt = arrival.endCycles;
+  _arrivals.push_back(arrival);
+  return arrival.endCycles;
+}
+
+uint64_t Mcp2515Emu::nextEvent() const
+{
+  uint64_t next = UINT64_MAX;
+  if (!_arrivals.empty()) next = _arrivals.front().endCycles;
+  if (_txBuffer >= 0 && _txEnd < next) next = _txEnd;
+  return next;
+}
+
+void Mcp2515Emu::advance(uint64_t now)
+{
+  for (;;)
+  {
+    bool arrival = !_arrivals.empty() && _arrivals.front().endCycles <= now;
+    bool txDone = _txBuffer >= 0 && _txEnd <= now;
+    if (!arrival && !txDone) break;
+    if (txDone && (!arrival || _txEnd <= _arrivals.front().endCycles))
+    {
+      _now = _txEnd;
+      _finishTx();
+    }
+    else
+    {
+      _now = _arrivals.front().endCycles;
+      CanFrame frame = _arrivals.front().frame;
+      _arrivals.pop_front();
+      _stats.busFrames++;
+      _receive(frame);
+    }
+    _startTx(_now);
+  }
+  if (now > _now) _now = now;
+}
+
+// ---------------------------------------------------------------------------
+// Register file
+
+uint8_t Mcp2515Emu::peek(uint8_t address) const
+{
+  address &= 0x7F;
+  uint8_t low = address & 0x0F;
+  if (low == REG_CANSTAT || low == REG_CANCTRL) return _regs[low];
+  return _regs[address];
+}
+
+uint8_t Mcp2515Emu::_read(uint8_t address)
+{
+  address &= 0x7F;
+  // SIDH..D7 of RXB0 (0x61..0x6D) or RXB1 (0x71..0x7D)
+  uint8_t low = address & 0x0F;
+  if ((address & 0xF0) == REG_RXB0CTRL && low >= 1 && low <= 0x0D) _rxRead[0] = true;
+  if ((address & 0xF0) == REG_RXB1CTRL && low >= 1 && low <= 0x0D) _rxRead[1] = true;
+  return peek(address);
+}
+
+void Mcp2515Emu::_write(uint8_t address, uint8_t value)
+{
+  address &= 0x7F;
+  uint8_t low = address & 0x0F;
+
+  if (low == REG_CANSTAT) return;
+  if (low == REG_CANCTRL)
+  {
+    _regs[REG_CANCTRL] = value & ~ABAT;
+    // the mode switch is immediate, the bus is treated as idle
+    _regs[REG_CANSTAT] = (_regs[REG_CANSTAT] & 0x1F) | (value & 0xE0);
+    if (value & ABAT)
+    {
+      for (uint8_t b = 0; b < 3; b++)
+      {
+        uint8_t &ctrl = _regs[REG_TXB0CTRL + 0x10 * b];
+        if ((ctrl & TXREQ) && b != _txBuffer) ctrl = (ctrl & ~TXREQ) | ABTF;
+      }
+    }
+    _startTx(_now);
+    return;
+  }
+  if (configOnly(address) && _mode() != MODE_CONFIG) return;
+
+  switch (address)
+  {
+    case REG_TXRTSCTRL:
+      _regs[address] = value & 0x07;
+      return;
+    case REG_TEC:
+    case REG_REC:
+      return;
+    case REG_CANINTF:
+      _releaseRx(_regs[address] & ~value);
+      _regs[address] = value;
+      return;
+    case REG_EFLG:
+      // only the overflow flags can be written (cleared) by the MCU
+      _regs[address] = (_regs[address] & 0x3F) | (value & 0xC0);
+      return;
+    case REG_RXB0CTRL:
+      _regs[address] = (value & 0x64) | ((value & BUKT) ? BUKT1 : 0) | (_regs[address] & 0x09);
+      return;
+    case REG_RXB1CTRL:
+      _regs[address] = (value & 0x60) | (_regs[address] & 0x0F);
+      return;
+  }
+  if ((address & 0x8F) == 0x00 && address >= REG_TXB0CTRL && address <= 0x50)
+  {
+    // TXBnCTRL: TXREQ and TXP are writable, the status bits are not
+    uint8_t &ctrl = _regs[address];
+    bool request = (value & TXREQ) && !(ctrl & TXREQ);
+    ctrl = (ctrl & 0x70) | (value & (TXREQ | TXP));
+    if (request)
+    {
+      ctrl &= ~ABTF;
+      _startTx(_now);
+    }
+    return;
+  }
+  if (address > REG_RXB0CTRL && address <= 0x6D) return;
+  if (address > REG_RXB1CTRL && address <= 0x7D) return;
+  _regs[address] = value;
+}
+
+void Mcp2515Emu::_modify(uint8_t address, uint8_t mask, uint8_t value)
+{
+  if (!bitModifiable(address & 0x7F)) mask = 0xFF;
+  uint8_t current = peek(address);
+  _write(address, (current & ~mask) | (value & mask));
+}
+
+void Mcp2515Emu::_releaseRx(uint8_t cleared)
+{
+  for (int b = 0; b < 2; b++)
+  {
+    if (!(cleared & (RX0IF << b))) continue;
+    if (_rxRead[b]) _stats.readOut++;
+    else _stats.discarded++;
+  }
+}
+
+void Mcp2515Emu::_setFlags(uint8_t canintf)
+{
+  _regs[REG_CANINTF] |= canintf;
+}
+
+void Mcp2515Emu::_setErrorFlags(uint8_t eflg)
+{
+  if (eflg & ~_regs[REG_EFLG])
+  {
+    _regs[REG_EFLG] |= eflg;
+    _setFlags(ERRIF);
+  }
+}
+
+void Mcp2515Emu::_updateErrorCounters()
+{
+  uint8_t tec = _regs[REG_TEC];
+  uint8_t rec = _regs[REG_REC];
+  uint8_t flags = 0;
+  if (tec >= 96 || rec >= 96) flags |= EWARN;
+  if (rec >= 96) flags |= RXWAR;
+  if (tec >= 96) flags |= TXWAR;
+  if (rec >= 128) flags |= RXEP;
+  if (tec >= 128) flags |= TXEP;
+  uint8_t raised = flags & ~_regs[REG_EFLG];
+  _regs[REG_EFLG] = (_regs[REG_EFLG] & (RX0OVR | RX1OVR | TXBO)) | flags;
+  if (raised) _setFlags(ERRIF);
+}
+
+// ---------------------------------------------------------------------------
+// Reception
+
+bool Mcp2515Emu::_matches(const CanFrame &frame, uint8_t filter, uint8_t mask) const
+{
+  const uint8_t *f = &_regs[filter];
+  const uint8_t *m = &_regs[mask];
+  uint32_t fsid = ((uint32_t)f[0] << 3) | (f[1] >> 5);
+  uint32_t msid = ((uint32_t)m[0] << 3) | (m[1] >> 5);
+  bool extended = (frame.flags & FRAME_EXTENDED) != 0;
+
+  if (((f[1] & SIDL_EXIDE) != 0) != extended) return false;
+  if (extended)
+  {
+    uint32_t feid = ((uint32_t)(f[1] & 0x03) << 16) | ((uint32_t)f[2] << 8) | f[3];
+    uint32_t meid = ((uint32_t)(m[1] & 0x03) << 16) | ((uint32_t)m[2] << 8) | m[3];
+    return (((frame.id >> 18) ^ fsid) & msid) == 0 && ((frame.id ^ feid) & meid & 0x3FFFF) == 0;
+  }
+  if (((frame.id ^ fsid) & msid & 0x7FF) != 0) return false;
+  // for standard frames EID8/EID0 filter the first two data bytes
+  bool rtr = (frame.flags & FRAME_RTR) != 0;
+  if (!rtr && frame.dlc > 0 && ((frame.data[0] ^ f[2]) & m[2])) return false;
+  if (!rtr && frame.dlc > 1 && ((frame.data[1] ^ f[3]) & m[3])) return false;
+  return true;
+}
+
+/**Filter code hit by frame for RXB0 (0 or 1), -1 if RXB0 does not accept it*/
+int Mcp2515Emu::_acceptRxb0(const CanFrame &frame) const
+{
+  uint8_t rxm = (_regs[REG_RXB0CTRL] >> 5) & 0x03;
+  bool extended = (frame.flags & FRAME_EXTENDED) != 0;
+  if (rxm == RXM_STD && extended) return -1;
+  if (rxm == RXM_EXT && !extended) return -1;
+  for (int i = 0; i < 2; i++)
+  {
+    if (_matches(frame, FILTER_ADDR[i], REG_RXM0)) return i;
+  }
+  // with RXM = 11 masks and filters are off, FILHIT still shows a matching filter
+  return rxm == RXM_ANY ? 0 : -1;
+}
+
+/**Filter code hit by frame for RXB1 (2..5), -1 if RXB1 does not accept it*/
+int Mcp2515Emu::_acceptRxb1(const CanFrame &frame) const
+{
+  uint8_t rxm = (_regs[REG_RXB1CTRL] >> 5) & 0x03;
+  bool extended = (frame.flags & FRAME_EXTENDED) != 0;
+  if (rxm == RXM_STD && extended) return -1;
+  if (rxm == RXM_EXT && !extended) return -1;
+  for (int i = 2; i < 6; i++)
+  {
+    if (_matches(frame, FILTER_ADDR[i], REG_RXM1)) return i;
+  }
+  return rxm == RXM_ANY ? 2 : -1;
+}
+
+void Mcp2515Emu::_store(uint8_t buffer, const CanFrame &frame, uint8_t filterHit)
+{
+  uint8_t *r = &_regs[buffer ? REG_RXB1CTRL : REG_RXB0CTRL];
+  bool rtr = (frame.flags & FRAME_RTR) != 0;
+  uint32_t id = frame.id;
+  if (frame.flags & FRAME_EXTENDED)
+  {
+    uint32_t sid = (id >> 18) & 0x7FF;
+    r[1] = sid >> 3;
+    r[2] = ((sid & 0x07) << 5) | SIDL_EXIDE | ((id >> 16) & 0x03);
+    r[3] = (id >> 8) & 0xFF;
+    r[4] = id & 0xFF;
+    r[5] = (rtr ? DLC_RTR : 0) | (frame.dlc & 0x0F);
+  }
+  else
+  {
+    r[1] = (id >> 3) & 0xFF;
+    r[2] = ((id & 0x07) << 5) | (rtr ? SIDL_SRR : 0);
+    r[3] = 0;
+    r[4] = 0;
+    r[5] = frame.dlc & 0x0F;
+  }
+  if (!rtr)
+  {
+    memcpy(&r[6], frame.data, frame.dlc > 8 ? 8 : frame.dlc);
+  }
+  if (buffer == 0)
+  {
+    r[0] = (r[0] & (0x60 | BUKT | BUKT1)) | (rtr ? RXRTR : 0) | (filterHit & 0x01);
+  }
+  else
+  {
+    r[0] = (r[0] & 0x60) | (rtr ? RXRTR : 0) | (filterHit >= 6 ? filterHit - 6 : filterHit);
+  }
+  _rxFilter[buffer] = filterHit;
+  _rxRead[buffer] = false;
+  _setFlags(buffer ? RX1IF : RX0IF);
+  _stats.received++;
+}
+
+void Mcp2515Emu::_receive(const CanFrame &frame)
+{
+  uint8_t mode = _mode();
+  if (mode == MODE_CONFIG || mode == MODE_LOOPBACK)
+  {
+    _stats.ignored++;
+    return;
+  }
+  if (mode == MODE_SLEEP)
+  {
+    // bus activity wakes the device into listen-only mode, the frame itself is lost
+    if (_regs[REG_CANINTE] & WAKIF)
+    {
+      _setFlags(WAKIF);
+      _regs[REG_CANSTAT] = (_regs[REG_CANSTAT] & 0x1F) | (MODE_LISTEN << 5);
+      _regs[REG_CANCTRL] = (_regs[REG_CANCTRL] & 0x1F) | (MODE_LISTEN << 5);
+    }
+    _stats.ignored++;
+    return;
+  }
+
+  uint32_t configured = configuredBitrate();
+  uint64_t deviation = configured > _busBitrate ? configured - _busBitrate : _busBitrate - configured;
+  if (configured == 0 || deviation * 1000 > (uint64_t)_busBitrate * BITRATE_TOLERANCE)
+  {
+    _setFlags(MERRF);
+    if (mode == MODE_NORMAL && _regs[REG_REC] < 255)
+    {
+      _regs[REG_REC]++;
+      _updateErrorCounters();
+    }
+    _stats.bitErrors++;
+    return;
+  }
+  if (mode == MODE_NORMAL && _regs[REG_REC] > 0)
+  {
+    _regs[REG_REC] = _regs[REG_REC] > 127 ? 120 : _regs[REG_REC] - 1;
+    _updateErrorCounters();
+  }
+  _receiveAccepted(frame);
+}
+
+void Mcp2515Emu::_receiveAccepted(const CanFrame &frame)
+{
+  uint8_t intf = _regs[REG_CANINTF];
+  int hit = _acceptRxb0(frame);
+  if (hit >= 0)
+  {
+    if (!(intf & RX0IF))
+    {
+      _store(0, frame, hit);
+    }
+    else if (!(_regs[REG_RXB0CTRL] & BUKT))
+    {
+      _setErrorFlags(RX0OVR);
+      _stats.overflows++;
+    }
+    else if (!(intf & RX1IF))
+    {
+      // rollover, RX STATUS reports RXF0/RXF1 as codes 6/7
+      _store(1, frame, hit + 6);
+      _stats.rolledOver++;
+    }
+    else
+    {
+      _setErrorFlags(RX1OVR);
+      _stats.overflows++;
+    }
+    return;
+  }
+  hit = _acceptRxb1(frame);
+  if (hit < 0)
+  {
+    _stats.filtered++;
+  }
+  else if (!(intf & RX1IF))
+  {
+    _store(1, frame, hit);
+  }
+  else
+  {
+    _setErrorFlags(RX1OVR);
+    _stats.overflows++;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Transmission
+
+void Mcp2515Emu::_startTx(uint64_t now)
+{
+  uint8_t mode = _mode();
+  if (_txBuffer >= 0 || (mode != MODE_NORMAL && mode != MODE_LOOPBACK)) return;
+  int best = -1;
+  for (int b = 0; b < 3; b++)
+  {
+    uint8_t ctrl = _regs[REG_TXB0CTRL + 0x10 * b];
+    // equal TXP: the higher buffer number goes first
+    if ((ctrl & TXREQ) && (best < 0 || (ctrl & TXP) >= (_regs[REG_TXB0CTRL + 0x10 * best] & TXP))) best = b;
+  }
+  if (best < 0) return;
+
+  const uint8_t *r = &_regs[REG_TXB0CTRL + 0x10 * best];
+  CanFrame frame;
+  memset(&frame, 0, sizeof(frame));
+  uint32_t sid = ((uint32_t)r[1] << 3) | (r[2] >> 5);
+  if (r[2] & SIDL_EXIDE)
+  {
+    frame.flags |= FRAME_EXTENDED;
+    frame.id = (sid << 18) | ((uint32_t)(r[2] & 0x03) << 16) | ((uint32_t)r[3] << 8) | r[4];
+  }
+  else
+  {
+    frame.id = sid;
+  }
+  if (r[5] & DLC_RTR) frame.flags |= FRAME_RTR;
+  frame.dlc = r[5] & 0x0F;
+  memcpy(frame.data, &r[6], 8);
+  frame.timeUs = now / (EMU_CPU_HZ / 1000000UL);
+
+  // no arbitration against the injected traffic, the frame just takes its time on the bus
+  uint64_t start = (mode == MODE_NORMAL && _busFreeAt > now) ? _busFreeAt : now;
+  _txBuffer = best;
+  _txEnd = start + _bitCycles(canFrameBits(frame));
+  _txFrame = frame;
+}
+
+void Mcp2515Emu::_finishTx()
+{
+  int b = _txBuffer;
+  _txBuffer = -1;
+  _regs[REG_TXB0CTRL + 0x10 * b] &= ~TXREQ;
+  _setFlags(TX0IF << b);
+  _stats.transmitted++;
+  if (_mode() == MODE_LOOPBACK)
+  {
+    _receiveAccepted(_txFrame);
+  }
+  else
+  {
+    _txFrames.push_back(_txFrame);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// SPI
+
+void Mcp2515Emu::select()
+{
+  _selected = true;
+  _spiState = SPI_IDLE;
+  _stats.spiCommands++;
+}
+
+void Mcp2515Emu::deselect()
+{
+  if (!_selected) return;
+  if (_clearOnDeselect)
+  {
+    _releaseRx(_regs[REG_CANINTF] & _clearOnDeselect);
+    _regs[REG_CANINTF] &= ~_clearOnDeselect;
+    _clearOnDeselect = 0;
+  }
+  _selected = false;
+  _spiState = SPI_IDLE;
+}
+
+uint8_t Mcp2515Emu::_readStatus() const
+{
+  uint8_t intf = _regs[REG_CANINTF];
+  uint8_t status = intf & (RX0IF | RX1IF);
+  for (int b = 0; b < 3; b++)
+  {
+    if (_regs[REG_TXB0CTRL + 0x10 * b] & TXREQ) status |= 0x04 << (2 * b);
+    if (intf & (TX0IF << b)) status |= 0x08 << (2 * b);
+  }
+  return status;
+}
+
+uint8_t Mcp2515Emu::_rxStatus() const
+{
+  uint8_t intf = _regs[REG_CANINTF];
+  uint8_t status = (intf & (RX0IF | RX1IF)) << 6;
+  if (!status) return 0;
+  int b = (intf & RX0IF) ? 0 : 1;
+  const uint8_t *r = &_regs[b ? REG_RXB1CTRL : REG_RXB0CTRL];
+  bool extended = (r[2] & SIDL_EXIDE) != 0;
+  bool rtr = extended ? (r[5] & DLC_RTR) != 0 : (r[2] & SIDL_SRR) != 0;
+  return status | (extended ? 0x10 : 0) | (rtr ? 0x08 : 0) | _rxFilter[b];
+}
+
+uint8_t Mcp2515Emu::transfer(uint8_t mosi)
+{
+  if (!_selected) return 0xFF;
+  _stats.spiBytes++;
+  switch (_spiState)
+  {
+    case SPI_IDLE:
+      _spiState = SPI_DONE;
+      if (mosi == 0xC0)
+      {
+        bool selected = _selected;
+        _reset();
+        _selected = selected;
+        _spiState = SPI_DONE;
+      }
+      else if (mosi == 0x03) _spiState = SPI_READ_ADDR;
+      else if (mosi == 0x02) _spiState = SPI_WRITE_ADDR;
+      else if (mosi == 0x05) _spiState = SPI_MODIFY_ADDR;
+      else if (mosi == 0xA0)
+      {
+        _statusByte = _readStatus();
+        _spiState = SPI_STATUS;
+      }
+      else if (mosi == 0xB0)
+      {
+        _statusByte = _rxStatus();
+        _spiState = SPI_STATUS;
+      }
+      else if ((mosi & 0xF9) == 0x90)
+      {
+        // READ RX BUFFER: n selects RXB1, m starts at D0 instead of SIDH
+        bool n = (mosi & 0x04) != 0;
+        bool m = (mosi & 0x02) != 0;
+        _address = (n ? REG_RXB1CTRL : REG_RXB0CTRL) + (m ? 6 : 1);
+        _clearOnDeselect = n ? RX1IF : RX0IF;
+        _spiState = SPI_READ_DATA;
+      }
+      else if ((mosi & 0xF8) == 0x40 && (mosi & 0x07) < 6)
+      {
+        // LOAD TX BUFFER: abc = buffer * 2 + (start at D0)
+        uint8_t abc = mosi & 0x07;
+        _address = REG_TXB0CTRL + 0x10 * (abc >> 1) + ((abc & 1) ? 6 : 1);
+        _spiState = SPI_WRITE_DATA;
+      }
+      else if ((mosi & 0xF8) == 0x80)
+      {
+        for (int b = 0; b < 3; b++)
+        {
+          uint8_t address = REG_TXB0CTRL + 0x10 * b;
+          if (mosi & (1 << b)) _write(address, _regs[address] | TXREQ);
+        }
+      }
+      return 0xFF;
+    case SPI_READ_ADDR:
+      _address = mosi & 0x7F;
+      _spiState = SPI_READ_DATA;
+      return 0xFF;
+    case SPI_READ_DATA:
+    {
+      uint8_t value = _read(_address);
+      _address = (_address + 1) & 0x7F;
+      return value;
+    }
+    case SPI_WRITE_ADDR:
+      _address = mosi & 0x7F;
+      _spiState = SPI_WRITE_DATA;
+      return 0xFF;
+    case SPI_WRITE_DATA:
+      _write(_address, mosi);
+      _address = (_address + 1) & 0x7F;
+      return 0xFF;
+    case SPI_MODIFY_ADDR:
+      _address = mosi & 0x7F;
+      _spiState = SPI_MODIFY_MASK;
+      return 0xFF;
+    case SPI_MODIFY_MASK:
+      _modifyMask = mosi;
+      _spiState = SPI_MODIFY_DATA;
+      return 0xFF;
+    case SPI_MODIFY_DATA:
+      _modify(_address, _modifyMask, mosi);
+      _spiState = SPI_DONE;
+      return 0xFF;
+    case SPI_STATUS:
+      // the status byte repeats for as long as the clock runs
+      return _statusByte;
+    case SPI_DONE:
+      break;
+  }
+  return 0xFF;
+}
+
+// ---------------------------------------------------------------------------
+// Pins
+
+bool Mcp2515Emu::intPin() const
+{
+  return (_regs[REG_CANINTF] & _regs[REG_CANINTE]) == 0;
+}
+
+bool Mcp2515Emu::rx0bfPin() const
+{
+  uint8_t bfp = _regs[REG_BFPCTRL];
+  if (!(bfp & 0x04)) return true;                       // B0BFE: high impedance
+  if (bfp & 0x01) return !(_regs[REG_CANINTF] & RX0IF); // B0BFM: buffer full interrupt
+  return (bfp & 0x10) != 0;                             // B0BFS: digital output
+}
+
+bool Mcp2515Emu::rx1bfPin() const
+{
+  uint8_t bfp = _regs[REG_BFPCTRL];
+  if (!(bfp & 0x08)) return true;
+  if (bfp & 0x02) return !(_regs[REG_CANINTF] & RX1IF);
+  return (bfp & 0x20) != 0;
+}
@@ -0,0 +1,163 @@
+/*
+  Mcp2515Emu.h - Register level model of the Microchip MCP2515 CAN controller
+
+  The model sits behind the SPI shim (see Emu.h) and answers the full SPI
+  command set: RESET, READ, WRITE, BIT MODIFY, READ STATUS, RX STATUS,
+  READ RX BUFFER, LOAD TX BUFFER and RTS. Behaviour follows the data sheet
+  (DS21801):
+  - the register file with CANSTAT/CANCTRL mirrored at every xEh/xFh
+    address, registers writable in configuration mode only, read-only bits
+    and the bit modify whitelist;
+  - operating modes: configuration, normal, listen-only, loopback, sleep;
+  - the bit timing programmed in CNF1..3 against the bus bitrate: a frame
+    sent at another bitrate is not received and raises MERRF (and REC in
+    normal mode), which is what the autobaud search of the drivers looks at;
+  - acceptance: RXB0 (masks RXM0, filters RXF0/1) before RXB1 (RXM1,
+    RXF2..5), the RXM receive modes, filtering of the first two data bytes
+    of standard frames, BUKT rollover, FILHIT and the RX STATUS filter codes;
+  - RXnIF, RX0OVR/RX1OVR, ERRIF, MERRF and WAKIF in CANINTF/EFLG, TXnIF on
+    transmit completion, the INT pin and the RX0BF/RX1BF pins of BFPCTRL;
+  - READ RX BUFFER clearing RXnIF when CS goes high.
+
+  Time is counted in CPU cycles of the emulated Arduino (EMU_CPU_HZ). Bus
+  frames are injected with their start time and arrive in the receive
+  buffers at the end of the frame, one after the other at the programmed
+  bus bitrate. Transmission is modelled without arbitration: a requested
+  TX buffer goes out as soon as the bus is idle.
+*/
+
+#ifndef Mcp2515Emu_h
+#define Mcp2515Emu_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#include "../CanFrame.h"
+
+/*Clock of the emulated AVR; one unit of emulator time*/
+#define EMU_CPU_HZ  16000000UL
+
+struct Mcp2515Stats
+{
+  uint64_t busFrames;    // frames that finished on the bus
+  uint64_t received;     // stored in RXB0 or RXB1
+  uint64_t rolledOver;   // of those, moved to RXB1 by BUKT
+  uint64_t overflows;    // accepted but lost: both target buffers were full
+  uint64_t filtered;     // rejected by the masks and filters
+  uint64_t bitErrors;    // bus bitrate did not match CNF1..3 (MERRF)
+  uint64_t ignored;      // arrived in configuration, loopback or sleep mode
+  uint64_t readOut;      // RXnIF cleared by the MCU after reading the buffer, i.e. frames consumed
+  uint64_t discarded;    // RXnIF cleared before the buffer was read: the frame is lost
+  uint64_t transmitted;  // TX buffers sent
+  uint64_t spiBytes;
+  uint64_t spiCommands;  // CS low/high cycles
+};
+
+class Mcp2515Emu
+{
+  public:
+    /**oscHz is the crystal of the MCP2515 (CNF1..3 are interpreted against it)*/
+    Mcp2515Emu(uint32_t oscHz = 16000000UL);
+
+    /**Power-on reset, also drops the injected frames that did not arrive yet*/
+    void powerOn();
+    /**Bitrate of the traffic on the bus*/
+    void setBusBitrate(uint32_t bitrate);
+    uint32_t busBitrate() const { return _busBitrate; }
+    /**Bitrate programmed in CNF1..3, 0 if the setting is invalid*/
+    uint32_t configuredBitrate() const;
+
+    /**Queues a bus frame starting at startCycles (or when the bus becomes idle). Returns the cycle at which it ends*/
+    uint64_t inject(const CanFrame &frame, uint64_t startCycles);
+    /**Frames injected but not finished yet*/
+    size_t pending() const { return _arrivals.size(); }
+    /**Cycle at which the bus is idle again*/
+    uint64_t busIdleAt() const { return _busFreeAt; }
+
+    /**Processes everything that happened on the bus up to now*/
+    void advance(uint64_t now);
+    /**Cycle of the next bus event (arrival or end of a transmission), UINT64_MAX if none*/
+    uint64_t nextEvent() const;
+
+    // SPI slave side
+    void select();
+    void deselect();
+    uint8_t transfer(uint8_t mosi);
+
+    // Output pins, true = high (inactive)
+    bool intPin() const;
+    bool rx0bfPin() const;
+    bool rx1bfPin() const;
+
+    /**Register contents without the side effects of an SPI read*/
+    uint8_t peek(uint8_t address) const;
+    const Mcp2515Stats &stats() const { return _stats; }
+    void clearStats();
+    /**Frames sent from the TX buffers in normal mode*/
+    const std::vector<CanFrame> &transmittedFrames() const { return _txFrames; }
+
+  private:
+    struct Arrival
+    {
+      CanFrame frame;
+      uint64_t endCycles;
+    };
+
+    enum SpiState
+    {
+      SPI_IDLE, SPI_READ_ADDR, SPI_READ_DATA, SPI_WRITE_ADDR, SPI_WRITE_DATA,
+      SPI_MODIFY_ADDR, SPI_MODIFY_MASK, SPI_MODIFY_DATA, SPI_STATUS, SPI_DONE
+    };
+
+    void _reset();
+    uint8_t _mode() const { return _regs[0x0E] >> 5; }
+    uint8_t _read(uint8_t address);
+    void _write(uint8_t address, uint8_t value);
+    void _modify(uint8_t address, uint8_t mask, uint8_t value);
+    /**Counts the frames whose RXnIF the MCU cleared (cleared holds RX0IF/RX1IF)*/
+    void _releaseRx(uint8_t cleared);
+    void _setFlags(uint8_t canintf);
+    void _setErrorFlags(uint8_t eflg);
+    void _updateErrorCounters();
+    void _receive(const CanFrame &frame);
+    void _receiveAccepted(const CanFrame &frame);
+    bool _matches(const CanFrame &frame, uint8_t filter, uint8_t mask) const;
+    int _acceptRxb0(const CanFrame &frame) const;
+    int _acceptRxb1(const CanFrame &frame) const;
+    void _store(uint8_t buffer, const CanFrame &frame, uint8_t filterHit);
+    void _startTx(uint64_t now);
+    void _finishTx();
+    uint8_t _readStatus() const;
+    uint8_t _rxStatus() const;
+    uint64_t _bitCycles(unsigned bits) const;
+
+    uint32_t _oscHz;
+    uint32_t _busBitrate;
+    uint8_t _regs[128];
+    // RX STATUS filter code of each buffer (0..5, 6/7 = RXF0/RXF1 rolled over)
+    uint8_t _rxFilter[2];
+    bool _rxRead[2];       // SIDH..D7 of the buffer read since the frame arrived
+
+    std::deque<Arrival> _arrivals;
+    uint64_t _busFreeAt;
+    uint64_t _now;
+
+    int _txBuffer;        // being sent, -1 if none
+    uint64_t _txEnd;
+    CanFrame _txFrame;
+    std::vector<CanFrame> _txFrames;
+
+    bool _selected;
+    SpiState _spiState;
+    uint8_t _address;
+    uint8_t _modifyMask;
+    uint8_t _statusByte;
+    // READ RX BUFFER clears this RXnIF when CS goes high, 0 for none
+    uint8_t _clearOnDeselect;
+
+    Mcp2515Stats _stats;
+};
+
+#endif
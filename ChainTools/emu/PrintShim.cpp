@@ -0,0 +1,538 @@
+#include "Emu.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "shim/Arduino.h"
+
+HardwareSerial Serial;
+
+static FILE *_serialOut = nullptr;
+static bool _serialKeep = false;
+static std::string _serialCaptured;
+static int _printDepth = 0;
+
+EmuPrintCall::EmuPrintCall()
+{
+  if (_printDepth++ == 0) emuCount.printCalls++;
+}
+
+EmuPrintCall::~EmuPrintCall()
+{
+  _printDepth--;
+}
+
+// ---------------------------------------------------------------------------
+// Print
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  EmuPrintCall call;
+  size_t n = 0;
+  while (size--)
+  {
+    if (!write(*buffer++)) break;
+    n++;
+  }
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper *str)
+{
+  EmuPrintCall call;
+  return write(reinterpret_cast<const char *>(str));
+}
+
+size_t Print::print(const String &str)
+{
+  EmuPrintCall call;
+  return write(str.c_str(), str.length());
+}
+
+size_t Print::print(const char str[])
+{
+  EmuPrintCall call;
+  return write(str);
+}
+
+size_t Print::print(char c)
+{
+  EmuPrintCall call;
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char value, int base)
+{
+  EmuPrintCall call;
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(int value, int base)
+{
+  EmuPrintCall call;
+  return print((long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base)
+{
+  EmuPrintCall call;
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(long value, int base)
+{
+  EmuPrintCall call;
+  int32_t v = (int32_t)value;
+  if (base == 0) return write((uint8_t)v);
+  if (base == 10 && v < 0)
+  {
+    size_t n = print('-');
+    return n + _printNumber((uint32_t)0 - (uint32_t)v, 10);
+  }
+  return _printNumber((uint32_t)v, base);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+  EmuPrintCall call;
+  if (base == 0) return write((uint8_t)value);
+  return _printNumber((uint32_t)value, base);
+}
+
+size_t Print::print(double value, int digits)
+{
+  EmuPrintCall call;
+  return _printFloat(value, digits);
+}
+
+size_t Print::println(void)
+{
+  EmuPrintCall call;
+  return write("\r\n");
+}
+
+size_t Print::println(const __FlashStringHelper *str) { EmuPrintCall call; size_t n = print(str); return n + println(); }
+size_t Print::println(const String &str) { EmuPrintCall call; size_t n = print(str); return n + println(); }
+size_t Print::println(const char str[]) { EmuPrintCall call; size_t n = print(str); return n + println(); }
+size_t Print::println(char c) { EmuPrintCall call; size_t n = print(c); return n + println(); }
+size_t Print::println(unsigned char value, int base) { EmuPrintCall call; size_t n = print(value, base); return n + println(); }
+size_t Print::println(int value, int base) { EmuPrintCall call; size_t n = print(value, base); return n + println(); }
+size_t Print::println(unsigned int value, int base) { EmuPrintCall call; size_t n = print(value, base); return n + println(); }
+size_t Print::println(long value, int base) { EmuPrintCall call; size_t n = print(value, base); return n + println(); }
+size_t Print::println(unsigned long value, int base) { EmuPrintCall call; size_t n = print(value, base); return n + println(); }
+size_t Print::println(double value, int digits) { EmuPrintCall call; size_t n = print(value, digits); return n + println(); }
+
+size_t Print::_printNumber(uint32_t value, uint8_t base)
+{
+  char buf[33];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  unsigned digits = 0;
+  do
+  {
+    char c = value % base;
+    value /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    digits++;
+  } while (value);
+  emuSpend((uint64_t)digits * EMU_CYCLES_PRINT_DIGIT);
+  return write(str);
+}
+
+size_t Print::_printFloat(double value, uint8_t digits)
+{
+  if (isnan(value)) return print("nan");
+  if (isinf(value)) return print("inf");
+  if (value > 4294967040.0 || value < -4294967040.0) return print("ovf");
+
+  size_t n = 0;
+  if (value < 0.0)
+  {
+    n += print('-');
+    value = -value;
+  }
+  double rounding = 0.5;
+  for (uint8_t i = 0; i < digits; ++i) rounding /= 10.0;
+  value += rounding;
+
+  unsigned long intPart = (unsigned long)value;
+  double remainder = value - (double)intPart;
+  n += print(intPart);
+  if (digits > 0) n += print('.');
+  while (digits-- > 0)
+  {
+    remainder *= 10.0;
+    unsigned int toPrint = (unsigned int)remainder;
+    n += print(toPrint);
+    remainder -= toPrint;
+  }
+  return n;
+}
+
+// ---------------------------------------------------------------------------
+// String
+
+/**Number to text like itoa/ltoa/ultoa of avr-libc: signed only in base 10, lower case digits*/
+static std::string toText(uint32_t value, bool negative, unsigned char base)
+{
+  if (base < 2) base = 10;
+  char buf[34];
+  char *str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  do
+  {
+    char c = value % base;
+    value /= base;
+    *--str = c < 10 ? c + '0' : c + 'a' - 10;
+  } while (value);
+  if (negative) *--str = '-';
+  return str;
+}
+
+static std::string intText(int16_t value, unsigned char base)
+{
+  if (base == 10 && value < 0) return toText((uint32_t)(-(int32_t)value), true, 10);
+  return toText(base == 10 ? (uint32_t)value : (uint16_t)value, false, base);
+}
+
+static std::string longText(int32_t value, unsigned char base)
+{
+  if (base == 10 && value < 0) return toText((uint32_t)0 - (uint32_t)value, true, 10);
+  return toText((uint32_t)value, false, base);
+}
+
+static std::string floatText(double value, unsigned char decimalPlaces)
+{
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%*.*f", decimalPlaces + 2, decimalPlaces, value);
+  return buf;
+}
+
+void String::_changed(size_t chars)
+{
+  emuCount.stringOps++;
+  emuSpend(EMU_CYCLES_STRING_ALLOC + (uint64_t)chars * EMU_CYCLES_STRING_CHAR);
+}
+
+String::String(const char *cstr) : _s(cstr ? cstr : "") { _changed(_s.size()); }
+String::String(const String &str) : _s(str._s) { _changed(_s.size()); }
+String::String(const __FlashStringHelper *str) : _s(reinterpret_cast<const char *>(str)) { _changed(_s.size()); }
+String::String(char c) : _s(1, c) { _changed(1); }
+String::String(unsigned char value, unsigned char base) : _s(toText(value, false, base)) { _changed(_s.size()); }
+String::String(int value, unsigned char base) : _s(intText((int16_t)value, base)) { _changed(_s.size()); }
+String::String(unsigned int value, unsigned char base) : _s(toText((uint16_t)value, false, base)) { _changed(_s.size()); }
+String::String(long value, unsigned char base) : _s(longText((int32_t)value, base)) { _changed(_s.size()); }
+String::String(unsigned long value, unsigned char base) : _s(toText((uint32_t)value, false, base)) { _changed(_s.size()); }
+String::String(float value, unsigned char decimalPlaces) : _s(floatText(value, decimalPlaces)) { _changed(_s.size()); }
+String::String(double value, unsigned char decimalPlaces) : _s(floatText(value, decimalPlaces)) { _changed(_s.size()); }
+
+String &String::operator=(const String &rhs)
+{
+  if (this != &rhs)
+  {
+    _s = rhs._s;
+    _changed(_s.size());
+  }
+  return *this;
+}
+
+String &String::operator=(const char *cstr)
+{
+  _s = cstr ? cstr : "";
+  _changed(_s.size());
+  return *this;
+}
+
+unsigned char String::reserve(unsigned int size)
+{
+  if (size > _s.capacity())
+  {
+    _s.reserve(size);
+    _changed(0);
+  }
+  return 1;
+}
+
+unsigned char String::concat(const String &str)
+{
+  _s += str._s;
+  _changed(_s.size());
+  return 1;
+}
+
+unsigned char String::concat(const char *cstr)
+{
+  if (!cstr) return 0;
+  _s += cstr;
+  _changed(_s.size());
+  return 1;
+}
+
+unsigned char String::concat(char c)
+{
+  _s += c;
+  _changed(_s.size());
+  return 1;
+}
+
+unsigned char String::concat(unsigned char num) { return concat(toText(num, false, 10).c_str()); }
+unsigned char String::concat(int num) { return concat(intText((int16_t)num, 10).c_str()); }
+unsigned char String::concat(unsigned int num) { return concat(toText((uint16_t)num, false, 10).c_str()); }
+unsigned char String::concat(long num) { return concat(longText((int32_t)num, 10).c_str()); }
+unsigned char String::concat(unsigned long num) { return concat(toText((uint32_t)num, false, 10).c_str()); }
+unsigned char String::concat(float num) { return concat(floatText(num, 2).c_str()); }
+unsigned char String::concat(double num) { return concat(floatText(num, 2).c_str()); }
+unsigned char String::concat(const __FlashStringHelper *str) { return concat(reinterpret_cast<const char *>(str)); }
+
+int String::compareTo(const String &s) const
+{
+  return strcmp(_s.c_str(), s._s.c_str());
+}
+
+unsigned char String::equals(const String &s) const
+{
+  return _s == s._s;
+}
+
+unsigned char String::equals(const char *cstr) const
+{
+  return _s == (cstr ? cstr : "");
+}
+
+unsigned char String::equalsIgnoreCase(const String &s) const
+{
+  if (_s.size() != s._s.size()) return 0;
+  for (size_t i = 0; i < _s.size(); i++)
+  {
+    if (tolower((unsigned char)_s[i]) != tolower((unsigned char)s._s[i])) return 0;
+  }
+  return 1;
+}
+
+unsigned char String::startsWith(const String &prefix) const
+{
+  return _s.compare(0, prefix._s.size(), prefix._s) == 0 && _s.size() >= prefix._s.size();
+}
+
+unsigned char String::endsWith(const String &suffix) const
+{
+  return _s.size() >= suffix._s.size() && _s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s) == 0;
+}
+
+char String::charAt(unsigned int index) const
+{
+  return index < _s.size() ? _s[index] : 0;
+}
+
+void String::setCharAt(unsigned int index, char c)
+{
+  if (index < _s.size()) _s[index] = c;
+}
+
+char &String::operator[](unsigned int index)
+{
+  static char dummy;
+  if (index >= _s.size())
+  {
+    dummy = 0;
+    return dummy;
+  }
+  return _s[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const
+{
+  if (!bufsize || !buf) return;
+  if (index >= _s.size())
+  {
+    buf[0] = 0;
+    return;
+  }
+  size_t n = _s.size() - index;
+  if (n > bufsize - 1) n = bufsize - 1;
+  memcpy(buf, _s.data() + index, n);
+  buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const
+{
+  size_t pos = _s.find(ch, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const
+{
+  size_t pos = _s.find(str._s, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch) const
+{
+  size_t pos = _s.rfind(ch);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String &str) const
+{
+  size_t pos = _s.rfind(str._s);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex) const
+{
+  return substring(beginIndex, length());
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+  if (beginIndex > endIndex)
+  {
+    unsigned int t = beginIndex;
+    beginIndex = endIndex;
+    endIndex = t;
+  }
+  if (beginIndex >= _s.size()) return String();
+  if (endIndex > _s.size()) endIndex = length();
+  return String(_s.substr(beginIndex, endIndex - beginIndex).c_str());
+}
+
+void String::replace(char find, char replace)
+{
+  for (char &c : _s)
+  {
+    if (c == find) c = replace;
+  }
+}
+
+void String::replace(const String &find, const String &replace)
+{
+  if (find._s.empty()) return;
+  size_t pos = 0;
+  while ((pos = _s.find(find._s, pos)) != std::string::npos)
+  {
+    _s.replace(pos, find._s.size(), replace._s);
+    pos += replace._s.size();
+  }
+  _changed(_s.size());
+}
+
+void String::remove(unsigned int index)
+{
+  remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+  if (index >= _s.size()) return;
+  _s.erase(index, count);
+  _changed(_s.size());
+}
+
+void String::toLowerCase()
+{
+  for (char &c : _s) c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase()
+{
+  for (char &c : _s) c = toupper((unsigned char)c);
+}
+
+void String::trim()
+{
+  size_t begin = 0;
+  while (begin < _s.size() && isspace((unsigned char)_s[begin])) begin++;
+  size_t end = _s.size();
+  while (end > begin && isspace((unsigned char)_s[end - 1])) end--;
+  _s = _s.substr(begin, end - begin);
+}
+
+long String::toInt() const
+{
+  return atol(_s.c_str());
+}
+
+float String::toFloat() const
+{
+  return (float)atof(_s.c_str());
+}
+
+// ---------------------------------------------------------------------------
+// HardwareSerial
+
+void HardwareSerial::begin(unsigned long baud, uint8_t config)
+{
+  (void)config;
+  // start bit, 8 data bits, stop bit
+  _byteCycles = baud ? (uint32_t)((10ULL * F_CPU + baud / 2) / baud) : 0;
+  _lineFreeAt = emuNow();
+}
+
+void HardwareSerial::end()
+{
+  flush();
+  _byteCycles = 0;
+}
+
+unsigned int HardwareSerial::_backlog()
+{
+  uint64_t now = emuNow();
+  if (!_byteCycles || _lineFreeAt <= now) return 0;
+  return (unsigned int)((_lineFreeAt - now + _byteCycles - 1) / _byteCycles);
+}
+
+int HardwareSerial::availableForWrite()
+{
+  // one character sits in the shift register, the rest in the ring buffer
+  unsigned int backlog = _backlog();
+  unsigned int queued = backlog ? backlog - 1 : 0;
+  return queued >= SERIAL_TX_BUFFER_SIZE - 1 ? 0 : SERIAL_TX_BUFFER_SIZE - 1 - queued;
+}
+
+void HardwareSerial::flush()
+{
+  emuWaitUntil(_lineFreeAt);
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  EmuPrintCall call;
+  if (_byteCycles)
+  {
+    // full buffer: write() spins until the UDRE interrupt made room
+    uint64_t room = (uint64_t)(SERIAL_TX_BUFFER_SIZE - 1) * _byteCycles;
+    if (_lineFreeAt > emuNow() + room) emuWaitUntil(_lineFreeAt - room);
+    uint64_t now = emuNow();
+    _lineFreeAt = (_lineFreeAt > now ? _lineFreeAt : now) + _byteCycles;
+  }
+  emuCount.serialBytes++;
+  if (_serialOut) fputc(c, _serialOut);
+  if (_serialKeep) _serialCaptured += (char)c;
+  emuSpend(EMU_CYCLES_UART_BYTE);
+  return 1;
+}
+
+void HardwareSerial::emuReset()
+{
+  _byteCycles = 0;
+  _lineFreeAt = 0;
+  _serialCaptured.clear();
+}
+
+void emuSerialOutput(FILE *out)
+{
+  _serialOut = out;
+}
+
+void emuSerialCapture(bool keep)
+{
+  _serialKeep = keep;
+  if (!keep) _serialCaptured.clear();
+}
+
+const std::string &emuSerialCaptured()
+{
+  return _serialCaptured;
+}
@@ -0,0 +1,300 @@
+#include "Emu.h"
+
+#include <ctype.h>
+#include <map>
+
+#include "shim/EEPROM.h"
+#include "shim/SD.h"
+
+SDClass SD;
+EEPROMClass EEPROM;
+
+#define SD_BLOCK_SIZE    512
+#define SD_CLUSTER_SIZE  32768  // FAT16 clusters on the 1..2 GB cards used with the loggers
+#define SD_O_WRITE       0x02
+#define SD_O_CREAT       0x10
+
+struct EmuSdNode
+{
+  std::string data;
+  bool directory = false;
+};
+
+/*Function-local statics, so sketches can open files from static constructors*/
+static std::map<std::string, std::shared_ptr<EmuSdNode>> &sdCard()
+{
+  static std::map<std::string, std::shared_ptr<EmuSdNode>> card;
+  return card;
+}
+
+static bool &sdPresent()
+{
+  static bool present = true;
+  return present;
+}
+
+/**8.3 names on FAT are case-insensitive: upper case, no leading slash*/
+static std::string sdName(const char *path)
+{
+  std::string name;
+  if (!path) return name;
+  while (*path == '/') path++;
+  for (; *path; path++) name += (char)toupper((unsigned char)*path);
+  return name;
+}
+
+static void sdBlocks(uint64_t blocks)
+{
+  emuCount.sdBlocks += blocks;
+  emuSpend(blocks * EMU_CYCLES_SD_BLOCK);
+}
+
+// ---------------------------------------------------------------------------
+// File
+
+File::File() : _mode(0), _position(0), _dirty(false)
+{
+}
+
+File::File(std::shared_ptr<EmuSdNode> node, const char *name, uint8_t mode)
+    : _node(node), _name(name), _mode(mode), _position(0), _dirty(false)
+{
+  // FILE_WRITE appends
+  if (_node && (mode & SD_O_WRITE)) _position = (uint32_t)_node->data.size();
+}
+
+size_t File::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buf, size_t size)
+{
+  EmuPrintCall call;
+  if (!_node || !(_mode & SD_O_WRITE) || !size) return 0;
+  std::string &data = _node->data;
+  if (_position > data.size()) data.resize(_position);
+  size_t overlap = data.size() - _position < size ? data.size() - _position : size;
+  data.replace(_position, overlap, (const char *)buf, size);
+
+  uint32_t end = _position + (uint32_t)size;
+  // a block goes to the card when the cache moves on to the next one, a new cluster also updates both FATs
+  uint64_t blocks = end / SD_BLOCK_SIZE - _position / SD_BLOCK_SIZE;
+  blocks += 2 * (end / SD_CLUSTER_SIZE - _position / SD_CLUSTER_SIZE);
+  _position = end;
+  _dirty = _position % SD_BLOCK_SIZE != 0;
+
+  emuCount.sdBytes += size;
+  emuSpend((uint64_t)size * EMU_CYCLES_SD_BYTE);
+  if (blocks) sdBlocks(blocks);
+  return size;
+}
+
+int File::read()
+{
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int File::peek()
+{
+  if (!_node || _position >= _node->data.size()) return -1;
+  return (uint8_t)_node->data[_position];
+}
+
+int File::available()
+{
+  if (!_node || _position >= _node->data.size()) return 0;
+  uint32_t n = (uint32_t)_node->data.size() - _position;
+  return n > 0x7FFF ? 0x7FFF : (int)n;
+}
+
+void File::flush()
+{
+  if (!_node || !_dirty) return;
+  // the partial data block and the directory entry with the new size
+  _dirty = false;
+  sdBlocks(2);
+}
+
+int File::read(void *buf, uint16_t nbyte)
+{
+  if (!_node || !(_mode & FILE_READ)) return -1;
+  const std::string &data = _node->data;
+  if (_position >= data.size()) return 0;
+  uint32_t n = (uint32_t)data.size() - _position;
+  if (n > nbyte) n = nbyte;
+  memcpy(buf, data.data() + _position, n);
+  uint32_t blocks = (_position + n) / SD_BLOCK_SIZE - _position / SD_BLOCK_SIZE;
+  _position += n;
+  emuSpend((uint64_t)n * EMU_CYCLES_SD_BYTE + (uint64_t)blocks * EMU_CYCLES_SD_BLOCK / 2);
+  return (int)n;
+}
+
+bool File::seek(uint32_t pos)
+{
+  if (!_node || pos > _node->data.size()) return false;
+  _position = pos;
+  return true;
+}
+
+uint32_t File::position()
+{
+  return _position;
+}
+
+uint32_t File::size()
+{
+  return _node ? (uint32_t)_node->data.size() : 0;
+}
+
+void File::close()
+{
+  flush();
+  _node.reset();
+}
+
+// ---------------------------------------------------------------------------
+// SDClass
+
+bool SDClass::begin(uint8_t csPin)
+{
+  (void)csPin;
+  emuSpend(EMU_CYCLES_SD_INIT);
+  return sdPresent();
+}
+
+File SDClass::open(const char *filename, uint8_t mode)
+{
+  std::string name = sdName(filename);
+  emuSpend(EMU_CYCLES_SD_BLOCK / 2);
+  if (!sdPresent() || name.empty()) return File();
+  std::map<std::string, std::shared_ptr<EmuSdNode>> &card = sdCard();
+  std::map<std::string, std::shared_ptr<EmuSdNode>>::iterator it = card.find(name);
+  if (it == card.end())
+  {
+    if (!(mode & SD_O_CREAT)) return File();
+    it = card.emplace(name, std::make_shared<EmuSdNode>()).first;
+    // new directory entry
+    sdBlocks(1);
+  }
+  if (it->second->directory) return File();
+  size_t slash = name.rfind('/');
+  return File(it->second, name.c_str() + (slash == std::string::npos ? 0 : slash + 1), mode);
+}
+
+bool SDClass::exists(const char *filepath)
+{
+  emuSpend(EMU_CYCLES_SD_BLOCK / 2);
+  return sdPresent() && sdCard().count(sdName(filepath)) != 0;
+}
+
+bool SDClass::mkdir(const char *filepath)
+{
+  std::string name = sdName(filepath);
+  if (!sdPresent() || name.empty()) return false;
+  std::shared_ptr<EmuSdNode> &node = sdCard()[name];
+  if (!node)
+  {
+    node = std::make_shared<EmuSdNode>();
+    node->directory = true;
+    sdBlocks(2);
+  }
+  return node->directory;
+}
+
+bool SDClass::remove(const char *filepath)
+{
+  std::map<std::string, std::shared_ptr<EmuSdNode>>::iterator it = sdCard().find(sdName(filepath));
+  if (!sdPresent() || it == sdCard().end() || it->second->directory) return false;
+  sdCard().erase(it);
+  sdBlocks(1);
+  return true;
+}
+
+bool SDClass::rmdir(const char *filepath)
+{
+  std::map<std::string, std::shared_ptr<EmuSdNode>>::iterator it = sdCard().find(sdName(filepath));
+  if (!sdPresent() || it == sdCard().end() || !it->second->directory) return false;
+  sdCard().erase(it);
+  sdBlocks(1);
+  return true;
+}
+
+const std::string *emuSdFile(const char *name)
+{
+  std::map<std::string, std::shared_ptr<EmuSdNode>>::iterator it = sdCard().find(sdName(name));
+  if (it == sdCard().end() || it->second->directory) return nullptr;
+  return &it->second->data;
+}
+
+void emuSdForEach(void (*fn)(const std::string &name, const std::string &data, void *arg), void *arg)
+{
+  for (const auto &entry : sdCard())
+  {
+    if (!entry.second->directory) fn(entry.first, entry.second->data, arg);
+  }
+}
+
+void emuSdClear()
+{
+  sdCard().clear();
+}
+
+void emuSdPresent(bool present)
+{
+  sdPresent() = present;
+}
+
+// ---------------------------------------------------------------------------
+// EEPROM
+
+static uint8_t *eepromCells()
+{
+  static uint8_t cells[EMU_EEPROM_SIZE];
+  static bool erased = false;
+  if (!erased)
+  {
+    memset(cells, 0xFF, sizeof(cells));
+    erased = true;
+  }
+  return cells;
+}
+
+/*End of the programming cycle of the last write*/
+static uint64_t _eepromBusyUntil = 0;
+
+static void eepromWaitReady()
+{
+  // a write from before the last board reset is long done
+  if (_eepromBusyUntil > emuNow() + EMU_CYCLES_EEPROM_WRITE) _eepromBusyUntil = 0;
+  emuWaitUntil(_eepromBusyUntil);
+}
+
+uint8_t EEPROMClass::read(int idx)
+{
+  // EECR.EEPE must be clear before the EEPROM can be read
+  eepromWaitReady();
+  emuSpend(EMU_CYCLES_PORT_ACCESS * 4);
+  return eepromCells()[idx & (EMU_EEPROM_SIZE - 1)];
+}
+
+void EEPROMClass::write(int idx, uint8_t val)
+{
+  eepromWaitReady();
+  eepromCells()[idx & (EMU_EEPROM_SIZE - 1)] = val;
+  emuCount.eepromWrites++;
+  emuSpend(EMU_CYCLES_PORT_ACCESS * 8);
+  _eepromBusyUntil = emuNow() + EMU_CYCLES_EEPROM_WRITE;
+}
+
+void EEPROMClass::update(int idx, uint8_t val)
+{
+  if (read(idx) != val) write(idx, val);
+}
+
+void emuEepromClear()
+{
+  memset(eepromCells(), 0xFF, EMU_EEPROM_SIZE);
+  _eepromBusyUntil = 0;
+}
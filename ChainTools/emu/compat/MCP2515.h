@@ -0,0 +1,13 @@
+/*
+  MCP2515.h - Wrapper for the sketches written against the older Harding library header
+
+  The current header defines DEBUG, SD_CHIP_SELECT and LIGHT_CAN as macros,
+  while the older sketches declare them as variables (boolean DEBUG = true;
+  const int SD_CHIP_SELECT = 9; ...) and cannot be compiled against it. Put
+  this folder in front of the library on the include path for those sketches.
+*/
+
+#include_next <MCP2515.h>
+#undef DEBUG
+#undef SD_CHIP_SELECT
+#undef LIGHT_CAN
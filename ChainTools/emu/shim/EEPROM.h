@@ -0,0 +1,40 @@
+/*
+  EEPROM.h - Host shim of the Arduino EEPROM library (4 KB, ATmega2560)
+
+  A write charges the programming time of the previous write if that one
+  is still running, like eeprom_write_byte() busy waiting on EEPE.
+*/
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include "Arduino.h"
+
+#define EMU_EEPROM_SIZE 4096
+
+class EEPROMClass
+{
+  public:
+    uint8_t read(int idx);
+    void write(int idx, uint8_t val);
+    void update(int idx, uint8_t val);
+    uint16_t length() { return EMU_EEPROM_SIZE; }
+
+    template<typename T> T &get(int idx, T &t)
+    {
+      uint8_t *ptr = (uint8_t *)&t;
+      for (size_t i = 0; i < sizeof(T); i++) ptr[i] = read(idx + (int)i);
+      return t;
+    }
+
+    template<typename T> const T &put(int idx, const T &t)
+    {
+      const uint8_t *ptr = (const uint8_t *)&t;
+      for (size_t i = 0; i < sizeof(T); i++) update(idx + (int)i, ptr[i]);
+      return t;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
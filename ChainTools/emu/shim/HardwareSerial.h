@@ -0,0 +1,46 @@
+/*
+  HardwareSerial.h - Host shim of the AVR UART driver
+
+  The 64 byte transmit buffer drains at the configured baud rate on the
+  board clock, so a sketch that prints faster than the line blocks exactly
+  as it does on the target. Receiving is not modelled (nothing arrives).
+*/
+
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include <stdint.h>
+
+#include "Stream.h"
+
+#define SERIAL_TX_BUFFER_SIZE 64
+#define SERIAL_8N1 0x06
+
+class HardwareSerial : public Stream
+{
+  public:
+    void begin(unsigned long baud) { begin(baud, SERIAL_8N1); }
+    void begin(unsigned long baud, uint8_t config);
+    void end();
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    int availableForWrite() override;
+    void flush() override;
+    size_t write(uint8_t c) override;
+    using Print::write;
+    operator bool() { return true; }
+
+    /**Back to the power-on state, used by the board reset*/
+    void emuReset();
+
+  private:
+    unsigned int _backlog();
+
+    uint32_t _byteCycles = 0;   // one character on the line, 0 before begin()
+    uint64_t _lineFreeAt = 0;   // cycle at which the last queued character is out
+};
+
+extern HardwareSerial Serial;
+
+#endif
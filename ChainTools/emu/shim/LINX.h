@@ -0,0 +1,13 @@
+/*
+  LINX.h - Host stub of the LabVIEW LINX firmware used by ChainLogger_no_S_mega
+
+  The LabVIEW link is not emulated; setupLINX() does nothing and
+  LINX_SERIAL_INTERFACE_ENABLED stays undefined.
+*/
+
+#ifndef LINX_h
+#define LINX_h
+
+inline void setupLINX(void) {}
+
+#endif
@@ -0,0 +1,3 @@
+/*
+  LINX_Config.h - Host stub, see LINX.h
+*/
@@ -0,0 +1,3 @@
+/*
+  LINX_Devices.h - Host stub, see LINX.h
+*/
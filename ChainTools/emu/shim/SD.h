@@ -0,0 +1,74 @@
+/*
+  SD.h - Host shim of the Arduino SD library, card contents in memory
+
+  Writes are charged per byte (copy into the block cache) and per 512 byte
+  block that reaches the card; flush() writes the partial block and the
+  directory entry, open() and exists() read the directory.
+*/
+
+#ifndef __SD_H__
+#define __SD_H__
+
+#include <memory>
+#include <string>
+
+#include "Arduino.h"
+
+#define FILE_READ  0x01
+#define FILE_WRITE 0x13
+
+#define SD_CHIP_SELECT_PIN 10
+
+struct EmuSdNode;
+
+class File : public Stream
+{
+  public:
+    File();
+    File(std::shared_ptr<EmuSdNode> node, const char *name, uint8_t mode);
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    using Print::write;
+    int availableForWrite() override { return 512; }
+    int read() override;
+    int peek() override;
+    int available() override;
+    void flush() override;
+    int read(void *buf, uint16_t nbyte);
+    bool seek(uint32_t pos);
+    uint32_t position();
+    uint32_t size();
+    void close();
+    operator bool() const { return _node != nullptr; }
+    const char *name() { return _name.c_str(); }
+    bool isDirectory() { return false; }
+    File openNextFile(uint8_t mode = FILE_READ) { (void)mode; return File(); }
+    void rewindDirectory() {}
+
+  private:
+    std::shared_ptr<EmuSdNode> _node;
+    std::string _name;
+    uint8_t _mode;
+    uint32_t _position;
+    bool _dirty;
+};
+
+class SDClass
+{
+  public:
+    bool begin(uint8_t csPin = SD_CHIP_SELECT_PIN);
+    bool begin(uint32_t clock, uint8_t csPin) { (void)clock; return begin(csPin); }
+    void end() {}
+    File open(const char *filename, uint8_t mode = FILE_READ);
+    File open(const String &filename, uint8_t mode = FILE_READ) { return open(filename.c_str(), mode); }
+    bool exists(const char *filepath);
+    bool exists(const String &filepath) { return exists(filepath.c_str()); }
+    bool mkdir(const char *filepath);
+    bool remove(const char *filepath);
+    bool rmdir(const char *filepath);
+};
+
+extern SDClass SD;
+
+#endif
@@ -0,0 +1,59 @@
+/*
+  SPI.h - Host shim of the Arduino SPI library
+
+  Bytes go to the MCP2515 model while its CS pin is low. Each transfer
+  charges 8 SPI clocks at the divider programmed in SPCR/SPSR (default
+  fosc/4) plus the call.
+*/
+
+#ifndef _SPI_H_INCLUDED
+#define _SPI_H_INCLUDED
+
+#include "Arduino.h"
+
+#define SPI_CLOCK_DIV4   0x00
+#define SPI_CLOCK_DIV16  0x01
+#define SPI_CLOCK_DIV64  0x02
+#define SPI_CLOCK_DIV128 0x03
+#define SPI_CLOCK_DIV2   0x04
+#define SPI_CLOCK_DIV8   0x05
+#define SPI_CLOCK_DIV32  0x06
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+class SPISettings
+{
+  public:
+    SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode);
+    SPISettings() : SPISettings(4000000, MSBFIRST, SPI_MODE0) {}
+
+  private:
+    uint8_t _divider;   // SPI_CLOCK_DIVn
+    friend class SPIClass;
+};
+
+class SPIClass
+{
+  public:
+    static void begin();
+    static void end();
+    static void beginTransaction(SPISettings settings);
+    static void endTransaction() {}
+    static void usingInterrupt(uint8_t) {}
+    static void notUsingInterrupt(uint8_t) {}
+    static uint8_t transfer(uint8_t data);
+    static uint16_t transfer16(uint16_t data);
+    static void transfer(void *buf, size_t count);
+    static void setBitOrder(uint8_t bitOrder);
+    static void setDataMode(uint8_t dataMode);
+    static void setClockDivider(uint8_t clockDiv);
+    static void attachInterrupt() {}
+    static void detachInterrupt() {}
+};
+
+extern SPIClass SPI;
+
+#endif
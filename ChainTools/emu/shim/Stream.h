@@ -0,0 +1,18 @@
+/*
+  Stream.h - Host shim of the Arduino Stream class (input side of Print)
+*/
+
+#ifndef Stream_h
+#define Stream_h
+
+#include "Print.h"
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+#endif
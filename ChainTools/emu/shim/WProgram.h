@@ -0,0 +1,5 @@
+/*
+  WProgram.h - Pre 1.0 name of Arduino.h
+*/
+
+#include "Arduino.h"
@@ -0,0 +1,22 @@
+/*
+  avr/interrupt.h - Host shim: global interrupt flag and ISR()
+
+  ISR(vector) defines emuIsr_<vector>(); the board calls the ones it models
+  (ADC_vect) when their trigger fires and SREG.I is set.
+*/
+
+#ifndef _AVR_INTERRUPT_H_
+#define _AVR_INTERRUPT_H_
+
+#include "io.h"
+
+#define sei() (emuAvr.sreg |= 0x80)
+#define cli() (emuAvr.sreg &= (uint8_t)~0x80)
+
+#ifdef __cplusplus
+#define ISR(vector, ...) extern "C" void emuIsr_##vector(void); extern "C" void emuIsr_##vector(void)
+#else
+#define ISR(vector, ...) void emuIsr_##vector(void); void emuIsr_##vector(void)
+#endif
+
+#endif
@@ -0,0 +1,187 @@
+/*
+  avr/io.h - Host shim of the AVR I/O registers, see ../../Emu.h
+
+  SPI, ports and pin registers go through accessor functions so the board
+  sees every access: a write to SPDR is shifted out when SPSR is polled for
+  SPIF (the loop every AVR SPI routine runs), port writes reach the pins
+  (and the CS line of the MCP2515) at the next register access. Pins of
+  PORTB/PORTC/PORTD map to Arduino pins 8-13, 14-19 (A0-A5 of the Uno) and
+  0-7 as on the ATmega328P. Timer1 and the ADC are plain registers read by
+  the Timer1 compare B -> ADC auto trigger model of the board.
+*/
+
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct EmuAvrRegs
+{
+  uint8_t sreg;
+  uint8_t spcr;
+  uint8_t admux;
+  uint8_t adcsra;
+  uint8_t adcsrb;
+  uint8_t tccr1a;
+  uint8_t tccr1b;
+  uint8_t tccr1c;
+  uint8_t timsk1;
+  uint8_t tifr1;
+  uint8_t eicra;
+  uint8_t eicrb;
+  uint8_t eimsk;
+  uint8_t eifr;
+  uint16_t adc;
+  uint16_t tcnt1;
+  uint16_t ocr1a;
+  uint16_t ocr1b;
+  uint16_t ocr1c;
+  uint16_t icr1;
+};
+
+extern volatile struct EmuAvrRegs emuAvr;
+
+volatile uint8_t *emuSpdr(void);
+volatile uint8_t *emuSpsr(void);
+/*port: 'B', 'C' or 'D'*/
+volatile uint8_t *emuPort(char port);
+volatile uint8_t *emuPin(char port);
+volatile uint8_t *emuDdr(char port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(sfr, bit) ((sfr) & _BV(bit))
+#define bit_is_clear(sfr, bit) (!((sfr) & _BV(bit)))
+#define loop_until_bit_is_set(sfr, bit) do { } while (bit_is_clear(sfr, bit))
+#define loop_until_bit_is_clear(sfr, bit) do { } while (bit_is_set(sfr, bit))
+
+#define SREG    emuAvr.sreg
+#define SREG_I  7
+
+/* SPI */
+#define SPCR  emuAvr.spcr
+#define SPSR  (*emuSpsr())
+#define SPDR  (*emuSpdr())
+#define SPIE  7
+#define SPE   6
+#define DORD  5
+#define MSTR  4
+#define CPOL  3
+#define CPHA  2
+#define SPR1  1
+#define SPR0  0
+#define SPIF  7
+#define WCOL  6
+#define SPI2X 0
+
+/* Ports */
+#define PORTB (*emuPort('B'))
+#define PORTC (*emuPort('C'))
+#define PORTD (*emuPort('D'))
+#define PINB  (*emuPin('B'))
+#define PINC  (*emuPin('C'))
+#define PIND  (*emuPin('D'))
+#define DDRB  (*emuDdr('B'))
+#define DDRC  (*emuDdr('C'))
+#define DDRD  (*emuDdr('D'))
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+/* ADC */
+#define ADMUX   emuAvr.admux
+#define ADCSRA  emuAvr.adcsra
+#define ADCSRB  emuAvr.adcsrb
+#define ADC     emuAvr.adc
+#define ADCW    emuAvr.adc
+#define REFS1 7
+#define REFS0 6
+#define ADLAR 5
+#define MUX4  4
+#define MUX3  3
+#define MUX2  2
+#define MUX1  1
+#define MUX0  0
+#define ADEN  7
+#define ADSC  6
+#define ADATE 5
+#define ADIF  4
+#define ADIE  3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+#define ACME  6
+#define MUX5  3
+#define ADTS2 2
+#define ADTS1 1
+#define ADTS0 0
+
+/* Timer1 */
+#define TCCR1A  emuAvr.tccr1a
+#define TCCR1B  emuAvr.tccr1b
+#define TCCR1C  emuAvr.tccr1c
+#define TCNT1   emuAvr.tcnt1
+#define OCR1A   emuAvr.ocr1a
+#define OCR1B   emuAvr.ocr1b
+#define OCR1C   emuAvr.ocr1c
+#define ICR1    emuAvr.icr1
+#define TIMSK1  emuAvr.timsk1
+#define TIFR1   emuAvr.tifr1
+#define COM1A1 7
+#define COM1A0 6
+#define COM1B1 5
+#define COM1B0 4
+#define WGM11  1
+#define WGM10  0
+#define ICNC1  7
+#define ICES1  6
+#define WGM13  4
+#define WGM12  3
+#define CS12   2
+#define CS11   1
+#define CS10   0
+#define ICIE1  5
+#define OCIE1C 3
+#define OCIE1B 2
+#define OCIE1A 1
+#define TOIE1  0
+#define ICF1   5
+#define OCF1C  3
+#define OCF1B  2
+#define OCF1A  1
+#define TOV1   0
+
+/* External interrupts */
+#define EICRA  emuAvr.eicra
+#define EICRB  emuAvr.eicrb
+#define EIMSK  emuAvr.eimsk
+#define EIFR   emuAvr.eifr
+
+#endif
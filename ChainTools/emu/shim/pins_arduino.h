@@ -0,0 +1,3 @@
+/*
+  pins_arduino.h - Host shim, the pin tables live in ../ArduinoShim.cpp
+*/
@@ -0,0 +1,25 @@
+/*
+  util/delay.h - Host shim: the busy loops charge their cycles to the board clock
+*/
+
+#ifndef _UTIL_DELAY_H_
+#define _UTIL_DELAY_H_
+
+#include <stdint.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void emuDelayCycles(uint32_t cycles);
+#ifdef __cplusplus
+}
+#endif
+
+#define _delay_us(us) emuDelayCycles((uint32_t)((us) * (F_CPU / 1000000.0)))
+#define _delay_ms(ms) emuDelayCycles((uint32_t)((ms) * (F_CPU / 1000.0)))
+
+#endif
@@ -0,0 +1,27 @@
+/*
+  ChainLogger.cpp - ChainLogger.ino on the emulated board
+
+  preparaSD() opens its File into a local variable, so the global dataFile
+  stays closed and processMessage() writes nothing (as on the board). Frames
+  read out of the MCP2515 are what is counted.
+*/
+
+#include "../EmuSketch.h"
+
+#include <Arduino.h>
+#include <MCP2515.h>
+
+// Prototypes the Arduino IDE generates for the sketch
+boolean initCAN(void);
+void setCanStatus();
+boolean initSD(void);
+void initSPI(void);
+void displayCanStatus(void);
+unsigned long getTimeDifference();
+boolean hasTimeElapsed(unsigned long start_time, unsigned long wait_time);
+void processMessage(Frame &message);
+void preparaSD(void);
+
+#include "../../../ChainLogger/ChainLogger.ino"
+
+const EmuSketch emuSketch = { "ChainLogger", 10, 2, -1, -1, EMU_OUT_CHIP };
@@ -0,0 +1,25 @@
+/*
+  ChainLogger_no_S.cpp - ChainLogger_no_S.ino on the emulated board
+
+  One SD line per frame, flushed after every frame.
+*/
+
+#include "../EmuSketch.h"
+
+#include <Arduino.h>
+#include <MCP2515.h>
+
+// Prototypes the Arduino IDE generates for the sketch
+boolean initCAN(void);
+void setCanStatus();
+boolean initSD(void);
+void initSPI(void);
+void displayCanStatus(void);
+unsigned long getTimeDifference();
+boolean hasTimeElapsed(unsigned long start_time, unsigned long wait_time);
+void processMessage(Frame &message);
+void preparaSD(void);
+
+#include "../../../ChainLogger_no_S/ChainLogger_no_S.ino"
+
+const EmuSketch emuSketch = { "ChainLogger_no_S", 10, 2, -1, -1, EMU_OUT_SD };
@@ -0,0 +1,27 @@
+/*
+  ChainLogger_no_S_mega.cpp - ChainLogger_no_S_mega.ino on the emulated board
+
+  LINX is stubbed out (shim/LINX.h). can_STV.cpp is left out: it has no
+  includes of its own and duplicates setCanStatus() of the sketch.
+*/
+
+#include "../EmuSketch.h"
+
+#include <Arduino.h>
+#include <MCP2515.h>
+
+// Prototypes the Arduino IDE generates for the sketch
+boolean initCAN(void);
+void setCanStatus();
+boolean initSD(void);
+void initSPI(void);
+void displayCanStatus(void);
+unsigned long getTimeDifference();
+boolean hasTimeElapsed(unsigned long start_time, unsigned long wait_time);
+void processMessage(Frame &message);
+void preparaSD(void);
+void print_hex(int v, int num_places);
+
+#include "../../../ChainLogger_no_S_mega/ChainLogger_no_S_mega.ino"
+
+const EmuSketch emuSketch = { "ChainLogger_no_S_mega", 53, 2, -1, -1, EMU_OUT_SD };
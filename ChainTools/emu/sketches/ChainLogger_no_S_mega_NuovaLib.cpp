@@ -0,0 +1,45 @@
+/*
+  ChainLogger_no_S_mega_NuovaLib.cpp - ChainLogger_no_S_mega_NuovaLib.ino on the emulated board
+
+  The emulated board has RX0BF/RX1BF wired to pins 3 and 18, so buffer full
+  capture mode is turned on (BUFFER_FULL_PINS_WIRED). The SD log is what is
+  counted; the serial live feed is decimated and the analog records
+  (ID 0x110) are told apart by their ID.
+*/
+
+#include "../EmuSketch.h"
+
+#include <Arduino.h>
+#include <MCP2515.h>
+
+#include "../../../ChainLogger_no_S_mega_NuovaLib/CaptureQueue.h"
+
+// Prototypes the Arduino IDE generates for the sketch
+void preparaSD(void);
+void processMessage(Frame &message);
+void serviceSinks(void);
+void drainSinks(void);
+char *putDec(char *p, unsigned long v);
+char *putHex(char *p, unsigned long v);
+void sdSinkWriteBlock(void);
+void sdSinkFlush(void);
+bool sdSinkReady(void);
+unsigned long sdTimeDiff(unsigned long timeUs);
+unsigned long getTimeDifference();
+void checkCanRx0();
+void checkCanRx1();
+void rx0BufferFull();
+void rx1BufferFull();
+void initBufferFullPins(void);
+void checkBuffersFull();
+void checkCanTx0();
+void checkCanTx1();
+void checkCanTx2();
+void checkCanErr0();
+void checkCanErr1();
+void readPots(void);
+
+#define BUFFER_FULL_PINS_WIRED
+#include "../../../ChainLogger_no_S_mega_NuovaLib/ChainLogger_no_S_mega_NuovaLib.ino"
+
+const EmuSketch emuSketch = { "ChainLogger_no_S_mega_NuovaLib", 53, 2, 3, 18, EMU_OUT_SD };
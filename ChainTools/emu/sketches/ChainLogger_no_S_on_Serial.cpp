@@ -0,0 +1,23 @@
+/*
+  ChainLogger_no_S_on_Serial.cpp - ChainLogger_no_S_on_Serial.ino on the emulated board
+
+  Frames are counted from the ChainStream packets it writes to Serial.
+*/
+
+#include "../EmuSketch.h"
+
+#include <Arduino.h>
+#include <MCP2515.h>
+
+// Prototypes the Arduino IDE generates for the sketch
+boolean initCAN(void);
+void setCanStatus();
+void initSPI(void);
+void displayCanStatus(void);
+unsigned long getTimeDifference();
+boolean hasTimeElapsed(unsigned long start_time, unsigned long wait_time);
+void processMessage(Frame &message);
+
+#include "../../../ChainLogger_no_S_on_Serial/ChainLogger_no_S_on_Serial.ino"
+
+const EmuSketch emuSketch = { "ChainLogger_no_S_on_Serial", 10, 2, -1, -1, EMU_OUT_STREAM };
@@ -0,0 +1,33 @@
+/*
+  driver_harding.cpp - Receive loop on the Harding library (Arduino Libraries/2) alone
+
+  Waits for the INT pin, reads CANINTF and empties the flagged buffers with
+  READ RX BUFFER, which clears RXnIF by itself. No logging, so this is the
+  ceiling for the loggers built on the same library.
+*/
+
+#include "../EmuSketch.h"
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <MCP2515.h>
+
+MCP2515 CAN(10, 2);
+
+void setup()
+{
+  SPI.begin();
+  CAN.Init(1000, 16);
+}
+
+void loop()
+{
+  if (!CAN.Interrupt()) return;
+  byte flags = CAN.Read(CANINTF);
+  if (flags & RX0IF) CAN.ReadBuffer(RXB0);
+  if (flags & RX1IF) CAN.ReadBuffer(RXB1);
+  // anything else (errors, TX) would hold INT low forever
+  if (flags & ~(RX0IF | RX1IF)) CAN.BitModify(CANINTF, flags & ~(RX0IF | RX1IF), 0);
+}
+
+const EmuSketch emuSketch = { "driver_harding", 10, 2, -1, -1, EMU_OUT_CHIP };
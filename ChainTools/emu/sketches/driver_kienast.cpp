@@ -0,0 +1,27 @@
+/*
+  driver_kienast.cpp - Receive loop on the Kienast library (Arduino Libraries/1) alone
+
+  The library only knows 500 kbps and below, polls CANINTF over SPI and
+  reads RXB0 register by register; RXB1 is never emptied.
+*/
+
+#include "../EmuSketch.h"
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <MCP2515.h>
+
+void setup()
+{
+  MCP2515::initCAN(CAN_BAUD_500K);
+  MCP2515::setCANReceiveonlyMode();
+}
+
+void loop()
+{
+  CANMSG msg;
+  // the wait loop runs while millis() < start + timeout, so 1 ms is the shortest poll
+  MCP2515::receiveCANMessage(&msg, 1);
+}
+
+const EmuSketch emuSketch = { "driver_kienast", 10, 2, -1, -1, EMU_OUT_CHIP };
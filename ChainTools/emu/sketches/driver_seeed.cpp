@@ -0,0 +1,32 @@
+/*
+  driver_seeed.cpp - Receive loop on the Seeed MCP_CAN library alone
+
+  Polls READ STATUS, then reads the buffer register by register and clears
+  its flag with BIT MODIFY (readMsgBuf()).
+*/
+
+#include "../EmuSketch.h"
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <mcp_can.h>
+
+MCP_CAN CAN(10);
+
+void setup()
+{
+  CAN.begin(CAN_1000KBPS);
+}
+
+void loop()
+{
+  unsigned char len;
+  unsigned char buf[8];
+  if (CAN.checkReceive() == CAN_MSGAVAIL)
+  {
+    CAN.readMsgBuf(&len, buf);
+    CAN.getCanId();
+  }
+}
+
+const EmuSketch emuSketch = { "driver_seeed", 10, 2, -1, -1, EMU_OUT_CHIP };
@@ -0,0 +1,26 @@
+/*
+  driver_sparkfun.cpp - Receive loop on the SparkFun/Greif driver (Arduino Libraries/3) alone
+
+  mcp2515.c talks to the chip through SPDR/SPSR and the port registers
+  directly (CS on PB2 = pin 10, INT on PD2 = pin 2), checks INT on PIND and
+  fetches the buffer named by RX STATUS.
+*/
+
+#include "../EmuSketch.h"
+
+#include <Arduino.h>
+#include "mcp2515.h"
+
+void setup()
+{
+  // CNF1 = BRP; with the CNF2/CNF3 of the driver BRP 0 is 1 Mbps at 16 MHz
+  mcp2515_init(0);
+}
+
+void loop()
+{
+  tCAN message;
+  if (mcp2515_check_message()) mcp2515_get_message(&message);
+}
+
+const EmuSketch emuSketch = { "driver_sparkfun", 10, 2, -1, -1, EMU_OUT_CHIP };
@@ -0,0 +1,487 @@
+/*
+  emu_bench - Maximum lossless frame rate of a logger sketch or MCP2515 driver
+
+  Usage: emu_bench_<sketch> [-s scenario] [-b bitrate] [-n frames] [-l dlc] [-x] [-S seed] [-d drain_ms] [-r fps] [-t|-T] [-v]
+
+  Built once per sketch (see README.md): the sketch runs on the emulated
+  board (emu/Emu.h) with an emulated MCP2515 on its SPI bus. Every trial
+  starts the board from reset in a child process, runs setup(), then feeds
+  n frames of a traffic scenario (Traffic.h) sped up or slowed down to the
+  trial's frame rate while loop() runs, and lets the sketch drain for
+  drain_ms. A rate is lossless when the MCP2515 did not overflow and every
+  frame was read out of it and, for the SD and serial stream loggers, also
+  logged. The maximum lossless rate is found by bisection between 0 and
+  the bus limit; -r runs a single trial at the given rate instead.
+
+  The shim calls (SPI, digitalWrite, print, String, SD, ...) are counted
+  from the first frame to the end of the last one and given per frame.
+  The CPU cost of a frame comes from a saturation trial: the bus runs
+  full for a few seconds, so the sketch always finds a frame waiting, and
+  the cycles of that window are divided by the frames it read out and
+  logged (or threw away unread) in it. Work not tied to a frame (analog
+  records, flushes) is part of the cost, and so is an interrupt driven
+  sketch starving its main loop under overload: its CPU bound rate then
+  comes out below its maximum lossless one. A sketch that keeps up with
+  the full bus only gets an upper bound, the bus time of a frame. -t prints the results as one row of a
+  comparison table instead, -T only the table header, so
+
+    ./bench_ChainLogger -T; for b in bench_*; do ./$b -t; done
+
+  compares all builds.
+
+  The bus bitrate is the one the sketch programs into CNF1..3 unless -b
+  overrides it. The default scenario is uniform (16 IDs 0x200.. in turn,
+  8 bytes); -l sets the data length of every frame and -x turns standard
+  IDs into 29 bit ones (0x18FF0000 + ID).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "ChainStream.h"
+#include "Traffic.h"
+#include "emu/Emu.h"
+#include "emu/EmuSketch.h"
+
+extern "C" void setup(void);
+extern "C" void loop(void);
+
+#define SETUP_LIMIT_MS    60000
+#define SATURATE_MS       3000
+
+struct BenchOptions
+{
+  uint32_t bitrate;   // 0 = as configured by the sketch
+  uint32_t frames;
+  uint64_t seed;
+  uint32_t drainMs;
+  bool verbose;
+  std::vector<TrafficSource> sources;
+  double sourcesFps;      // frame rate of the sources as built
+};
+
+struct TrialResult
+{
+  bool setupOk;
+  uint32_t bitrate;       // bus bitrate used
+  uint32_t configured;    // bitrate in CNF1..3 after setup()
+  uint64_t injected;
+  uint64_t received;
+  uint64_t overflows;
+  uint64_t bitErrors;
+  uint64_t readOut;
+  uint64_t discarded;
+  uint64_t logged;
+  uint64_t windowCycles;  // while the traffic ran: start of the traffic to the end of the last frame
+  uint64_t windowDone;    // frames read out and logged (or discarded by the sketch) by the end of the window
+  EmuCounters window;     // shim calls made in the window
+};
+
+static bool isTrafficId(const BenchOptions &opt, uint32_t id)
+{
+  for (const TrafficSource &source : opt.sources)
+  {
+    if (source.id == id) return true;
+  }
+  return false;
+}
+
+/**Lines of a "Msg#,Time Diff,ID,DLC,Data" log whose ID is one of the traffic IDs*/
+static void countSdLines(const std::string &name, const std::string &data, void *arg)
+{
+  (void)name;
+  std::pair<const BenchOptions *, uint64_t> *count = (std::pair<const BenchOptions *, uint64_t> *)arg;
+  size_t pos = 0;
+  while (pos < data.size())
+  {
+    size_t end = data.find('\n', pos);
+    if (end == std::string::npos) break;   // not terminated: cut off by the deadline
+    std::string line = data.substr(pos, end - pos);
+    pos = end + 1;
+    size_t c1 = line.find(',');
+    size_t c2 = c1 == std::string::npos ? c1 : line.find(',', c1 + 1);
+    if (c2 == std::string::npos) continue;
+    char *stop;
+    unsigned long id = strtoul(line.c_str() + c2 + 1, &stop, 16);
+    if (stop != line.c_str() + c2 + 1 && *stop == ',' && isTrafficId(*count->first, (uint32_t)id)) count->second++;
+  }
+}
+
+static uint64_t countLogged(const BenchOptions &opt, const Mcp2515Emu &chip)
+{
+  switch (emuSketch.output)
+  {
+    case EMU_OUT_SD:
+    {
+      std::pair<const BenchOptions *, uint64_t> count(&opt, 0);
+      emuSdForEach(countSdLines, &count);
+      return count.second;
+    }
+    case EMU_OUT_STREAM:
+    {
+      const std::string &raw = emuSerialCaptured();
+      StreamDecoder decoder;
+      std::vector<CanFrame> frames;
+      decoder.feed((const uint8_t *)raw.data(), raw.size(), frames);
+      uint64_t n = 0;
+      for (const CanFrame &frame : frames)
+      {
+        if (isTrafficId(opt, frame.id)) n++;
+      }
+      return n;
+    }
+    default:
+      return chip.stats().readOut;
+  }
+}
+
+struct TrialWatch
+{
+  const BenchOptions *opt;
+  const Mcp2515Emu *chip;
+  TrialResult *result;
+};
+
+/**Takes the window figures as the last frame ends*/
+static void endOfTraffic(void *arg)
+{
+  TrialWatch *watch = (TrialWatch *)arg;
+  const Mcp2515Stats &stats = watch->chip->stats();
+  uint64_t logged = countLogged(*watch->opt, *watch->chip);
+  watch->result->window = emuCounters();
+  watch->result->windowDone = (logged < stats.readOut ? logged : stats.readOut) + stats.discarded;
+}
+
+/**One trial of frames at rate on a fresh board, in the current (child) process*/
+static TrialResult runTrial(const BenchOptions &opt, double rate, uint32_t frames)
+{
+  TrialResult result;
+  memset(&result, 0, sizeof(result));
+
+  emuReset();
+  emuSerialOutput(opt.verbose ? stderr : NULL);
+  Mcp2515Emu chip;
+  emuAttachChip(&chip, emuSketch.csPin, emuSketch.intPin, emuSketch.rx0bfPin, emuSketch.rx1bfPin);
+
+  emuSetDeadline((uint64_t)SETUP_LIMIT_MS * (EMU_CPU_HZ / 1000));
+  try
+  {
+    setup();
+  }
+  catch (const EmuDeadline &)
+  {
+    return result;
+  }
+  result.setupOk = true;
+  result.configured = chip.configuredBitrate();
+  result.bitrate = opt.bitrate ? opt.bitrate : result.configured;
+  if (!result.bitrate || rate <= 0) return result;
+  chip.setBusBitrate(result.bitrate);
+  chip.clearStats();
+  emuClearCounters();
+  uint64_t cleared = emuNow();
+  // the decoder only resynchronises on a packet delimiter, so start the capture after the setup() text
+  emuSerialCapture(false);
+  emuSerialCapture(emuSketch.output == EMU_OUT_STREAM);
+
+  std::vector<TrafficSource> sources = opt.sources;
+  trafficSpeedUp(sources, rate / opt.sourcesFps);
+  TrafficGenerator traffic(sources, result.bitrate, opt.seed);
+  uint64_t start = emuNow() + EMU_CPU_HZ / 1000;
+  uint64_t end = start;
+  for (uint32_t n = 0; n < frames; n++)
+  {
+    uint64_t startNs;
+    CanFrame frame = traffic.next(&startNs);
+    end = chip.inject(frame, start + startNs * (EMU_CPU_HZ / 1000000) / 1000);
+  }
+  result.injected = frames;
+  result.windowCycles = end - cleared;
+
+  TrialWatch watch = { &opt, &chip, &result };
+  emuWatchAt(end, endOfTraffic, &watch);
+  emuSetDeadline(end + (uint64_t)opt.drainMs * (EMU_CPU_HZ / 1000));
+  try
+  {
+    for (;;) loop();
+  }
+  catch (const EmuDeadline &)
+  {
+  }
+
+  const Mcp2515Stats &stats = chip.stats();
+  result.received = stats.received;
+  result.overflows = stats.overflows;
+  result.bitErrors = stats.bitErrors;
+  result.readOut = stats.readOut;
+  result.discarded = stats.discarded;
+  result.logged = countLogged(opt, chip);
+  return result;
+}
+
+/**Runs the trial in a child process: the sketch globals start from scratch every time*/
+static bool forkTrial(const BenchOptions &opt, double rate, uint32_t frames, TrialResult &result)
+{
+  int fds[2];
+  if (pipe(fds) != 0)
+  {
+    perror("emu_bench: pipe");
+    return false;
+  }
+  fflush(stdout);
+  fflush(stderr);
+  pid_t pid = fork();
+  if (pid < 0)
+  {
+    perror("emu_bench: fork");
+    return false;
+  }
+  if (pid == 0)
+  {
+    close(fds[0]);
+    TrialResult r = runTrial(opt, rate, frames);
+    fflush(stderr);
+    ssize_t n = write(fds[1], &r, sizeof(r));
+    _exit(n == (ssize_t)sizeof(r) ? 0 : 1);
+  }
+  close(fds[1]);
+  size_t got = 0;
+  while (got < sizeof(result))
+  {
+    ssize_t n = read(fds[0], (char *)&result + got, sizeof(result) - got);
+    if (n <= 0) break;
+    got += (size_t)n;
+  }
+  close(fds[0]);
+  int status;
+  waitpid(pid, &status, 0);
+  if (got != sizeof(result))
+  {
+    fprintf(stderr, "emu_bench: trial at %.0f fps crashed (status %d)\n", rate, status);
+    return false;
+  }
+  return true;
+}
+
+static bool lossless(const TrialResult &r)
+{
+  return r.overflows == 0 && r.bitErrors == 0 && r.discarded == 0 && r.readOut >= r.injected && r.logged >= r.injected;
+}
+
+/**Counters of the traffic window per frame: sent (a normal trial) or done (saturation)*/
+static void printCounters(const EmuCounters &w, double frames)
+{
+  printf("%.1f SPI commands (%.1f bytes), %.1f digitalWrite, %.1f digitalRead, %.1f millis, %.1f print, %.1f String, "
+         "%.2f ISR, %.1f serial bytes, %.1f SD bytes, %.3f SD blocks\n",
+         w.spiSelects / frames, w.spiTransfers / frames, w.digitalWrites / frames, w.digitalReads / frames,
+         w.millisCalls / frames, w.printCalls / frames, w.stringOps / frames, w.isrCalls / frames,
+         w.serialBytes / frames, w.sdBytes / frames, w.sdBlocks / frames);
+}
+
+static void printTrial(double rate, const TrialResult &r)
+{
+  printf("  %.0f fps: injected %llu, received %llu, overflows %llu, read out %llu, discarded %llu, logged %llu%s\n",
+         rate, (unsigned long long)r.injected, (unsigned long long)r.received, (unsigned long long)r.overflows,
+         (unsigned long long)r.readOut, (unsigned long long)r.discarded, (unsigned long long)r.logged, lossless(r) ? " (lossless)" : "");
+  printf("    per frame while the traffic ran: ");
+  printCounters(r.window, r.injected ? (double)r.injected : 1.0);
+}
+
+/**The frames of a saturation trial were all done in its window: the sketch was waiting for the bus*/
+static bool keptUp(const TrialResult &r)
+{
+  // the two receive buffers may still hold frames at the end
+  return r.windowDone + 2 >= r.injected;
+}
+
+static void printSaturation(const TrialResult &r)
+{
+  double done = r.windowDone ? (double)r.windowDone : 1.0;
+  double cycles = r.windowCycles / done;
+  printf("  full bus for %d ms: %llu of %llu frames done, %s%.0f cycles per frame (%.0f fps CPU bound)\n", SATURATE_MS,
+         (unsigned long long)r.windowDone, (unsigned long long)r.injected, keptUp(r) ? "at most " : "", cycles,
+         EMU_CPU_HZ / cycles);
+  printf("    per frame done: ");
+  printCounters(r.window, done);
+}
+
+static void printTableHeader()
+{
+  printf("%-32s %6s %7s %6s %8s %8s %6s %6s %6s %7s %7s %7s %6s\n", "sketch", "kbit/s", "max fps", "bus %", "cyc/frm",
+         "cpu fps", "SPI cm", "SPI B", "calls", "ser B", "SD B", "SD blk", "ISR");
+}
+
+/**One row: the maximum lossless rate and the per frame costs of the saturation trial*/
+static void printTableRow(uint32_t bitrate, double best, double busLimit, const TrialResult &sat)
+{
+  double done = sat.windowDone ? (double)sat.windowDone : 1.0;
+  double cycles = sat.windowCycles / done;
+  const EmuCounters &w = sat.window;
+  uint64_t calls = w.digitalWrites + w.digitalReads + w.millisCalls + w.printCalls + w.stringOps;
+  char cost[16];
+  snprintf(cost, sizeof(cost), "%s%.0f", keptUp(sat) ? "<" : "", cycles);
+  printf("%-32s %6u %7.0f %6.1f %8s %8.0f %6.1f %6.1f %6.1f %7.1f %7.1f %7.3f %6.2f\n", emuSketch.name, bitrate / 1000,
+         best, 100.0 * best / busLimit, cost, EMU_CPU_HZ / cycles, w.spiSelects / done, w.spiTransfers / done,
+         calls / done, w.serialBytes / done, w.sdBytes / done, w.sdBlocks / done, w.isrCalls / done);
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: emu_bench [-s scenario] [-b bitrate] [-n frames] [-l dlc] [-x] [-S seed] [-d drain_ms] [-r fps] "
+                  "[-t|-T] [-v]\n");
+}
+
+int main(int argc, char **argv)
+{
+  BenchOptions opt;
+  opt.bitrate = 0;
+  opt.frames = 2000;
+  opt.seed = 1;
+  opt.drainMs = 1500;
+  opt.verbose = false;
+  double fixedRate = 0;
+  const char *scenario = "uniform";
+  int dlc = -1;
+  bool extended = false;
+  bool table = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) scenario = argv[++i];
+    else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) opt.bitrate = (uint32_t)atol(argv[++i]);
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) opt.frames = (uint32_t)atol(argv[++i]);
+    else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) dlc = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-x") == 0) extended = true;
+    else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) opt.seed = strtoull(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) opt.drainMs = (uint32_t)atol(argv[++i]);
+    else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) fixedRate = atof(argv[++i]);
+    else if (strcmp(argv[i], "-t") == 0) table = true;
+    else if (strcmp(argv[i], "-T") == 0)
+    {
+      printTableHeader();
+      return 0;
+    }
+    else if (strcmp(argv[i], "-v") == 0) opt.verbose = true;
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (dlc > 8 || opt.frames == 0)
+  {
+    usage();
+    return 2;
+  }
+  if (!trafficScenario(scenario, opt.sources))
+  {
+    fprintf(stderr, "emu_bench: unknown scenario %s, one of:\n", scenario);
+    for (const char *const *name = trafficScenarioNames(); *name; name++) fprintf(stderr, "  %s\n", *name);
+    return 2;
+  }
+  for (TrafficSource &source : opt.sources)
+  {
+    if (dlc >= 0) source.dlc = (uint8_t)dlc;
+    if (extended && !(source.flags & FRAME_EXTENDED))
+    {
+      source.id |= 0x18FF0000UL;
+      source.flags |= FRAME_EXTENDED;
+    }
+  }
+  opt.sourcesFps = trafficFrameRate(opt.sources);
+
+  TrialResult probe;
+  if (!forkTrial(opt, 0, 0, probe)) return 1;
+  if (!probe.setupOk)
+  {
+    fprintf(stderr, "emu_bench: %s: setup() did not return within %d ms\n", emuSketch.name, SETUP_LIMIT_MS);
+    return 1;
+  }
+  if (!probe.bitrate)
+  {
+    fprintf(stderr, "emu_bench: %s: no valid bit timing in CNF1..3, give the bus bitrate with -b\n", emuSketch.name);
+    return 1;
+  }
+  if (probe.configured != probe.bitrate)
+  {
+    fprintf(stderr, "emu_bench: %s: warning: sketch configures %u bit/s, bus runs at %u bit/s\n", emuSketch.name,
+            probe.configured, probe.bitrate);
+  }
+
+  // the frame rate at which the scenario fills the bus
+  double load = trafficBusLoad(opt.sources, probe.bitrate);
+  double busLimit = opt.sourcesFps / load;
+  if (!table)
+  {
+    printf("%s: %u bit/s, %s traffic (%zu IDs, %.1f bits per frame on average), bus limit %.0f fps\n", emuSketch.name,
+           probe.bitrate, scenario, opt.sources.size(), load * probe.bitrate / opt.sourcesFps, busLimit);
+  }
+
+  TrialResult r;
+  if (fixedRate > 0)
+  {
+    if (!forkTrial(opt, fixedRate, opt.frames, r)) return 1;
+    printTrial(fixedRate, r);
+    return lossless(r) ? 0 : 1;
+  }
+
+  double best = 0;
+  TrialResult bestResult;
+  memset(&bestResult, 0, sizeof(bestResult));
+  double hi = busLimit;
+  if (!forkTrial(opt, busLimit, opt.frames, r)) return 1;
+  TrialResult lowest = r;
+  if (lossless(r))
+  {
+    best = busLimit;
+    bestResult = r;
+  }
+  else
+  {
+    double lo = 0;
+    while (hi - lo > busLimit * 0.005)
+    {
+      double mid = (lo + hi) / 2;
+      if (!forkTrial(opt, mid, opt.frames, r)) return 1;
+      if (lossless(r))
+      {
+        lo = mid;
+        bestResult = r;
+      }
+      else
+      {
+        hi = mid;
+        lowest = r;
+      }
+    }
+    best = lo;
+  }
+
+  // releases faster than the bus can carry them, so there is no gap between frames
+  TrialResult saturated;
+  if (!forkTrial(opt, busLimit * 1.25, (uint32_t)(busLimit * SATURATE_MS / 1000), saturated)) return 1;
+
+  if (table)
+  {
+    printTableRow(probe.bitrate, best, busLimit, saturated);
+    return 0;
+  }
+  if (best > 0)
+  {
+    printf("  max lossless %.0f fps (%.1f %% bus load)%s\n", best, 100.0 * best / busLimit,
+           best >= busLimit ? ", limited by the bus" : "");
+    printTrial(best, bestResult);
+  }
+  else
+  {
+    // bursts of the scenario stay back to back at any rate
+    printf("  not lossless even at %.0f fps\n", hi);
+    printTrial(hi, lowest);
+  }
+  printSaturation(saturated);
+  return 0;
+}
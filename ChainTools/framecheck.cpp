@@ -0,0 +1,146 @@
+/*
+  framecheck - Validates payload checksums and alive counters of a capture
+
+  Usage: framecheck rules.chk DATAxx.txt|DATAxx.bin [-j threads]
+
+  Checks every frame of the capture (a log, parsed batch by batch on -j
+  threads, or a txt2bin frame file) against the per-ID rules file (see
+  FrameCheck.h) and prints, per ID, frames checked, checksum and counter
+  errors, frames too short for their rule, and the Msg# of the first
+  failing frames. The check rate goes to stderr. Exits 1 if any frame
+  failed.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+
+#include "FrameCheck.h"
+#include "FrameFile.h"
+#include "MappedFile.h"
+#include "ParallelLogParser.h"
+
+/*Text parsed per batch, and frames per check() call*/
+#define CHECK_TEXT_BATCH  (16UL << 20)
+#define CHECK_BATCH       65536
+
+static void usage()
+{
+  fprintf(stderr, "usage: framecheck rules.chk DATAxx.txt|DATAxx.bin [-j threads]\n");
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+  const char *rulesPath = NULL;
+  const char *input = NULL;
+  unsigned threads = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+    else if (argv[i][0] != '-' && !rulesPath) rulesPath = argv[i];
+    else if (argv[i][0] != '-' && !input) input = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!rulesPath || !input)
+  {
+    usage();
+    return 2;
+  }
+
+  std::vector<CheckRule> rules;
+  std::string error;
+  if (!loadCheckRules(rulesPath, rules, &error))
+  {
+    fprintf(stderr, "framecheck: %s: %s\n", rulesPath, error.c_str());
+    return 1;
+  }
+  FrameChecker checker(rules);
+  uint64_t frameCount = 0;
+  double checkSeconds = 0;
+  double start = nowSeconds();
+
+  FrameFile bin;
+  MappedFile text;
+  if (bin.open(input))
+  {
+    bin.map().adviseSequential();
+    double t = nowSeconds();
+    for (size_t i = 0; i < bin.count(); i += CHECK_BATCH)
+    {
+      checker.check(bin.frames() + i, bin.count() - i < CHECK_BATCH ? bin.count() - i : CHECK_BATCH);
+    }
+    checkSeconds = nowSeconds() - t;
+    frameCount = bin.count();
+  }
+  else if (errno == EINVAL && text.open(input))
+  {
+    // batches end on a line boundary
+    text.adviseSequential();
+    ThreadPool pool(threads);
+    ParallelLogParser parser(pool);
+    std::vector<CanFrame> frames;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while (p < end)
+    {
+      const char *stop = (size_t)(end - p) > CHECK_TEXT_BATCH ? p + CHECK_TEXT_BATCH : end;
+      if (stop < end)
+      {
+        const char *nl = (const char *)memchr(stop, '\n', (size_t)(end - stop));
+        stop = nl ? nl + 1 : end;
+      }
+      frames.clear();
+      parser.parse(p, stop, frames);
+      double t = nowSeconds();
+      for (size_t i = 0; i < frames.size(); i += CHECK_BATCH)
+      {
+        checker.check(&frames[i], frames.size() - i < CHECK_BATCH ? frames.size() - i : CHECK_BATCH);
+      }
+      checkSeconds += nowSeconds() - t;
+      frameCount += frames.size();
+      p = stop;
+    }
+  }
+  else
+  {
+    fprintf(stderr, "framecheck: %s: %s\n", input, strerror(errno));
+    return 1;
+  }
+  double elapsed = nowSeconds() - start;
+
+  uint64_t failed = 0;
+  printf("%-11s %10s %10s %10s %8s  first failing Msg# (s: checksum, c: counter, short: too short)\n", "ID", "frames",
+         "checksum", "counter", "short");
+  for (const CheckResult &r : checker.results())
+  {
+    char id[16];
+    snprintf(id, sizeof(id), r.extended ? "%08X" : "%03X", r.id);
+    printf("%-11s %10llu %10llu %10llu %8llu ", id, (unsigned long long)r.frames, (unsigned long long)r.checksumErrors,
+           (unsigned long long)r.counterErrors, (unsigned long long)r.shortFrames);
+    for (const CheckFailure &f : r.first)
+    {
+      printf(" %u%s%s%s", f.msgNum, f.kind & CHECK_FAIL_SUM ? "s" : "", f.kind & CHECK_FAIL_COUNTER ? "c" : "",
+             f.kind & CHECK_FAIL_SHORT ? "short" : "");
+    }
+    printf("\n");
+    failed += r.checksumErrors + r.counterErrors + r.shortFrames;
+  }
+  fprintf(stderr, "framecheck: %llu frames, %llu without a rule, checked at %.1f M frames/s (%.3f s in all)\n",
+          (unsigned long long)frameCount, (unsigned long long)checker.unchecked(),
+          checkSeconds > 0 ? frameCount / checkSeconds / 1e6 : 0.0, elapsed);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,234 @@
+/*
+  lod - Builds and queries min/max plot pyramids of decoded signals
+
+  Usage: lod file.dbc DATAxx.txt|DATAxx.bin [-o DATAxx.lod] [-w bucket_us] [-j threads]
+         lod DATAxx.lod -s signal [-f first_s] [-l last_s] [-p pixels]
+
+  The first form decodes the capture batch by batch with the DBC file and
+  adds every signal value to its Pyramid (see Pyramid.h) as it comes, the
+  way a live view would, then writes all pyramids next to the log (the
+  input name with .lod in place of its extension by default). Level 0
+  buckets are -w us wide, or follow the sample spacing of each signal.
+
+  The second form prints the buckets of one signal ("Message.Signal" or
+  just "Signal") between -f and -l seconds (the whole signal by default)
+  for a plot -p pixels wide (1000 by default) as "start_s,min,mean,max,
+  count" lines; the bucket width and query time go to stderr.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <utility>
+
+#include "Dbc.h"
+#include "FrameFile.h"
+#include "MappedFile.h"
+#include "ParallelLogParser.h"
+#include "Pyramid.h"
+#include "SignalDecoder.h"
+
+/*Text parsed per batch, and frames per decode() call*/
+#define LOD_TEXT_BATCH  (16UL << 20)
+#define DECODE_BATCH    65536
+
+static void usage()
+{
+  fprintf(stderr, "usage: lod file.dbc DATAxx.txt|DATAxx.bin [-o DATAxx.lod] [-w bucket_us] [-j threads]\n"
+                  "       lod DATAxx.lod -s signal [-f first_s] [-l last_s] [-p pixels]\n");
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string lodName(const char *input)
+{
+  std::string name = input;
+  size_t dot = name.find_last_of('.');
+  size_t slash = name.find_last_of('/');
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) name.erase(dot);
+  return name + ".lod";
+}
+
+/**Adds the values decoded so far to their pyramids and empties the columns*/
+static uint64_t feed(std::vector<SignalColumn> &columns, std::vector<Pyramid> &pyramids)
+{
+  uint64_t values = 0;
+  for (size_t s = 0; s < columns.size(); s++)
+  {
+    SignalColumn &c = columns[s];
+    pyramids[s].add(c.timeUs.data(), c.value.data(), c.value.size());
+    values += c.value.size();
+    c.timeUs.clear();
+    c.value.clear();
+  }
+  return values;
+}
+
+static int query(const LodFile &lod, const char *path, const char *signal, double first, double last, unsigned pixels)
+{
+  const LodFileEntry *e = lod.find(signal);
+  if (!e)
+  {
+    fprintf(stderr, "lod: %s: no signal %s\n", path, signal);
+    return 1;
+  }
+  const LodFileLevel &l0 = e->levels[0];
+  uint64_t firstUs = first >= 0 ? (uint64_t)(first * 1e6) : l0.first * e->baseUs;
+  uint64_t lastUs = last >= 0 ? (uint64_t)(last * 1e6) : (l0.first + l0.count) * e->baseUs - 1;
+
+  std::vector<LodPoint> points;
+  double start = nowSeconds();
+  uint64_t width = lod.query(*e, firstUs, lastUs, pixels, points);
+  double elapsed = nowSeconds() - start;
+
+  printf("start_s,min,mean,max,count\n");
+  for (const LodPoint &p : points)
+    printf("%.6f,%.8g,%.8g,%.8g,%u\n", p.startUs / 1e6, p.min, p.mean, p.max, p.count);
+  fprintf(stderr, "lod: %s [%s]: %zu buckets of %.3f ms for %u pixels in %.1f us\n", e->name, e->unit,
+          points.size(), width / 1e3, pixels, elapsed * 1e6);
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  const char *dbcPath = NULL;
+  const char *input = NULL;
+  const char *output = NULL;
+  const char *signal = NULL;
+  unsigned threads = 0;
+  uint64_t bucketUs = 0;
+  double first = -1;
+  double last = -1;
+  unsigned pixels = 1000;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+    else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) bucketUs = strtoull(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+    else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) signal = argv[++i];
+    else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) first = atof(argv[++i]);
+    else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) last = atof(argv[++i]);
+    else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) pixels = (unsigned)atoi(argv[++i]);
+    else if (argv[i][0] != '-' && !dbcPath) dbcPath = argv[i];
+    else if (argv[i][0] != '-' && !input) input = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!dbcPath || !pixels)
+  {
+    usage();
+    return 2;
+  }
+
+  LodFile lod;
+  if (lod.open(dbcPath))
+  {
+    if (input || !signal)
+    {
+      usage();
+      return 2;
+    }
+    return query(lod, dbcPath, signal, first, last, pixels);
+  }
+  if (!input || signal)
+  {
+    usage();
+    return 2;
+  }
+
+  DbcFile dbc;
+  std::string error;
+  if (!dbc.load(dbcPath, &error))
+  {
+    fprintf(stderr, "lod: %s: %s\n", dbcPath, error.c_str());
+    return 1;
+  }
+  SignalDecoder decoder(dbc);
+  std::vector<SignalColumn> columns;
+  decoder.columns(columns);
+  std::vector<Pyramid> pyramids(columns.size(), Pyramid(bucketUs));
+  uint64_t frameCount = 0;
+  uint64_t values = 0;
+  double start = nowSeconds();
+
+  FrameFile bin;
+  MappedFile text;
+  if (bin.open(input))
+  {
+    bin.map().adviseSequential();
+    for (size_t i = 0; i < bin.count(); i += DECODE_BATCH)
+    {
+      size_t n = bin.count() - i < DECODE_BATCH ? bin.count() - i : DECODE_BATCH;
+      decoder.decode(bin.frames() + i, n, columns);
+      values += feed(columns, pyramids);
+    }
+    frameCount = bin.count();
+  }
+  else if (errno == EINVAL && text.open(input))
+  {
+    // batches end on a line boundary, as a capture grows
+    text.adviseSequential();
+    ThreadPool pool(threads);
+    ParallelLogParser parser(pool);
+    std::vector<CanFrame> frames;
+    const char *p = text.data();
+    const char *end = p + text.size();
+    while (p < end)
+    {
+      const char *stop = (size_t)(end - p) > LOD_TEXT_BATCH ? p + LOD_TEXT_BATCH : end;
+      if (stop < end)
+      {
+        const char *nl = (const char *)memchr(stop, '\n', (size_t)(end - stop));
+        stop = nl ? nl + 1 : end;
+      }
+      frames.clear();
+      parser.parse(p, stop, frames);
+      for (size_t i = 0; i < frames.size(); i += DECODE_BATCH)
+      {
+        size_t n = frames.size() - i < DECODE_BATCH ? frames.size() - i : DECODE_BATCH;
+        decoder.decode(&frames[i], n, columns);
+        values += feed(columns, pyramids);
+      }
+      frameCount += frames.size();
+      p = stop;
+    }
+  }
+  else
+  {
+    fprintf(stderr, "lod: %s: %s\n", input, strerror(errno));
+    return 1;
+  }
+
+  // only signals the capture has
+  std::vector<std::string> names;
+  std::vector<std::string> units;
+  std::vector<Pyramid> kept;
+  for (size_t s = 0; s < columns.size(); s++)
+  {
+    if (pyramids[s].empty()) continue;
+    names.push_back(columns[s].name);
+    units.push_back(columns[s].unit);
+    kept.push_back(std::move(pyramids[s]));
+  }
+  std::string outName = output ? output : lodName(input);
+  if (!writeLodFile(outName.c_str(), names, units, kept))
+  {
+    fprintf(stderr, "lod: %s: %s\n", outName.c_str(), strerror(errno));
+    return 1;
+  }
+  double elapsed = nowSeconds() - start;
+  fprintf(stderr, "lod: %s: %llu frames, %llu values of %zu signals in %.3f s\n", outName.c_str(),
+          (unsigned long long)frameCount, (unsigned long long)values, kept.size(), elapsed);
+  return 0;
+}
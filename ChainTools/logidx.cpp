@@ -0,0 +1,111 @@
+/*
+  logidx - Time index of a DATAxx.txt log, and the frames of a time window
+
+  Usage: logidx DATAxx.txt [-b first_s] [-e last_s] [-n frames] [-m ms] [-r]
+
+  Loads DATAxx.idx next to the log, or builds it (an entry every -n frames
+  or -m ms, see TimeIndex.h) when it is missing, stale or -r is given.
+  With -b and/or -e prints the frames of that window as
+  "time_s,Msg#,ID,DLC,data", parsing only from the index entry before it.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "MappedFile.h"
+#include "TimeIndex.h"
+
+static void usage()
+{
+  fprintf(stderr, "usage: logidx DATAxx.txt [-b first_s] [-e last_s] [-n frames] [-m ms] [-r]\n");
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string idxName(const char *input)
+{
+  std::string name = input;
+  size_t dot = name.find_last_of('.');
+  size_t slash = name.find_last_of('/');
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) name.erase(dot);
+  return name + ".idx";
+}
+
+int main(int argc, char **argv)
+{
+  const char *input = NULL;
+  double first = -1;
+  double last = -1;
+  uint32_t everyFrames = TIME_INDEX_FRAMES;
+  uint32_t everyMs = TIME_INDEX_MS;
+  bool rebuild = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) first = atof(argv[++i]);
+    else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) last = atof(argv[++i]);
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) everyFrames = (uint32_t)atol(argv[++i]);
+    else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) everyMs = (uint32_t)atol(argv[++i]);
+    else if (strcmp(argv[i], "-r") == 0) rebuild = true;
+    else if (argv[i][0] != '-' && !input) input = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!input)
+  {
+    usage();
+    return 2;
+  }
+
+  struct stat st;
+  MappedFile map;
+  if (stat(input, &st) != 0 || !map.open(input))
+  {
+    fprintf(stderr, "logidx: %s: %s\n", input, strerror(errno));
+    return 1;
+  }
+  std::string indexName = idxName(input);
+  TimeIndex index;
+  double start = nowSeconds();
+  if (rebuild || !index.read(indexName.c_str(), (uint64_t)st.st_size, (int64_t)st.st_mtime))
+  {
+    map.adviseSequential();
+    index.build(map.data(), map.size(), everyFrames, everyMs);
+    if (!index.write(indexName.c_str(), (uint64_t)st.st_size, (int64_t)st.st_mtime))
+    {
+      fprintf(stderr, "logidx: %s: %s\n", indexName.c_str(), strerror(errno));
+      return 1;
+    }
+    fprintf(stderr, "logidx: %s: %zu entries, built in %.3f s\n", indexName.c_str(), index.count(),
+            nowSeconds() - start);
+  }
+  if (first < 0 && last < 0) return 0;
+
+  map.adviseRandom();
+  start = nowSeconds();
+  std::vector<CanFrame> frames;
+  uint64_t firstMs = first > 0 ? (uint64_t)(first * 1000) : 0;
+  uint64_t lastMs = last >= 0 ? (uint64_t)(last * 1000) : UINT64_MAX;
+  index.window(map.data(), map.size(), firstMs, lastMs, frames);
+  double elapsed = nowSeconds() - start;
+  for (const CanFrame &f : frames)
+  {
+    printf("%.3f,%u,%X,%u,", f.timeUs / 1e6, f.msgNum, f.id, f.dlc);
+    for (int b = 0; b < f.dlc; b++) printf("%02X ", f.data[b]);
+    printf("\n");
+  }
+  fprintf(stderr, "logidx: %zu frames in the window, found and decoded in %.3f ms\n", frames.size(), elapsed * 1e3);
+  return 0;
+}
@@ -0,0 +1,175 @@
+/*
+  logmerge - Merges sessions and loggers into one time ordered capture
+
+  Usage: logmerge input[@offset_s] [input[@offset_s] ...] -o merged.bin|merged.txt [-s sync_id[x]]
+
+  Reads every input (a DATAxx.txt log or a txt2bin file) as a stream and
+  merges them by time (see LogMerge.h). Input n becomes channel n. Each
+  input's times are moved by its @offset (seconds, may be negative), for
+  example the start of a power cycle's DATAxx.txt after the previous one;
+  with -s the inputs are moved so that their first frame with the sync ID
+  (29 bit with an x) lines up with the first input's, on top of the first
+  input's own offset. A .bin output keeps every frame's channel and Msg#;
+  a text output has no channel column, so its Msg# counts the merged
+  frames and Time Diff is taken from the merged times.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <time.h>
+
+#include "FrameFile.h"
+#include "LogMerge.h"
+#include "LogWriter.h"
+
+/*Frames merged per output batch*/
+#define MERGE_BATCH  65536
+
+static void usage()
+{
+  fprintf(stderr, "usage: logmerge input[@offset_s] [input[@offset_s] ...] -o merged.bin|merged.txt [-s sync_id[x]]\n");
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<std::string> inputs;
+  std::vector<int64_t> offsets;
+  const char *output = NULL;
+  const char *sync = NULL;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+    else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) sync = argv[++i];
+    else if (argv[i][0] != '-')
+    {
+      // a path may hold an @ of its own: only a number after the last one is an offset
+      const char *at = strrchr(argv[i], '@');
+      char *end = NULL;
+      double seconds = at ? strtod(at + 1, &end) : 0;
+      if (at && end != at + 1 && *end == 0)
+      {
+        inputs.push_back(std::string(argv[i], (size_t)(at - argv[i])));
+        offsets.push_back((int64_t)(seconds * 1e6));
+      }
+      else
+      {
+        inputs.push_back(argv[i]);
+        offsets.push_back(0);
+      }
+    }
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  uint32_t syncId = 0;
+  bool syncExtended = false;
+  if (sync)
+  {
+    char *end;
+    syncId = (uint32_t)strtoul(sync, &end, 16);
+    syncExtended = *end == 'x';
+    if (end == sync || *(end + syncExtended) != 0 || syncId > (syncExtended ? 0x1FFFFFFFU : 0x7FFU))
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (inputs.empty() || !output || inputs.size() > 256)
+  {
+    usage();
+    return 2;
+  }
+  const char *dot = strrchr(output, '.');
+  bool binOutput = dot && strcmp(dot, ".bin") == 0;
+
+  double start = nowSeconds();
+  std::vector<const char *> paths;
+  for (const std::string &s : inputs) paths.push_back(s.c_str());
+  LogMerge merge;
+  if (!merge.open(paths))
+  {
+    fprintf(stderr, "logmerge: %s: %s\n", paths[merge.failed()], strerror(errno));
+    return 1;
+  }
+  if (sync)
+  {
+    size_t missing;
+    if (!merge.syncOffsets(syncId, syncExtended, offsets, missing))
+    {
+      fprintf(stderr, "logmerge: %s: no frame with sync ID %s\n", paths[missing], sync);
+      return 1;
+    }
+    for (size_t i = 0; i < offsets.size(); i++)
+    {
+      fprintf(stderr, "logmerge: %s: offset %+.6f s\n", paths[i], offsets[i] / 1e6);
+    }
+  }
+  merge.setOffsets(offsets);
+
+  FrameFileWriter bin;
+  FILE *text = NULL;
+  if (binOutput ? !bin.open(output) : !(text = fopen(output, "wb")))
+  {
+    fprintf(stderr, "logmerge: %s: %s\n", output, strerror(errno));
+    return 1;
+  }
+  std::unique_ptr<LogWriter> writer;
+  if (text)
+  {
+    writer.reset(new LogWriter(text));
+    writer->header();
+  }
+  std::vector<CanFrame> frames;
+  uint64_t count = 0;
+  uint64_t writtenMs = 0;
+  bool ok = true;
+  for (;;)
+  {
+    frames.clear();
+    size_t n = merge.next(frames, MERGE_BATCH);
+    if (n == 0) break;
+    if (binOutput) ok = bin.write(frames.data(), n);
+    else
+    {
+      for (CanFrame &f : frames)
+      {
+        // Time Diff such that its running sum is the merged time in ms
+        uint64_t ms = f.timeUs / 1000;
+        f.timeDiffMs = (uint32_t)(ms - writtenMs);
+        writtenMs = ms;
+        f.msgNum = (uint32_t)count++;
+      }
+      writer->write(frames.data(), n);
+      ok = writer->flush();
+    }
+    if (!ok) break;
+    if (binOutput) count += n;
+  }
+  if (binOutput) ok = bin.close() && ok;
+  else
+  {
+    writer.reset();
+    ok = fclose(text) == 0 && ok;
+  }
+  if (!ok)
+  {
+    fprintf(stderr, "logmerge: %s: %s\n", output, strerror(errno));
+    return 1;
+  }
+  fprintf(stderr, "logmerge: %llu frames from %zu inputs in %.3f s\n", (unsigned long long)count, inputs.size(),
+          nowSeconds() - start);
+  return 0;
+}
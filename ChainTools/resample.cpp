@@ -0,0 +1,262 @@
+/*
+  resample - Decoded signals aligned onto one time base
+
+  Usage: resample file.dbc DATAxx.txt|DATAxx.bin [-s Msg.Sig,...] [-r rate_hz] [-m method] [-g gap_ms]
+                  [-o aligned.csv] [-j threads]
+         resample -B [-n signals] [-N samples] [-m method] [-j threads]
+
+  Decodes the capture with the DBC file (see SignalDecoder.h), then
+  resamples the chosen signals (all by default) at -r Hz (100) from the
+  first to the last sample with -m linear, hermite or spline (see
+  Resample.h), one signal per thread. Samples more than -g ms apart (off
+  by default) leave NaN between them. -o writes "time_s,signal,..." rows.
+
+  -B is the benchmark: -n signals (200) of -N samples (10000000) at an
+  irregular ~10 ms spacing with NaN gaps, each resampled onto a grid of as
+  many points; prints the aligned points per second.
+*/
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Dbc.h"
+#include "FrameFile.h"
+#include "MappedFile.h"
+#include "ParallelLogParser.h"
+#include "Resample.h"
+#include "SignalDecoder.h"
+
+static void usage()
+{
+  fprintf(stderr, "usage: resample file.dbc DATAxx.txt|DATAxx.bin [-s Msg.Sig,...] [-r rate_hz] [-m linear|hermite|spline] "
+                  "[-g gap_ms] [-o aligned.csv] [-j threads]\n"
+                  "       resample -B [-n signals] [-N samples] [-m method] [-j threads]\n");
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*Keeps the benchmark's results from being optimized away*/
+static volatile double sink;
+
+static int benchmark(ThreadPool &pool, size_t signals, size_t samples, const ResampleOptions &options)
+{
+  // a handful of distinct signals, shared by all: memory stays at one input and one output per thread
+  const size_t DISTINCT = 4;
+  std::vector<std::vector<uint64_t>> times(DISTINCT);
+  std::vector<std::vector<double>> values(DISTINCT);
+  std::vector<SignalSeries> series;
+  uint64_t rng = 0x9E3779B97F4A7C15ULL;
+  for (size_t s = 0; s < DISTINCT; s++)
+  {
+    times[s].resize(samples);
+    values[s].resize(samples);
+    uint64_t t = 0;
+    for (size_t i = 0; i < samples; i++)
+    {
+      rng ^= rng >> 12;
+      rng ^= rng << 25;
+      rng ^= rng >> 27;
+      uint64_t r = rng * 0x2545F4914F6CDD1DULL;
+      t += 9000 + r % 2001;
+      times[s][i] = t;
+      values[s][i] = (r >> 40) % 5000 == 0 ? NAN : sin(t * 1e-6 * (s + 1)) * 100;
+    }
+  }
+  ResampleGrid grid;
+  grid.startUs = times[0][0];
+  grid.stepUs = (times[0][samples - 1] - grid.startUs) / samples;
+  grid.count = samples;
+
+  double start = nowSeconds();
+  pool.run(signals, [&](size_t i) {
+    thread_local std::vector<double> out;
+    out.resize(grid.count);
+    SignalSeries in = {times[i % DISTINCT].data(), values[i % DISTINCT].data(), samples};
+    resample(in, grid, options, out.data());
+    sink = out[grid.count / 2];
+  });
+  double elapsed = nowSeconds() - start;
+  printf("%zu signals x %zu samples on %u threads: %.2f s, %.1f M points/s (%.2f ns per point per thread)\n", signals,
+         samples, pool.threads(), elapsed, signals * samples / elapsed / 1e6,
+         elapsed * pool.threads() * 1e9 / (signals * samples));
+  return 0;
+}
+
+/**Whether column name is in the comma separated list (Msg.Sig or just Sig)*/
+static bool selected(const char *list, const std::string &name)
+{
+  if (!list) return true;
+  size_t dot = name.find('.');
+  std::string signal = dot == std::string::npos ? name : name.substr(dot + 1);
+  for (const char *p = list; *p;)
+  {
+    const char *end = strchr(p, ',');
+    std::string item = end ? std::string(p, end) : std::string(p);
+    if (item == name || item == signal) return true;
+    if (!end) break;
+    p = end + 1;
+  }
+  return false;
+}
+
+int main(int argc, char **argv)
+{
+  const char *dbcPath = NULL;
+  const char *input = NULL;
+  const char *output = NULL;
+  const char *signals = NULL;
+  double rate = 100;
+  double gapMs = 0;
+  unsigned threads = 0;
+  bool bench = false;
+  size_t benchSignals = 200;
+  size_t benchSamples = 10000000;
+  ResampleOptions options;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) signals = argv[++i];
+    else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) rate = atof(argv[++i]);
+    else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) gapMs = atof(argv[++i]);
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+    else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+    else if (strcmp(argv[i], "-B") == 0) bench = true;
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) benchSignals = (size_t)strtoull(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc) benchSamples = (size_t)strtoull(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+    {
+      if (!resampleMethod(argv[++i], options.method))
+      {
+        usage();
+        return 2;
+      }
+    }
+    else if (argv[i][0] != '-' && !dbcPath) dbcPath = argv[i];
+    else if (argv[i][0] != '-' && !input) input = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  ThreadPool pool(threads);
+  if (bench)
+  {
+    if (benchSamples < 2)
+    {
+      usage();
+      return 2;
+    }
+    return benchmark(pool, benchSignals, benchSamples, options);
+  }
+  if (!dbcPath || !input || rate <= 0 || gapMs < 0)
+  {
+    usage();
+    return 2;
+  }
+  options.maxGapUs = (uint64_t)(gapMs * 1000);
+
+  DbcFile dbc;
+  std::string error;
+  if (!dbc.load(dbcPath, &error))
+  {
+    fprintf(stderr, "resample: %s: %s\n", dbcPath, error.c_str());
+    return 1;
+  }
+  const CanFrame *frames;
+  size_t count;
+  FrameFile bin;
+  MappedFile text;
+  std::vector<CanFrame> parsed;
+  if (bin.open(input))
+  {
+    frames = bin.frames();
+    count = bin.count();
+  }
+  else if (errno == EINVAL && text.open(input))
+  {
+    ParallelLogParser parser(pool);
+    parser.parse(text.data(), text.data() + text.size(), parsed);
+    text.close();
+    frames = parsed.data();
+    count = parsed.size();
+  }
+  else
+  {
+    fprintf(stderr, "resample: %s: %s\n", input, strerror(errno));
+    return 1;
+  }
+
+  SignalDecoder decoder(dbc);
+  std::vector<SignalColumn> columns;
+  decoder.decode(frames, count, columns);
+  std::vector<const SignalColumn *> chosen;
+  uint64_t firstUs = UINT64_MAX, lastUs = 0;
+  for (const SignalColumn &c : columns)
+  {
+    if (c.value.empty() || !selected(signals, c.name)) continue;
+    chosen.push_back(&c);
+    firstUs = c.timeUs.front() < firstUs ? c.timeUs.front() : firstUs;
+    lastUs = c.timeUs.back() > lastUs ? c.timeUs.back() : lastUs;
+  }
+  if (chosen.empty())
+  {
+    fprintf(stderr, "resample: no samples of the chosen signals\n");
+    return 1;
+  }
+
+  ResampleGrid grid;
+  grid.startUs = firstUs;
+  grid.stepUs = (uint64_t)(1e6 / rate) ? (uint64_t)(1e6 / rate) : 1;
+  grid.count = (size_t)((lastUs - firstUs) / grid.stepUs + 1);
+  std::vector<SignalSeries> series;
+  std::vector<std::vector<double>> aligned(chosen.size(), std::vector<double>(grid.count));
+  std::vector<double *> out;
+  for (size_t i = 0; i < chosen.size(); i++)
+  {
+    series.push_back({chosen[i]->timeUs.data(), chosen[i]->value.data(), chosen[i]->value.size()});
+    out.push_back(aligned[i].data());
+  }
+  double start = nowSeconds();
+  resampleAll(pool, series, grid, options, out.data());
+  double elapsed = nowSeconds() - start;
+  fprintf(stderr, "resample: %zu signals onto %zu points in %.3f s on %u threads\n", chosen.size(), grid.count, elapsed,
+          pool.threads());
+
+  if (output)
+  {
+    FILE *f = fopen(output, "w");
+    if (!f)
+    {
+      fprintf(stderr, "resample: %s: %s\n", output, strerror(errno));
+      return 1;
+    }
+    fprintf(f, "time_s");
+    for (const SignalColumn *c : chosen) fprintf(f, ",%s", c->name.c_str());
+    fprintf(f, "\n");
+    for (size_t k = 0; k < grid.count; k++)
+    {
+      fprintf(f, "%.6f", (grid.startUs + k * grid.stepUs) / 1e6);
+      for (size_t i = 0; i < chosen.size(); i++)
+      {
+        if (isnan(aligned[i][k])) fprintf(f, ",");
+        else fprintf(f, ",%.10g", aligned[i][k]);
+      }
+      fprintf(f, "\n");
+    }
+    if (fclose(f) != 0)
+    {
+      fprintf(stderr, "resample: %s: write error\n", output);
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+/*
+  ring_tap - Reader of the chain_rxd shared memory ring
+
+  Usage: ring_tap [-n /ring_name] [-a] [-o DATAxx.txt] [-q]
+
+  Attaches to the ring (see FrameRing.h) at its newest frame, or with -a
+  at the oldest one still in it, and writes the frames in the DATAxx.txt
+  format (to stdout without -o; -q only counts them) until the capture
+  ends or on Ctrl-C. Any number of taps run side by side; one that falls a
+  whole ring behind loses frames instead of slowing the capture, and the
+  frames it lost are reported on stderr.
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FrameRing.h"
+#include "LogWriter.h"
+
+/*Frames taken per read, and the wait when the ring has none*/
+#define TAP_BATCH    4096
+#define TAP_IDLE_NS  1000000
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int)
+{
+  stopRequested = 1;
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: ring_tap [-n /ring_name] [-a] [-o output.txt] [-q]\n");
+}
+
+int main(int argc, char **argv)
+{
+  const char *name = FRAME_RING_NAME;
+  const char *output = NULL;
+  bool oldest = false;
+  bool quiet = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) name = argv[++i];
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+    else if (strcmp(argv[i], "-a") == 0) oldest = true;
+    else if (strcmp(argv[i], "-q") == 0) quiet = true;
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  FrameRingReader ring;
+  if (!ring.open(name))
+  {
+    fprintf(stderr, "ring_tap: %s: %s\n", name, strerror(errno));
+    return 1;
+  }
+  if (oldest) ring.rewind();
+  FILE *out = output ? fopen(output, "wb") : stdout;
+  if (!out)
+  {
+    fprintf(stderr, "ring_tap: %s: %s\n", output, strerror(errno));
+    return 1;
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  LogWriter writer(out);
+  if (!quiet) writer.header();
+  std::vector<CanFrame> frames(TAP_BATCH);
+  uint64_t frameCount = 0;
+  while (!stopRequested)
+  {
+    size_t n = ring.read(frames.data(), frames.size());
+    if (n == 0)
+    {
+      if (ring.finished()) break;
+      if (!quiet) writer.flush();
+      struct timespec idle = {0, TAP_IDLE_NS};
+      nanosleep(&idle, NULL);
+      continue;
+    }
+    if (!quiet) writer.write(frames.data(), n);
+    frameCount += n;
+  }
+  writer.flush();
+  if (output) fclose(out);
+
+  fprintf(stderr, "ring_tap: %llu frames, %llu lost to overruns\n", (unsigned long long)frameCount,
+          (unsigned long long)ring.lost());
+  return 0;
+}
@@ -0,0 +1,125 @@
+/*
+  txt2bin - Converts a DATAxx.txt log into a packed frame file
+
+  Usage: txt2bin DATAxx.txt [-o DATAxx.bin] [-j threads]
+
+  Maps the log, parses it in chunks on -j threads (all hardware threads by
+  default, see ParallelLogParser.h) and writes the frames as a FrameFile
+  (see FrameFile.h); the output defaults to the input name with .bin in
+  place of its extension. Line counts and the parse rate go to stderr.
+  Replaces UI/txt2bin.vi for large captures.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+
+#include "FrameFile.h"
+#include "MappedFile.h"
+#include "ParallelLogParser.h"
+
+/*Text parsed and written per batch*/
+#define TXT2BIN_BATCH  (128UL << 20)
+
+static void usage()
+{
+  fprintf(stderr, "usage: txt2bin DATAxx.txt [-o output.bin] [-j threads]\n");
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string binName(const char *input)
+{
+  std::string name = input;
+  size_t dot = name.find_last_of('.');
+  size_t slash = name.find_last_of('/');
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) name.erase(dot);
+  return name + ".bin";
+}
+
+int main(int argc, char **argv)
+{
+  const char *input = NULL;
+  const char *output = NULL;
+  unsigned threads = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+    else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+    else if (argv[i][0] != '-' && !input) input = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!input)
+  {
+    usage();
+    return 2;
+  }
+  std::string outName = output ? output : binName(input);
+
+  MappedFile map;
+  if (!map.open(input))
+  {
+    fprintf(stderr, "txt2bin: %s: %s\n", input, strerror(errno));
+    return 1;
+  }
+  map.adviseSequential();
+  FrameFileWriter writer;
+  if (!writer.open(outName.c_str()))
+  {
+    fprintf(stderr, "txt2bin: %s: %s\n", outName.c_str(), strerror(errno));
+    return 1;
+  }
+
+  // batches end on a line boundary so the frame vector stays bounded
+  ThreadPool pool(threads);
+  ParallelLogParser parser(pool);
+  std::vector<CanFrame> frames;
+  double parseSeconds = 0;
+  double start = nowSeconds();
+  const char *p = map.data();
+  const char *end = p + map.size();
+  bool ok = true;
+  while (p < end && ok)
+  {
+    const char *stop = (size_t)(end - p) > TXT2BIN_BATCH ? p + TXT2BIN_BATCH : end;
+    if (stop < end)
+    {
+      const char *nl = (const char *)memchr(stop, '\n', (size_t)(end - stop));
+      stop = nl ? nl + 1 : end;
+    }
+    frames.clear();
+    double t = nowSeconds();
+    parser.parse(p, stop, frames);
+    parseSeconds += nowSeconds() - t;
+    ok = writer.write(frames.data(), frames.size());
+    p = stop;
+  }
+  if (!writer.close()) ok = false;
+  double elapsed = nowSeconds() - start;
+  if (!ok)
+  {
+    fprintf(stderr, "txt2bin: %s: write error\n", outName.c_str());
+    return 1;
+  }
+
+  const LogParseStats &s = parser.stats();
+  double mb = map.size() / 1e6;
+  fprintf(stderr, "txt2bin: %s: %llu lines, %llu frames, %llu skipped, %llu bad, %llu truncated; "
+                  "%.1f MB parsed at %.0f MB/s on %u threads, %.0f MB/s with output\n",
+          input, (unsigned long long)s.lines, (unsigned long long)s.frames, (unsigned long long)s.skipped,
+          (unsigned long long)s.badLines, (unsigned long long)s.truncated, mb,
+          parseSeconds > 0 ? mb / parseSeconds : 0.0, pool.threads(), elapsed > 0 ? mb / elapsed : 0.0);
+  return 0;
+}
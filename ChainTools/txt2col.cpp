@@ -0,0 +1,121 @@
+/*
+  txt2col - Builds the per-ID column store of a capture
+
+  Usage: txt2col DATAxx.txt|DATAxx.bin [-o DATAxx.col] [-j threads]
+
+  Takes a DATAxx.txt log (parsed on -j threads, see ParallelLogParser.h)
+  or a frame file from txt2bin, splits it by ID on the same threads (see
+  FrameDemux.h) and writes a column store (see ColumnStore.h); the output
+  defaults to the input name with .col in place of its extension. colq
+  reads it back.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+
+#include "ColumnStore.h"
+#include "FrameDemux.h"
+#include "FrameFile.h"
+#include "MappedFile.h"
+#include "ParallelLogParser.h"
+
+static void usage()
+{
+  fprintf(stderr, "usage: txt2col DATAxx.txt|DATAxx.bin [-o output.col] [-j threads]\n");
+}
+
+static double nowSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string colName(const char *input)
+{
+  std::string name = input;
+  size_t dot = name.find_last_of('.');
+  size_t slash = name.find_last_of('/');
+  if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) name.erase(dot);
+  return name + ".col";
+}
+
+int main(int argc, char **argv)
+{
+  const char *input = NULL;
+  const char *output = NULL;
+  unsigned threads = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) output = argv[++i];
+    else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+    else if (argv[i][0] != '-' && !input) input = argv[i];
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+  if (!input)
+  {
+    usage();
+    return 2;
+  }
+  std::string outName = output ? output : colName(input);
+
+  double start = nowSeconds();
+  const CanFrame *frames;
+  size_t count;
+  FrameFile bin;
+  MappedFile text;
+  std::vector<CanFrame> parsed;
+  ThreadPool pool(threads);
+  if (bin.open(input))
+  {
+    bin.map().adviseSequential();
+    frames = bin.frames();
+    count = bin.count();
+  }
+  else if (errno == EINVAL && text.open(input))
+  {
+    text.adviseSequential();
+    ParallelLogParser parser(pool);
+    parser.parse(text.data(), text.data() + text.size(), parsed);
+    text.close();
+    frames = parsed.data();
+    count = parsed.size();
+    const LogParseStats &s = parser.stats();
+    if (s.badLines) fprintf(stderr, "txt2col: %s: %llu bad lines skipped\n", input, (unsigned long long)s.badLines);
+  }
+  else
+  {
+    fprintf(stderr, "txt2col: %s: %s\n", input, strerror(errno));
+    return 1;
+  }
+  double read = nowSeconds();
+
+  FrameDemux demux(pool);
+  demux.split(frames, count);
+  double split = nowSeconds();
+  if (!writeColumnStore(outName.c_str(), demux, pool))
+  {
+    fprintf(stderr, "txt2col: %s: %s\n", outName.c_str(), strerror(errno));
+    return 1;
+  }
+  double written = nowSeconds();
+
+  ColumnStore store;
+  if (!store.open(outName.c_str()))
+  {
+    fprintf(stderr, "txt2col: %s: %s\n", outName.c_str(), strerror(errno));
+    return 1;
+  }
+  fprintf(stderr, "txt2col: %s: %zu frames of %zu IDs; read in %.3f s, split by ID in %.3f s, columns written in %.3f s "
+                  "on %u threads\n",
+          outName.c_str(), count, store.idCount(), read - start, split - read, written - split, pool.threads());
+  return 0;
+}